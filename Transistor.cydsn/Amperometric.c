@@ -15,6 +15,8 @@ Analog Devices Software License Agreement.
  
 *****************************************************************************/
 #include "Amperometric.h"
+#include "ad5941_seqcache.h"
+#include "ad5941_seqalloc.h"
 
 /* 
   Application configuration structure. Specified by user from template.
@@ -25,7 +27,7 @@ AppAMPCfg_Type AppAMPCfg =
 {
   .bParaChanged = bFALSE,
   .SeqStartAddr = 0,
-  .MaxSeqLen = 0,
+  .MaxSeqLen = 128,         /* Sequencer SRAM reserved for this application, in words */
   
   .SeqStartAddrCal = 0,
   .MaxSeqLenCal = 0,
@@ -50,6 +52,11 @@ AppAMPCfg_Type AppAMPCfg =
   .RtiaCalValue = 0,
 	.ExtRtiaVal = 0,
   
+/* Sensor multiplexing */
+  .ChanNum = 1,                 /* One sensor, always connected */
+  .ChanGpio = {0},
+  .ChanSettleTime = 50,         /* 50ms after switching sensor */
+  
 /*LPDAC Configure */
   .Vzero = 1100,                /* Sets voltage on SE0 and LPTIA */
   .SensorBias = 500,            /* Sets voltage between RE0 and SE0 */
@@ -75,6 +82,76 @@ AD5940Err AppAMPGetCfg(void *pCfg)
   return AD5940ERR_PARA;
 }
 
+/* Nominal value of internal RTIA in Ohm, indexed by LPTIARTIA_xxx */
+static const float AppAMPRtiaNominal[] = 
+{
+  0, 200, 1e3, 2e3, 3e3, 4e3, 6e3, 8e3, 10e3, 12e3, 16e3, 20e3, 24e3, 30e3, 32e3,
+  40e3, 48e3, 64e3, 85e3, 96e3, 100e3, 120e3, 128e3, 160e3, 196e3, 256e3, 512e3,
+};
+
+/* LPDAC codes for Vzero and SensorBias */
+static void AppAMPLpDacCode(uint16_t *pData6Bit, uint16_t *pData12Bit)
+{
+  *pData6Bit = (uint32_t)((AppAMPCfg.Vzero-200)/DAC6BITVOLT_1LSB);
+  *pData12Bit = (int32_t)((AppAMPCfg.SensorBias)/DAC12BITVOLT_1LSB) + *pData6Bit*64;
+  if(*pData12Bit>*pData6Bit*64)
+    (*pData12Bit)--;
+}
+
+/* Locate parameter dependent writes in initialization sequence. InitSeqInfo.pSeqCmd must be valid */
+static void AppAMPSeqSlotFind(void)
+{
+  AD5940_SEQSlotFind(&AppAMPCfg.InitSeqInfo, REG_AFE_LPDACDAT0, &AppAMPCfg.LpDacSlot);
+  AD5940_SEQSlotFind(&AppAMPCfg.InitSeqInfo, REG_AFE_LPTIACON0, &AppAMPCfg.LpTiaSlot);
+}
+
+/* Apply SensorBias, Vzero and LptiaRtiaSel to initialization sequence in SRAM and to registers.
+   All parameters are checked before anything is written, a rejected update leaves SRAM and registers unchanged */
+static AD5940Err AppAMPSeqPatch(void)
+{
+  AD5940Err error;
+  uint16_t Data6Bit, Data12Bit;
+  uint32_t RtiaOld = 0;
+  BoolFlag bRtiaChange = bFALSE;
+
+  if(AppAMPCfg.ExtRtia == bFALSE)  /* LptiaRtiaSel is not used with external RTIA */
+  {
+    RtiaOld = (AppAMPCfg.LpTiaSlot.Cmd&BITM_AFE_LPTIACON0_TIAGAIN)>>BITP_AFE_LPTIACON0_TIAGAIN;
+    if(RtiaOld != AppAMPCfg.LptiaRtiaSel)
+    {
+      if((AppAMPCfg.LpTiaSlot.Cmd&0x80000000) == 0)
+        return AD5940ERR_SEQREG;
+      if((RtiaOld == LPTIARTIA_OPEN) || (RtiaOld > LPTIARTIA_512K) ||\
+         (AppAMPCfg.LptiaRtiaSel == LPTIARTIA_OPEN) || (AppAMPCfg.LptiaRtiaSel > LPTIARTIA_512K))
+        return AD5940ERR_PARA;
+      bRtiaChange = bTRUE;
+    }
+  }
+  AppAMPLpDacCode(&Data6Bit, &Data12Bit);
+  error = AD5940_SEQSlotPatch(&AppAMPCfg.LpDacSlot, BITM_AFE_LPDACDAT0_DACIN6|BITM_AFE_LPDACDAT0_DACIN12,\
+                              ((uint32_t)Data6Bit<<BITP_AFE_LPDACDAT0_DACIN6)|Data12Bit, bTRUE);
+  if(error != AD5940ERR_OK) return error;
+  if(bRtiaChange == bFALSE)
+    return AD5940ERR_OK;
+  error = AD5940_SEQSlotPatch(&AppAMPCfg.LpTiaSlot, BITM_AFE_LPTIACON0_TIAGAIN,\
+                              AppAMPCfg.LptiaRtiaSel<<BITP_AFE_LPTIACON0_TIAGAIN, bTRUE);
+  if(error != AD5940ERR_OK) return error;
+  /* Scale calibration result by nominal values until new RTIA is calibrated on next AppAMPInit */
+  AppAMPCfg.RtiaCalValue.Magnitude *= AppAMPRtiaNominal[AppAMPCfg.LptiaRtiaSel]/AppAMPRtiaNominal[RtiaOld];
+  AppAMPCfg.ReDoRtiaCal = bTRUE;
+  return AD5940ERR_OK;
+}
+
+/* Ring of continuous acquisition started by AMPCTRL_STREAM, NULL if not streaming */
+static AppAMPStream_Type *pAppAMPStream = NULL;
+
+/* Data FIFO words read by one AD5940_FIFORdAsync in AppAMPStreamService */
+#define AMP_STREAM_CHUNK      32
+
+/* Raw FIFO words of the read in flight. One slot more than a chunk, the ring leaves one slot empty */
+static uint32_t AppAMPStreamWords[AMP_STREAM_CHUNK+1];
+static FIFORing_Type AppAMPStreamFifo;
+
 AD5940Err AppAMPCtrl(int32_t AmpCtrl, void *pPara)
 {
   switch (AmpCtrl)
@@ -89,14 +166,53 @@ AD5940Err AppAMPCtrl(int32_t AmpCtrl, void *pPara)
       /* Start it */
       wupt_cfg.WuptEn = bTRUE;
       wupt_cfg.WuptEndSeq = WUPTENDSEQ_A;
-      wupt_cfg.WuptOrder[0] = SEQID_0;
-      wupt_cfg.SeqxSleepTime[SEQID_0] = 4-1;
-      wupt_cfg.SeqxWakeupTime[SEQID_0] = (uint32_t)(AppAMPCfg.WuptClkFreq*AppAMPCfg.AmpODR)-4-1; 
+      wupt_cfg.WuptOrder[0] = AppAMPCfg.MeasureSeqInfo.SeqId;
+      wupt_cfg.SeqxSleepTime[AppAMPCfg.MeasureSeqInfo.SeqId] = 4-1;
+      wupt_cfg.SeqxWakeupTime[AppAMPCfg.MeasureSeqInfo.SeqId] = (uint32_t)(AppAMPCfg.WuptClkFreq*AppAMPCfg.AmpODR)-4-1; 
+      if(AD5940_WUPTCheck(&wupt_cfg, AppAMPCfg.MeasureSeqInfo.SeqId, AppAMPCfg.MeasSeqTime, AppAMPCfg.WuptClkFreq) != AD5940ERR_OK)
+        return AD5940ERR_PARA;  /* ODR is too high for measurement sequence */
       AD5940_WUPTCfg(&wupt_cfg);
       
       AppAMPCfg.FifoDataCount = 0;  /* restart */
+      pAppAMPStream = NULL;
       break;
     }
+    case AMPCTRL_STREAM:
+    {
+      AppAMPStream_Type *pStream = (AppAMPStream_Type *)pPara;
+      AD5940Err error;
+
+      if((pStream == NULL) || (pStream->pBuffer == NULL) || (pStream->Size < 2))
+        return AD5940ERR_PARA;
+      AD5940_ReadReg(REG_AFE_ADCDAT); /* Any SPI Operation can wakeup AFE */
+      if(AppAMPCfg.AMPInited == bFALSE)
+        return AD5940ERR_APPERROR;
+      /* Drop samples left from last run so Index and Chan start from the first sensor */
+      AD5940_FIFOCtrlS(AppAMPCfg.DataFifoSrc, bFALSE);
+      AD5940_FIFOCtrlS(AppAMPCfg.DataFifoSrc, bTRUE);
+      AD5940_INTCCfg(AFEINTC_1, AFEINTSRC_DATAFIFOOF, bTRUE);
+      AD5940_INTCClrFlag(AFEINTSRC_DATAFIFOTHRESH|AFEINTSRC_DATAFIFOOF);
+      AppAMPCfg.StopRequired = bFALSE;
+      error = AppAMPCtrl(AMPCTRL_START, NULL);
+      if(error != AD5940ERR_OK)
+        return error;
+      pStream->WrIdx = 0;
+      pStream->RdIdx = 0;
+      pStream->Dropped = 0;
+      pStream->FifoOverflow = 0;
+      pStream->NextIndex = 0;
+      pStream->TickPeriod = (uint32_t)(AppAMPCfg.WuptClkFreq*AppAMPCfg.AmpODR);
+      AD5940_FIFORingInit(&AppAMPStreamFifo, AppAMPStreamWords, AMP_STREAM_CHUNK+1);
+      pAppAMPStream = pStream;
+      break;
+    }
+    case AMPCTRL_PARAUPDATE:
+    {
+      AD5940_ReadReg(REG_AFE_ADCDAT); /* Any SPI Operation can wakeup AFE */
+      if(AppAMPCfg.AMPInited == bFALSE)
+        return AD5940ERR_APPERROR;
+      return AppAMPSeqPatch();  /* Takes effect now, sequences stay in SRAM */
+    }
     case AMPCTRL_STOPNOW:
     {
       AD5940_ReadReg(REG_AFE_ADCDAT); /* Any SPI Operation can wakeup AFE */
@@ -170,10 +286,7 @@ static AD5940Err AppAMPSeqCfgGen(void)
   lp_loop.LpDacCfg.LpDacRef = LPDACREF_2P5;
   lp_loop.LpDacCfg.DataRst = bFALSE;
   lp_loop.LpDacCfg.PowerEn = bTRUE;
-  lp_loop.LpDacCfg.DacData6Bit = (uint32_t)((AppAMPCfg.Vzero-200)/DAC6BITVOLT_1LSB);
-	lp_loop.LpDacCfg.DacData12Bit =(int32_t)((AppAMPCfg.SensorBias)/DAC12BITVOLT_1LSB) + lp_loop.LpDacCfg.DacData6Bit*64;
-	if(lp_loop.LpDacCfg.DacData12Bit>lp_loop.LpDacCfg.DacData6Bit*64)
-		lp_loop.LpDacCfg.DacData12Bit--;
+  AppAMPLpDacCode(&lp_loop.LpDacCfg.DacData6Bit, &lp_loop.LpDacCfg.DacData12Bit);
 	lp_loop.LpAmpCfg.LpAmpSel = LPAMP0;
   lp_loop.LpAmpCfg.LpAmpPwrMod = LPAMPPWR_NORM;
   lp_loop.LpAmpCfg.LpPaPwrEn = bTRUE;
@@ -228,12 +341,14 @@ static AD5940Err AppAMPSeqCfgGen(void)
   AD5940_SEQGenCtrl(bFALSE); /* Stop sequencer generator */
   if(error == AD5940ERR_OK)
   {
-    AppAMPCfg.InitSeqInfo.SeqId = SEQID_1;
+    if(SeqLen > AppAMPCfg.MaxSeqLen)
+      return AD5940ERR_SEQLEN;  /* Doesn't fit in SRAM reserved for this application */
     AppAMPCfg.InitSeqInfo.SeqRamAddr = AppAMPCfg.SeqStartAddr;
     AppAMPCfg.InitSeqInfo.pSeqCmd = pSeqCmd;
     AppAMPCfg.InitSeqInfo.SeqLen = SeqLen;
     /* Write command to SRAM */
     AD5940_SEQCmdWrite(AppAMPCfg.InitSeqInfo.SeqRamAddr, pSeqCmd, SeqLen);
+    AppAMPSeqSlotFind();  /* pSeqCmd is reused by next sequence */
   }
   else
     return error; /* Error */
@@ -246,7 +361,7 @@ static AD5940Err AppAMPSeqMeasureGen(void)
   uint32_t const *pSeqCmd;
   uint32_t SeqLen;
 
-  uint32_t WaitClks;
+  uint32_t WaitClks, i;
   ClksCalInfo_Type clks_cal;
   
   clks_cal.DataType = DATATYPE_SINC2;
@@ -258,12 +373,21 @@ static AD5940Err AppAMPSeqMeasureGen(void)
   AD5940_ClksCalculate(&clks_cal, &WaitClks);
 	WaitClks += 15;
   AD5940_SEQGenCtrl(bTRUE);
-  AD5940_SEQGpioCtrlS(AGPIO_Pin2);
-  AD5940_AFECtrlS(AFECTRL_ADCPWR|AFECTRL_SINC2NOTCH, bTRUE);
-  AD5940_SEQGenInsert(SEQ_WAIT(16*250));    /* wait 250us */
-  AD5940_AFECtrlS(AFECTRL_ADCCNV, bTRUE);   /* Start ADC convert*/
-  AD5940_SEQGenInsert(SEQ_WAIT(WaitClks));  /* wait for first data ready */
-  AD5940_AFECtrlS(AFECTRL_ADCPWR|AFECTRL_ADCCNV|AFECTRL_SINC2NOTCH, bFALSE);  /* Stop ADC */
+  for(i=0;i<AppAMPCfg.ChanNum;i++)
+  {
+    if(AppAMPCfg.ChanNum > 1)
+    {
+      AD5940_SEQGpioCtrlS(AGPIO_Pin2|AppAMPCfg.ChanGpio[i]);  /* Switch to next sensor */
+      AD5940_SEQGenInsert(SEQ_WAIT((uint32_t)(AppAMPCfg.SysClkFreq*AppAMPCfg.ChanSettleTime/1000)));
+    }
+    else
+      AD5940_SEQGpioCtrlS(AGPIO_Pin2);
+    AD5940_AFECtrlS(AFECTRL_ADCPWR|AFECTRL_SINC2NOTCH, bTRUE);
+    AD5940_SEQGenInsert(SEQ_WAIT(16*250));    /* wait 250us */
+    AD5940_AFECtrlS(AFECTRL_ADCCNV, bTRUE);   /* Start ADC convert*/
+    AD5940_SEQGenInsert(SEQ_WAIT(WaitClks));  /* wait for first data ready */
+    AD5940_AFECtrlS(AFECTRL_ADCPWR|AFECTRL_ADCCNV|AFECTRL_SINC2NOTCH, bFALSE);  /* Stop ADC */
+  }
   AD5940_SEQGpioCtrlS(0);
   AD5940_EnterSleepS();/* Goto hibernate */
   /* Sequence end. */
@@ -272,7 +396,8 @@ static AD5940Err AppAMPSeqMeasureGen(void)
 
   if(error == AD5940ERR_OK)
   {
-    AppAMPCfg.MeasureSeqInfo.SeqId = SEQID_0;
+    if(AppAMPCfg.InitSeqInfo.SeqLen + SeqLen > AppAMPCfg.MaxSeqLen)
+      return AD5940ERR_SEQLEN;
     AppAMPCfg.MeasureSeqInfo.SeqRamAddr = AppAMPCfg.InitSeqInfo.SeqRamAddr + AppAMPCfg.InitSeqInfo.SeqLen ;
     AppAMPCfg.MeasureSeqInfo.pSeqCmd = pSeqCmd;
     AppAMPCfg.MeasureSeqInfo.SeqLen = SeqLen;
@@ -307,18 +432,97 @@ fImpPol_Type RtiaCalValue;  /* Calibration result */
  
   return AD5940ERR_OK;
 }
+/* Reserve sequencer SRAM and SEQIDs. Sequences of the other application stay in SRAM. */
+static AD5940Err AppAMPSeqAlloc(void)
+{
+  uint32_t addr, seq_id[2];
+
+  if((AD5940_SEQAllocRegion(AD5940_SEQALLOC_AMP, AppAMPCfg.MaxSeqLen, &addr) != 0) ||\
+     (AD5940_SEQAllocId(AD5940_SEQALLOC_AMP, 2, seq_id) != 0))
+    return AD5940ERR_SEQLEN;
+  if((addr != AppAMPCfg.SeqStartAddr) || (seq_id[0] != AppAMPCfg.MeasureSeqInfo.SeqId) ||\
+     (seq_id[1] != AppAMPCfg.InitSeqInfo.SeqId))
+    AppAMPCfg.bParaChanged = bTRUE;  /* Sequences are moved, load them again */
+  AppAMPCfg.SeqStartAddr = addr;
+  AppAMPCfg.MeasureSeqInfo.SeqId = seq_id[0];
+  AppAMPCfg.InitSeqInfo.SeqId = seq_id[1];
+  return AD5940ERR_OK;
+}
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+#define AMP_SEQKEY(key, field)  AD5940_SEQCacheHash(key, &AppAMPCfg.field, sizeof(AppAMPCfg.field))
+/* Sequence cache key. Add every parameter used by AppAMPSeqCfgGen/AppAMPSeqMeasureGen here. */
+static uint32_t AppAMPSeqKey(uint32_t key)
+{
+
+  key = AMP_SEQKEY(key, SeqStartAddr);
+  key = AMP_SEQKEY(key, InitSeqInfo.SeqId);
+  key = AMP_SEQKEY(key, MeasureSeqInfo.SeqId);
+  key = AMP_SEQKEY(key, SysClkFreq);
+  key = AMP_SEQKEY(key, AdcClkFreq);
+  key = AMP_SEQKEY(key, ADCPgaGain);
+  key = AMP_SEQKEY(key, ADCSinc3Osr);
+  key = AMP_SEQKEY(key, ADCSinc2Osr);
+  key = AMP_SEQKEY(key, LptiaRtiaSel);
+  key = AMP_SEQKEY(key, LpTiaRf);
+  key = AMP_SEQKEY(key, LpTiaRl);
+  key = AMP_SEQKEY(key, Vzero);
+  key = AMP_SEQKEY(key, SensorBias);
+  key = AMP_SEQKEY(key, ExtRtia);
+  if(AppAMPCfg.ChanNum > 1)   /* Keys of single sensor sequences are not changed */
+  {
+    key = AMP_SEQKEY(key, ChanNum);
+    key = AMP_SEQKEY(key, ChanGpio);
+    key = AMP_SEQKEY(key, ChanSettleTime);
+  }
+  return key;
+}
+#endif
+
+/* Let sequencer drive the sensor select pins */
+static void AppAMPChanGpioCfg(void)
+{
+  uint32_t pins = 0, func, i;
+
+  for(i=0;i<AppAMPCfg.ChanNum;i++)
+    pins |= AppAMPCfg.ChanGpio[i];
+  func = AD5940_ReadReg(REG_AGPIO_GP0CON);
+  for(i=0;i<8;i++)
+  {
+    if(pins & (1L<<i))
+      func = (func&~(3L<<(i*2)))|((uint32_t)GP0_SYNC<<(i*2));
+  }
+  AD5940_AGPIOFuncCfg(func);
+  AD5940_AGPIOOen(AD5940_ReadReg(REG_AGPIO_GP0OEN)|pins);
+}
+
 /* This function provide application initialize.   */
 AD5940Err AppAMPInit(uint32_t *pBuffer, uint32_t BufferSize)
 {
   AD5940Err error = AD5940ERR_OK;
   SEQCfg_Type seq_cfg;
   FIFOCfg_Type fifo_cfg;
-
+  SEQAnalyzeCfg_Type ana_cfg;
+  SEQAnalyzeResult_Type ana_res;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+  SEQInfo_Type * const seq_info[] = {&AppAMPCfg.InitSeqInfo, &AppAMPCfg.MeasureSeqInfo};
+#endif
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+  uint32_t seq_key;
+#endif
+
+  if((AppAMPCfg.ChanNum == 0) || (AppAMPCfg.ChanNum > AMP_CHAN_MAX))
+    return AD5940ERR_PARA;
+  if((AppAMPCfg.ChanNum > 1) && (AppAMPCfg.DataFifoSrc != FIFOSRC_SINC2NOTCH))
+    return AD5940ERR_PARA;    /* Only SINC2 gives exactly one sample per sensor */
   if(AD5940_WakeUp(10) > 10)  /* Wakeup AFE by read register, read 10 times at most */
     return AD5940ERR_WAKEUP;  /* Wakeup Failed */
 
+  error = AppAMPSeqAlloc();
+  if(error != AD5940ERR_OK) return error;
+
   /* Configure sequencer and stop it */
-  seq_cfg.SeqMemSize = SEQMEMSIZE_2KB;  /* 2kB SRAM is used for sequencer, others for data FIFO */
+  seq_cfg.SeqMemSize = AD5940_SEQAllocMemSize();  /* Sequencer partition holds sequences of all applications, others for data FIFO */
   seq_cfg.SeqBreakEn = bFALSE;
   seq_cfg.SeqIgnoreEn = bFALSE;
   seq_cfg.SeqCntCRCClr = bTRUE;
@@ -332,16 +536,22 @@ AD5940Err AppAMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   {
     AppAMPRtiaCal();
     AppAMPCfg.ReDoRtiaCal = bFALSE;
-  }else
-		AppAMPCfg.RtiaCalValue.Magnitude = AppAMPCfg.ExtRtiaVal;
+  }else if(AppAMPCfg.ExtRtia == bTRUE)
+		AppAMPCfg.RtiaCalValue.Magnitude = AppAMPCfg.ExtRtiaVal;  /* Keep calibration result of internal RTIA on re-initialization */
   
 	/* Reconfigure FIFO */
   AD5940_FIFOCtrlS(DFTSRC_SINC3, bFALSE);									/* Disable FIFO firstly */
   fifo_cfg.FIFOEn = bTRUE;
   fifo_cfg.FIFOMode = FIFOMODE_FIFO;
-  fifo_cfg.FIFOSize = FIFOSIZE_4KB;                       /* 4kB for FIFO, The reset 2kB for sequencer */
+  fifo_cfg.FIFOSize = AD5940_SEQAllocFifoSize();          /* The rest of SRAM for FIFO */
   fifo_cfg.FIFOSrc = AppAMPCfg.DataFifoSrc;
   fifo_cfg.FIFOThresh = AppAMPCfg.FifoThresh;              
+  if(AppAMPCfg.ChanNum > 1)
+  {
+    /* Interrupt on whole measurement cycles */
+    fifo_cfg.FIFOThresh = (AppAMPCfg.FifoThresh+AppAMPCfg.ChanNum-1)/AppAMPCfg.ChanNum*AppAMPCfg.ChanNum;
+    AppAMPChanGpioCfg();
+  }
   AD5940_FIFOCfg(&fifo_cfg);
 
   AD5940_INTCClrFlag(AFEINTSRC_ALLINT);
@@ -351,17 +561,51 @@ AD5940Err AppAMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   if((AppAMPCfg.AMPInited == bFALSE)||\
        (AppAMPCfg.bParaChanged == bTRUE))
   {
-    if(pBuffer == 0)  return AD5940ERR_PARA;
-    if(BufferSize == 0) return AD5940ERR_PARA;   
-    AD5940_SEQGenInit(pBuffer, BufferSize);
-
-    /* Generate initialize sequence */
-    error = AppAMPSeqCfgGen(); /* Application initialization sequence using either MCU or sequencer */
-    if(error != AD5940ERR_OK) return error;
+    /* Load sequences generated offline or saved with the same parameters to SRAM, otherwise generate them */
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+    seq_key = AppAMPSeqKey(AD5940_SEQCacheKeyInit());
+#endif
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+    if(AD5940_SEQRomLoad(AD5940_SEQCACHE_SLOT_AMP, AppAMPSeqKey(AD5940_SEQ_ROM_KEY_BASIS), seq_info, 2) == 0)
+      AppAMPSeqSlotFind();  /* Slots are found by AppAMPSeqCfgGen otherwise */
+    else
+#endif
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+    if(AD5940_SEQCacheLoad(AD5940_SEQCACHE_SLOT_AMP, seq_key, seq_info, 2) == 0)
+      AppAMPSeqSlotFind();
+    else
+#endif
+    {
+      if(pBuffer == 0)  return AD5940ERR_PARA;
+      if(BufferSize == 0) return AD5940ERR_PARA;   
+      AD5940_SEQGenInit(pBuffer, BufferSize);
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheBegin(AD5940_SEQCACHE_SLOT_AMP);
+#endif
+
+      /* Generate initialize sequence */
+      error = AppAMPSeqCfgGen(); /* Application initialization sequence using either MCU or sequencer */
+      if(error != AD5940ERR_OK) return error;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheAdd(AD5940_SEQCACHE_SLOT_AMP, seq_info[0]);  /* Save it now, the buffer is reused by next sequence */
+#endif
+
+      /* Generate measurement sequence */
+      error = AppAMPSeqMeasureGen();
+      if(error != AD5940ERR_OK) return error;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheAdd(AD5940_SEQCACHE_SLOT_AMP, seq_info[1]);
+      AD5940_SEQCacheCommit(AD5940_SEQCACHE_SLOT_AMP, seq_key);
+#endif
+    }
 
-    /* Generate measurement sequence */
-    error = AppAMPSeqMeasureGen();
+    /* Measurement sequence duration, the wakeup period must be longer */
+    AD5940_StructInit(&ana_cfg, sizeof(ana_cfg));
+    ana_cfg.SysClkFreq = AppAMPCfg.SysClkFreq;
+    ana_cfg.AfeconInit = REG_AFE_AFECON_RESET;
+    error = AD5940_SEQAnalyze(AppAMPCfg.MeasureSeqInfo.pSeqCmd, AppAMPCfg.MeasureSeqInfo.SeqLen, &ana_cfg, &ana_res);
     if(error != AD5940ERR_OK) return error;
+    AppAMPCfg.MeasSeqTime = ana_res.Duration;
 
     AppAMPCfg.bParaChanged = bFALSE; /* Clear this flag as we already implemented the new configuration */
   }
@@ -372,6 +616,14 @@ AD5940Err AppAMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   AD5940_SEQCfg(&seq_cfg);  /* Enable sequencer */
   AD5940_SEQMmrTrig(AppAMPCfg.InitSeqInfo.SeqId);
   while(AD5940_INTCTestFlag(AFEINTC_1, AFEINTSRC_ENDSEQ) == bFALSE);
+  if(AD5940_SEQVerify(&AppAMPCfg.InitSeqInfo) == bFALSE)
+  {
+    /* SRAM was lost(AFE reset without notice) and is restored now, run it again */
+    AD5940_INTCClrFlag(AFEINTSRC_ENDSEQ);
+    AD5940_SEQCfg(&seq_cfg);
+    AD5940_SEQMmrTrig(AppAMPCfg.InitSeqInfo.SeqId);
+    while(AD5940_INTCTestFlag(AFEINTC_1, AFEINTSRC_ENDSEQ) == bFALSE);
+  }
   
   /* Measurement sequence  */
   AppAMPCfg.MeasureSeqInfo.WriteSRAM = bFALSE;
@@ -408,17 +660,78 @@ static AD5940Err AppAMPRegModify(int32_t * const pData, uint32_t *pDataCount)
   return AD5940ERR_OK;
 }
 
+/* ADC code to voltage/current scale, only changes with PGA gain, reference voltage and RTIA calibration */
+static struct
+{
+  uint32_t PgaGain;             /* Configuration the scale was calculated for */
+  uint32_t RefVoltBits;         /* Float bits, compared as integer so checking costs no soft-float call */
+  uint32_t RtiaMagBits;
+  float VoltScale;              /* Volt per LSB of (code-32768) */
+  float CurScale;               /* uA per LSB of (32768-code) */
+  int32_t CurMant;              /* pA per LSB of (32768-code) is CurMant*2^-CurShift, 32768<=CurMant<65536 */
+  int32_t CurShift;
+  BoolFlag bValid;
+}AppAMPScale;
+
+static uint32_t AppAMPFloatBits(float Value)
+{
+  uint32_t Bits;
+  memcpy(&Bits, &Value, sizeof(Bits));
+  return Bits;
+}
+
+/* Recalculate the scale if PGA gain, reference voltage or RTIA changed. Cheap when nothing changed. */
+static void AppAMPScaleUpdate(void)
+{
+  static const float PgaGainTable[] = {1.0f, 1.5f, 2.0f, 4.0f, 9.0f};  /* Indexed by ADCPGA_x */
+  float kFactor = 1.835/1.82;
+  float fScale;
+  int Exp;
+
+  if((AppAMPScale.bValid == bTRUE) && (AppAMPScale.PgaGain == AppAMPCfg.ADCPgaGain) &&
+     (AppAMPScale.RefVoltBits == AppAMPFloatBits(AppAMPCfg.ADCRefVolt)) &&
+     (AppAMPScale.RtiaMagBits == AppAMPFloatBits(AppAMPCfg.RtiaCalValue.Magnitude)))
+    return;
+  AppAMPScale.PgaGain = AppAMPCfg.ADCPgaGain;
+  AppAMPScale.RefVoltBits = AppAMPFloatBits(AppAMPCfg.ADCRefVolt);
+  AppAMPScale.RtiaMagBits = AppAMPFloatBits(AppAMPCfg.RtiaCalValue.Magnitude);
+  AppAMPScale.bValid = bTRUE;
+
+  if(AppAMPCfg.ADCPgaGain > ADCPGA_9)
+    AppAMPScale.VoltScale = 0;  /* Unknown gain gives 0, same as before */
+  else
+    AppAMPScale.VoltScale = AppAMPCfg.ADCRefVolt/PgaGainTable[AppAMPCfg.ADCPgaGain]*kFactor/32768;
+  /* RTIA is not calibrated yet. Report 0 rather than Inf/NaN */
+  if(AppAMPCfg.RtiaCalValue.Magnitude == 0)
+    AppAMPScale.CurScale = 0;
+  else
+    AppAMPScale.CurScale = AppAMPScale.VoltScale/AppAMPCfg.RtiaCalValue.Magnitude*1000000;
+
+  /* Fixed point: pA/LSB = f*2^Exp with 0.5<=f<1, keep f as unsigned Q16 */
+  fScale = frexpf(AppAMPScale.CurScale*1000000, &Exp);
+  AppAMPScale.CurMant = (int32_t)(fScale*65536 + 0.5f);
+  AppAMPScale.CurShift = 16 - Exp;
+  if(AppAMPScale.CurMant == 65536)
+  {
+    AppAMPScale.CurMant = 32768;
+    AppAMPScale.CurShift--;
+  }
+  if(AppAMPScale.CurMant == 0)
+    AppAMPScale.CurShift = 0;
+}
+
 /* Depending on the data type, do appropriate data pre-process before return back to controller */
 static AD5940Err AppAMPDataProcess(int32_t * const pData, uint32_t *pDataCount)
 {
   uint32_t i, datacount;
   datacount = *pDataCount;
   float *pOut = (float *)pData;
+  float Scale;
+
+  AppAMPScaleUpdate();   /* Once per block, not per sample */
+  Scale = AppAMPScale.CurScale;
   for(i=0;i<datacount;i++)
-  {
-    pData[i] &= 0xffff;
-    pOut[i] = AppAMPCalcCurrent(pData[i]);
-  }
+    pOut[i] = (float)(32768 - (pData[i]&0xffff))*Scale;
   return AD5940ERR_OK;
 }
 
@@ -436,6 +749,7 @@ AD5940Err AppAMPISR(void *pBuff, uint32_t *pCount)
   if(AD5940_INTCTestFlag(AFEINTC_0, AFEINTSRC_DATAFIFOTHRESH) == bTRUE)
   {
     FifoCnt = AD5940_FIFOGetCnt();
+    FifoCnt -= FifoCnt%AppAMPCfg.ChanNum;  /* Leave incomplete cycle in FIFO, so pBuff starts from first sensor */
     AD5940_FIFORd((uint32_t *)pBuff, FifoCnt);
     AD5940_INTCClrFlag(AFEINTSRC_DATAFIFOTHRESH);
     AppAMPRegModify(pBuff, &FifoCnt);   /* If there is need to do AFE re-configure, do it here when AFE is in active state */
@@ -451,39 +765,183 @@ AD5940Err AppAMPISR(void *pBuff, uint32_t *pCount)
   return 0;
 } 
 
+/* Keep compiler from moving sample stores after the index that publishes them */
+#if defined(__GNUC__)
+#define AMP_STREAM_BARRIER()  __asm volatile("" ::: "memory")
+#else
+#define AMP_STREAM_BARRIER()
+#endif
+
+/**
+  @brief Initialize the ring for continuous acquisition. Pass it to AppAMPCtrl(AMPCTRL_STREAM, pStream).
+  @param pStream: The ring.
+  @param pBuffer: Sample storage.
+  @param Size: Number of samples in pBuffer, holds at most Size-1 samples.
+  @return none.
+*/
+void AppAMPStreamInit(AppAMPStream_Type *pStream, AppAMPSample_Type *pBuffer, uint32_t Size)
+{
+  memset(pStream, 0, sizeof(*pStream));
+  pStream->pBuffer = pBuffer;
+  pStream->Size = Size;
+}
+
+/**
+  @brief Completion callback of AD5940_FIFORdAsync started by AppAMPStreamService. Converts the words to current
+         and publishes the samples. Runs from interrupt context on DMA platforms, so it does no SPI access.
+  @return none.
+*/
+static void AppAMPStreamPublish(void)
+{
+  AppAMPStream_Type *pStream = pAppAMPStream;
+  AppAMPSample_Type *pSample;
+  uint32_t Data[AMP_STREAM_CHUNK];
+  uint32_t n, i, wr, next;
+
+  n = AD5940_FIFORingPop(&AppAMPStreamFifo, Data, AMP_STREAM_CHUNK);
+  if(pStream == NULL)
+    return;
+  AppAMPCalcCurrentBatch(Data, (int32_t *)Data, n);
+  wr = pStream->WrIdx;
+  for(i=0;i<n;i++)
+  {
+    next = (wr + 1)%pStream->Size;
+    if(next == pStream->RdIdx)
+      pStream->Dropped++;
+    else
+    {
+      pSample = &pStream->pBuffer[wr];
+      pSample->Index = pStream->NextIndex;
+      pSample->Chan = pStream->NextIndex%AppAMPCfg.ChanNum;
+      pSample->Tick = pStream->NextIndex/AppAMPCfg.ChanNum*pStream->TickPeriod;
+      pSample->Current = (int32_t)Data[i];
+      wr = next;
+    }
+    pStream->NextIndex++;
+  }
+  AMP_STREAM_BARRIER();
+  pStream->WrIdx = wr;      /* Publish this burst */
+}
+
+/**
+  @brief Producer of continuous acquisition: move every sample in data FIFO to the ring given by AMPCTRL_STREAM.
+         Call it when MCU interrupt flag is set (DATAFIFOTHRESH), not from the interrupt itself because it uses SPI.
+         Only whole measurement cycles are taken from FIFO, like AppAMPISR.
+         FIFO is drained by AD5940_FIFORdAsync in chunks and each chunk is converted and published by its completion
+         callback. On DMA platforms the CPU sleeps or serves other interrupts while a chunk is moving. Wakeup timer
+         handling and sleep key stay here because they use blocking SPI.
+  @return AD5940ERR_OK, AD5940ERR_APPERROR if not streaming, AD5940ERR_WAKEUP if AFE does not respond.
+*/
+AD5940Err AppAMPStreamService(void)
+{
+  AppAMPStream_Type *pStream = pAppAMPStream;
+  uint32_t FifoCnt, DataCount, n;
+
+  if(pStream == NULL)
+    return AD5940ERR_APPERROR;
+  if(AD5940_WakeUp(10) > 10)  /* Wakeup AFE by read register, read 10 times at most */
+    return AD5940ERR_WAKEUP;  /* Wakeup Failed */
+  AD5940_SleepKeyCtrlS(SLPKEY_LOCK);
+
+  if(AD5940_INTCTestFlag(AFEINTC_1, AFEINTSRC_DATAFIFOOF) == bTRUE)
+    pStream->FifoOverflow++;
+  /* Clear before reading count, data coming after this sets the flag again */
+  AD5940_INTCClrFlag(AFEINTSRC_DATAFIFOTHRESH|AFEINTSRC_DATAFIFOOF);
+  FifoCnt = AD5940_FIFOGetCnt();
+  FifoCnt -= FifoCnt%AppAMPCfg.ChanNum;
+  DataCount = FifoCnt;
+  while(FifoCnt > 0)
+  {
+    n = (FifoCnt > AMP_STREAM_CHUNK)?AMP_STREAM_CHUNK:FifoCnt;
+    if(AD5940_FIFORdAsync(&AppAMPStreamFifo, n, AppAMPStreamPublish) != AD5940ERR_OK)
+      break;  /* Words left stay in FIFO for next call */
+    AD5940_FIFORdAsyncWait();
+    FifoCnt -= n;
+  }
+  DataCount -= FifoCnt;
+  AppAMPRegModify(NULL, &DataCount);
+  AD5940_SleepKeyCtrlS(SLPKEY_UNLOCK);
+  return AD5940ERR_OK;
+}
+
+/**
+  @brief Consumer of continuous acquisition: take samples out of the ring.
+  @param pStream: The ring given to AMPCTRL_STREAM.
+  @param pSample: Buffer to store samples.
+  @param MaxCount: Size of pSample in samples.
+  @return Number of samples copied.
+*/
+uint32_t AppAMPStreamRead(AppAMPStream_Type *pStream, AppAMPSample_Type *pSample, uint32_t MaxCount)
+{
+  uint32_t wr = pStream->WrIdx;
+  uint32_t rd = pStream->RdIdx;
+  uint32_t count = 0;
+
+  AMP_STREAM_BARRIER();   /* Read samples only after the index that published them */
+  while((rd != wr) && (count < MaxCount))
+  {
+    pSample[count++] = pStream->pBuffer[rd];
+    rd = (rd + 1)%pStream->Size;
+  }
+  AMP_STREAM_BARRIER();
+  pStream->RdIdx = rd;
+  return count;
+}
+
 /* Calculate voltage */
 float AppAMPCalcVoltage(uint32_t ADCcode)
 {
-  float kFactor = 1.835/1.82;
-  float fVolt = 0.0;
-  int32_t tmp = 0;
-  tmp = ADCcode - 32768;
-  switch(AppAMPCfg.ADCPgaGain)
-  {
-    case ADCPGA_1:
-      fVolt = ((float)(tmp)/32768)*(AppAMPCfg.ADCRefVolt/1)*kFactor;
-      break;
-    case ADCPGA_1P5:
-      fVolt = ((float)(tmp)/32768)*(AppAMPCfg.ADCRefVolt/1.5f)*kFactor;
-      break;
-    case ADCPGA_2:
-      fVolt = ((float)(tmp)/32768)*(AppAMPCfg.ADCRefVolt/2)*kFactor;
-      break;
-    case ADCPGA_4:
-      fVolt = ((float)(tmp)/32768)*(AppAMPCfg.ADCRefVolt/4)*kFactor;
-      break;
-    case ADCPGA_9:
-      fVolt = ((float)(tmp)/32768)*(AppAMPCfg.ADCRefVolt/9)*kFactor;
-      break;
-  } 
-  return fVolt;
+  AppAMPScaleUpdate();
+  return (float)((int32_t)ADCcode - 32768)*AppAMPScale.VoltScale;
 }
 /* Calculate current in uA */
 float AppAMPCalcCurrent(uint32_t ADCcode)
 {
-  float fCurrent, fVoltage = 0.0;
-  fVoltage = AppAMPCalcVoltage(ADCcode);
-  fCurrent = fVoltage/AppAMPCfg.RtiaCalValue.Magnitude;
-  
-  return -fCurrent*1000000;
+  AppAMPScaleUpdate();
+  return (float)(32768 - (int32_t)ADCcode)*AppAMPScale.CurScale;
+}
+
+/**
+  @brief Convert a block of ADC data to current with integer multiply and shift only, no float per sample.
+         Scale is calculated once when PGA gain, reference voltage or RTIA calibration changes.
+         Error against AppAMPCalcCurrent is below 2^-16 of the result plus 0.5pA rounding, less than half an ADC
+         LSB. Result saturates at +/-2147uA.
+  @param pData: FIFO data, only low 16 bits (ADC code) are used.
+  @param pCurrent: Current in pA. Can be the same buffer as pData.
+  @param DataCount: Number of data.
+  @return none.
+*/
+void AppAMPCalcCurrentBatch(const uint32_t *pData, int32_t *pCurrent, uint32_t DataCount)
+{
+  int32_t Mant, Shift, Diff;
+  int64_t Wide;
+  uint32_t i;
+
+  AppAMPScaleUpdate();
+  Mant = AppAMPScale.CurMant;
+  Shift = AppAMPScale.CurShift;
+  if(Shift > 0)
+  {
+    /* |Diff|<=32768 and Mant<65536, product fits in int32. Round by shifting one bit less first */
+    Shift--;
+    for(i=0;i<DataCount;i++)
+    {
+      Diff = 32768 - (int32_t)(pData[i]&0xffff);
+      pCurrent[i] = ((Diff*Mant>>Shift) + 1)>>1;
+    }
+  }
+  else
+  {
+    /* 32768pA per LSB or more, only with very small RTIA. Saturate to int32 */
+    for(i=0;i<DataCount;i++)
+    {
+      Diff = 32768 - (int32_t)(pData[i]&0xffff);
+      Wide = ((int64_t)Diff*Mant)<<(-Shift);
+      if(Wide > INT32_MAX)
+        Wide = INT32_MAX;
+      else if(Wide < INT32_MIN)
+        Wide = INT32_MIN;
+      pCurrent[i] = (int32_t)Wide;
+    }
+  }
 }
@@ -16,13 +16,14 @@ Analog Devices Software License Agreement.
 *****************************************************************************/
 #ifndef _AMPEROMETRIC_H_
 #define _AMPEROMETRIC_H_
-#include "AD5940.H"
+#include "ad5940.h"
 #include "stdio.h"
 #include "string.h"
 #include "math.h"
 
 #define DAC12BITVOLT_1LSB   (2200.0f/4095)  //mV
 #define DAC6BITVOLT_1LSB    (DAC12BITVOLT_1LSB*64)  //mV
+#define AMP_CHAN_MAX        3   /* Maximum number of sensors multiplexed to LPTIA0 */
 /* 
   Note: this example will use SEQID_0 as measurement sequence, and use SEQID_1 as init sequence. 
   SEQID_3 is used for calibration.
@@ -60,9 +61,15 @@ typedef struct
   float SensorBias;             /* Sensor bias voltage = VRE0 - VSE0 */
   BoolFlag ExtRtia;             /* Use internal or external Rtia */
   float ExtRtiaVal;							/* External Rtia value if using one */
+  uint32_t ChanNum;             /* Number of sensors measured in one sequence, 1 to AMP_CHAN_MAX. With more than one, sensors are switched by AFE GPIOs */
+  uint32_t ChanGpio[AMP_CHAN_MAX];  /* AGPIO_Pinx that selects each sensor, driven by sequencer. Pins are set to SYNC function */
+  float ChanSettleTime;         /* Settling time in ms after switching to a sensor, before ADC conversion */
   BoolFlag AMPInited;           /* If the program run firstly, generated sequence commands */
   SEQInfo_Type InitSeqInfo;
   SEQInfo_Type MeasureSeqInfo;
+  float MeasSeqTime;              /* Measurement sequence duration in seconds from AD5940_SEQAnalyze. Checked against AmpODR when starting */
+  SEQSlot_Type LpDacSlot;         /* LPDACDAT0 write in initialization sequence, patched by AMPCTRL_PARAUPDATE */
+  SEQSlot_Type LpTiaSlot;         /* LPTIACON0 write in initialization sequence, patched by AMPCTRL_PARAUPDATE */
   BoolFlag StopRequired;          /* After FIFO is ready, stop the measurement sequence */
   uint32_t FifoDataCount;         /* Count how many times impedance have been measured */
 /* End */
@@ -83,12 +90,54 @@ typedef struct
 #define AMPCTRL_STOPNOW        1
 #define AMPCTRL_STOPSYNC       2
 #define AMPCTRL_SHUTDOWN       4   /* Note: shutdown here means turn off everything and put AFE to hibernate mode. The word 'SHUT DOWN' is only used here. */
+#define AMPCTRL_PARAUPDATE     5   /* Apply new SensorBias, Vzero and LptiaRtiaSel by patching initialization sequence in SRAM, no need to set bParaChanged */
+#define AMPCTRL_STREAM         6   /* Start continuous acquisition into the AppAMPStream_Type ring given by pPara. Stop with AMPCTRL_STOPNOW/STOPSYNC */
+
+/**
+ * One sample of continuous acquisition
+*/
+typedef struct
+{
+  uint32_t Index;               /* Sample number since AMPCTRL_STREAM. Every converted sample is numbered, gaps are dropped samples */
+  uint32_t Tick;                /* Sample time since AMPCTRL_STREAM in wakeup timer clocks (WuptClkFreq). Wraps around */
+  uint32_t Chan;                /* Sensor, 0 to ChanNum-1 */
+  int32_t Current;              /* Current in pA, from AppAMPCalcCurrentBatch */
+}AppAMPSample_Type;
+
+/**
+ * Single-producer/single-consumer ring of samples. AppAMPStreamService (in its FIFO read callback, which can run
+ * in interrupt context) is the only writer of WrIdx and
+ * AppAMPStreamRead the only writer of RdIdx, so they can run in different contexts without locking.
+ * One slot is always left empty to tell full from empty, so it holds at most Size-1 samples.
+*/
+typedef struct
+{
+  AppAMPSample_Type *pBuffer;   /* Sample storage */
+  uint32_t Size;                /* Number of samples in pBuffer */
+  volatile uint32_t WrIdx;      /* Next slot written by AppAMPStreamService */
+  volatile uint32_t RdIdx;      /* Next slot read by AppAMPStreamRead */
+  volatile uint32_t Dropped;    /* Samples discarded because ring was full. The newest ones are discarded */
+  volatile uint32_t FifoOverflow; /* Times AFE data FIFO overflowed. Samples are lost on chip, Index/Tick/Chan after it are not exact */
+  uint32_t NextIndex;           /* Index of next sample read from FIFO */
+  uint32_t TickPeriod;          /* Wakeup timer clocks of one measurement sequence period */
+}AppAMPStream_Type;
+
+/* 
+  Multiplexed sensors: with ChanNum > 1 the measurement sequence selects each sensor by ChanGpio, waits ChanSettleTime
+  and converts one sample. Samples are in FIFO in channel order, AppAMPISR only returns whole cycles, so result i of
+  AppAMPISR is channel i%ChanNum. DataFifoSrc must be FIFOSRC_SINC2NOTCH, SINC3 gives a timing dependent number of
+  samples per sensor.
+*/
 
 AD5940Err AppAMPGetCfg(void *pCfg);
 AD5940Err AppAMPInit(uint32_t *pBuffer, uint32_t BufferSize);
 AD5940Err AppAMPISR(void *pBuff, uint32_t *pCount);
 AD5940Err AppAMPCtrl(int32_t AmpCtrl, void *pPara);
+void AppAMPStreamInit(AppAMPStream_Type *pStream, AppAMPSample_Type *pBuffer, uint32_t Size);
+AD5940Err AppAMPStreamService(void);
+uint32_t AppAMPStreamRead(AppAMPStream_Type *pStream, AppAMPSample_Type *pSample, uint32_t MaxCount);
 float AppAMPCalcVoltage(uint32_t ADCcode);
 float AppAMPCalcCurrent(uint32_t ADCcode);
+void AppAMPCalcCurrentBatch(const uint32_t *pData, int32_t *pCurrent, uint32_t DataCount);
 
 #endif
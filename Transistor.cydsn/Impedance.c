@@ -17,6 +17,8 @@ Analog Devices Software License Agreement.
 #include "string.h"
 #include "math.h"
 #include "Impedance.h"
+#include "ad5941_seqcache.h"
+#include "ad5941_seqalloc.h"
 
 /* Default LPDAC resolution(2.5V internal reference). */
 #define DAC12BITVOLT_1LSB   (2200.0f/4095)  //mV
@@ -31,12 +33,12 @@ AppIMPCfg_Type AppIMPCfg =
 {
   .bParaChanged = bFALSE,
   .SeqStartAddr = 0,
-  .MaxSeqLen = 0,
+  .MaxSeqLen = 128,         /* Sequencer SRAM reserved for this application, in words */
   
   .SeqStartAddrCal = 0,
   .MaxSeqLenCal = 0,
 
-  .ImpODR = 20.0,           /* 20.0 Hz*/
+  .ImpODR = 10.0,           /* 10.0 Hz. Measurement sequence with DFTNUM_16384 takes about 82ms */
   .NumOfData = -1,
   .SysClkFreq = 16000000.0,
   .WuptClkFreq = 32000.0,
@@ -95,6 +97,13 @@ int32_t AppIMPGetCfg(void *pCfg)
   return AD5940ERR_PARA;
 }
 
+/* Locate parameter dependent writes in initialization sequence. InitSeqInfo.pSeqCmd must be valid */
+static void AppIMPSeqSlotFind(void)
+{
+  AD5940_SEQSlotFind(&AppIMPCfg.InitSeqInfo, REG_AFE_WGFCW, &AppIMPCfg.WgFcwSlot);
+  AppIMPCfg.WgFcwPending = bFALSE;  /* Initialization sequence writes it */
+}
+
 int32_t AppIMPCtrl(uint32_t Command, void *pPara)
 {
   
@@ -109,16 +118,41 @@ int32_t AppIMPCtrl(uint32_t Command, void *pPara)
       if(AppIMPCfg.IMPInited == bFALSE)
         return AD5940ERR_APPERROR;
       /* Start it */
+      if(AppIMPCfg.WgFcwPending == bTRUE)
+      {
+        AD5940_WriteReg(REG_AFE_WGFCW, AppIMPCfg.WgFcwSlot.Cmd&BITM_AFE_WGFCW_SINEFCW);
+        AppIMPCfg.WgFreq = AppIMPCfg.SeqFreq;
+        AppIMPCfg.WgFcwPending = bFALSE;
+      }
       wupt_cfg.WuptEn = bTRUE;
       wupt_cfg.WuptEndSeq = WUPTENDSEQ_A;
-      wupt_cfg.WuptOrder[0] = SEQID_0;
-      wupt_cfg.SeqxSleepTime[SEQID_0] = 4;
-      wupt_cfg.SeqxWakeupTime[SEQID_0] = (uint32_t)(AppIMPCfg.WuptClkFreq/AppIMPCfg.ImpODR)-4;
+      wupt_cfg.WuptOrder[0] = AppIMPCfg.MeasureSeqInfo.SeqId;
+      wupt_cfg.SeqxSleepTime[AppIMPCfg.MeasureSeqInfo.SeqId] = 4;
+      wupt_cfg.SeqxWakeupTime[AppIMPCfg.MeasureSeqInfo.SeqId] = (uint32_t)(AppIMPCfg.WuptClkFreq/AppIMPCfg.ImpODR)-4;
+      if(AD5940_WUPTCheck(&wupt_cfg, AppIMPCfg.MeasureSeqInfo.SeqId, AppIMPCfg.MeasSeqTime, AppIMPCfg.WuptClkFreq) != AD5940ERR_OK)
+        return AD5940ERR_PARA;  /* ODR is too high for measurement sequence */
       AD5940_WUPTCfg(&wupt_cfg);
       
       AppIMPCfg.FifoDataCount = 0;  /* restart */
       break;
     }
+    case IMPCTRL_PARAUPDATE:
+    {
+      AD5940Err error;
+
+      if(AD5940_WakeUp(10) > 10)  /* Wakeup AFE by read register, read 10 times at most */
+        return AD5940ERR_WAKEUP;  /* Wakeup Failed */
+      if(AppIMPCfg.IMPInited == bFALSE)
+        return AD5940ERR_APPERROR;
+      if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
+        return AD5940ERR_PARA;    /* Frequency is controlled by sweep */
+      error = AD5940_SEQSlotPatch(&AppIMPCfg.WgFcwSlot, BITM_AFE_WGFCW_SINEFCW,\
+                                  AD5940_WGFreqWordCal(AppIMPCfg.SinFreq, AppIMPCfg.SysClkFreq), bFALSE);
+      if(error != AD5940ERR_OK) return error;
+      AppIMPCfg.SeqFreq = AppIMPCfg.SinFreq;
+      AppIMPCfg.WgFcwPending = bTRUE;   /* Don't change WG in the middle of a measurement. WgFreq follows when it is written */
+      break;
+    }
     case IMPCTRL_STOPNOW:
     {
       if(AD5940_WakeUp(10) > 10)  /* Wakeup AFE by read register, read 10 times at most */
@@ -139,10 +173,7 @@ int32_t AppIMPCtrl(uint32_t Command, void *pPara)
       {
         if(pPara == 0)
           return AD5940ERR_PARA;
-        if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
-          *(float*)pPara = AppIMPCfg.FreqofData;
-        else
-          *(float*)pPara = AppIMPCfg.SinFreq;
+        *(float*)pPara = AppIMPCfg.FreqofData;
       }
     break;
     case IMPCTRL_SHUTDOWN:
@@ -170,10 +201,24 @@ float AppIMPGetCurrFreq(void)
   if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
     return AppIMPCfg.FreqofData;
   else
-    return AppIMPCfg.SinFreq;
+    return AppIMPCfg.WgFreq;  /* Not SinFreq, a new SinFreq is not produced until WGFCW is written */
 }
 
 /* Application initialization */
+/* Reset sweep state and return frequency of the first measurement, which initialization sequence writes to WGFCW */
+static float AppIMPSweepInit(void)
+{
+  if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
+  {
+    AppIMPCfg.SweepCurrFreq = AppIMPCfg.SweepCfg.SweepStart;
+    AD5940_SweepNext(&AppIMPCfg.SweepCfg, &AppIMPCfg.SweepNextFreq);
+    AppIMPCfg.SeqFreq = AppIMPCfg.SweepCurrFreq;
+  }
+  else
+    AppIMPCfg.SeqFreq = AppIMPCfg.SinFreq;
+  return AppIMPCfg.SeqFreq;
+}
+
 static AD5940Err AppIMPSeqCfgGen(void)
 {
   AD5940Err error = AD5940ERR_OK;
@@ -233,18 +278,7 @@ static AD5940Err AppIMPSeqCfgGen(void)
   HsLoopCfg.WgCfg.WgType = WGTYPE_SIN;
   HsLoopCfg.WgCfg.GainCalEn = bTRUE;
   HsLoopCfg.WgCfg.OffsetCalEn = bTRUE;
-  if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
-  {
-    AppIMPCfg.FreqofData = AppIMPCfg.SweepCfg.SweepStart;
-    AppIMPCfg.SweepCurrFreq = AppIMPCfg.SweepCfg.SweepStart;
-    AD5940_SweepNext(&AppIMPCfg.SweepCfg, &AppIMPCfg.SweepNextFreq);
-    sin_freq = AppIMPCfg.SweepCurrFreq;
-  }
-  else
-  {
-    sin_freq = AppIMPCfg.SinFreq;
-    AppIMPCfg.FreqofData = sin_freq;
-  }
+  sin_freq = AppIMPSweepInit();
   HsLoopCfg.WgCfg.SinCfg.SinFreqWord = AD5940_WGFreqWordCal(sin_freq, AppIMPCfg.SysClkFreq);
   HsLoopCfg.WgCfg.SinCfg.SinAmplitudeWord = (uint32_t)(AppIMPCfg.DacVoltPP/800.0f*2047 + 0.5f);
   HsLoopCfg.WgCfg.SinCfg.SinOffsetWord = 0;
@@ -305,12 +339,14 @@ static AD5940Err AppIMPSeqCfgGen(void)
   AD5940_SEQGenCtrl(bFALSE); /* Stop sequencer generator */
   if(error == AD5940ERR_OK)
   {
-    AppIMPCfg.InitSeqInfo.SeqId = SEQID_1;
+    if(SeqLen > AppIMPCfg.MaxSeqLen)
+      return AD5940ERR_SEQLEN;  /* Doesn't fit in SRAM reserved for this application */
     AppIMPCfg.InitSeqInfo.SeqRamAddr = AppIMPCfg.SeqStartAddr;
     AppIMPCfg.InitSeqInfo.pSeqCmd = pSeqCmd;
     AppIMPCfg.InitSeqInfo.SeqLen = SeqLen;
     /* Write command to SRAM */
     AD5940_SEQCmdWrite(AppIMPCfg.InitSeqInfo.SeqRamAddr, pSeqCmd, SeqLen);
+    AppIMPSeqSlotFind();  /* pSeqCmd is reused by next sequence */
   }
   else
     return error; /* Error */
@@ -380,7 +416,8 @@ static AD5940Err AppIMPSeqMeasureGen(void)
 
   if(error == AD5940ERR_OK)
   {
-    AppIMPCfg.MeasureSeqInfo.SeqId = SEQID_0;
+    if(AppIMPCfg.InitSeqInfo.SeqLen + SeqLen > AppIMPCfg.MaxSeqLen)
+      return AD5940ERR_SEQLEN;
     AppIMPCfg.MeasureSeqInfo.SeqRamAddr = AppIMPCfg.InitSeqInfo.SeqRamAddr + AppIMPCfg.InitSeqInfo.SeqLen ;
     AppIMPCfg.MeasureSeqInfo.pSeqCmd = pSeqCmd;
     AppIMPCfg.MeasureSeqInfo.SeqLen = SeqLen;
@@ -393,18 +430,81 @@ static AD5940Err AppIMPSeqMeasureGen(void)
 }
 
 
+/* Reserve sequencer SRAM and SEQIDs. Sequences of the other application stay in SRAM. */
+static AD5940Err AppIMPSeqAlloc(void)
+{
+  uint32_t addr, seq_id[2];
+
+  if((AD5940_SEQAllocRegion(AD5940_SEQALLOC_IMP, AppIMPCfg.MaxSeqLen, &addr) != 0) ||\
+     (AD5940_SEQAllocId(AD5940_SEQALLOC_IMP, 2, seq_id) != 0))
+    return AD5940ERR_SEQLEN;
+  if((addr != AppIMPCfg.SeqStartAddr) || (seq_id[0] != AppIMPCfg.MeasureSeqInfo.SeqId) ||\
+     (seq_id[1] != AppIMPCfg.InitSeqInfo.SeqId))
+    AppIMPCfg.bParaChanged = bTRUE;  /* Sequences are moved, load them again */
+  AppIMPCfg.SeqStartAddr = addr;
+  AppIMPCfg.MeasureSeqInfo.SeqId = seq_id[0];
+  AppIMPCfg.InitSeqInfo.SeqId = seq_id[1];
+  return AD5940ERR_OK;
+}
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+#define IMP_SEQKEY(key, field)  AD5940_SEQCacheHash(key, &AppIMPCfg.field, sizeof(AppIMPCfg.field))
+/* Sequence cache key. Add every parameter used by AppIMPSeqCfgGen/AppIMPSeqMeasureGen here. */
+static uint32_t AppIMPSeqKey(uint32_t key)
+{
+
+  key = IMP_SEQKEY(key, SeqStartAddr);
+  key = IMP_SEQKEY(key, InitSeqInfo.SeqId);
+  key = IMP_SEQKEY(key, MeasureSeqInfo.SeqId);
+  key = IMP_SEQKEY(key, SysClkFreq);
+  key = IMP_SEQKEY(key, AdcClkFreq);
+  key = IMP_SEQKEY(key, DswitchSel);
+  key = IMP_SEQKEY(key, PswitchSel);
+  key = IMP_SEQKEY(key, NswitchSel);
+  key = IMP_SEQKEY(key, TswitchSel);
+  key = IMP_SEQKEY(key, HstiaRtiaSel);
+  key = IMP_SEQKEY(key, ExcitBufGain);
+  key = IMP_SEQKEY(key, HsDacGain);
+  key = IMP_SEQKEY(key, HsDacUpdateRate);
+  key = IMP_SEQKEY(key, DacVoltPP);
+  key = IMP_SEQKEY(key, BiasVolt);
+  key = IMP_SEQKEY(key, SinFreq);
+  key = IMP_SEQKEY(key, SweepCfg.SweepEn);
+  key = IMP_SEQKEY(key, SweepCfg.SweepStart);
+  key = IMP_SEQKEY(key, DftNum);
+  key = IMP_SEQKEY(key, DftSrc);
+  key = IMP_SEQKEY(key, HanWinEn);
+  key = IMP_SEQKEY(key, AdcPgaGain);
+  key = IMP_SEQKEY(key, ADCSinc3Osr);
+  key = IMP_SEQKEY(key, ADCSinc2Osr);
+  key = IMP_SEQKEY(key, ADCAvgNum);
+  return key;
+}
+#endif
+
 /* This function provide application initialize. It can also enable Wupt that will automatically trigger sequence. Or it can configure  */
 int32_t AppIMPInit(uint32_t *pBuffer, uint32_t BufferSize)
 {
   AD5940Err error = AD5940ERR_OK;  
   SEQCfg_Type seq_cfg;
   FIFOCfg_Type fifo_cfg;
+  SEQAnalyzeCfg_Type ana_cfg;
+  SEQAnalyzeResult_Type ana_res;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+  SEQInfo_Type * const seq_info[] = {&AppIMPCfg.InitSeqInfo, &AppIMPCfg.MeasureSeqInfo};
+#endif
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+  uint32_t seq_key;
+#endif
 
   if(AD5940_WakeUp(10) > 10)  /* Wakeup AFE by read register, read 10 times at most */
     return AD5940ERR_WAKEUP;  /* Wakeup Failed */
 
+  error = AppIMPSeqAlloc();
+  if(error != AD5940ERR_OK) return error;
+
   /* Configure sequencer and stop it */
-  seq_cfg.SeqMemSize = SEQMEMSIZE_2KB;  /* 2kB SRAM is used for sequencer, others for data FIFO */
+  seq_cfg.SeqMemSize = AD5940_SEQAllocMemSize();  /* Sequencer partition holds sequences of all applications, others for data FIFO */
   seq_cfg.SeqBreakEn = bFALSE;
   seq_cfg.SeqIgnoreEn = bTRUE;
   seq_cfg.SeqCntCRCClr = bTRUE;
@@ -416,7 +516,7 @@ int32_t AppIMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   AD5940_FIFOCtrlS(FIFOSRC_DFT, bFALSE);									/* Disable FIFO firstly */
   fifo_cfg.FIFOEn = bTRUE;
   fifo_cfg.FIFOMode = FIFOMODE_FIFO;
-  fifo_cfg.FIFOSize = FIFOSIZE_4KB;                       /* 4kB for FIFO, The reset 2kB for sequencer */
+  fifo_cfg.FIFOSize = AD5940_SEQAllocFifoSize();          /* The rest of SRAM for FIFO */
   fifo_cfg.FIFOSrc = FIFOSRC_DFT;
   fifo_cfg.FIFOThresh = AppIMPCfg.FifoThresh;              /* DFT result. One pair for RCAL, another for Rz. One DFT result have real part and imaginary part */
   AD5940_FIFOCfg(&fifo_cfg);
@@ -427,17 +527,57 @@ int32_t AppIMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   if((AppIMPCfg.IMPInited == bFALSE)||\
        (AppIMPCfg.bParaChanged == bTRUE))
   {
-    if(pBuffer == 0)  return AD5940ERR_PARA;
-    if(BufferSize == 0) return AD5940ERR_PARA;   
-    AD5940_SEQGenInit(pBuffer, BufferSize);
-
-    /* Generate initialize sequence */
-    error = AppIMPSeqCfgGen(); /* Application initialization sequence using either MCU or sequencer */
-    if(error != AD5940ERR_OK) return error;
+    /* Load sequences generated offline or saved with the same parameters to SRAM, otherwise generate them */
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+    seq_key = AppIMPSeqKey(AD5940_SEQCacheKeyInit());
+#endif
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+    if(AD5940_SEQRomLoad(AD5940_SEQCACHE_SLOT_IMP, AppIMPSeqKey(AD5940_SEQ_ROM_KEY_BASIS), seq_info, 2) == 0)
+    {
+      AppIMPSweepInit();  /* Sweep state and slots are set up by AppIMPSeqCfgGen otherwise */
+      AppIMPSeqSlotFind();
+    }
+    else
+#endif
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+    if(AD5940_SEQCacheLoad(AD5940_SEQCACHE_SLOT_IMP, seq_key, seq_info, 2) == 0)
+    {
+      AppIMPSweepInit();
+      AppIMPSeqSlotFind();
+    }
+    else
+#endif
+    {
+      if(pBuffer == 0)  return AD5940ERR_PARA;
+      if(BufferSize == 0) return AD5940ERR_PARA;   
+      AD5940_SEQGenInit(pBuffer, BufferSize);
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheBegin(AD5940_SEQCACHE_SLOT_IMP);
+#endif
+
+      /* Generate initialize sequence */
+      error = AppIMPSeqCfgGen(); /* Application initialization sequence using either MCU or sequencer */
+      if(error != AD5940ERR_OK) return error;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheAdd(AD5940_SEQCACHE_SLOT_IMP, seq_info[0]);  /* Save it now, the buffer is reused by next sequence */
+#endif
+
+      /* Generate measurement sequence */
+      error = AppIMPSeqMeasureGen();
+      if(error != AD5940ERR_OK) return error;
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+      AD5940_SEQCacheAdd(AD5940_SEQCACHE_SLOT_IMP, seq_info[1]);
+      AD5940_SEQCacheCommit(AD5940_SEQCACHE_SLOT_IMP, seq_key);
+#endif
+    }
 
-    /* Generate measurement sequence */
-    error = AppIMPSeqMeasureGen();
+    /* Measurement sequence duration, the wakeup period must be longer */
+    AD5940_StructInit(&ana_cfg, sizeof(ana_cfg));
+    ana_cfg.SysClkFreq = AppIMPCfg.SysClkFreq;
+    ana_cfg.AfeconInit = REG_AFE_AFECON_RESET;
+    error = AD5940_SEQAnalyze(AppIMPCfg.MeasureSeqInfo.pSeqCmd, AppIMPCfg.MeasureSeqInfo.SeqLen, &ana_cfg, &ana_res);
     if(error != AD5940ERR_OK) return error;
+    AppIMPCfg.MeasSeqTime = ana_res.Duration;
 
     AppIMPCfg.bParaChanged = bFALSE; /* Clear this flag as we already implemented the new configuration */
   }
@@ -449,6 +589,17 @@ int32_t AppIMPInit(uint32_t *pBuffer, uint32_t BufferSize)
   AD5940_SEQCfg(&seq_cfg);  /* Enable sequencer */
   AD5940_SEQMmrTrig(AppIMPCfg.InitSeqInfo.SeqId);
   while(AD5940_INTCTestFlag(AFEINTC_1, AFEINTSRC_ENDSEQ) == bFALSE);
+  if(AD5940_SEQVerify(&AppIMPCfg.InitSeqInfo) == bFALSE)
+  {
+    /* SRAM was lost(AFE reset without notice) and is restored now, run it again */
+    AD5940_INTCClrFlag(AFEINTSRC_ENDSEQ);
+    AD5940_SEQCfg(&seq_cfg);
+    AD5940_SEQMmrTrig(AppIMPCfg.InitSeqInfo.SeqId);
+    while(AD5940_INTCTestFlag(AFEINTC_1, AFEINTSRC_ENDSEQ) == bFALSE);
+  }
+  AppIMPCfg.WgFreq = AppIMPCfg.SeqFreq;   /* Initialization sequence wrote WGFCW */
+  AppIMPCfg.FreqofData = AppIMPCfg.WgFreq;
+  AppIMPCfg.WgFcwPending = bFALSE;
   
   /* Measurement sequence  */
   AppIMPCfg.MeasureSeqInfo.WriteSRAM = bFALSE;
@@ -484,10 +635,119 @@ int32_t AppIMPRegModify(int32_t * const pData, uint32_t *pDataCount)
   if(AppIMPCfg.SweepCfg.SweepEn) /* Need to set new frequency and set power mode */
   {
     AD5940_WGFreqCtrlS(AppIMPCfg.SweepNextFreq, AppIMPCfg.SysClkFreq);
+    AppIMPCfg.WgFreq = AppIMPCfg.SweepNextFreq;
+  }
+  else if(AppIMPCfg.WgFcwPending == bTRUE) /* SinFreq is changed by IMPCTRL_PARAUPDATE */
+  {
+    AD5940_WriteReg(REG_AFE_WGFCW, AppIMPCfg.WgFcwSlot.Cmd&BITM_AFE_WGFCW_SINEFCW);
+    AppIMPCfg.WgFreq = AppIMPCfg.SeqFreq;
+    AppIMPCfg.WgFcwPending = bFALSE;
   }
   return AD5940ERR_OK;
 }
 
+/* Integer CORDIC for DFT results, no float per iteration. Angles are binary: 2^32 is one turn, so they wrap like radians do. */
+#define IMP_CORDIC_ITER     20
+#define IMP_CORDIC_TOPBIT   27    /* Scale input so largest part is below 2^28, gain of 2.33 keeps it in int32 */
+#define IMP_CORDIC_RAD      (1.46291808e-9f)  /* Radian per binary angle unit, 2*pi/2^32 */
+
+static const uint32_t AppIMPCordicAtan[IMP_CORDIC_ITER] =
+{
+  0x20000000, 0x12E4051E, 0x09FB385B, 0x051111D4,
+  0x028B0D43, 0x0145D7E1, 0x00A2F61E, 0x00517C55,
+  0x0028BE53, 0x00145F2F, 0x000A2F98, 0x000517CC,
+  0x00028BE6, 0x000145F3, 0x0000A2FA, 0x0000517D,
+  0x000028BE, 0x0000145F, 0x00000A30, 0x00000518,
+};
+
+/* Left shift that moves the highest set bit of Max(non zero) to IMP_CORDIC_TOPBIT */
+static int32_t AppIMPCordicNorm(uint32_t Max)
+{
+#if defined(__GNUC__)
+  return __builtin_clz(Max) - (31 - IMP_CORDIC_TOPBIT);
+#else
+  int32_t Shift = 0;
+  while(Max < (1u<<IMP_CORDIC_TOPBIT))
+  {
+    Max <<= 1;
+    Shift++;
+  }
+  return Shift;
+#endif
+}
+
+/**
+  @brief Magnitude and angle of vector (x,y), like sqrt(x*x+y*y) and atan2(y,x).
+  @param x, y: Vector, |x| and |y| no more than 2^17 (18bit DFT result).
+  @param pMag: Magnitude*CORDIC gain(1.6468)*2^(*pShift). Gain cancels out in a ratio of two magnitudes.
+  @param pShift: Left shift applied to input.
+  @return Angle, 2^32 is 2*pi. Error is below 2^-19 rad.
+*/
+static uint32_t AppIMPCordic(int32_t x, int32_t y, uint32_t *pMag, int32_t *pShift)
+{
+  uint32_t Angle = 0;
+  uint32_t Max;
+  int32_t Shift, Tmp, Sign, i;
+
+  if(x < 0)   /* Rotate by pi to right half plane, CORDIC converges within +/-99 degree */
+  {
+    x = -x;
+    y = -y;
+    Angle = 0x80000000;
+  }
+  Max = (uint32_t)x | (uint32_t)((y < 0)?-y:y);
+  if(Max == 0)
+  {
+    *pMag = 0;
+    *pShift = 0;
+    return 0;
+  }
+  Shift = AppIMPCordicNorm(Max);
+  x <<= Shift;
+  y = (int32_t)((uint32_t)y << Shift);
+  for(i=0;i<IMP_CORDIC_ITER;i++)
+  {
+    /* Rotate toward y=0. Sign is 0 if y>0 else -1, (v^Sign)-Sign negates v without a branch */
+    Sign = (y - 1)>>31;
+    Tmp = x;
+    x += ((y>>i)^Sign) - Sign;
+    y -= ((Tmp>>i)^Sign) - Sign;
+    Angle += (AppIMPCordicAtan[i]^(uint32_t)Sign) - (uint32_t)Sign;
+  }
+  *pMag = (uint32_t)x;
+  *pShift = Shift;
+  return Angle;
+}
+
+/**
+  @brief Ratio of two CORDIC magnitudes by shift-and-subtract division. M0 has no divide instruction,
+         this loop is as fast as the library call and gives a full float mantissa.
+  @param Num, Den: Magnitudes from AppIMPCordic, both in [2^27, 2^30).
+  @return Num/Den in Q24, rounded.
+*/
+static uint32_t AppIMPMagRatio(uint32_t Num, uint32_t Den)
+{
+  uint32_t Ratio = 0;
+  uint32_t Bit;
+  int32_t i;
+
+  while(Num >= Den)   /* Integer part, no more than 7 */
+  {
+    Num -= Den;
+    Ratio++;
+  }
+  for(i=0;i<24;i++)   /* Num<Den<2^30, Num<<1 does not overflow */
+  {
+    Num <<= 1;
+    Bit = (Num >= Den);
+    Num -= Den & (0u - Bit);
+    Ratio = (Ratio<<1) | Bit;
+  }
+  if((Num<<1) >= Den)
+    Ratio++;
+  return Ratio;
+}
+
 /* Depending on the data type, do appropriate data pre-process before return back to controller */
 int32_t AppIMPDataProcess(int32_t * const pData, uint32_t *pDataCount)
 {
@@ -513,30 +773,34 @@ int32_t AppIMPDataProcess(int32_t * const pData, uint32_t *pDataCount)
   for(uint32_t i=0; i<ImpResCount; i++)
   {
     iImpCar_Type *pDftRcal, *pDftRz;
+    uint32_t RcalMag, RzMag, Ratio;
+    uint32_t RcalPhase, RzPhase;
+    int32_t RcalShift, RzShift;
 
     pDftRcal = pSrcData++;
     pDftRz = pSrcData++;
-    float RzMag,RzPhase;
-    float RcalMag, RcalPhase;
-    
-    RcalMag = sqrt((float)pDftRcal->Real*pDftRcal->Real+(float)pDftRcal->Image*pDftRcal->Image);
-    RcalPhase = atan2(-pDftRcal->Image,pDftRcal->Real);
-    RzMag = sqrt((float)pDftRz->Real*pDftRz->Real+(float)pDftRz->Image*pDftRz->Image);
-    RzPhase = atan2(-pDftRz->Image,pDftRz->Real);
-
-    RzMag = RcalMag/RzMag*AppIMPCfg.RcalVal;
-    RzPhase = RcalPhase - RzPhase;
+    /* Angle is atan2(-Image, Real) as before */
+    RcalPhase = AppIMPCordic(pDftRcal->Real, -pDftRcal->Image, &RcalMag, &RcalShift);
+    RzPhase = AppIMPCordic(pDftRz->Real, -pDftRz->Image, &RzMag, &RzShift);
     //printf("V:%d,%d,I:%d,%d ",pDftRcal->Real,pDftRcal->Image, pDftRz->Real, pDftRz->Image);
-    
-    pOut[i].Magnitude = RzMag;
-    pOut[i].Phase = RzPhase;
+
+    /* |Z| = Rcal*|Vrcal|/|Vrz|, the CORDIC gain is the same for both and cancels */
+    if(RzMag == 0)
+      pOut[i].Magnitude = INFINITY;
+    else if(RcalMag == 0)
+      pOut[i].Magnitude = 0;
+    else
+    {
+      Ratio = AppIMPMagRatio(RcalMag, RzMag);
+      pOut[i].Magnitude = ldexpf((float)Ratio, RzShift - RcalShift - 24)*AppIMPCfg.RcalVal;
+    }
+    /* Difference of binary angles wraps to [-pi, pi) */
+    pOut[i].Phase = (float)(int32_t)(RcalPhase - RzPhase)*IMP_CORDIC_RAD;
   }
   *pDataCount = ImpResCount; 
-  AppIMPCfg.FreqofData = AppIMPCfg.SweepCurrFreq;
-  /* Calculate next frequency point */
+  /* Calculate next frequency point. FreqofData is set by AppIMPISR from the frequency WG was producing */
   if(AppIMPCfg.SweepCfg.SweepEn == bTRUE)
   {
-    AppIMPCfg.FreqofData = AppIMPCfg.SweepCurrFreq;
     AppIMPCfg.SweepCurrFreq = AppIMPCfg.SweepNextFreq;
     AD5940_SweepNext(&AppIMPCfg.SweepCfg, &AppIMPCfg.SweepNextFreq);
   }
@@ -570,6 +834,7 @@ int32_t AppIMPISR(void *pBuff, uint32_t *pCount)
     }
     AD5940_FIFORd((uint32_t *)pBuff, FifoCnt);
     AD5940_INTCClrFlag(AFEINTSRC_DATAFIFOTHRESH);
+    AppIMPCfg.FreqofData = AppIMPCfg.WgFreq;  /* Data was measured before AppIMPRegModify changes WG */
     AppIMPRegModify(pBuff, &FifoCnt);   /* If there is need to do AFE re-configure, do it here when AFE is in active state */
     //AD5940_EnterSleepS(); /* Manually put AFE back to hibernate mode. This operation only takes effect when register value is ACTIVE previously */
     AD5940_SleepKeyCtrlS(SLPKEY_UNLOCK);  /* Allow AFE to enter sleep mode. */
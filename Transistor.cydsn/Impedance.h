@@ -62,9 +62,14 @@ typedef struct
   float SweepCurrFreq;
   float SweepNextFreq;
   float FreqofData;                         /* The frequency of latest data sampled */
+  float SeqFreq;                  /* Frequency written to WGFCW by initialization sequence, follows IMPCTRL_PARAUPDATE */
+  float WgFreq;                   /* Frequency WG is producing. Only changed where WGFCW is written */
   BoolFlag IMPInited;                       /* If the program run firstly, generated sequence commands */
   SEQInfo_Type InitSeqInfo;
   SEQInfo_Type MeasureSeqInfo;
+  float MeasSeqTime;              /* Measurement sequence duration in seconds from AD5940_SEQAnalyze. Checked against ImpODR when starting */
+  SEQSlot_Type WgFcwSlot;         /* WGFCW write in initialization sequence, patched by IMPCTRL_PARAUPDATE */
+  BoolFlag WgFcwPending;          /* Patched WGFCW is written to register between measurements */
   BoolFlag StopRequired;          /* After FIFO is ready, stop the measurement sequence */
   uint32_t FifoDataCount;         /* Count how many times impedance have been measured */
 }AppIMPCfg_Type;
@@ -72,13 +77,15 @@ typedef struct
 #define IMPCTRL_START          0
 #define IMPCTRL_STOPNOW        1
 #define IMPCTRL_STOPSYNC       2
-#define IMPCTRL_GETFREQ        3   /* Get Current frequency of returned data from ISR */
+#define IMPCTRL_GETFREQ        3   /* Get frequency of data returned from ISR, the frequency WG produced when it was measured */
 #define IMPCTRL_SHUTDOWN       4   /* Note: shutdown here means turn off everything and put AFE to hibernate mode. The word 'SHUT DOWN' is only used here. */
+#define IMPCTRL_PARAUPDATE     5   /* Apply new SinFreq by patching initialization sequence in SRAM, no need to set bParaChanged. WG changes before next measurement */
 
 
 int32_t AppIMPInit(uint32_t *pBuffer, uint32_t BufferSize);
 int32_t AppIMPGetCfg(void *pCfg);
 int32_t AppIMPISR(void *pBuff, uint32_t *pCount);
 int32_t AppIMPCtrl(uint32_t Command, void *pPara);
+float AppIMPGetCurrFreq(void);
 
 #endif
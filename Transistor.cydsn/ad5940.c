@@ -63,6 +63,9 @@ static void AD5940_SPIWriteReg(uint16_t RegAddr, uint32_t RegData);
 static uint32_t AD5940_D2DReadReg(uint16_t RegAddr);
 static void AD5940_D2DWriteReg(uint16_t RegAddr, uint32_t RegData);
 #endif
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+static void AD5940_RegCacheSeqCmd(uint32_t CmdWord);
+#endif
 
 /** 
  * @addtogroup AD5940_Library
@@ -79,6 +82,41 @@ static void AD5940_D2DWriteReg(uint16_t RegAddr, uint32_t RegData);
 */
 
 #define SEQUENCE_GENERATOR  /*!< Build sequence generator part in to lib. Comment this line to remove this feature  */
+#define SEQUENCE_OPTIMIZER  /*!< Optimize generated sequence in AD5940_SEQGenFetchSeq. Comment this line to keep sequence as generated */
+
+/**
+ * @brief Number of sequencer clocks one command takes.
+ * @details Wait command takes its count of clocks including its own execution, SEQ_NOP(count 0) takes one clock.
+ *          Write and timeout commands take one clock. AD5940_SEQOptimize, AD5940_SEQCycleTime and AD5940_SEQAnalyze
+ *          all use this model.
+*/
+static uint32_t AD5940_SEQCmdCycles(uint32_t Cmd)
+{
+  if((Cmd>>30) == 0)
+  {
+    Cmd &= 0x3FFFFFFF;  /* Wait command */
+    return (Cmd == 0) ? 1 : Cmd;
+  }
+  return 1;   /* Write or timeout command */
+}
+
+/**
+ * @brief Supply current in uA with blocks in Afecon powered.
+*/
+static float AD5940_SEQBlockCurrent(const SEQAnalyzeCfg_Type *pCfg, uint32_t Afecon)
+{
+  uint32_t bit;
+  float Current = pCfg->ActiveCurrent;
+
+  if(pCfg->pBlockCurrent == NULL)
+    return 0;
+  for(bit=0;bit<32;bit++)
+  {
+    if(Afecon & (1UL<<bit))
+      Current += pCfg->pBlockCurrent[bit];
+  }
+  return Current;
+}
 
 #ifdef SEQUENCE_GENERATOR
 /**
@@ -100,11 +138,26 @@ struct
 
   uint32_t *pSeqBuff;           /**< The buffer for sequence generator(both sequences and RegInfo) */
   uint32_t SeqLen;              /**< Generated sequence length till now */
-  SEQGenRegInfo_Type *pRegInfo; /**< Pointer to buffer where stores register info */
+  SEQGenRegInfo_Type *pRegInfo; /**< Pointer to the last element of buffer. Register info N is stored at pRegInfo[-N] */
   uint32_t RegCount;            /**< The count of register info available in buffer *pRegInfo. */
   AD5940Err LastError;          /**< The last error message. */
+  uint32_t RegMap[256/32];      /**< Bit n is set if register with 8-bit address n has register info */
+  uint8_t RegIndex[256];        /**< Register info index of each 8-bit register address */
 }SeqGenDB;  /* Data base of Seq Generator */
 
+/**
+ * @brief Clear all register info in data-base.
+ * @return None.
+*/
+static void AD5940_SEQGenClearRegInfo(void)
+{
+  uint32_t i;
+
+  SeqGenDB.RegCount = 0;
+  for(i=0;i<sizeof(SeqGenDB.RegMap)/sizeof(SeqGenDB.RegMap[0]);i++)
+    SeqGenDB.RegMap[i] = 0;
+}
+
 /**
  * @brief Manually input a command to sequencer generator.
  * @param CmdWord: The 32-bit width sequencer command word. @ref Sequencer_Helper can be used to generate commands.
@@ -119,6 +172,9 @@ void AD5940_SEQGenInsert(uint32_t CmdWord)
   {
     SeqGenDB.pSeqBuff[SeqGenDB.SeqLen] = CmdWord;
     SeqGenDB.SeqLen ++;
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+    AD5940_RegCacheSeqCmd(CmdWord);
+#endif
   }
   else  /* There is no buffer */
     SeqGenDB.LastError = AD5940ERR_BUFF;
@@ -126,34 +182,133 @@ void AD5940_SEQGenInsert(uint32_t CmdWord)
 
 /**
  * @brief Search data-base to get current register value.
+ *        Sequencer register address is 8-bit, so a direct map of 256 entries finds the register info without scanning.
  * @param RegAddr: The register address.
  * @param pIndex: Pointer to a variable that used to store index of found register-info.
  * @return Return AD5940ERR_OK if register found in data-base. Otherwise return AD5940ERR_SEQREG.
 */
 static AD5940Err AD5940_SEQGenSearchReg(uint32_t RegAddr, uint32_t *pIndex)
 {
-  uint32_t i;
-
   RegAddr = (RegAddr>>2)&0xff;
-  for(i=0;i<SeqGenDB.SeqLen;i++)
+  if(SeqGenDB.RegMap[RegAddr>>5] & (1UL<<(RegAddr&0x1f)))
   {
-    if(RegAddr == SeqGenDB.pRegInfo[i].RegAddr)
-    {
-      *pIndex = i;
-      return AD5940ERR_OK;
-    }
+    *pIndex = SeqGenDB.RegIndex[RegAddr];
+    return AD5940ERR_OK;
   }
   return AD5940ERR_SEQREG;
 }
 
+#ifndef AD5940_SEQGEN_LIVEREAD
+/**
+ * Reset value of registers that sequencer can write(0x2000 to 0x21FC), sorted by address.
+ * Registers of LPDAC1/LPTIA1 have no reset value defined in header, they are read from chip.
+*/
+static const RegPair_Type SEQGenRegDefault[] =
+{
+  {REG_AFE_AFECON,        REG_AFE_AFECON_RESET},
+  {REG_AFE_SEQCON,        REG_AFE_SEQCON_RESET},
+  {REG_AFE_FIFOCON,       REG_AFE_FIFOCON_RESET},
+  {REG_AFE_SWCON,         REG_AFE_SWCON_RESET},
+  {REG_AFE_HSDACCON,      REG_AFE_HSDACCON_RESET},
+  {REG_AFE_WGCON,         REG_AFE_WGCON_RESET},
+  {REG_AFE_WGDCLEVEL1,    REG_AFE_WGDCLEVEL1_RESET},
+  {REG_AFE_WGDCLEVEL2,    REG_AFE_WGDCLEVEL2_RESET},
+  {REG_AFE_WGDELAY1,      REG_AFE_WGDELAY1_RESET},
+  {REG_AFE_WGSLOPE1,      REG_AFE_WGSLOPE1_RESET},
+  {REG_AFE_WGDELAY2,      REG_AFE_WGDELAY2_RESET},
+  {REG_AFE_WGSLOPE2,      REG_AFE_WGSLOPE2_RESET},
+  {REG_AFE_WGFCW,         REG_AFE_WGFCW_RESET},
+  {REG_AFE_WGPHASE,       REG_AFE_WGPHASE_RESET},
+  {REG_AFE_WGOFFSET,      REG_AFE_WGOFFSET_RESET},
+  {REG_AFE_WGAMPLITUDE,   REG_AFE_WGAMPLITUDE_RESET},
+  {REG_AFE_ADCFILTERCON,  REG_AFE_ADCFILTERCON_RESET},
+  {REG_AFE_HSDACDAT,      REG_AFE_HSDACDAT_RESET},
+  {REG_AFE_LPREFBUFCON,   REG_AFE_LPREFBUFCON_RESET},
+  {REG_AFE_SYNCEXTDEVICE, REG_AFE_SYNCEXTDEVICE_RESET},
+  {REG_AFE_SEQCRC,        REG_AFE_SEQCRC_RESET},
+  {REG_AFE_SEQCNT,        REG_AFE_SEQCNT_RESET},
+  {REG_AFE_SEQTIMEOUT,    REG_AFE_SEQTIMEOUT_RESET},
+  {REG_AFE_DATAFIFORD,    REG_AFE_DATAFIFORD_RESET},
+  {REG_AFE_CMDFIFOWRITE,  REG_AFE_CMDFIFOWRITE_RESET},
+  {REG_AFE_ADCDAT,        REG_AFE_ADCDAT_RESET},
+  {REG_AFE_DFTREAL,       REG_AFE_DFTREAL_RESET},
+  {REG_AFE_DFTIMAG,       REG_AFE_DFTIMAG_RESET},
+  {REG_AFE_SINC2DAT,      REG_AFE_SINC2DAT_RESET},
+  {REG_AFE_TEMPSENSDAT,   REG_AFE_TEMPSENSDAT_RESET},
+  {REG_AFE_AFEGENINTSTA,  REG_AFE_AFEGENINTSTA_RESET},
+  {REG_AFE_ADCMIN,        REG_AFE_ADCMIN_RESET},
+  {REG_AFE_ADCMINSM,      REG_AFE_ADCMINSM_RESET},
+  {REG_AFE_ADCMAX,        REG_AFE_ADCMAX_RESET},
+  {REG_AFE_ADCMAXSMEN,    REG_AFE_ADCMAXSMEN_RESET},
+  {REG_AFE_ADCDELTA,      REG_AFE_ADCDELTA_RESET},
+  {REG_AFE_HPOSCCON,      REG_AFE_HPOSCCON_RESET},
+  {REG_AFE_DFTCON,        REG_AFE_DFTCON_RESET},
+  {REG_AFE_LPTIASW0,      REG_AFE_LPTIASW0_RESET},
+  {REG_AFE_LPTIACON0,     REG_AFE_LPTIACON0_RESET},
+  {REG_AFE_HSRTIACON,     REG_AFE_HSRTIACON_RESET},
+  {REG_AFE_DE0RESCON,     REG_AFE_DE0RESCON_RESET},
+  {REG_AFE_HSTIACON,      REG_AFE_HSTIACON_RESET},
+  {REG_AFE_LPMODEKEY,     REG_AFE_LPMODEKEY_RESET},
+  {REG_AFE_LPMODECLKSEL,  REG_AFE_LPMODECLKSEL_RESET},
+  {REG_AFE_LPMODECON,     REG_AFE_LPMODECON_RESET},
+  {REG_AFE_SEQSLPLOCK,    REG_AFE_SEQSLPLOCK_RESET},
+  {REG_AFE_SEQTRGSLP,     REG_AFE_SEQTRGSLP_RESET},
+  {REG_AFE_LPDACDAT0,     REG_AFE_LPDACDAT0_RESET},
+  {REG_AFE_LPDACSW0,      REG_AFE_LPDACSW0_RESET},
+  {REG_AFE_LPDACCON0,     REG_AFE_LPDACCON0_RESET},
+  {REG_AFE_DSWFULLCON,    REG_AFE_DSWFULLCON_RESET},
+  {REG_AFE_NSWFULLCON,    REG_AFE_NSWFULLCON_RESET},
+  {REG_AFE_PSWFULLCON,    REG_AFE_PSWFULLCON_RESET},
+  {REG_AFE_TSWFULLCON,    REG_AFE_TSWFULLCON_RESET},
+  {REG_AFE_TEMPSENS,      REG_AFE_TEMPSENS_RESET},
+  {REG_AFE_BUFSENCON,     REG_AFE_BUFSENCON_RESET},
+  {REG_AFE_ADCCON,        REG_AFE_ADCCON_RESET},
+  {REG_AFE_DSWSTA,        REG_AFE_DSWSTA_RESET},
+  {REG_AFE_PSWSTA,        REG_AFE_PSWSTA_RESET},
+  {REG_AFE_NSWSTA,        REG_AFE_NSWSTA_RESET},
+  {REG_AFE_TSWSTA,        REG_AFE_TSWSTA_RESET},
+  {REG_AFE_STATSVAR,      REG_AFE_STATSVAR_RESET},
+  {REG_AFE_STATSCON,      REG_AFE_STATSCON_RESET},
+  {REG_AFE_STATSMEAN,     REG_AFE_STATSMEAN_RESET},
+  {REG_AFE_SEQ0INFO,      REG_AFE_SEQ0INFO_RESET},
+  {REG_AFE_SEQ2INFO,      REG_AFE_SEQ2INFO_RESET},
+  {REG_AFE_CMDFIFOWADDR,  REG_AFE_CMDFIFOWADDR_RESET},
+  {REG_AFE_CMDDATACON,    REG_AFE_CMDDATACON_RESET},
+  {REG_AFE_DATAFIFOTHRES, REG_AFE_DATAFIFOTHRES_RESET},
+  {REG_AFE_SEQ3INFO,      REG_AFE_SEQ3INFO_RESET},
+  {REG_AFE_SEQ1INFO,      REG_AFE_SEQ1INFO_RESET},
+  {REG_AFE_REPEATADCCNV,  REG_AFE_REPEATADCCNV_RESET},
+};
+#define SEQGEN_REGDEFAULT_NUM   (sizeof(SEQGenRegDefault)/sizeof(SEQGenRegDefault[0]))
+#endif
+
 /**
- * @brief Get the register default value by SPI read. This function requires AD5940 is in active state, otherwise we cannot get the default register value.
+ * @brief Get the register default value. The reset value table is used so sequence is generated without SPI access
+ *        and doesn't depend on chip state. Registers not in table, or all registers if AD5940_SEQGEN_LIVEREAD is defined,
+ *        are read by SPI. That requires AD5940 is in active state.
  * @param RegAddr: The register address.
  * @param pRegData: Pointer to a variable to store register default value.
  * @return Return AD5940ERR_OK.
 */
 static AD5940Err AD5940_SEQGenGetRegDefault(uint32_t RegAddr, uint32_t *pRegData)
 {
+#ifndef AD5940_SEQGEN_LIVEREAD
+  int32_t low = 0, high = SEQGEN_REGDEFAULT_NUM - 1, mid;
+
+  while(low <= high)
+  {
+    mid = (low + high)/2;
+    if(SEQGenRegDefault[mid].RegAddr == RegAddr)
+    {
+      *pRegData = SEQGenRegDefault[mid].RegData;
+      return AD5940ERR_OK;
+    }
+    if(SEQGenRegDefault[mid].RegAddr < RegAddr)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+#endif
 #ifdef CHIPSEL_M355
   *pRegData = AD5940_D2DReadReg(RegAddr);
 #else
@@ -171,13 +326,17 @@ static AD5940Err AD5940_SEQGenGetRegDefault(uint32_t RegAddr, uint32_t *pRegData
 static void AD5940_SEQRegInfoInsert(uint16_t RegAddr, uint32_t RegData)
 {
   uint32_t temp;
+  SEQGenRegInfo_Type *pRegInfo;
   temp = SeqGenDB.RegCount + SeqGenDB.SeqLen;
   
   if(temp < SeqGenDB.BufferSize)
   {
-    SeqGenDB.pRegInfo --; /* Move back */
-    SeqGenDB.pRegInfo[0].RegAddr = (RegAddr>>2)&0xff;
-    SeqGenDB.pRegInfo[0].RegValue = RegData&0x00ffffff;
+    RegAddr = (RegAddr>>2)&0xff;
+    pRegInfo = SeqGenDB.pRegInfo - SeqGenDB.RegCount; /* Register info grows from end of buffer */
+    pRegInfo->RegAddr = RegAddr;
+    pRegInfo->RegValue = RegData&0x00ffffff;
+    SeqGenDB.RegIndex[RegAddr] = (uint8_t)SeqGenDB.RegCount;
+    SeqGenDB.RegMap[RegAddr>>5] |= 1UL<<(RegAddr&0x1f);
     SeqGenDB.RegCount ++;
   }
   else  /* There is no more buffer  */
@@ -204,7 +363,7 @@ static uint32_t AD5940_SEQReadReg(uint16_t RegAddr)
   else
   {
     /* return the current register value stored in data-base */
-    RegData = SeqGenDB.pRegInfo[RegIndex].RegValue;
+    RegData = (SeqGenDB.pRegInfo - RegIndex)->RegValue;
   }
 
   return RegData;
@@ -230,7 +389,7 @@ static void AD5940_SEQWriteReg(uint16_t RegAddr, uint32_t RegData)
   if(AD5940_SEQGenSearchReg(RegAddr, &RegIndex) == AD5940ERR_OK)
   {
     /* Store register value */
-    SeqGenDB.pRegInfo[RegIndex].RegValue = RegData;
+    (SeqGenDB.pRegInfo - RegIndex)->RegValue = RegData;
     /* Generate Sequence command */
     AD5940_SEQGenInsert(SEQ_WR(RegAddr, RegData));
   }
@@ -263,13 +422,117 @@ void AD5940_SEQGenInit(uint32_t *pBuffer, uint32_t BufferSize)
   SeqGenDB.pRegInfo = (SEQGenRegInfo_Type*)pBuffer + BufferSize - 1; /* Point to the last element in buffer */
   SeqGenDB.SeqLen = 0;
 
-  SeqGenDB.RegCount = 0;
+  AD5940_SEQGenClearRegInfo();
   SeqGenDB.LastError = AD5940ERR_OK;
   SeqGenDB.EngineStart = bFALSE;
 }
 
 /**
- * @brief Get sequencer command generated.
+ * Registers that have side effect when written by sequencer. Writes to them are never removed,
+ * and optimizer doesn't look across them.
+*/
+static const uint16_t SeqOptBarrierReg[] =
+{
+  REG_AFE_SEQCON,         /* SEQ_STOP/SEQ_HALT */
+  REG_AFE_FIFOCON,        /* Disable then enable resets FIFO */
+  REG_AFE_SYNCEXTDEVICE,  /* GPIO pulse */
+  REG_AFE_SEQCRC,
+  REG_AFE_SEQCNT,
+  REG_AFE_DATAFIFORD,
+  REG_AFE_CMDFIFOWRITE,
+  REG_AFE_AFEGENINTSTA,   /* SEQ_INTx */
+  REG_AFE_SEQSLPLOCK,
+  REG_AFE_SEQTRGSLP,      /* SEQ_SLP */
+  REG_AFE_CMDFIFOWADDR,
+};
+
+/**
+ * @brief Check if command is a write to register listed in SeqOptBarrierReg.
+ * @param Cmd: Sequencer command. Must be a write command.
+ * @return Return bTRUE if it's a barrier.
+*/
+static BoolFlag AD5940_SEQOptIsBarrier(uint32_t Cmd)
+{
+  uint32_t i, RegAddr;
+
+  RegAddr = 0x2000 + (((Cmd>>24)&0x7f)<<2);
+  for(i=0;i<sizeof(SeqOptBarrierReg)/sizeof(SeqOptBarrierReg[0]);i++)
+  {
+    if(RegAddr == SeqOptBarrierReg[i])
+      return bTRUE;
+  }
+  return bFALSE;
+}
+
+/**
+ * @brief Peephole optimizer for sequencer commands. The sequence is optimized in place.
+ * @details Following commands are removed:
+ *          - A register write that is overwritten before any wait/time-out command, e.g. AFECON on then off.
+ *          - A register write of the value that register already holds in this sequence.
+ *          - Back-to-back wait commands, they are merged to one. A wait takes its count of clocks including its own
+ *            execution(see AD5940_SEQCmdCycles), so the merged count is the sum of both and total wait time is unchanged.
+ *          Each removed write makes sequence one sequencer clock shorter.
+ *          Writes to registers with side effect(SEQCON, FIFOCON, SYNCEXTDEVICE, SEQTRGSLP, AFEGENINTSTA etc.) are kept
+ *          and nothing is optimized across them.
+ * @param pSeqCmd: Pointer to sequence commands.
+ * @param SeqLen: Number of commands.
+ * @return Return the number of commands after optimization.
+*/
+uint32_t AD5940_SEQOptimize(uint32_t *pSeqCmd, uint32_t SeqLen)
+{
+  uint32_t i, j, k, Len, Cmd, Prev;
+  BoolFlag bLive, bDrop;
+
+  Len = 0;
+  for(i=0;i<SeqLen;i++)
+  {
+    Cmd = pSeqCmd[i];
+    bDrop = bFALSE;
+    if((Cmd&0xc0000000) == 0) /* Wait command */
+    {
+      if((Len > 0) && ((pSeqCmd[Len-1]&0xc0000000) == 0) &&
+         (AD5940_SEQCmdCycles(pSeqCmd[Len-1]) + AD5940_SEQCmdCycles(Cmd) <= 0x3fffffff))
+      {
+        pSeqCmd[Len-1] = AD5940_SEQCmdCycles(pSeqCmd[Len-1]) + AD5940_SEQCmdCycles(Cmd);
+        bDrop = bTRUE;
+      }
+    }
+    else if((Cmd&0x80000000) && (AD5940_SEQOptIsBarrier(Cmd) == bFALSE))
+    {
+      bLive = bFALSE;   /* Set once a wait/time-out is found, the earlier writes took effect */
+      for(k=Len;k>0;k--)
+      {
+        Prev = pSeqCmd[k-1];
+        if((Prev&0x80000000) == 0)
+        {
+          bLive = bTRUE;
+          continue;
+        }
+        if(AD5940_SEQOptIsBarrier(Prev) == bTRUE)
+          break;
+        if(((Prev^Cmd)&0x7f000000) != 0)
+          continue;     /* Other register */
+        if(Prev == Cmd)
+        {
+          bDrop = bTRUE;  /* Register already holds this value */
+          break;
+        }
+        if(bLive == bTRUE)
+          break;
+        /* Overwritten before it takes effect, remove it and check the value before it */
+        for(j=k-1;j<Len-1;j++)
+          pSeqCmd[j] = pSeqCmd[j+1];
+        Len--;
+      }
+    }
+    if(bDrop == bFALSE)
+      pSeqCmd[Len++] = Cmd;
+  }
+  return Len;
+}
+
+/**
+ * @brief Get sequencer command generated. The sequence is optimized by @ref AD5940_SEQOptimize if SEQUENCE_OPTIMIZER is defined.
  * @param ppSeqCmd: Pointer to a variable(pointer) used to store the pointer to generated sequencer command.
  * @param pSeqLen: Pointer to a variable that used to store how many commands available in buffer.
  * @return Return lasterror.
@@ -278,6 +541,10 @@ AD5940Err AD5940_SEQGenFetchSeq(const uint32_t **ppSeqCmd, uint32_t *pSeqLen)
 {
   AD5940Err lasterror;
 
+#ifdef SEQUENCE_OPTIMIZER
+  if(SeqGenDB.LastError == AD5940ERR_OK)
+    SeqGenDB.SeqLen = AD5940_SEQOptimize(SeqGenDB.pSeqBuff, SeqGenDB.SeqLen);
+#endif
   if(ppSeqCmd)
     *ppSeqCmd = SeqGenDB.pSeqBuff;  
   if(pSeqLen)
@@ -315,33 +582,81 @@ void AD5940_SEQGenCtrl(BoolFlag bFlag)
 */
 uint32_t AD5940_SEQCycleTime(void)
 {
-  uint32_t i, Cycles, Cmd;  
+  uint32_t i, Cycles;  
   Cycles = 0;
-  for(i=0;i<SeqGenDB.RegCount;i++)
+  for(i=0;i<SeqGenDB.SeqLen;i++)
+    Cycles += AD5940_SEQCmdCycles(SeqGenDB.pSeqBuff[i]);
+  return Cycles;  
+}
+#endif
+
+/**
+ * @brief Analyze timing and power of a sequence without running it.
+ * @details Sequencer commands are executed one per clock. Wait command stops sequencer for specified clocks,
+ *          timeout command only starts a timer. AFECON writes are tracked to know which blocks are powered
+ *          in each clock. Analysis ends at SEQ_STOP or the last command.
+ * @param pSeqCmd: Sequencer commands, either generated or stored in MCU flash.
+ * @param SeqLen: Number of commands.
+ * @param pCfg: Clock, initial AFECON and optional current table and conversion to check.
+ * @param pResult: Duration, maximum ODR, estimated charge and block on-time of this sequence.
+ * @return AD5940ERR_OK or AD5940ERR_PARA if clock frequency is not positive.
+*/
+AD5940Err AD5940_SEQAnalyze(const uint32_t *pSeqCmd, uint32_t SeqLen, const SEQAnalyzeCfg_Type *pCfg, SEQAnalyzeResult_Type *pResult)
+{
+  uint32_t i, bit, Cmd, Cycles, RegAddr, Afecon, Conv;
+  float Current, Charge;
+
+  if(pSeqCmd == NULL || pCfg == NULL || pResult == NULL)
+    return AD5940ERR_NULLP;
+  if(pCfg->SysClkFreq <= 0)
+    return AD5940ERR_PARA;
+  AD5940_StructInit(pResult, sizeof(*pResult));
+  if(pCfg->pClksCal)
+    AD5940_ClksCalculate(pCfg->pClksCal, &pResult->ConvCyclesReq);
+  Afecon = pCfg->AfeconInit;
+  Current = AD5940_SEQBlockCurrent(pCfg, Afecon);
+  Charge = 0;
+  Conv = 0;
+  for(i=0;i<SeqLen;i++)
   {
-    Cmd = (SeqGenDB.pSeqBuff[i]  >> 30) & 0x3;
-    if (Cmd & 0x2)
+    Cmd = pSeqCmd[i];
+    Cycles = AD5940_SEQCmdCycles(Cmd);
+    pResult->Cycles += Cycles;
+    Charge += Current*Cycles;
+    for(bit=0;bit<32;bit++)
     {
-      /* A write command */
-      Cycles += 1;
+      if(Afecon & (1UL<<bit))
+        pResult->BlockCycles[bit] += Cycles;
+    }
+    if(Afecon & AFECTRL_ADCCNV)
+    {
+      Conv += Cycles;
+      if(Conv > pResult->ConvCycles)
+        pResult->ConvCycles = Conv;
     }
     else
+      Conv = 0;
+    if(Cmd & 0x80000000)
     {
-      if (Cmd & 0x1)
+      /* A write command. Register address is 0x2000 + 4*(bit30:24) */
+      RegAddr = REG_AFE_AFECON + (((Cmd>>24)&0x7f)<<2);
+      if(RegAddr == REG_AFE_AFECON)
       {
-        /* Timeout Command */    
-        Cycles += 1;
+        Afecon = Cmd&0xffffff;
+        Current = AD5940_SEQBlockCurrent(pCfg, Afecon);
       }
-      else
-        {
-          /* Wait command */
-          Cycles += SeqGenDB.pSeqBuff[i] & 0x3FFFFFFF;
-        }
+      else if(RegAddr == REG_AFE_SEQTRGSLP)
+        pResult->bSleep = bTRUE;
+      else if(Cmd == SEQ_STOP())
+        break;
     }
-  } 
-  return Cycles;  
+  }
+  pResult->AfeconEnd = Afecon;
+  pResult->Duration = pResult->Cycles/pCfg->SysClkFreq;
+  pResult->MaxODR = pResult->Cycles?pCfg->SysClkFreq/pResult->Cycles:0;
+  pResult->Charge = pCfg->pBlockCurrent?Charge/pCfg->SysClkFreq:0;
+  return AD5940ERR_OK;
 }
-#endif
 /**
  * @} Sequencer_Generator_Functions
 */
@@ -876,8 +1191,8 @@ void AD5940_FIFORd(uint32_t *pBuffer, uint32_t uiReadCount)
  * @{
  * 
  * @defgroup SPI_Block_Functions
- * @brief The basic SPI protocols. All functions are basic on AD5940_ReadWriteNBytes which
- *        provided by user.
+ * @brief The basic SPI protocols. All functions build SPI frames and run them by the
+ *        transaction engine (AD5940_SPISubmit) provided by platform.
  *        
  *  ##SPI basic protocol
  *        All SPI protocol starts with one-byte command word. Following are data(16B or 32B)
@@ -886,49 +1201,39 @@ void AD5940_FIFORd(uint32_t *pBuffer, uint32_t uiReadCount)
 */
 
 /**
-  @brief Using SPI to transmit one byte and return the received byte. 
-  @param data: The 8-bit data SPI will transmit.
-  @return received data.
-**/
-static unsigned char AD5940_ReadWrite8B(unsigned char data)
-{
-   uint8_t tx[1], rx[1];
-   tx[0] = data;
-   AD5940_ReadWriteNBytes(tx,rx,1);
-   return rx[0];
-}
-
-/**
-  @brief Using SPI to transmit two bytes and return the received bytes. 
-  @param data: The 16-bit data SPI will transmit.
-  @return received data.
-**/
-static uint16_t AD5940_ReadWrite16B(uint16_t data)
-{
-   uint8_t SendBuffer[2];
-   uint8_t RecvBuffer[2];
-   SendBuffer[0] = data>>8;
-   SendBuffer[1] = data&0xff;
-   AD5940_ReadWriteNBytes(SendBuffer,RecvBuffer,2);
-   return (((uint16_t)RecvBuffer[0])<<8)|RecvBuffer[1];
-}
-
-/**
- * @brief Using SPI to transmit four bytes and return the received bytes. 
- * @param data: The 32-bit data SPI will transmit.
- * @return received data.
+ * @brief Encode SETADDR and WRITEREG frames of one register write.
+ * @param pBuff: Buffer to store SPI bytes. 8 bytes at most are used.
+ * @param pFrames: Two frames are filled. Frames point into pBuff.
+ * @param RegAddr: The register address.
+ * @param RegData: The register data.
+ * @return Number of bytes used in pBuff.
 **/
-static uint32_t AD5940_ReadWrite32B(uint32_t data)
+static uint32_t AD5940_SPIEncodeWrite(uint8_t *pBuff, AD5940_SPIFrame_Type *pFrames, uint16_t RegAddr, uint32_t RegData)
 {
-   uint8_t SendBuffer[4];
-   uint8_t RecvBuffer[4];
-  
-   SendBuffer[0] = (data>>24)&0xff;
-   SendBuffer[1] = (data>>16)&0xff;
-   SendBuffer[2] = (data>> 8)&0xff;
-   SendBuffer[3] = (data    )&0xff;
-   AD5940_ReadWriteNBytes(SendBuffer,RecvBuffer,4);
-   return (((uint32_t)RecvBuffer[0])<<24)|(((uint32_t)RecvBuffer[1])<<16)|(((uint32_t)RecvBuffer[2])<<8)|RecvBuffer[3];
+  uint32_t len = 0;
+  /* Set register address */
+  pBuff[len++] = SPICMD_SETADDR;
+  pBuff[len++] = RegAddr>>8;
+  pBuff[len++] = RegAddr&0xff;
+  /* Write it */
+  pBuff[len++] = SPICMD_WRITEREG;
+  if(((RegAddr>=0x1000)&&(RegAddr<=0x3014)))  /* 32bit register */
+  {
+    pBuff[len++] = (RegData>>24)&0xff;
+    pBuff[len++] = (RegData>>16)&0xff;
+  }
+  pBuff[len++] = (RegData>>8)&0xff;
+  pBuff[len++] = RegData&0xff;
+
+  pFrames[0].pTx = pBuff;
+  pFrames[0].pRx = 0;
+  pFrames[0].Length = 3;
+  pFrames[0].TxFill = 0;
+  pFrames[0].CsCtrl = AD5940_FRAME_CS_FULL;
+  pFrames[1] = pFrames[0];
+  pFrames[1].pTx = pBuff + 3;
+  pFrames[1].Length = len - 3;
+  return len;
 }
 
 /**
@@ -939,19 +1244,11 @@ static uint32_t AD5940_ReadWrite32B(uint32_t data)
 **/
 static void AD5940_SPIWriteReg(uint16_t RegAddr, uint32_t RegData)
 {  
-  /* Set register address */
-  AD5940_CsClr();
-  AD5940_ReadWrite8B(SPICMD_SETADDR);
-  AD5940_ReadWrite16B(RegAddr);
-  AD5940_CsSet();
-  /* Add delay here to meet the SPI timing. */
-  AD5940_CsClr();
-  AD5940_ReadWrite8B(SPICMD_WRITEREG);
-  if(((RegAddr>=0x1000)&&(RegAddr<=0x3014)))
-    AD5940_ReadWrite32B(RegData);
-  else
-    AD5940_ReadWrite16B(RegData);
-  AD5940_CsSet();
+  uint8_t SendBuffer[8];
+  AD5940_SPIFrame_Type Frames[2];
+
+  AD5940_SPIEncodeWrite(SendBuffer, Frames, RegAddr, RegData);
+  AD5940_SPITransfer(Frames, 2);
 }
 
 /**
@@ -961,70 +1258,245 @@ static void AD5940_SPIWriteReg(uint16_t RegAddr, uint32_t RegData)
 **/
 static uint32_t AD5940_SPIReadReg(uint16_t RegAddr)
 {  
-  uint32_t Data = 0;
+  uint8_t SendBuffer[9] = {SPICMD_SETADDR, 0, 0, SPICMD_READREG, 0, 0, 0, 0, 0};
+  uint8_t RecvBuffer[6];
+  AD5940_SPIFrame_Type Frames[2];
+  BoolFlag b32bit = ((RegAddr>=0x1000)&&(RegAddr<=0x3014))?bTRUE:bFALSE;
+
   /* Set register address that we want to read */
-  AD5940_CsClr();
-  AD5940_ReadWrite8B(SPICMD_SETADDR);
-  AD5940_ReadWrite16B(RegAddr);
-  AD5940_CsSet();
-  /* Read it */
-  AD5940_CsClr();
-  AD5940_ReadWrite8B(SPICMD_READREG);
-  AD5940_ReadWrite8B(0);  //Dummy read
-  /* The real data is coming */
-  if((RegAddr>=0x1000)&&(RegAddr<=0x3014))
-    Data = AD5940_ReadWrite32B(0);
-  else
-    Data = AD5940_ReadWrite16B(0);
-  AD5940_CsSet();
-  return Data;
+  SendBuffer[1] = RegAddr>>8;
+  SendBuffer[2] = RegAddr&0xff;
+  Frames[0].pTx = SendBuffer;
+  Frames[0].pRx = 0;
+  Frames[0].Length = 3;
+  Frames[0].TxFill = 0;
+  Frames[0].CsCtrl = AD5940_FRAME_CS_FULL;
+  /* Read it: command, one dummy byte, then the real data is coming */
+  Frames[1].pTx = SendBuffer + 3;
+  Frames[1].pRx = RecvBuffer;
+  Frames[1].Length = b32bit?6:4;
+  Frames[1].TxFill = 0;
+  Frames[1].CsCtrl = AD5940_FRAME_CS_FULL;
+  AD5940_SPITransfer(Frames, 2);
+
+  if(b32bit)
+    return (((uint32_t)RecvBuffer[2])<<24)|(((uint32_t)RecvBuffer[3])<<16)|(((uint32_t)RecvBuffer[4])<<8)|RecvBuffer[5];
+  return (((uint32_t)RecvBuffer[2])<<8)|RecvBuffer[3];
+}
+
+/**
+  @brief Convert words received as raw SPI bytes (MSB first) to CPU byte order in place.
+  @param pBuffer: The received words.
+  @param uiCount: Number of words.
+  @return none.
+**/
+static void AD5940_FIFOWordSwap(uint32_t *pBuffer, uint32_t uiCount)
+{
+  uint8_t *p;
+  while(uiCount--)
+  {
+    p = (uint8_t *)pBuffer;
+    *pBuffer++ = (((uint32_t)p[0])<<24)|(((uint32_t)p[1])<<16)|(((uint32_t)p[2])<<8)|p[3];
+  }
+}
+
+/* Command and 6 dummy bytes before valid data read back by READFIFO. */
+static const uint8_t FIFORdHeader[7] = {SPICMD_READFIFO, 0, 0, 0, 0, 0, 0};
+/* Last two FIFO data are read back with none-zero offset */
+static const uint8_t FIFORdTail[8] = {0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44};
+
+/**
+  @brief Fill the frames of a READFIFO transaction. Bulk data is read with constant 0 offset
+         so the platform can move it with DMA; bytes arrive MSB first and are swapped afterwards.
+  @param pFrames: Four frames at most are filled.
+  @param pSeg0: Buffer of first part of bulk data.
+  @param uiSeg0: Words in first part.
+  @param pSeg1: Buffer of second part of bulk data when ring buffer wraps.
+  @param uiSeg1: Words in second part. Can be 0.
+  @param pTail: 8 bytes buffer for last two words.
+  @return Number of frames.
+**/
+static uint32_t AD5940_FIFORdFrames(AD5940_SPIFrame_Type *pFrames, uint32_t *pSeg0, uint32_t uiSeg0,
+                                    uint32_t *pSeg1, uint32_t uiSeg1, uint8_t *pTail)
+{
+  uint32_t n = 0;
+  pFrames[n].pTx = FIFORdHeader;
+  pFrames[n].pRx = 0;
+  pFrames[n].Length = sizeof(FIFORdHeader);
+  pFrames[n].TxFill = 0;
+  pFrames[n++].CsCtrl = AD5940_FRAME_CS_ASSERT;
+  if(uiSeg0)
+  {
+    pFrames[n].pTx = 0;
+    pFrames[n].pRx = (uint8_t *)pSeg0;
+    pFrames[n].Length = uiSeg0*4;
+    pFrames[n].TxFill = 0;
+    pFrames[n++].CsCtrl = 0;
+  }
+  if(uiSeg1)
+  {
+    pFrames[n] = pFrames[n-1];
+    pFrames[n].pRx = (uint8_t *)pSeg1;
+    pFrames[n++].Length = uiSeg1*4;
+  }
+  pFrames[n].pTx = FIFORdTail;
+  pFrames[n].pRx = pTail;
+  pFrames[n].Length = sizeof(FIFORdTail);
+  pFrames[n].TxFill = 0;
+  pFrames[n++].CsCtrl = AD5940_FRAME_CS_RELEASE;
+  return n;
 }
 
 /**
   @brief Read specific number of data from FIFO with optimized SPI access.
   @param pBuffer: Pointer to a buffer that used to store data read back.
-  @param uiReadCount: How much data to be read.
+  @param uiReadCount: How much data to be read. Data FIFO is 6kB at most, so it's less than 1536.
   @return none.
 **/
 void AD5940_FIFORd(uint32_t *pBuffer, uint32_t uiReadCount)   
 {
   /* Use function AD5940_SPIReadReg to read REG_AFE_DATAFIFORD is also one method. */
-   uint32_t i;
-   
-   if(uiReadCount < 3)
-   {
-      /* This method is more efficient when readcount < 3 */
-      uint32_t i;
-      AD5940_CsClr();
-      AD5940_ReadWrite8B(SPICMD_SETADDR);
-      AD5940_ReadWrite16B(REG_AFE_DATAFIFORD);
-      AD5940_CsSet();
-      for(i=0;i<uiReadCount;i++)
-      {
-         AD5940_CsClr();
-         AD5940_ReadWrite8B(SPICMD_READREG);
-         AD5940_ReadWrite8B(0);//Write Host status/Don't care
-         pBuffer[i] = AD5940_ReadWrite32B(0);
-         AD5940_CsSet();
-      }
-   }
-   else
-   {
-      AD5940_CsClr();
-      AD5940_ReadWrite8B(SPICMD_READFIFO);
-      /* 6 dummy write before valid data read back */
-      for(i=0;i<6;i++)
-         AD5940_ReadWrite8B(0);
-      /* Continuously read DATAFIFORD register with offset 0 */
-      for(i=0;i<uiReadCount-2;i++)
-      {
-         pBuffer[i] = AD5940_ReadWrite32B(0); /*Offset is 0, so we always read DATAFIFORD register */
-      }
-      /* Read back last two FIFO data with none-zero offset*/
-      pBuffer[i++] = AD5940_ReadWrite32B(0x44444444);
-      pBuffer[i] = AD5940_ReadWrite32B(0x44444444);
-      AD5940_CsSet();
-   }
+  AD5940_SPIFrame_Type Frames[4];
+  uint8_t Tail[8];
+  uint32_t i;
+
+  if(uiReadCount == 0)
+    return;
+  if(uiReadCount < 3)
+  {
+    /* This method is more efficient when readcount < 3: set address once, then READREG for each data */
+    static const uint8_t SendBuffer[9] = {SPICMD_SETADDR, REG_AFE_DATAFIFORD>>8, REG_AFE_DATAFIFORD&0xff,
+                                          SPICMD_READREG, 0, 0, 0, 0, 0};
+    uint8_t RecvBuffer[2][6];
+    Frames[0].pTx = SendBuffer;
+    Frames[0].pRx = 0;
+    Frames[0].Length = 3;
+    Frames[0].TxFill = 0;
+    Frames[0].CsCtrl = AD5940_FRAME_CS_FULL;
+    for(i=0;i<uiReadCount;i++)
+    {
+      Frames[i+1] = Frames[0];
+      Frames[i+1].pTx = SendBuffer + 3;   /* Write Host status/Don't care, then data */
+      Frames[i+1].pRx = RecvBuffer[i];
+      Frames[i+1].Length = 6;
+    }
+    AD5940_SPITransfer(Frames, uiReadCount+1);
+    for(i=0;i<uiReadCount;i++)
+      pBuffer[i] = (((uint32_t)RecvBuffer[i][2])<<24)|(((uint32_t)RecvBuffer[i][3])<<16)|
+                   (((uint32_t)RecvBuffer[i][4])<<8)|RecvBuffer[i][5];
+  }
+  else
+  {
+    i = uiReadCount-2;
+    AD5940_SPITransfer(Frames, AD5940_FIFORdFrames(Frames, pBuffer, i, 0, 0, Tail));
+    AD5940_FIFOWordSwap(pBuffer, i);
+    pBuffer[i++] = (((uint32_t)Tail[0])<<24)|(((uint32_t)Tail[1])<<16)|(((uint32_t)Tail[2])<<8)|Tail[3];
+    pBuffer[i] = (((uint32_t)Tail[4])<<24)|(((uint32_t)Tail[5])<<16)|(((uint32_t)Tail[6])<<8)|Tail[7];
+  }
+}
+
+/* State of the FIFO read started by AD5940_FIFORdAsync */
+static struct
+{
+  AD5940_SPIXfer_Type Xfer;
+  AD5940_SPIFrame_Type Frames[4];
+  uint8_t Tail[8];
+  FIFORing_Type *pRing;
+  uint32_t Count;
+  void (*pfnDone)(void);
+}FIFORdAsync;
+
+/**
+  @brief Transaction completion of AD5940_FIFORdAsync. Converts the received words and publishes them to the ring.
+  @return none.
+**/
+static void AD5940_FIFORdAsyncDone(AD5940_SPIXfer_Type *pXfer)
+{
+  FIFORing_Type *pRing = FIFORdAsync.pRing;
+  uint32_t idx = pRing->WrIdx;
+  uint32_t bulk = FIFORdAsync.Count-2;
+  uint32_t seg0 = pRing->Size - idx;
+  uint8_t *p = FIFORdAsync.Tail;
+
+  (void)pXfer;
+  if(seg0 > bulk) seg0 = bulk;
+  AD5940_FIFOWordSwap(&pRing->pBuffer[idx], seg0);
+  AD5940_FIFOWordSwap(pRing->pBuffer, bulk-seg0);
+  idx = (idx + bulk)%pRing->Size;
+  pRing->pBuffer[idx] = (((uint32_t)p[0])<<24)|(((uint32_t)p[1])<<16)|(((uint32_t)p[2])<<8)|p[3];
+  idx = (idx + 1)%pRing->Size;
+  pRing->pBuffer[idx] = (((uint32_t)p[4])<<24)|(((uint32_t)p[5])<<16)|(((uint32_t)p[6])<<8)|p[7];
+  idx = (idx + 1)%pRing->Size;
+  pRing->WrIdx = idx;
+  FIFORdAsync.pRing = 0;
+  if(FIFORdAsync.pfnDone)
+    FIFORdAsync.pfnDone();
+}
+
+/**
+  @brief Read data FIFO into a ring buffer without waiting for the SPI transfer.
+         The read is one transaction submitted to the platform transaction engine, so on a DMA capable
+         platform the function returns while data is still moving. pfnDone is called (from
+         interrupt context on DMA platforms) once the words are in the ring.
+  @param pRing: The ring buffer initialized by AD5940_FIFORingInit.
+  @param uiReadCount: How much data to be read.
+  @param pfnDone: Callback when data is available in ring. Can be NULL.
+  @return AD5940ERR_OK, AD5940ERR_BUFF if ring has no space, AD5940ERR_ERROR if last read is ongoing.
+**/
+AD5940Err AD5940_FIFORdAsync(FIFORing_Type *pRing, uint32_t uiReadCount, void (*pfnDone)(void))
+{
+  uint32_t idx, bulk, seg0;
+
+  if(pRing == 0 || uiReadCount == 0)
+    return AD5940ERR_PARA;
+  if(FIFORdAsync.pRing != 0)
+    return AD5940ERR_ERROR;
+  if((pRing->Size - 1 - AD5940_FIFORingCount(pRing)) < uiReadCount)
+    return AD5940ERR_BUFF;
+  idx = pRing->WrIdx;
+  if(uiReadCount < 3)
+  {
+    /* Too short to benefit from burst. */
+    uint32_t Data[2];
+    AD5940_FIFORd(Data, uiReadCount);
+    for(seg0=0; seg0<uiReadCount; seg0++)
+    {
+      pRing->pBuffer[idx] = Data[seg0];
+      idx = (idx + 1)%pRing->Size;
+    }
+    pRing->WrIdx = idx;
+    if(pfnDone)
+      pfnDone();
+    return AD5940ERR_OK;
+  }
+  bulk = uiReadCount - 2;
+  seg0 = pRing->Size - idx;
+  if(seg0 > bulk) seg0 = bulk;
+  FIFORdAsync.pRing = pRing;
+  FIFORdAsync.Count = uiReadCount;
+  FIFORdAsync.pfnDone = pfnDone;
+  FIFORdAsync.Xfer.pFrames = FIFORdAsync.Frames;
+  FIFORdAsync.Xfer.FrameCount = AD5940_FIFORdFrames(FIFORdAsync.Frames, &pRing->pBuffer[idx], seg0,
+                                                    pRing->pBuffer, bulk-seg0, FIFORdAsync.Tail);
+  FIFORdAsync.Xfer.pfnDone = AD5940_FIFORdAsyncDone;
+  FIFORdAsync.Xfer.pUser = 0;
+  if(AD5940_SPISubmit(&FIFORdAsync.Xfer) != 0)
+  {
+    FIFORdAsync.pRing = 0;
+    return AD5940ERR_ERROR;
+  }
+  return AD5940ERR_OK;
+}
+
+/**
+  @brief Wait until the read started by AD5940_FIFORdAsync is finished and its callback has returned.
+         The platform idle hook runs while waiting. Do not call it from the callback.
+  @return none.
+**/
+void AD5940_FIFORdAsyncWait(void)
+{
+  if(FIFORdAsync.Xfer.pFrames != 0)
+    AD5940_SPIWait(&FIFORdAsync.Xfer);
 }
 
 /**
@@ -1033,6 +1505,214 @@ void AD5940_FIFORd(uint32_t *pBuffer, uint32_t uiReadCount)
 */
 #endif
 
+#ifdef CHIPSEL_M355
+AD5940Err AD5940_FIFORdAsync(FIFORing_Type *pRing, uint32_t uiReadCount, void (*pfnDone)(void))
+{
+  uint32_t idx;
+  if(pRing == 0 || uiReadCount == 0)
+    return AD5940ERR_PARA;
+  if((pRing->Size - 1 - AD5940_FIFORingCount(pRing)) < uiReadCount)
+    return AD5940ERR_BUFF;
+  idx = pRing->WrIdx;
+  while(uiReadCount--)
+  {
+    pRing->pBuffer[idx] = *(volatile uint32_t *)(0x400c206C);
+    idx = (idx + 1)%pRing->Size;
+  }
+  pRing->WrIdx = idx;
+  if(pfnDone)
+    pfnDone();
+  return AD5940ERR_OK;
+}
+
+void AD5940_FIFORdAsyncWait(void)
+{
+}
+#endif
+
+/**
+ * @brief Initialize the ring buffer used by AD5940_FIFORdAsync.
+ * @param pRing: The ring buffer.
+ * @param pBuffer: Word storage of the ring.
+ * @param Size: Number of words in pBuffer. Ring holds at most Size-1 words.
+ * @return none.
+**/
+void AD5940_FIFORingInit(FIFORing_Type *pRing, uint32_t *pBuffer, uint32_t Size)
+{
+  pRing->pBuffer = pBuffer;
+  pRing->Size = Size;
+  pRing->WrIdx = 0;
+  pRing->RdIdx = 0;
+}
+
+/**
+ * @brief Get how many words are waiting in ring buffer.
+ * @param pRing: The ring buffer.
+ * @return Number of words.
+**/
+uint32_t AD5940_FIFORingCount(FIFORing_Type *pRing)
+{
+  uint32_t wr = pRing->WrIdx;
+  uint32_t rd = pRing->RdIdx;
+  return (wr >= rd)?(wr - rd):(pRing->Size - rd + wr);
+}
+
+/**
+ * @brief Take words out of ring buffer.
+ * @param pRing: The ring buffer.
+ * @param pData: Buffer to store the words.
+ * @param MaxCount: Size of pData in words.
+ * @return Number of words copied.
+**/
+uint32_t AD5940_FIFORingPop(FIFORing_Type *pRing, uint32_t *pData, uint32_t MaxCount)
+{
+  uint32_t count = AD5940_FIFORingCount(pRing);
+  uint32_t rd = pRing->RdIdx;
+  uint32_t i;
+  if(count > MaxCount) count = MaxCount;
+  for(i=0;i<count;i++)
+  {
+    pData[i] = pRing->pBuffer[rd];
+    rd = (rd + 1)%pRing->Size;
+  }
+  pRing->RdIdx = rd;
+  return count;
+}
+
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+/**
+ * Registers kept in shadow cache. Only registers that are written by MCU alone can be listed here:
+ * status/data/flag registers change by hardware, and registers like AFECON are also written by
+ * sequences running on chip, so they are always read from chip.
+*/
+static const uint16_t RegCacheAddr[] =
+{
+  REG_AFE_FIFOCON,
+  REG_AFE_SEQCON,
+  REG_AFE_CMDDATACON,
+  REG_AFE_DATAFIFOTHRES,
+  REG_AFE_SEQ0INFO,
+  REG_AFE_SEQ1INFO,
+  REG_AFE_SEQ2INFO,
+  REG_AFE_SEQ3INFO,
+  REG_INTC_INTCPOL,
+  REG_INTC_INTCSEL0,
+  REG_INTC_INTCSEL1,
+  REG_WUPTMR_CON,
+  REG_AGPIO_GP0CON,
+  REG_AGPIO_GP0OEN,
+  REG_AGPIO_GP0PE,
+  REG_AGPIO_GP0IEN,
+};
+#define REGCACHE_SIZE   (sizeof(RegCacheAddr)/sizeof(RegCacheAddr[0]))
+
+static uint32_t RegCacheData[REGCACHE_SIZE];
+static uint32_t RegCacheValid;    /* Bit n set: RegCacheData[n] is same as chip */
+static uint32_t RegCacheSeqMask;  /* Bit n set: register is written by a sequence, never cache it */
+static RegCacheStat_Type RegCacheStat;
+
+/**
+ * @brief Find register in cache table.
+ * @param RegAddr: The register address.
+ * @return Index in RegCacheAddr, or -1 if register is not cacheable.
+**/
+static int32_t AD5940_RegCacheIndex(uint16_t RegAddr)
+{
+  int32_t i;
+  for(i=0; i<(int32_t)REGCACHE_SIZE; i++)
+  {
+    if(RegCacheAddr[i] == RegAddr)
+      return (RegCacheSeqMask & (1L<<i))?-1:i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Check command recorded by sequence generator. Register written by sequencer is changed
+ *        without MCU knowing it, so it's removed from cache.
+ * @param CmdWord: The sequencer command.
+ * @return Return None.
+**/
+static void AD5940_RegCacheSeqCmd(uint32_t CmdWord)
+{
+  int32_t i;
+  if((CmdWord & 0x80000000) == 0) return; /* Not a write command */
+  i = AD5940_RegCacheIndex(0x2000 | (((CmdWord>>24)&0x7f)<<2));
+  if(i < 0) return;
+  RegCacheSeqMask |= 1L<<i;
+  RegCacheValid &= ~(1L<<i);
+}
+
+/**
+ * @brief Update cache after register is written to chip (write-through).
+ * @param RegAddr: The register address.
+ * @param RegData: The register data.
+ * @return Return None.
+**/
+static void AD5940_RegCacheUpdate(uint16_t RegAddr, uint32_t RegData)
+{
+  int32_t i = AD5940_RegCacheIndex(RegAddr);
+  if(i < 0) return;
+  RegCacheData[i] = RegData;
+  RegCacheValid |= 1L<<i;
+}
+
+/**
+ * @brief Read register through cache.
+ * @param RegAddr: The register address.
+ * @return Return register value.
+**/
+static uint32_t AD5940_RegCacheRead(uint16_t RegAddr)
+{
+  uint32_t RegData;
+  int32_t i = AD5940_RegCacheIndex(RegAddr);
+  if(i < 0)
+  {
+    RegCacheStat.Uncached++;
+    return AD5940_SPIReadReg(RegAddr);
+  }
+  if(RegCacheValid & (1L<<i))
+  {
+    RegCacheStat.Hit++;
+    return RegCacheData[i];
+  }
+  RegCacheStat.Miss++;
+  RegData = AD5940_SPIReadReg(RegAddr);
+  RegCacheData[i] = RegData;
+  RegCacheValid |= 1L<<i;
+  return RegData;
+}
+#endif
+
+/**
+ * @brief Drop all cached register values. Next read of each register goes to chip.
+ *        Called on reset. Call it if registers listed in cache are changed by others, like a sequence.
+ * @return Return None.
+**/
+void AD5940_RegCacheInvalidate(void)
+{
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+  RegCacheValid = 0;
+#endif
+}
+
+/**
+ * @brief Get register cache statistics.
+ * @param pStat: Pointer to structure to store statistics. All zero if cache is disabled.
+ * @return Return None.
+**/
+void AD5940_RegCacheGetStat(RegCacheStat_Type *pStat)
+{
+  if(pStat == NULL) return;
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+  *pStat = RegCacheStat;
+#else
+  pStat->Hit = 0;
+  pStat->Miss = 0;
+  pStat->Uncached = 0;
+#endif
+}
+
 /**
  * @brief Write register. If sequencer generator is enabled, the register write is recorded. 
  *        Otherwise, the data is written to AD5940 by SPI.
@@ -1050,7 +1730,12 @@ void AD5940_WriteReg(uint16_t RegAddr, uint32_t RegData)
 #ifdef CHIPSEL_M355
     AD5940_D2DWriteReg(RegAddr, RegData);
 #else
+  {
     AD5940_SPIWriteReg(RegAddr, RegData);
+#ifdef AD5940_REGCACHE
+    AD5940_RegCacheUpdate(RegAddr, RegData);
+#endif
+  }
 #endif
 }
 
@@ -1069,11 +1754,65 @@ uint32_t AD5940_ReadReg(uint16_t RegAddr)
 #endif
 #ifdef CHIPSEL_M355
     return AD5940_D2DReadReg(RegAddr);
+#elif defined(AD5940_REGCACHE)
+    return AD5940_RegCacheRead(RegAddr);
 #else
     return AD5940_SPIReadReg(RegAddr);
 #endif
 }
 
+/**
+ * @brief Write a table of registers. If sequencer generator is enabled, the register writes are recorded.
+ *        Otherwise, SETADDR/WRITEREG frames of several registers are encoded into one buffer and
+ *        sent as one transaction, CS is toggled between frames by platform.
+ * @param pRegs: The register address and data table. Registers are written in table order.
+ * @param RegCount: Number of entries in table.
+ * @return Return None.
+**/
+void AD5940_WriteRegBatch(const RegPair_Type *pRegs, uint32_t RegCount)
+{
+#ifndef CHIPSEL_M355
+#define BATCH_REG_MAX   8   /* Registers encoded in one buffer. Each takes up to 8 bytes. */
+  uint8_t SendBuffer[BATCH_REG_MAX*8];
+  AD5940_SPIFrame_Type Frames[BATCH_REG_MAX*2];
+  uint32_t len, i;
+#endif
+
+#ifdef SEQUENCE_GENERATOR
+  if(SeqGenDB.EngineStart == bTRUE)
+  {
+    while(RegCount--)
+    {
+      AD5940_SEQWriteReg(pRegs->RegAddr, pRegs->RegData);
+      pRegs++;
+    }
+    return;
+  }
+#endif
+#ifdef CHIPSEL_M355
+  while(RegCount--)
+  {
+    AD5940_D2DWriteReg(pRegs->RegAddr, pRegs->RegData);
+    pRegs++;
+  }
+#else
+  while(RegCount)
+  {
+    len = 0;
+    for(i=0; i<BATCH_REG_MAX && i<RegCount; i++)
+      len += AD5940_SPIEncodeWrite(&SendBuffer[len], &Frames[i*2], pRegs[i].RegAddr, pRegs[i].RegData);
+    AD5940_SPITransfer(Frames, i*2);
+#ifdef AD5940_REGCACHE
+    for(len=0; len<i; len++)
+      AD5940_RegCacheUpdate(pRegs[len].RegAddr, pRegs[len].RegData);
+#endif
+    pRegs += i;
+    RegCount -= i;
+  }
+#undef BATCH_REG_MAX
+#endif
+}
+
 
 /**
  * @defgroup AFE_Control 
@@ -1096,11 +1835,7 @@ void AD5940_Initialize(void)
 {
   int i;
   /* Write following registers with its data sequentially whenever there is a reset happened. */
-  const struct
-  {
-    uint16_t reg_addr;
-    uint32_t reg_data;
-  }RegTable[]=
+  const RegPair_Type RegTable[]=
   {
     {0x0908, 0x02c9},
     {0x0c08, 0x206C},
@@ -1127,14 +1862,15 @@ void AD5940_Initialize(void)
   };
   //initialize global variables
   SeqGenDB.SeqLen = 0;
-  SeqGenDB.RegCount = 0;
+  AD5940_SEQGenClearRegInfo();
   SeqGenDB.LastError = AD5940ERR_OK;
   SeqGenDB.EngineStart = bFALSE;
+  AD5940_RegCacheInvalidate();  /* Chip may have been reset without notice */
+  AD5940_SEQShadowInvalidate();
 #ifndef CHIPSEL_M355
   AD5940_CsSet(); /* Pull high CS in case it's low */
 #endif
-  for(i=0; i<sizeof(RegTable)/sizeof(RegTable[0]); i++)
-    AD5940_WriteReg(RegTable[i].reg_addr, RegTable[i].reg_data);
+  AD5940_WriteRegBatch(RegTable, sizeof(RegTable)/sizeof(RegTable[0]));
   i = AD5940_ReadReg(REG_AFECON_CHIPID);  
   if(i == 0x5501)
     bIsS2silicon = bTRUE;
@@ -2002,16 +2738,18 @@ void AD5940_DFTCfgS(DFTCfg_Type *pDftCfg)
 */
 void AD5940_FIFOCfg(FIFOCfg_Type *pFifoCfg)
 {
-  uint32_t tempreg;
+  uint32_t tempreg, memcon;
   //check parameters
   AD5940_WriteReg(REG_AFE_FIFOCON, 0);  /* Disable FIFO firstly! */
   /* CMDDATACON register. Configure this firstly */
-  tempreg = AD5940_ReadReg(REG_AFE_CMDDATACON);
-  tempreg &= BITM_AFE_CMDDATACON_CMD_MEM_SEL|BITM_AFE_CMDDATACON_CMDMEMMDE; /* Keep sequencer memory settings */
+  memcon = AD5940_ReadReg(REG_AFE_CMDDATACON);
+  tempreg = memcon & (BITM_AFE_CMDDATACON_CMD_MEM_SEL|BITM_AFE_CMDDATACON_CMDMEMMDE); /* Keep sequencer memory settings */
   tempreg |= pFifoCfg->FIFOMode << BITP_AFE_CMDDATACON_DATAMEMMDE; 				  /* Data FIFO mode: stream or FIFO */
   tempreg |= pFifoCfg->FIFOSize << BITP_AFE_CMDDATACON_DATA_MEM_SEL;  		  /* Data FIFO memory size */
   /* The reset memory can be used for sequencer, configure it by function AD5940_SEQCfg() */
   AD5940_WriteReg(REG_AFE_CMDDATACON, tempreg);
+  if(((tempreg^memcon)&BITM_AFE_CMDDATACON_DATA_MEM_SEL) != 0)
+    AD5940_SEQShadowInvalidate();  /* Data FIFO may overlap sequencer commands */
 
   /* FIFO Threshold */
   AD5940_WriteReg(REG_AFE_DATAFIFOTHRES, pFifoCfg->FIFOThresh << BITP_AFE_DATAFIFOTHRES_HIGHTHRES);
@@ -2101,16 +2839,18 @@ uint32_t AD5940_FIFOGetCnt(void)
 void AD5940_SEQCfg(SEQCfg_Type *pSeqCfg)
 {
   /* check parameters */
-  uint32_t tempreg, fifocon;
+  uint32_t tempreg, fifocon, memcon;
   
   fifocon = AD5940_ReadReg(REG_AFE_FIFOCON);
   AD5940_WriteReg(REG_AFE_FIFOCON, 0);  /* Disable FIFO before changing memory configuration */
   /* Configure CMDDATACON register */
-  tempreg = AD5940_ReadReg(REG_AFE_CMDDATACON);
-  tempreg &= ~(BITM_AFE_CMDDATACON_CMDMEMMDE|BITM_AFE_CMDDATACON_CMD_MEM_SEL);  /* Clear settings for sequencer memory */
+  memcon = AD5940_ReadReg(REG_AFE_CMDDATACON);
+  tempreg = memcon & ~(BITM_AFE_CMDDATACON_CMDMEMMDE|BITM_AFE_CMDDATACON_CMD_MEM_SEL);  /* Clear settings for sequencer memory */
   tempreg |= (1L) << BITP_AFE_CMDDATACON_CMDMEMMDE;    										  /* Sequencer is always in memory mode */ 
   tempreg |= (pSeqCfg->SeqMemSize) << BITP_AFE_CMDDATACON_CMD_MEM_SEL; 	
   AD5940_WriteReg(REG_AFE_CMDDATACON, tempreg);
+  if(((tempreg^memcon)&BITM_AFE_CMDDATACON_CMD_MEM_SEL) != 0)
+    AD5940_SEQShadowInvalidate();  /* Sequencer memory is changed */
 
   if(pSeqCfg->SeqCntCRCClr)
   {
@@ -2189,19 +2929,374 @@ void AD5940_SEQMmrTrig(uint32_t SeqId)
   AD5940_WriteReg(REG_AFECON_TRIGSEQ, 1L<<SeqId);
 }
 
+/**
+ * Sequencer SRAM shadow. It records what has been written to SRAM, so only changed commands are written again.
+*/
+static struct
+{
+  uint32_t *pShadow;    /**< Copy of SRAM word 0 to Size-1 */
+  uint32_t *pValid;     /**< Bit n is set if pShadow[n] is same as SRAM word n */
+  uint32_t Size;        /**< Number of SRAM words tracked. Zero means shadow is disabled. */
+}SeqShadowDB;
+
+/**
+ * @brief Initialize sequencer SRAM shadow. Once it's enabled, @ref AD5940_SEQCmdWrite only writes commands
+ *        that are different from the ones already in SRAM, so changing a few parameters of a sequence costs a few
+ *        SPI writes instead of rewriting the whole sequence.
+ * @param pBuffer: Buffer for shadow. Set it to NULL to disable shadow.
+ * @param BufferSize: Buffer size in words. Every 33 words track 32 words of SRAM from address 0. Commands beyond are
+ *                    always written.
+ * @return return none.
+**/
+void AD5940_SEQShadowInit(uint32_t *pBuffer, uint32_t BufferSize)
+{
+  SeqShadowDB.Size = 0;
+  if(pBuffer == NULL) return;
+  SeqShadowDB.Size = (BufferSize/33)*32;
+  SeqShadowDB.pShadow = pBuffer;
+  SeqShadowDB.pValid = pBuffer + SeqShadowDB.Size;
+  AD5940_SEQShadowInvalidate();
+}
+
+/**
+ * @brief Forget SRAM content recorded in shadow. Next @ref AD5940_SEQCmdWrite writes all commands.
+ *        It's called on reset and when sequencer memory size changes.
+ * @return return none.
+**/
+void AD5940_SEQShadowInvalidate(void)
+{
+  uint32_t i;
+  for(i=0;i<SeqShadowDB.Size/32;i++)
+    SeqShadowDB.pValid[i] = 0;
+}
+
 /**
  * @brief Write sequencer commands to AD5940 SRAM.
+ * @details If SRAM shadow is enabled by @ref AD5940_SEQShadowInit, commands that are already in SRAM are skipped.
  * @return return none.
 **/
 void AD5940_SEQCmdWrite(uint32_t StartAddr, const uint32_t *pCommand, uint32_t CmdCnt)
 {
+  uint32_t mask;
+
   while(CmdCnt--)
   {
+#ifdef SEQUENCE_GENERATOR
+    if((StartAddr < SeqShadowDB.Size) && (SeqGenDB.EngineStart == bFALSE)) /* Writes are recorded by generator, not SRAM */
+#else
+    if(StartAddr < SeqShadowDB.Size)
+#endif
+    {
+      mask = 1L<<(StartAddr&31);
+      if((SeqShadowDB.pValid[StartAddr>>5]&mask) && (SeqShadowDB.pShadow[StartAddr] == *pCommand))
+      {
+        StartAddr++;    /* Already in SRAM */
+        pCommand++;
+        continue;
+      }
+      SeqShadowDB.pShadow[StartAddr] = *pCommand;
+      SeqShadowDB.pValid[StartAddr>>5] |= mask;
+    }
     AD5940_WriteReg(REG_AFE_CMDFIFOWADDR, StartAddr++);
     AD5940_WriteReg(REG_AFE_CMDFIFOWRITE, *pCommand++);
   }
 }
 
+/**
+ * @brief Calculate sequencer CRC of commands, the same way as register SEQCRC.
+ * @details CRC-8 with polynomial x^8+x^2+x+1, each command is calculated from its most significant byte.
+ * @param Crc: Initial value. Use REG_AFE_SEQCRC_RESET for CRC after SEQCNT and SEQCRC are cleared.
+ * @param pCommand: Pointer to commands.
+ * @param CmdCnt: Number of commands.
+ * @return Return the CRC.
+**/
+uint8_t AD5940_SEQCRCCalc(uint8_t Crc, const uint32_t *pCommand, uint32_t CmdCnt)
+{
+  int32_t i, b;
+
+  while(CmdCnt--)
+  {
+    for(i=24;i>=0;i-=8)
+    {
+      Crc ^= (uint8_t)(*pCommand>>i);
+      for(b=0;b<8;b++)
+        Crc = (Crc&0x80)?((Crc<<1)^0x07):(Crc<<1);
+    }
+    pCommand++;
+  }
+  return Crc;
+}
+
+/**
+ * @brief Verify sequence in SRAM by sequencer command count and CRC. 
+ * @details Call it after the sequence has run once since SEQCNT and SEQCRC are cleared(@ref SEQCfg_Type.SeqCntCRCClr).
+ *          The expected commands are taken from SRAM shadow. If count or CRC is different, SRAM is not what
+ *          MCU thinks, for example AFE was reset without notice. All commands in shadow are written to SRAM again.
+ *          Sequence that is not fully recorded in shadow is not checked.
+ * @param pSeq: The sequence that has just run.
+ * @return Return bTRUE if sequence is verified or not checked. bFALSE if SRAM is rewritten, run the sequence again.
+**/
+BoolFlag AD5940_SEQVerify(const SEQInfo_Type *pSeq)
+{
+  uint32_t i;
+  uint8_t crc;
+
+  if((pSeq->SeqRamAddr + pSeq->SeqLen) > SeqShadowDB.Size)
+    return bTRUE;
+  for(i=pSeq->SeqRamAddr;i<pSeq->SeqRamAddr+pSeq->SeqLen;i++)
+  {
+    if((SeqShadowDB.pValid[i>>5] & (1L<<(i&31))) == 0)
+      return bTRUE;
+  }
+  crc = AD5940_SEQCRCCalc(REG_AFE_SEQCRC_RESET, SeqShadowDB.pShadow + pSeq->SeqRamAddr, pSeq->SeqLen);
+  if(((AD5940_ReadReg(REG_AFE_SEQCNT)&BITM_AFE_SEQCNT_COUNT) == pSeq->SeqLen) && \
+     ((AD5940_ReadReg(REG_AFE_SEQCRC)&BITM_AFE_SEQCRC_CRC) == crc))
+    return bTRUE;
+  /* Restore SRAM from shadow */
+  for(i=0;i<SeqShadowDB.Size;i++)
+  {
+    if(SeqShadowDB.pValid[i>>5] & (1L<<(i&31)))
+    {
+      AD5940_WriteReg(REG_AFE_CMDFIFOWADDR, i);
+      AD5940_WriteReg(REG_AFE_CMDFIFOWRITE, SeqShadowDB.pShadow[i]);
+    }
+  }
+  return bFALSE;
+}
+
+/**
+ * @brief Locate the command that writes a register in a sequence, so the value can be changed later without regenerating the sequence.
+ * @details The last write to RegAddr is used, which decides register value after the sequence.
+ *          Call it when pSeq->pSeqCmd is valid, i.e. right after the sequence is generated or loaded.
+ * @param pSeq: The sequence in SRAM and its commands in MCU.
+ * @param RegAddr: Register address. Only registers that sequencer can write.
+ * @param pSlot: Return the slot.
+ * @return AD5940ERR_OK or AD5940ERR_SEQREG if the sequence doesn't write this register.
+**/
+AD5940Err AD5940_SEQSlotFind(const SEQInfo_Type *pSeq, uint32_t RegAddr, SEQSlot_Type *pSlot)
+{
+  uint32_t i;
+
+  if(pSeq == NULL || pSeq->pSeqCmd == NULL || pSlot == NULL)
+    return AD5940ERR_NULLP;
+  pSlot->RegAddr = RegAddr;
+  pSlot->Cmd = 0;
+  for(i=pSeq->SeqLen;i>0;i--)
+  {
+    if((pSeq->pSeqCmd[i-1]&0xff000000) == (SEQ_WR(RegAddr, 0)&0xff000000))
+    {
+      pSlot->SeqRamAddr = pSeq->SeqRamAddr + i - 1;
+      pSlot->Cmd = pSeq->pSeqCmd[i-1];
+      return AD5940ERR_OK;
+    }
+  }
+  return AD5940ERR_SEQREG;
+}
+
+/**
+ * @brief Change bits of a register write command in SRAM.
+ * @details Only one SRAM word is written. It takes effect next time the sequence runs. 
+ *          Use bWriteReg to apply it immediately when the sequence already run, e.g. initialization sequence.
+ *          AFE must be awake.
+ * @param pSlot: Slot from AD5940_SEQSlotFind.
+ * @param Mask: Bits to change.
+ * @param Data: New value of these bits.
+ * @param bWriteReg: Also write the new value to register.
+ * @return AD5940ERR_OK or AD5940ERR_SEQREG if slot is not found.
+**/
+AD5940Err AD5940_SEQSlotPatch(SEQSlot_Type *pSlot, uint32_t Mask, uint32_t Data, BoolFlag bWriteReg)
+{
+  uint32_t Cmd;
+
+  if(pSlot == NULL)
+    return AD5940ERR_NULLP;
+  if((pSlot->Cmd&0x80000000) == 0)
+    return AD5940ERR_SEQREG;
+  Mask &= 0xffffff; /* Sequencer writes 24bit data */
+  Cmd = (pSlot->Cmd&~Mask)|(Data&Mask);
+  if(Cmd != pSlot->Cmd)
+  {
+    pSlot->Cmd = Cmd;
+    AD5940_SEQCmdWrite(pSlot->SeqRamAddr, &Cmd, 1);
+  }
+  if(bWriteReg == bTRUE)
+    AD5940_WriteReg(pSlot->RegAddr, Cmd&0xffffff);
+  return AD5940ERR_OK;
+}
+
+/**
+ * Command FIFO streaming state.
+*/
+static struct
+{
+  SEQStreamCfg_Type Cfg;
+  SEQStreamStat_Type Stat;
+  uint32_t FifoSize;    /**< Command FIFO size in words */
+  uint32_t CmdOffset;   /**< Next command in Cfg.pSeqCmd */
+  uint32_t LastCnt;     /**< SEQCNT when it's read last time */
+  uint32_t CmdDataCon;  /**< CMDDATACON before streaming */
+  uint32_t SeqCon;      /**< SEQCON before streaming */
+  BoolFlag bEnd;        /**< All commands including the appended SEQ_STOP are pushed */
+}SeqStreamDB;
+
+/**
+ * @brief Push at most MaxCnt commands of the program to command FIFO. SEQ_STOP is appended after the last one.
+ * @return return none.
+**/
+static void AD5940_SEQStreamPush(uint32_t MaxCnt)
+{
+  uint32_t buff[8];
+  uint32_t i, n;
+
+  while((MaxCnt > 0) && (SeqStreamDB.bEnd == bFALSE))
+  {
+    if(SeqStreamDB.Cfg.pfnGetCmd != NULL)
+      n = SeqStreamDB.Cfg.pfnGetCmd(buff, (MaxCnt > 8)?8:MaxCnt, SeqStreamDB.Cfg.pCtx);
+    else
+    {
+      n = SeqStreamDB.Cfg.SeqLen - SeqStreamDB.CmdOffset;
+      if(n > 8) n = 8;
+      if(n > MaxCnt) n = MaxCnt;
+      for(i=0;i<n;i++)
+        buff[i] = SeqStreamDB.Cfg.pSeqCmd[SeqStreamDB.CmdOffset++];
+    }
+    if(n == 0)
+    {
+      buff[0] = SEQ_STOP();   /* End of program. It clears SEQEN and generates ENDSEQ interrupt */
+      n = 1;
+      SeqStreamDB.bEnd = bTRUE;
+    }
+    for(i=0;i<n;i++)
+    {
+      AD5940_WriteReg(REG_AFE_CMDFIFOWRITE, buff[i]);
+#if defined(AD5940_REGCACHE) && !defined(CHIPSEL_M355)
+      AD5940_RegCacheSeqCmd(buff[i]);   /* Registers written by the program are not cached */
+#endif
+    }
+    SeqStreamDB.Stat.Pushed += n;
+    MaxCnt -= n;
+  }
+}
+
+/**
+ * @brief Run a program from command FIFO instead of sequencer SRAM.
+ * @details MCU fills the command FIFO and keeps refilling it by @ref AD5940_SEQStreamFill while sequencer executes
+ *          commands, so the program can be much longer than SRAM, e.g. a long voltammetry staircase or a dense frequency
+ *          sweep generated on the fly. SEQ_STOP is appended to the program. Sequences in SRAM can't be triggered until
+ *          the stream ends, and with CmdFifoSize other than SEQMEMSIZE_32B they are overwritten(SRAM shadow is invalidated).
+ *          Data FIFO is disabled and re-enabled since sequencer memory is changed, read out data before starting.
+ *          AFE must stay active during streaming, do not put it to sleep in the program.
+ *          If FIFO runs empty, sequencer waits for new commands, so put SEQ_WAIT commands in program to give MCU time to refill.
+ * @param pStreamCfg: The program and command FIFO size. It's copied.
+ * @return AD5940ERR_OK, or AD5940ERR_PARA if command FIFO overlaps data FIFO.
+**/
+AD5940Err AD5940_SEQStreamStart(const SEQStreamCfg_Type *pStreamCfg)
+{
+  static const uint16_t FifoWords[4] = {8, 512, 1024, 1536};  /* 32B, 2kB, 4kB, 6kB */
+  uint32_t tempreg, fifocon, datasize;
+
+  if(pStreamCfg == NULL)
+    return AD5940ERR_NULLP;
+  if((pStreamCfg->pfnGetCmd == NULL) && (pStreamCfg->pSeqCmd == NULL))
+    return AD5940ERR_NULLP;
+  if(pStreamCfg->CmdFifoSize > SEQMEMSIZE_6KB)
+    return AD5940ERR_PARA;
+  AD5940_SEQStreamStop();
+  tempreg = AD5940_ReadReg(REG_AFE_CMDDATACON);
+  datasize = (tempreg&BITM_AFE_CMDDATACON_DATA_MEM_SEL) >> BITP_AFE_CMDDATACON_DATA_MEM_SEL;
+  if(pStreamCfg->CmdFifoSize + datasize > SEQMEMSIZE_6KB)
+    return AD5940ERR_PARA;  /* Both share 6kB SRAM */
+
+  SeqStreamDB.Cfg = *pStreamCfg;
+  SeqStreamDB.FifoSize = FifoWords[pStreamCfg->CmdFifoSize];
+  SeqStreamDB.CmdOffset = 0;
+  SeqStreamDB.LastCnt = 0;
+  SeqStreamDB.CmdDataCon = tempreg;
+  SeqStreamDB.bEnd = bFALSE;
+  SeqStreamDB.Stat.Pushed = 0;
+  SeqStreamDB.Stat.Executed = 0;
+  SeqStreamDB.Stat.Underrun = 0;
+
+  SeqStreamDB.SeqCon = AD5940_ReadReg(REG_AFE_SEQCON);
+  AD5940_WriteReg(REG_AFE_SEQCON, 0);  /* Disable sequencer firstly */
+  AD5940_WriteReg(REG_AFE_SEQCNT, 0);  /* Clear SEQCNT. It counts commands taken from FIFO */
+  fifocon = AD5940_ReadReg(REG_AFE_FIFOCON);
+  AD5940_WriteReg(REG_AFE_FIFOCON, 0);  /* Disable FIFO before changing memory configuration */
+  tempreg &= ~(BITM_AFE_CMDDATACON_CMDMEMMDE|BITM_AFE_CMDDATACON_CMD_MEM_SEL);
+  tempreg |= ENUM_AFE_CMDDATACON_CFIFO;
+  tempreg |= pStreamCfg->CmdFifoSize << BITP_AFE_CMDDATACON_CMD_MEM_SEL;
+  AD5940_WriteReg(REG_AFE_CMDDATACON, tempreg);
+  AD5940_WriteReg(REG_AFE_FIFOCON, fifocon);
+  if(pStreamCfg->CmdFifoSize != SEQMEMSIZE_32B)
+    AD5940_SEQShadowInvalidate();  /* Command FIFO overwrites SRAM */
+  SeqStreamDB.Stat.bBusy = bTRUE;
+
+  AD5940_SEQStreamPush(SeqStreamDB.FifoSize);
+  AD5940_WriteReg(REG_AFE_SEQCON, (SeqStreamDB.SeqCon&BITM_AFE_SEQCON_SEQWRTMR)|BITM_AFE_SEQCON_SEQEN);
+  AD5940_SEQMmrTrig(SEQID_0);  /* Sequencer info is not used in FIFO mode */
+  return AD5940ERR_OK;
+}
+
+/**
+ * @brief Refill command FIFO.
+ * @details Call it from AFE interrupt handler on AFEINTSRC_CMDFIFOEMPTY or AFEINTSRC_CMDFIFOTHRESH, or poll it.
+ *          There is no command FIFO count register, so FIFO level is the number of pushed commands minus SEQCNT.
+ *          The FIFO is topped up every time. Once the program has executed, memory mode is restored by
+ *          @ref AD5940_SEQStreamStop. It's not reentrant.
+ * @return bTRUE if stream is still running.
+**/
+BoolFlag AD5940_SEQStreamFill(void)
+{
+  uint32_t cnt, level;
+
+  if(SeqStreamDB.Stat.bBusy == bFALSE)
+    return bFALSE;
+  cnt = AD5940_ReadReg(REG_AFE_SEQCNT)&BITM_AFE_SEQCNT_COUNT;
+  SeqStreamDB.Stat.Executed += (cnt - SeqStreamDB.LastCnt)&BITM_AFE_SEQCNT_COUNT;  /* FIFO is much smaller than SEQCNT range */
+  SeqStreamDB.LastCnt = cnt;
+  level = SeqStreamDB.Stat.Pushed - SeqStreamDB.Stat.Executed;
+  if(SeqStreamDB.bEnd == bTRUE)
+  {
+    if((level == 0) && ((AD5940_ReadReg(REG_AFE_SEQCON)&BITM_AFE_SEQCON_SEQEN) == 0))
+    {
+      AD5940_SEQStreamStop();  /* SEQ_STOP has executed */
+      return bFALSE;
+    }
+    return bTRUE;
+  }
+  if(level == 0)
+    SeqStreamDB.Stat.Underrun++;
+  AD5940_SEQStreamPush(SeqStreamDB.FifoSize - level);
+  return bTRUE;
+}
+
+/**
+ * @brief Stop streaming and put sequencer back to memory mode.
+ * @details Called by @ref AD5940_SEQStreamFill when program ends. Call it to abort a running program.
+ *          Data FIFO is not touched so results of the program can still be read.
+ * @return return none.
+**/
+void AD5940_SEQStreamStop(void)
+{
+  if(SeqStreamDB.Stat.bBusy == bFALSE)
+    return;
+  AD5940_WriteReg(REG_AFE_SEQCON, 0);
+  AD5940_WriteReg(REG_AFE_CMDDATACON, SeqStreamDB.CmdDataCon);  /* Commands left in FIFO are dropped */
+  AD5940_WriteReg(REG_AFE_SEQCON, SeqStreamDB.SeqCon);
+  SeqStreamDB.Stat.bBusy = bFALSE;
+}
+
+/**
+ * @brief Get command FIFO streaming status.
+ * @param pStat: Return the status. Executed is updated by @ref AD5940_SEQStreamFill.
+ * @return return none.
+**/
+void AD5940_SEQStreamGetStat(SEQStreamStat_Type *pStat)
+{
+  if(pStat != NULL)
+    *pStat = SeqStreamDB.Stat;
+}
+
 /**
    @brief Initialize Sequence INFO. 
    @details There are four set of registers that record sequence information. 
@@ -2354,6 +3449,31 @@ AD5940Err AD5940_SEQGpioTrigCfg(SeqGpioTrig_Cfg *pSeqGpioTrigCfg)
   return AD5940ERR_OK;
 }
 
+/**
+ * @brief Check wakeup timer settings of a sequence against its duration before applying them.
+ * @param pWuptCfg: Wakeup timer settings for AD5940_WUPTCfg.
+ * @param SeqId: The sequence triggered by wakeup timer. @ref SEQID_Const
+ * @param SeqTime: Duration of that sequence in seconds, from AD5940_SEQAnalyze.
+ * @param WuptClkFreq: Wakeup timer clock frequency in Hz.
+ * @return AD5940ERR_OK, or AD5940ERR_PARA if sleep/wakeup time exceeds 20bit or sequence cannot end within one period.
+*/
+AD5940Err AD5940_WUPTCheck(const WUPTCfg_Type *pWuptCfg, uint32_t SeqId, float SeqTime, float WuptClkFreq)
+{
+  float Period;
+
+  if(pWuptCfg == NULL)
+    return AD5940ERR_NULLP;
+  if(SeqId > SEQID_3 || WuptClkFreq <= 0)
+    return AD5940ERR_PARA;
+  if(pWuptCfg->SeqxSleepTime[SeqId] > 0xFFFFF || pWuptCfg->SeqxWakeupTime[SeqId] > 0xFFFFF)
+    return AD5940ERR_PARA;
+  /* One period is sleep time plus wakeup time plus 2 clocks */
+  Period = (pWuptCfg->SeqxSleepTime[SeqId] + pWuptCfg->SeqxWakeupTime[SeqId] + 2)/WuptClkFreq;
+  if(SeqTime >= Period)
+    return AD5940ERR_PARA;
+  return AD5940ERR_OK;
+}
+
 /**
  * @brief Configure Wakeup Timer
  * @param pWuptCfg: Pointer to configuration structure.
@@ -3007,6 +4127,8 @@ AD5940Err  AD5940_SoftRst(void)
 {
   AD5940_WriteReg(REG_AFECON_SWRSTCON, AD5940_SWRST);
   AD5940_Delay10us(20); /* AD5940 need some time to exit reset status. 200us looks good. */
+  AD5940_RegCacheInvalidate();  /* All registers are back to default value */
+  AD5940_SEQShadowInvalidate(); /* SRAM is cleared */
   /* We can check RSTSTA register to make sure software reset happened. */
   return AD5940ERR_OK;
 }
@@ -3023,6 +4145,8 @@ void AD5940_HWReset(void)
   AD5940_Delay10us(200); /* Delay some time */
   AD5940_RstSet();
   AD5940_Delay10us(500); /* AD5940 need some time to exit reset status. 200us looks good. */
+  AD5940_RegCacheInvalidate();  /* All registers are back to default value */
+  AD5940_SEQShadowInvalidate(); /* SRAM is cleared */
 #else
   //There is no method to reset AFE only for M355.
 #endif
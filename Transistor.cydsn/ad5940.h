@@ -38,6 +38,9 @@
 #define SPICMD_WRITEREG  0x2D
 #define SPICMD_READFIFO  0x5F
 
+#define AD5940_REGCACHE   /* 寄存器影子缓存，读-改-写只需一次SPI写。注释掉即关闭 */
+//#define AD5940_SEQGEN_LIVEREAD   /* 序列生成器通过SPI读取寄存器初值（需AFE处于激活状态），默认使用复位值表 */
+
 //#define ADI_DEBUG   /**< Comment this line to remove debug info. */
 
 #ifdef ADI_DEBUG
@@ -4514,6 +4517,40 @@ typedef struct
   const uint32_t *pSeqCmd;  /**< Pointer to the sequencer commands that stored in MCU */
 }SEQInfo_Type;
 
+/**
+ * A register write command in SRAM that can be patched without regenerating the sequence
+*/
+typedef struct
+{
+  uint32_t RegAddr;         /**< Register written by this command */
+  uint32_t SeqRamAddr;      /**< Address of the command in AD5940 SRAM */
+  uint32_t Cmd;             /**< The command currently in SRAM. 0 means slot is not found */
+}SEQSlot_Type;
+
+/**
+ * Command FIFO streaming. Commands are pushed to command FIFO by MCU while sequencer executes them,
+ * so program length is not limited by sequencer SRAM.
+*/
+typedef struct
+{
+  uint32_t CmdFifoSize;     /**< Command FIFO memory @ref SEQMEMSIZE_Const. SEQMEMSIZE_32B uses the 8-word local memory and leaves all 6kB SRAM to data FIFO */
+  const uint32_t *pSeqCmd;  /**< Program in MCU memory. Used when pfnGetCmd is NULL */
+  uint32_t SeqLen;          /**< Length of pSeqCmd */
+  uint32_t (*pfnGetCmd)(uint32_t *pCmd, uint32_t MaxCnt, void *pCtx); /**< Produce up to MaxCnt commands on demand, return the number produced. Return 0 at end of program */
+  void *pCtx;               /**< Passed to pfnGetCmd */
+}SEQStreamCfg_Type;
+
+/**
+ * Command FIFO streaming status
+*/
+typedef struct
+{
+  BoolFlag bBusy;           /**< Stream is running */
+  uint32_t Pushed;          /**< Commands written to command FIFO */
+  uint32_t Executed;        /**< Commands executed by sequencer, counted by SEQCNT */
+  uint32_t Underrun;        /**< Times command FIFO was found empty before end of program. Sequencer waits, so timing of program is stretched */
+}SEQStreamStat_Type;
+
 typedef struct
 {
   uint32_t PinSel;          /**< Select which pin are going to be configured. @ref AGPIOPIN_Const */
@@ -4705,6 +4742,34 @@ typedef struct
   float RatioSys2AdcClk;      /**< Ratio of system clock to ADC clock frequency */
 }ClksCalInfo_Type;
 
+/**
+ * Configuration for static analysis of a sequencer command array
+*/
+typedef struct
+{
+  float SysClkFreq;           /**< Sequencer clock frequency in Hz. Normally the system clock */
+  uint32_t AfeconInit;        /**< AFECON value when sequence starts. Use the AfeconEnd of previous sequence or REG_AFE_AFECON_RESET */
+  const float *pBlockCurrent; /**< Supply current in uA of each AFECON bit when set, 32 entries indexed by bit. Set to NULL to skip charge estimation */
+  float ActiveCurrent;        /**< Supply current in uA of the AFE while sequencer is running, excluding blocks in pBlockCurrent */
+  ClksCalInfo_Type *pClksCal; /**< Optional. The conversion the sequence is expected to complete while ADCCNV is set. Set to NULL to skip the check */
+}SEQAnalyzeCfg_Type;
+
+/**
+ * Result of static analysis of a sequencer command array
+*/
+typedef struct
+{
+  uint32_t Cycles;            /**< Sequencer clocks from start to last command or SEQ_STOP */
+  float Duration;             /**< Sequence duration in seconds */
+  float MaxODR;               /**< Maximum rate in Hz the sequence can be triggered at, 1/Duration */
+  float Charge;               /**< Estimated charge per run in uC. 0 if SEQAnalyzeCfg_Type.pBlockCurrent is NULL */
+  uint32_t BlockCycles[32];   /**< Clocks each AFECON bit stays set, indexed by bit */
+  uint32_t AfeconEnd;         /**< AFECON value when sequence ends */
+  uint32_t ConvCycles;        /**< Longest continuous clocks with AFECTRL_ADCCNV set */
+  uint32_t ConvCyclesReq;     /**< Clocks needed by SEQAnalyzeCfg_Type.pClksCal, 0 if not specified */
+  BoolFlag bSleep;            /**< Sequence triggers sleep(SEQ_SLP) */
+}SEQAnalyzeResult_Type;
+
 /** 
  * Software controlled Sweep Function 
  * */
@@ -4745,6 +4810,37 @@ typedef struct
   int32_t Image;        /**< The real imaginary in Cartesian coordinate */
 }iImpCar_Type;
 
+/**
+ * Register address and data pair. Used by AD5940_WriteRegBatch.
+*/
+typedef struct
+{
+  uint16_t RegAddr;           /**< The register address */
+  uint32_t RegData;           /**< The register data */
+}RegPair_Type;
+
+/**
+ * Register shadow cache statistics. Only reads through SPI are counted.
+*/
+typedef struct
+{
+  uint32_t Hit;               /**< Cacheable register read served from cache */
+  uint32_t Miss;              /**< Cacheable register read from chip and filled */
+  uint32_t Uncached;          /**< Read of a register that is never cached */
+}RegCacheStat_Type;
+
+/**
+ * Word ring buffer filled by AD5940_FIFORdAsync. One slot is always left empty
+ * to tell full from empty, so it holds at most Size-1 words.
+*/
+typedef struct
+{
+  uint32_t *pBuffer;          /**< Word storage */
+  uint32_t Size;              /**< Number of words in pBuffer */
+  volatile uint32_t WrIdx;    /**< Next slot written by FIFO read */
+  volatile uint32_t RdIdx;    /**< Next slot consumed by application */
+}FIFORing_Type;
+
 /**
  *  FreqParams_Type - Structure to store optimum filter settings 
 */
@@ -4769,7 +4865,15 @@ typedef struct
 /* 1. Basic SPI functions */
 void      AD5940_WriteReg(uint16_t RegAddr, uint32_t RegData);
 uint32_t  AD5940_ReadReg(uint16_t RegAddr);
+void      AD5940_WriteRegBatch(const RegPair_Type *pRegs, uint32_t RegCount);
+void      AD5940_RegCacheInvalidate(void);
+void      AD5940_RegCacheGetStat(RegCacheStat_Type *pStat);
 void      AD5940_FIFORd(uint32_t *pBuffer,uint32_t uiReadCount);
+AD5940Err AD5940_FIFORdAsync(FIFORing_Type *pRing, uint32_t uiReadCount, void (*pfnDone)(void));
+void      AD5940_FIFORdAsyncWait(void);
+void      AD5940_FIFORingInit(FIFORing_Type *pRing, uint32_t *pBuffer, uint32_t Size);
+uint32_t  AD5940_FIFORingCount(FIFORing_Type *pRing);
+uint32_t  AD5940_FIFORingPop(FIFORing_Type *pRing, uint32_t *pData, uint32_t MaxCount);
 
 /* 2. AD5940 Top Control functions */
 void      AD5940_Initialize(void); /* Call this function firstly once AD5940 power on or come from soft reset */
@@ -4826,6 +4930,16 @@ void      AD5940_SEQCtrlS(BoolFlag SeqEn);
 void      AD5940_SEQHaltS(void);
 void      AD5940_SEQMmrTrig(uint32_t SeqId); /* Manually trigger sequence */
 void      AD5940_SEQCmdWrite(uint32_t StartAddr, const uint32_t *pCommand, uint32_t CmdCnt);
+void      AD5940_SEQShadowInit(uint32_t *pBuffer, uint32_t BufferSize);  /* Enable SRAM shadow, only changed commands are written */
+void      AD5940_SEQShadowInvalidate(void);
+uint8_t   AD5940_SEQCRCCalc(uint8_t Crc, const uint32_t *pCommand, uint32_t CmdCnt);
+BoolFlag  AD5940_SEQVerify(const SEQInfo_Type *pSeq);  /* Check SEQCNT/SEQCRC after sequence run, rewrite SRAM if it's lost */
+AD5940Err AD5940_SEQSlotFind(const SEQInfo_Type *pSeq, uint32_t RegAddr, SEQSlot_Type *pSlot);  /* Locate last write to RegAddr in a sequence */
+AD5940Err AD5940_SEQSlotPatch(SEQSlot_Type *pSlot, uint32_t Mask, uint32_t Data, BoolFlag bWriteReg);  /* Change bits of that write in SRAM */
+AD5940Err AD5940_SEQStreamStart(const SEQStreamCfg_Type *pStreamCfg);  /* Run a program from command FIFO */
+BoolFlag  AD5940_SEQStreamFill(void);     /* Refill command FIFO, call it on CMDFIFOEMPTY/CMDFIFOTHRESH interrupt or poll it */
+void      AD5940_SEQStreamStop(void);
+void      AD5940_SEQStreamGetStat(SEQStreamStat_Type *pStat);
 void      AD5940_SEQInfoCfg(SEQInfo_Type *pSeq);
 AD5940Err AD5940_SEQInfoGet(uint32_t SeqId, SEQInfo_Type *pSeqInfo);
 void      AD5940_SEQGpioCtrlS(uint32_t GpioSet);   /* Sequencer can control GPIO0~7 if the GPIO function is set to SYNC */
@@ -4833,6 +4947,7 @@ uint32_t  AD5940_SEQTimeOutRd(void);  /* Read back current sequence time out val
 AD5940Err AD5940_SEQGpioTrigCfg(SeqGpioTrig_Cfg *pSeqGpioTrigCfg);
 void      AD5940_WUPTCfg(WUPTCfg_Type *pWuptCfg);
 void      AD5940_WUPTCtrl(BoolFlag Enable);  /* Enable or disable Wakeup timer */
+AD5940Err AD5940_WUPTCheck(const WUPTCfg_Type *pWuptCfg, uint32_t SeqId, float SeqTime, float WuptClkFreq); /* Check timer period against sequence duration */
 AD5940Err AD5940_WUPTTime(uint32_t SeqId, uint32_t SleepTime, uint32_t WakeupTime);
 
 /* 7. MISC_Block */
@@ -4889,8 +5004,10 @@ void      AD5940_SEQGenInit(uint32_t *pBuffer, uint32_t BufferSize);/* Initializ
 void      AD5940_SEQGenCtrl(BoolFlag bFlag);  /* Enable or disable sequence generator */
 void      AD5940_SEQGenInsert(uint32_t CmdWord); /* Manually insert a sequence command */
 AD5940Err AD5940_SEQGenFetchSeq(const uint32_t **ppSeqCmd, uint32_t *pSeqCount);  /* Fetch generated sequence and start a new sequence */
+uint32_t  AD5940_SEQOptimize(uint32_t *pSeqCmd, uint32_t SeqLen);  /* Remove dead writes and merge waits, return new length */
 void      AD5940_ClksCalculate(ClksCalInfo_Type *pFilterInfo, uint32_t *pClocks);
 uint32_t  AD5940_SEQCycleTime(void);
+AD5940Err AD5940_SEQAnalyze(const uint32_t *pSeqCmd, uint32_t SeqLen, const SEQAnalyzeCfg_Type *pCfg, SEQAnalyzeResult_Type *pResult);
 void      AD5940_SweepNext(SoftSweepCfg_Type *pSweepCfg, float *pNextFreq);
 void      AD5940_StructInit(void *pStruct, uint32_t StructSize);
 float     AD5940_ADCCode2Volt(uint32_t code, uint32_t ADCPga, float VRef1p82); /* Calculate ADC code to voltage */
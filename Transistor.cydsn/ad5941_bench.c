@@ -0,0 +1,189 @@
+/*******************************************************************************
+* File Name: ad5941_bench.c
+*
+* Description:
+*   AD5940 SPI访问基准测试
+*   每项测试重复执行一个ad5940.c访问函数，记录周期计数、SPI字节计数和
+*   空闲钩子中的时间，输出：
+*     us/op  - 每次操作的平均时间
+*     B/s    - SPI字节数/总时间，包含命令字节和CS切换、驱动开销
+*     busy%  - CPU不在空闲钩子中的时间比例；忙等(pfnSleep为NULL)时为100%
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*   AD5940_BENCH_ENABLE为0时本文件不产生代码。
+*
+********************************************************************************/
+
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5941_bench.h"
+
+#if (AD5940_BENCH_ENABLE != 0u)
+
+#define BENCH_FIFO_MAX          (1024u)     /* FIFO读测试的最大字数 */
+#define BENCH_SEQ_CMDS          (64u)       /* 序列写测试的命令数 */
+
+static void (*s_pfnBenchSleep)(void) = NULL;
+static uint32_t s_BenchIdle = 0;            /* 空闲钩子中累计的周期数 */
+static uint32_t s_BenchFifo[BENCH_FIFO_MAX];
+static uint32_t s_BenchSeq[BENCH_SEQ_CMDS];
+
+/*******************************************************************************
+* 被测操作
+*******************************************************************************/
+
+static void Bench_ReadReg(uint32_t Arg)
+{
+    (void)AD5940_ReadReg((uint16_t)Arg);
+}
+
+static void Bench_WriteReg(uint32_t Arg)
+{
+    AD5940_WriteReg((uint16_t)Arg, 0);
+}
+
+static void Bench_FIFORd(uint32_t Arg)
+{
+    AD5940_FIFORd(s_BenchFifo, Arg);
+}
+
+static void Bench_SEQCmdWrite(uint32_t Arg)
+{
+    AD5940_SEQCmdWrite(0, s_BenchSeq, Arg);
+}
+
+static void Bench_Initialize(uint32_t Arg)
+{
+    (void)Arg;
+    AD5940_Initialize();
+}
+
+/*******************************************************************************
+* 计时
+*******************************************************************************/
+
+/**
+ * @brief 测试期间的空闲钩子：累计调用pfnSleep的时间
+ */
+static void Bench_IdleHook(void)
+{
+    uint32_t start = AD5940_CycleCount();
+
+    if (s_pfnBenchSleep != NULL)
+        s_pfnBenchSleep();
+    s_BenchIdle += AD5940_CycleCount() - start;
+}
+
+void AD5940_BenchOne(const char *pName, void (*pfnOp)(uint32_t Arg), uint32_t Arg,
+                     uint32_t Ops, AD5940_BenchResult_Type *pResult)
+{
+    uint32_t cycles;
+    uint32_t bytes;
+    uint32_t idle;
+    uint32_t i;
+
+    bytes = AD5940_SPIGetByteCount();
+    idle = s_BenchIdle;
+    cycles = AD5940_CycleCount();
+    for (i = 0; i < Ops; i++)
+        pfnOp(Arg);
+    cycles = AD5940_CycleCount() - cycles;
+
+    pResult->pName = pName;
+    pResult->Ops = Ops;
+    pResult->Cycles = (cycles != 0u) ? cycles : 1u;
+    pResult->IdleCycles = s_BenchIdle - idle;
+    pResult->Bytes = AD5940_SPIGetByteCount() - bytes;
+}
+
+/*******************************************************************************
+* 测试表和输出
+*******************************************************************************/
+
+typedef struct
+{
+    const char *pName;
+    void (*pfnOp)(uint32_t Arg);
+    uint32_t Arg;
+    uint32_t Ops;
+} BenchCase_Type;
+
+static const BenchCase_Type s_BenchCase[] =
+{
+    {"ReadReg16",       Bench_ReadReg,      REG_AFECON_ADIID,       100u},
+    {"ReadReg32",       Bench_ReadReg,      REG_AFE_AFECON,         100u},
+    {"ReadRegCached",   Bench_ReadReg,      REG_AFE_FIFOCON,        100u},
+    {"WriteReg",        Bench_WriteReg,     REG_AFE_CMDFIFOWADDR,   100u},
+    {"FIFORd 1",        Bench_FIFORd,       1u,                     100u},
+    {"FIFORd 2",        Bench_FIFORd,       2u,                     100u},
+    {"FIFORd 3",        Bench_FIFORd,       3u,                     100u},
+    {"FIFORd 64",       Bench_FIFORd,       64u,                    20u},
+    {"FIFORd 512",      Bench_FIFORd,       512u,                   5u},
+    {"FIFORd 1024",     Bench_FIFORd,       BENCH_FIFO_MAX,         5u},
+    {"SEQCmdWrite 64",  Bench_SEQCmdWrite,  BENCH_SEQ_CMDS,         10u},
+    {"Initialize",      Bench_Initialize,   0u,                     10u},
+};
+
+#define BENCH_CASE_NUM  (sizeof(s_BenchCase) / sizeof(s_BenchCase[0]))
+
+static void Bench_Print(AD5940_BenchPrintFunc pfnPrint, const AD5940_BenchResult_Type *pRes)
+{
+    uint32_t hz = AD5940_CycleHz();
+    uint32_t us10;      /* 0.1us/op */
+    uint32_t bps;
+    uint32_t busy10;    /* 0.1% */
+
+    us10 = (uint32_t)(((uint64_t)pRes->Cycles * 10000000u) / ((uint64_t)hz * pRes->Ops));
+    bps = (uint32_t)(((uint64_t)pRes->Bytes * hz) / pRes->Cycles);
+    busy10 = (uint32_t)(((uint64_t)(pRes->Cycles - pRes->IdleCycles) * 1000u) / pRes->Cycles);
+
+    pfnPrint("  %-16s %5lu %9lu.%lu %9lu %4lu.%lu\r\n", pRes->pName, (unsigned long)pRes->Ops,
+             (unsigned long)(us10 / 10u), (unsigned long)(us10 % 10u), (unsigned long)bps,
+             (unsigned long)(busy10 / 10u), (unsigned long)(busy10 % 10u));
+}
+
+void AD5940_BenchRun(void (*pfnSleep)(void), AD5940_BenchPrintFunc pfnPrint)
+{
+    static const uint8_t backends[] = {AD5940_SPI_BACKEND_SOFT, AD5940_SPI_BACKEND_SCB};
+    AD5940_BenchResult_Type res;
+    uint8_t oldBackend = AD5940_SPIGetBackend();
+    uint32_t b;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_SEQ_CMDS; i++)
+        s_BenchSeq[i] = SEQ_NOP();
+
+    s_pfnBenchSleep = pfnSleep;
+    AD5940_SPISetIdleHook(Bench_IdleHook);
+    AD5940_CycleCounterStart();
+
+    for (b = 0; b < sizeof(backends); b++)
+    {
+        if (AD5940_SPISetBackend(backends[b]) != 0)
+            continue;
+
+        if (pfnPrint != NULL)
+        {
+            pfnPrint("[BENCH] backend %s, raw %lu B/s, clock %lu Hz\r\n",
+                     (backends[b] == AD5940_SPI_BACKEND_SOFT) ? "SOFT" : "SCB",
+                     (unsigned long)AD5940_SPIMeasureThroughput(AD5940_SPI_MEASURE_MAX),
+                     (unsigned long)AD5940_CycleHz());
+            pfnPrint("  %-16s %5s %11s %9s %6s\r\n", "op", "n", "us/op", "B/s", "busy%");
+        }
+        for (i = 0; i < BENCH_CASE_NUM; i++)
+        {
+            AD5940_BenchOne(s_BenchCase[i].pName, s_BenchCase[i].pfnOp, s_BenchCase[i].Arg,
+                            s_BenchCase[i].Ops, &res);
+            if (pfnPrint != NULL)
+                Bench_Print(pfnPrint, &res);
+        }
+    }
+
+    AD5940_CycleCounterStop();
+    AD5940_SPISetIdleHook(pfnSleep);
+    (void)AD5940_SPISetBackend(oldBackend);
+}
+
+#endif /* AD5940_BENCH_ENABLE */
+
+/* [] END OF FILE */
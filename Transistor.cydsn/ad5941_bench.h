@@ -0,0 +1,73 @@
+/*******************************************************************************
+* File Name: ad5941_bench.h
+*
+* Description:
+*   AD5940 SPI访问基准测试
+*   对ad5940.c中常用的访问函数计时，给出每次操作的时间、总线字节率和
+*   CPU占用率，用于比较SPI后端和驱动层的改动。
+*
+*   目标板上由周期计数器(SysTick)计时，主机上由ad5940_sim的仿真时钟计时
+*   （host/bench_main.c）。AD5940_BENCH_ENABLE为0时不产生代码。
+*
+********************************************************************************/
+
+#ifndef AD5941_BENCH_H
+#define AD5941_BENCH_H
+
+#include <stdint.h>
+
+/*******************************************************************************
+* 配置
+*******************************************************************************/
+
+/* 编译基准测试，默认关闭 */
+#ifndef AD5940_BENCH_ENABLE
+#define AD5940_BENCH_ENABLE         (0u)
+#endif
+
+/*******************************************************************************
+* 类型定义
+*******************************************************************************/
+
+/* 一项测试的结果 */
+typedef struct
+{
+    const char *pName;
+    uint32_t Ops;               /* 重复次数 */
+    uint32_t Cycles;            /* 总周期数 */
+    uint32_t IdleCycles;        /* 在空闲钩子中的周期数 */
+    uint32_t Bytes;             /* SPI传输字节数 */
+} AD5940_BenchResult_Type;
+
+/* 输出函数，与printf兼容 */
+typedef int (*AD5940_BenchPrintFunc)(const char *pFmt, ...);
+
+#if (AD5940_BENCH_ENABLE != 0u)
+
+/**
+ * @brief 对每个已编译的SPI后端运行全部测试并输出结果
+ * @param pfnSleep: 等待DMA时的空闲函数（如CySysPmSleep），NULL表示忙等；
+ *                  测试期间替换空闲钩子，结束后恢复为pfnSleep
+ * @param pfnPrint: 输出函数，NULL不输出
+ *
+ * 需在AD5940_Initialize()之后、应用初始化(AppAMPInit等)之前调用：
+ * 测试会覆盖序列器SRAM起始的64条命令并读空数据FIFO。结束后恢复原后端。
+ */
+void AD5940_BenchRun(void (*pfnSleep)(void), AD5940_BenchPrintFunc pfnPrint);
+
+/**
+ * @brief 运行单项测试
+ * @param pName: 名称
+ * @param pfnOp: 被测操作，参数为Arg
+ * @param Arg: 传给pfnOp的参数
+ * @param Ops: 重复次数
+ * @param pResult: 结果
+ */
+void AD5940_BenchOne(const char *pName, void (*pfnOp)(uint32_t Arg), uint32_t Arg,
+                     uint32_t Ops, AD5940_BenchResult_Type *pResult);
+
+#endif /* AD5940_BENCH_ENABLE */
+
+#endif /* AD5941_BENCH_H */
+
+/* [] END OF FILE */
@@ -16,81 +16,738 @@
 ********************************************************************************/
 
 #include "project.h"
+#include "ad5940.h"
+#include "ad5941_platform.h"
 
 /*******************************************************************************
-* 底层SPI通信函数 - 使用软件SPI实现（解决硬件SPI时钟问题）
+* SPI后端可用性检测
 *******************************************************************************/
 
-/* ===== 软件 SPI 引脚定义 ===== */
-/* 使用GPIO模拟SPI，避免TopDesign时钟配置问题 */
+/* TopDesign中放置了名为SPI_1的SCB组件(SPI主机, CPOL=0/CPHA=0, 8位, MSB先行,
+ * 不使用SCB自带的SS)时，编译硬件SPI后端。CS仍由AD5940_CS引脚控制。 */
+#if defined(CY_SCB_SPI_1_H)
+    #define AD5940_SPI_SCB_PRESENT      (1u)
+#else
+    #define AD5940_SPI_SCB_PRESENT      (0u)
+#endif
 
-#define SPI_CS_HIGH()      AD5940_CS_Write(1)        // CS 高电平
-#define SPI_CS_LOW()       AD5940_CS_Write(0)        // CS 低电平
-#define SPI_SCLK_SET()     AD5940_SCLK_Write(1)      // SCLK 设高
-#define SPI_SCLK_CLR()     AD5940_SCLK_Write(0)      // SCLK 设低
-#define SPI_MOSI_SET()     AD5940_MOSI_Write(1)      // MOSI 设高
-#define SPI_MOSI_CLR()     AD5940_MOSI_Write(0)      // MOSI 设低
-#define SPI_MISO_GET()     AD5940_MISO_Read()        // MISO 读取
+/* SCLK/MOSI/MISO仍作为GPIO组件存在时，编译软件SPI后端 */
+#if defined(CY_PINS_AD5940_SCLK_H) && defined(CY_PINS_AD5940_MOSI_H) && defined(CY_PINS_AD5940_MISO_H)
+    #define AD5940_SPI_SOFT_PRESENT     (1u)
+#else
+    #define AD5940_SPI_SOFT_PRESENT     (0u)
+#endif
+
+#if (AD5940_SPI_SCB_PRESENT == 0u) && (AD5940_SPI_SOFT_PRESENT == 0u)
+    #error "AD5940: 没有可用的SPI后端(需要SPI_1 SCB组件或AD5940_SCLK/MOSI/MISO引脚)"
+#endif
+
+/* SCB硬件FIFO深度(PSoC4为8字节)，限制在途字节数以防RX FIFO溢出 */
+#if (AD5940_SPI_SCB_PRESENT != 0u)
+    #if defined(SPI_1_FIFO_SIZE)
+        #define AD5940_SCB_FIFO_DEPTH   (SPI_1_FIFO_SIZE)
+    #else
+        #define AD5940_SCB_FIFO_DEPTH   (8u)
+    #endif
+#endif
+
+/* 突发读DMA需要SCB后端。SPI_1须在组件配置中打开RX/TX DMA触发输出，
+ * 且RX/TX缓冲区大小等于硬件FIFO深度（不使用软件缓冲区中断）；
+ * TopDesign中SPI_1的rx_tr_out/tx_tr_out需连接到下面两个DMA通道的触发输入。 */
+#if (AD5940_SPI_SCB_PRESENT != 0u) && defined(CY_DMA_GLOBAL_P4_H) && (AD5940_SPI_DMA_ENABLE != 0u)
+    #define AD5940_SPI_DMA_PRESENT      (1u)
+#else
+    #define AD5940_SPI_DMA_PRESENT      (0u)
+#endif
+
+#if (AD5940_SPI_DMA_PRESENT != 0u)
+    /* 放置了DMA组件时使用组件通道（触发已由fitter布线），否则运行时分配 */
+    #if defined(AD5940_RxDma_CHANNEL) && defined(AD5940_TxDma_CHANNEL)
+        #define AD5940_DMA_RX_CH_FIXED  (AD5940_RxDma_CHANNEL)
+        #define AD5940_DMA_TX_CH_FIXED  (AD5940_TxDma_CHANNEL)
+    #endif
+    #define AD5940_DMA_RX_PRIO          (0)     /* RX优先于TX，保证RX FIFO不溢出 */
+    #define AD5940_DMA_TX_PRIO          (1)
+
+static void ScbDma_Init(void);
+#endif
+
+static void SPI_WaitQueueIdle(void);
+
+/* 当前使用的SPI后端，可在运行时通过AD5940_SPISetBackend()切换 */
+#if (AD5940_SPI_BACKEND_DEFAULT == AD5940_SPI_BACKEND_SCB) && (AD5940_SPI_SCB_PRESENT != 0u)
+static uint8_t s_SpiBackend = AD5940_SPI_BACKEND_SCB;
+#elif (AD5940_SPI_SOFT_PRESENT != 0u)
+static uint8_t s_SpiBackend = AD5940_SPI_BACKEND_SOFT;
+#else
+static uint8_t s_SpiBackend = AD5940_SPI_BACKEND_SCB;
+#endif
+
+/* SPI累计传输字节数，在各后端的底层传输函数中累加 */
+static volatile uint32_t s_SpiBytes = 0;
+
+/*******************************************************************************
+* 底层SPI通信函数 - 软件SPI实现（解决硬件SPI时钟问题）
+*******************************************************************************/
+
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+
+/* ===== 软件 SPI 端口寄存器 ===== */
+/* 直接读写cyfitter.h中的GPIO寄存器，不经过AD5940_*_Write()组件函数。
+ * 有DR_SET/DR_CLR的器件用原子置位/清零，否则对DR做读-改-写 */
+#if defined(AD5940_SCLK__DR_SET) && defined(AD5940_MOSI__DR_SET)
+    #define SOFTSPI_SCLK_HI()   CY_SET_REG32(AD5940_SCLK__DR_SET, AD5940_SCLK__MASK)
+    #define SOFTSPI_SCLK_LO()   CY_SET_REG32(AD5940_SCLK__DR_CLR, AD5940_SCLK__MASK)
+    #define SOFTSPI_MOSI_HI()   CY_SET_REG32(AD5940_MOSI__DR_SET, AD5940_MOSI__MASK)
+    #define SOFTSPI_MOSI_LO()   CY_SET_REG32(AD5940_MOSI__DR_CLR, AD5940_MOSI__MASK)
+#else
+    #define SOFTSPI_SCLK_HI()   CY_SET_REG32(AD5940_SCLK__DR, CY_GET_REG32(AD5940_SCLK__DR) | AD5940_SCLK__MASK)
+    #define SOFTSPI_SCLK_LO()   CY_SET_REG32(AD5940_SCLK__DR, CY_GET_REG32(AD5940_SCLK__DR) & ~AD5940_SCLK__MASK)
+    #define SOFTSPI_MOSI_HI()   CY_SET_REG32(AD5940_MOSI__DR, CY_GET_REG32(AD5940_MOSI__DR) | AD5940_MOSI__MASK)
+    #define SOFTSPI_MOSI_LO()   CY_SET_REG32(AD5940_MOSI__DR, CY_GET_REG32(AD5940_MOSI__DR) & ~AD5940_MOSI__MASK)
+#endif
+#define SOFTSPI_MISO_BIT()      ((CY_GET_REG32(AD5940_MISO__PS) >> AD5940_MISO__SHIFT) & 1u)
+
+/* 软件SPI半周期延时循环数，初值为AD5940_SOFTSPI_CLKDIV，AD5940_SPISetClockDiv()修改 */
+static uint32_t s_SoftSpiDiv = AD5940_SOFTSPI_CLKDIV;
+
+/**
+ * @brief 软件SPI半周期延时 - 由运行时分频s_SoftSpiDiv决定
+ * 分频为0时使用不含延时的展开版本
+ */
+#define SOFTSPI_HALF_DELAY()                                        \
+    do {                                                            \
+        uint32_t d_;                                                \
+        for (d_ = s_SoftSpiDiv; d_ != 0u; d_--)                     \
+        {                                                           \
+            CY_NOP;                                                 \
+        }                                                           \
+    } while (0)
+#define SOFTSPI_NO_DELAY()      do { } while (0)
+
+/* 一个位周期 (Mode 0: MOSI在SCLK上升沿前建立，上升沿后采样MISO) */
+#define SOFTSPI_BIT(n, DELAY)                                       \
+    do {                                                            \
+        if ((data & (1u << (n))) != 0u) { SOFTSPI_MOSI_HI(); }      \
+        else { SOFTSPI_MOSI_LO(); }                                 \
+        DELAY();                                                    \
+        SOFTSPI_SCLK_HI();                                          \
+        DELAY();                                                    \
+        receive = (uint8_t)((receive << 1) | SOFTSPI_MISO_BIT());   \
+        SOFTSPI_SCLK_LO();                                          \
+    } while (0)
+
+#define SOFTSPI_BYTE(DELAY)                                         \
+    do {                                                            \
+        SOFTSPI_BIT(7, DELAY);                                      \
+        SOFTSPI_BIT(6, DELAY);                                      \
+        SOFTSPI_BIT(5, DELAY);                                      \
+        SOFTSPI_BIT(4, DELAY);                                      \
+        SOFTSPI_BIT(3, DELAY);                                      \
+        SOFTSPI_BIT(2, DELAY);                                      \
+        SOFTSPI_BIT(1, DELAY);                                      \
+        SOFTSPI_BIT(0, DELAY);                                      \
+    } while (0)
 
 /**
- * @brief 软件SPI延时 - 控制时钟频率
- * 2us延时对应约250 kHz时钟频率（符合AD5940规范 ≤400 kHz）
+ * @brief 软件SPI收发一个字节（8位完全展开，无延时）
+ *
+ * 原实现每位3次组件函数调用加4us延时，约15 kB/s。
+ * 分频为0时每位约十几个SYSCLK周期，24 MHz下估计在150~200 kB/s，
+ * 实际数值用AD5940_SPIMeasureThroughput()在目标板上测量。
  */
-static inline void SPI_Delay(void)
+static CY_INLINE uint8_t SoftSPI_TxRxByte(uint8_t data)
 {
-    // 增加延时，确保波形稳定，特别是对于长线连接
-    CyDelayUs(5); 
+    uint8_t receive = 0;
+
+    SOFTSPI_BYTE(SOFTSPI_NO_DELAY);
+    return receive;
 }
 
-uint8_t SoftSPI_TxRxByte(uint8_t data)
+/**
+ * @brief 软件SPI收发一个字节，每半个位周期延时s_SoftSpiDiv次循环
+ */
+static uint8_t SoftSPI_TxRxByteSlow(uint8_t data)
 {
-    uint8_t i;
     uint8_t receive = 0;
 
-    for (i = 0; i < 8; i++)
-    {
-        // 1. 准备 MOSI 数据
-        if (data & 0x80) AD5940_MOSI_Write(1);
-        else AD5940_MOSI_Write(0);
-        data <<= 1;
-        
-        CyDelayUs(1); // ⭐ 增加 1us 确保电平稳定
-        
-        // 2. 拉高时钟 (Mode 0: 在上升沿采样)
-        AD5940_SCLK_Write(1);
-        CyDelayUs(2); // ⭐ 时钟高电平宽度
-        
-        // 3. 读取 MISO
-        receive <<= 1;
-        if (AD5940_MISO_Read()) receive |= 1;
-        
-        // 4. 拉低时钟
-        AD5940_SCLK_Write(0);
-        CyDelayUs(1); // ⭐ 时钟低电平宽度
-    }
+    SOFTSPI_BYTE(SOFTSPI_HALF_DELAY);
     return receive;
 }
 
+/**
+ * @brief 软件SPI读写多字节
+ */
+static void SoftSPI_ReadWriteNBytes(const uint8_t *pSendBuffer, uint8_t *pRecvBuff, uint32_t length)
+{
+    uint32_t i;
+
+    s_SpiBytes += length;
+    if (s_SoftSpiDiv == 0u)
+    {
+        for (i = 0; i < length; i++)
+            pRecvBuff[i] = SoftSPI_TxRxByte(pSendBuffer[i]);
+    }
+    else
+    {
+        for (i = 0; i < length; i++)
+            pRecvBuff[i] = SoftSPI_TxRxByteSlow(pSendBuffer[i]);
+    }
+}
+#endif /* AD5940_SPI_SOFT_PRESENT */
+
+#if (AD5940_SPI_SCB_PRESENT != 0u)
+/**
+ * @brief SCB硬件SPI读写多字节
+ *
+ * TX FIFO保持装满以获得连续的SCLK，但发送与接收的差值不超过FIFO深度，
+ * 这样即使CPU来不及读取，RX FIFO也不会溢出。
+ */
+static void ScbSPI_ReadWriteNBytes(const uint8_t *pSendBuffer, uint8_t *pRecvBuff, uint32_t length)
+{
+    uint32_t txCount = 0;
+    uint32_t rxCount = 0;
+
+    s_SpiBytes += length;
+    SPI_1_SpiUartClearRxBuffer();
+
+    while (rxCount < length)
+    {
+        while ((txCount < length) && ((txCount - rxCount) < AD5940_SCB_FIFO_DEPTH))
+        {
+            SPI_1_SpiUartWriteTxData((uint32)pSendBuffer[txCount]);
+            txCount++;
+        }
+
+        while (SPI_1_SpiUartGetRxBufferSize() != 0u)
+        {
+            pRecvBuff[rxCount] = (uint8_t)SPI_1_SpiUartReadRxData();
+            rxCount++;
+        }
+    }
+}
+#endif /* AD5940_SPI_SCB_PRESENT */
+
+/**
+ * @brief 选择SPI传输后端
+ * @param backend: AD5940_SPI_BACKEND_SOFT 或 AD5940_SPI_BACKEND_SCB
+ * @return 0=成功, -1=该后端未编译进固件
+ *
+ * 只能在CS为高（没有进行中的传输）时调用。
+ */
+int32_t AD5940_SPISetBackend(uint8_t backend)
+{
+    switch (backend)
+    {
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+        case AD5940_SPI_BACKEND_SOFT:
+    #if (AD5940_SPI_SCB_PRESENT != 0u)
+            SPI_1_Stop();
+    #endif
+            AD5940_SCLK_Write(0);    /* CPOL=0 空闲态 */
+            s_SpiBackend = backend;
+            return 0;
+#endif
+#if (AD5940_SPI_SCB_PRESENT != 0u)
+        case AD5940_SPI_BACKEND_SCB:
+            SPI_1_Start();
+    #if (AD5940_SPI_DMA_PRESENT != 0u)
+            ScbDma_Init();
+    #endif
+            s_SpiBackend = backend;
+            return 0;
+#endif
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief 获取当前SPI传输后端
+ */
+uint8_t AD5940_SPIGetBackend(void)
+{
+    return s_SpiBackend;
+}
+
+uint32_t AD5940_SPIGetByteCount(void)
+{
+    return s_SpiBytes;
+}
+
+/**
+ * @brief 测量当前SPI后端吞吐量
+ * @param length: 测试传输字节数(1~AD5940_SPI_MEASURE_MAX)
+ * @return 字节/秒, 0=参数错误
+ *
+ * 用周期计数器计时一次length字节的传输。测量期间CS保持高电平，
+ * AD5940忽略这些字节。
+ */
+uint32_t AD5940_SPIMeasureThroughput(uint32_t length)
+{
+    uint8_t txBuff[AD5940_SPI_MEASURE_MAX];
+    uint8_t rxBuff[AD5940_SPI_MEASURE_MAX];
+    uint32_t start;
+    uint32_t ticks;
+    uint32_t i;
+
+    if ((length == 0u) || (length > AD5940_SPI_MEASURE_MAX))
+        return 0;
+
+    for (i = 0; i < length; i++)
+        txBuff[i] = (uint8_t)i;
+
+    AD5940_CS_Write(1);      /* CS 高电平 */
+    AD5940_CycleCounterStart();
+    start = AD5940_CycleCount();
+    (void)AD5940_ReadWriteNBytes(txBuff, rxBuff, length);
+    ticks = AD5940_CycleCount() - start;
+    AD5940_CycleCounterStop();
+
+    if (ticks == 0u)
+        ticks = 1u;
+    return (uint32_t)(((uint64_t)length * CYDEV_BCLK__SYSCLK__HZ) / ticks);
+}
+
 /**
  * @brief SPI读写多字节 - 修正空闲态
+ *
+ * 不控制CS，只负责传输数据；CS由AD5940_CsClr()/AD5940_CsSet()控制。
  */
 int32_t AD5940_ReadWriteNBytes(uint8_t *pSendBuffer, uint8_t *pRecvBuff, uint32_t length)
 {
+    if (!pSendBuffer || !pRecvBuff || length == 0)
+        return -1;
+
+    SPI_WaitQueueIdle();
+#if (AD5940_SPI_SCB_PRESENT != 0u)
+    if (s_SpiBackend == AD5940_SPI_BACKEND_SCB)
+    {
+        ScbSPI_ReadWriteNBytes(pSendBuffer, pRecvBuff, length);
+        return 0;
+    }
+#endif
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+    SoftSPI_ReadWriteNBytes(pSendBuffer, pRecvBuff, length);
+#endif
+
+    return 0;
+}
+
+/*******************************************************************************
+* SPI异步传输引擎
+*******************************************************************************/
+
+/*
+ * 一次传输(AD5940_SPIXfer_Type)由若干帧组成，每帧是一段连续的SPI字节，
+ * 帧前后是否翻转CS由CsCtrl决定。提交的传输在队列中依次执行：
+ *   - SCB后端且DMA可用：每帧由RX/TX两个DMA通道搬运，RX完成中断推进到下一帧，
+ *     传输完成后在中断中调用回调并启动下一个传输，CPU在此期间可以处理BLE或休眠；
+ *   - 其他情况：提交时同步执行完毕，返回前调用回调。
+ * 阻塞接口(AD5940_ReadWriteNBytes等)先等待队列空闲，因此不能在回调中调用。
+ */
+
+static AD5940_SPIXfer_Type * volatile s_pXferHead = NULL;    /* 正在执行的传输 */
+static AD5940_SPIXfer_Type * volatile s_pXferTail = NULL;
+static void (*s_pfnIdle)(void) = NULL;
+
+static void SPI_XferFinish(void);
+
+#if (AD5940_SPI_DMA_PRESENT != 0u)
+
+static int32 s_DmaRxCh = CYDMA_INVALID_CHANNEL;
+static int32 s_DmaTxCh = CYDMA_INVALID_CHANNEL;
+static volatile uint32 s_DmaTxFill = 0;    /* pTx为NULL时的TX DMA源，地址不递增 */
+static volatile uint32 s_DmaRxSink = 0;    /* pRx为NULL时的RX DMA目的，地址不递增 */
+static uint32_t s_FrameIndex = 0;          /* 当前传输中正在执行的帧 */
+
+static void ScbDma_StartFrame(const AD5940_SPIFrame_Type *pFrame);
+
+/**
+ * @brief RX DMA完成中断回调：结束当前帧，启动下一帧或结束传输
+ */
+static void ScbDma_RxDone(void)
+{
+    AD5940_SPIXfer_Type *pXfer = s_pXferHead;
+
+    CyDmaChDisable(s_DmaTxCh);
+    CyDmaChDisable(s_DmaRxCh);
+    if (pXfer == NULL)
+        return;
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceFrame(&pXfer->pFrames[s_FrameIndex], AD5940_TRACE_DMA);
+#endif
+    if ((pXfer->pFrames[s_FrameIndex].CsCtrl & AD5940_FRAME_CS_RELEASE) != 0u)
+        AD5940_CS_Write(1);
+
+    s_FrameIndex++;
+    if (s_FrameIndex < pXfer->FrameCount)
+        ScbDma_StartFrame(&pXfer->pFrames[s_FrameIndex]);
+    else
+        SPI_XferFinish();
+}
+
+/**
+ * @brief 配置一个描述符
+ * @param isRx: 1=SPI RX FIFO→内存, 0=内存→SPI TX FIFO
+ * @param pData: 内存地址；NULL时RX丢弃到s_DmaRxSink，TX发送s_DmaTxFill
+ */
+static void ScbDma_SetDescr(int32 channel, int32 descr, uint8_t isRx, uint8_t *pData, uint32_t len)
+{
+    cydma_init_struct cfg;
+
+    cfg.dataElementSize = CYDMA_BYTE;
+    cfg.numDataElements = (int32)len;
+    cfg.srcDstTransferWidth = isRx ? CYDMA_WORD_ELEMENT : CYDMA_ELEMENT_WORD;
+    if (pData == NULL)
+        cfg.addressIncrement = CYDMA_INC_NONE;
+    else
+        cfg.addressIncrement = isRx ? CYDMA_INC_DST_ADDR : CYDMA_INC_SRC_ADDR;
+    cfg.triggerType = CYDMA_PULSE_UNKNOWN;    /* SCB触发为电平触发 */
+    cfg.transferMode = CYDMA_SINGLE_DATA_ELEMENT;
+    cfg.preemptable = CYDMA_PREEMPTABLE;
+    cfg.actions = CYDMA_INVALIDATE | (isRx ? CYDMA_GENERATE_IRQ : CYDMA_NONE);
+
+    CyDmaSetConfiguration(channel, descr, &cfg);
+    if (isRx)
+    {
+        CyDmaSetSrcAddress(channel, descr, (void *)SPI_1_RX_FIFO_RD_PTR);
+        CyDmaSetDstAddress(channel, descr, (pData != NULL) ? (void *)pData : (void *)&s_DmaRxSink);
+    }
+    else
+    {
+        CyDmaSetSrcAddress(channel, descr, (pData != NULL) ? (void *)pData : (void *)&s_DmaTxFill);
+        CyDmaSetDstAddress(channel, descr, (void *)SPI_1_TX_FIFO_WR_PTR);
+    }
+    CyDmaValidateDescriptor(channel, descr);
+}
+
+/**
+ * @brief 分配并配置DMA通道，失败时引擎使用同步路径
+ */
+static void ScbDma_Init(void)
+{
+    if (s_DmaRxCh != CYDMA_INVALID_CHANNEL)
+        return;
+
+    CyDmaEnable();
+#if defined(AD5940_DMA_RX_CH_FIXED)
+    s_DmaRxCh = AD5940_DMA_RX_CH_FIXED;
+    s_DmaTxCh = AD5940_DMA_TX_CH_FIXED;
+#else
+    s_DmaRxCh = CyDmaChAlloc();
+    s_DmaTxCh = CyDmaChAlloc();
+    if ((s_DmaRxCh == CYDMA_INVALID_CHANNEL) || (s_DmaTxCh == CYDMA_INVALID_CHANNEL))
+    {
+        if (s_DmaRxCh != CYDMA_INVALID_CHANNEL)
+            (void)CyDmaChFree(s_DmaRxCh);
+        s_DmaRxCh = CYDMA_INVALID_CHANNEL;
+        s_DmaTxCh = CYDMA_INVALID_CHANNEL;
+        return;
+    }
+#endif
+    CyDmaSetPriority(s_DmaRxCh, AD5940_DMA_RX_PRIO);
+    CyDmaSetPriority(s_DmaTxCh, AD5940_DMA_TX_PRIO);
+    (void)CyDmaSetInterruptCallback(s_DmaRxCh, &ScbDma_RxDone);
+    CyDmaSetInterruptSourceMask(CyDmaGetInterruptSourceMask() | (1uL << (uint32)s_DmaRxCh));
+    CyIntEnable(CYDMA_INTR_NUMBER);
+
+    /* RX FIFO非空即触发；TX FIFO少于半满时触发，在途字节不超过FIFO深度 */
+    SPI_1_RX_FIFO_CTRL_REG = (SPI_1_RX_FIFO_CTRL_REG & ~SPI_1_RX_FIFO_CTRL_TRIGGER_LEVEL_MASK);
+    SPI_1_TX_FIFO_CTRL_REG = (SPI_1_TX_FIFO_CTRL_REG & ~SPI_1_TX_FIFO_CTRL_TRIGGER_LEVEL_MASK) |
+                             ((AD5940_SCB_FIFO_DEPTH / 2u) & SPI_1_TX_FIFO_CTRL_TRIGGER_LEVEL_MASK);
+}
+
+/**
+ * @brief 用DMA启动一帧传输
+ */
+static void ScbDma_StartFrame(const AD5940_SPIFrame_Type *pFrame)
+{
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_ASSERT) != 0u)
+        AD5940_CS_Write(0);
+
+    s_DmaTxFill = pFrame->TxFill;
+    s_SpiBytes += pFrame->Length;
+    SPI_1_SpiUartClearRxBuffer();
+
+    ScbDma_SetDescr(s_DmaRxCh, 0, 1u, pFrame->pRx, pFrame->Length);
+    ScbDma_SetDescr(s_DmaTxCh, 0, 0u, (uint8_t *)pFrame->pTx, pFrame->Length);
+    CyDmaSetNextDescriptor(s_DmaRxCh, 0);
+    CyDmaSetNextDescriptor(s_DmaTxCh, 0);
+
+    /* 先使能RX，再使能TX开始产生时钟 */
+    CyDmaChEnable(s_DmaRxCh);
+    CyDmaChEnable(s_DmaTxCh);
+}
+
+/**
+ * @brief 当前传输能否由DMA执行
+ */
+static uint8_t ScbDma_Usable(void)
+{
+    return ((s_SpiBackend == AD5940_SPI_BACKEND_SCB) && (s_DmaRxCh != CYDMA_INVALID_CHANNEL)) ? 1u : 0u;
+}
+#endif /* AD5940_SPI_DMA_PRESENT */
+
+/**
+ * @brief 同步执行一帧，DMA不可用时使用
+ */
+static void SyncSPI_Frame(const AD5940_SPIFrame_Type *pFrame)
+{
+    uint8_t fillBuff[16];
+    uint8_t sinkBuff[16];
+    const uint8_t *pTx = pFrame->pTx;
+    uint8_t *pRx = pFrame->pRx;
+    uint32_t len = pFrame->Length;
+    uint32_t chunk;
     uint32_t i;
 
-    if (!pSendBuffer || !pRecvBuff || length == 0)
+    for (i = 0; i < sizeof(fillBuff); i++)
+        fillBuff[i] = pFrame->TxFill;
+
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_ASSERT) != 0u)
+        AD5940_CS_Write(0);
+
+    while (len != 0u)
+    {
+        chunk = (len > sizeof(fillBuff)) ? sizeof(fillBuff) : len;
+#if (AD5940_SPI_SCB_PRESENT != 0u)
+        if (s_SpiBackend == AD5940_SPI_BACKEND_SCB)
+            ScbSPI_ReadWriteNBytes((pTx != NULL) ? pTx : fillBuff, (pRx != NULL) ? pRx : sinkBuff, chunk);
+        else
+#endif
+        {
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+            SoftSPI_ReadWriteNBytes((pTx != NULL) ? pTx : fillBuff, (pRx != NULL) ? pRx : sinkBuff, chunk);
+#endif
+        }
+        if (pTx != NULL)
+            pTx += chunk;
+        if (pRx != NULL)
+            pRx += chunk;
+        len -= chunk;
+    }
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceFrame(pFrame, 0u);
+#endif
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_RELEASE) != 0u)
+        AD5940_CS_Write(1);
+}
+
+/**
+ * @brief 启动队首传输。由提交者(队列原为空时)或上一个传输的完成处理调用
+ */
+static void SPI_XferStart(void)
+{
+    AD5940_SPIXfer_Type *pXfer = s_pXferHead;
+
+    if (pXfer == NULL)
+        return;
+    pXfer->State = AD5940_XFER_ACTIVE;
+
+#if (AD5940_SPI_DMA_PRESENT != 0u)
+    if (ScbDma_Usable())
+    {
+        s_FrameIndex = 0;
+        ScbDma_StartFrame(&pXfer->pFrames[0]);
+        return;
+    }
+#endif
+    {
+        uint32_t i;
+        for (i = 0; i < pXfer->FrameCount; i++)
+            SyncSPI_Frame(&pXfer->pFrames[i]);
+        SPI_XferFinish();
+    }
+}
+
+/**
+ * @brief 结束队首传输：出队、调用回调、启动下一个传输
+ */
+static void SPI_XferFinish(void)
+{
+    AD5940_SPIXfer_Type *pXfer = s_pXferHead;
+
+    s_pXferHead = pXfer->pNext;
+    if (s_pXferHead == NULL)
+        s_pXferTail = NULL;
+    pXfer->pNext = NULL;
+    pXfer->State = AD5940_XFER_DONE;
+
+    if (pXfer->pfnDone != NULL)
+        pXfer->pfnDone(pXfer);
+
+    /* 同步路径下回调可能已经提交并执行了新传输，这里只在队首未启动时启动 */
+    if ((s_pXferHead != NULL) && (s_pXferHead->State == AD5940_XFER_QUEUED))
+        SPI_XferStart();
+}
+
+/**
+ * @brief 等待直到条件满足，期间在关中断状态下调用空闲钩子
+ */
+static void SPI_WaitState(volatile uint8_t *pState, uint8_t doneState)
+{
+    uint8 intState;
+
+    while (*pState != doneState)
+    {
+        /* 关中断后再检查一次，避免完成中断发生在检查与睡眠之间 */
+        intState = CyEnterCriticalSection();
+        if ((*pState != doneState) && (s_pfnIdle != NULL))
+            s_pfnIdle();
+        CyExitCriticalSection(intState);
+    }
+}
+
+int32_t AD5940_SPISubmit(AD5940_SPIXfer_Type *pXfer)
+{
+    uint8 intState;
+    uint32_t i;
+
+    if ((pXfer == NULL) || (pXfer->pFrames == NULL) || (pXfer->FrameCount == 0u))
+        return -1;
+    if ((pXfer->State == AD5940_XFER_QUEUED) || (pXfer->State == AD5940_XFER_ACTIVE))
         return -1;
+    for (i = 0; i < pXfer->FrameCount; i++)
+    {
+        if (pXfer->pFrames[i].Length == 0u)
+            return -1;
+    }
 
-    // ⭐ 不控制CS，只负责传输数据
-    for (i = 0; i < length; i++)
+    intState = CyEnterCriticalSection();
+    pXfer->pNext = NULL;
+    pXfer->State = AD5940_XFER_QUEUED;
+    if (s_pXferTail != NULL)
+    {
+        s_pXferTail->pNext = pXfer;
+        s_pXferTail = pXfer;
+        pXfer = NULL;       /* 排队，由前一个传输完成时启动 */
+    }
+    else
+    {
+        s_pXferHead = pXfer;
+        s_pXferTail = pXfer;
+    }
+    CyExitCriticalSection(intState);
+
+    /* 队列原本为空，立即启动（同步路径较长，不在临界区内执行） */
+    if (pXfer != NULL)
+        SPI_XferStart();
+
+    return 0;
+}
+
+void AD5940_SPIWait(AD5940_SPIXfer_Type *pXfer)
+{
+    if ((pXfer == NULL) || (pXfer->State == AD5940_XFER_IDLE))
+        return;
+    SPI_WaitState(&pXfer->State, AD5940_XFER_DONE);
+}
+
+uint8_t AD5940_SPIIsIdle(void)
+{
+    return (s_pXferHead == NULL) ? 1u : 0u;
+}
+
+int32_t AD5940_SPITransfer(const AD5940_SPIFrame_Type *pFrames, uint32_t FrameCount)
+{
+    AD5940_SPIXfer_Type xfer;
+
+    xfer.pFrames = pFrames;
+    xfer.FrameCount = FrameCount;
+    xfer.pfnDone = NULL;
+    xfer.pUser = NULL;
+    xfer.State = AD5940_XFER_IDLE;
+    xfer.pNext = NULL;
+
+    if (AD5940_SPISubmit(&xfer) != 0)
+        return -1;
+    AD5940_SPIWait(&xfer);
+
+    return 0;
+}
+
+/**
+ * @brief 等待队列中所有传输完成，同步读写前调用
+ */
+static void SPI_WaitQueueIdle(void)
+{
+    uint8 intState;
+
+    while (s_pXferHead != NULL)
     {
-        pRecvBuff[i] = SoftSPI_TxRxByte(pSendBuffer[i]);
-        CyDelayUs(2);  // 字节间延时
+        intState = CyEnterCriticalSection();
+        if ((s_pXferHead != NULL) && (s_pfnIdle != NULL))
+            s_pfnIdle();
+        CyExitCriticalSection(intState);
     }
+}
+
+/*******************************************************************************
+* SPI突发读
+*******************************************************************************/
+
+static AD5940_SPIFrame_Type s_BurstFrames[2];
+static AD5940_SPIXfer_Type s_BurstXfer;
+static AD5940_SPIBurstDoneFunc s_pfnBurstDone = NULL;
+
+static void SPI_BurstDone(AD5940_SPIXfer_Type *pXfer)
+{
+    (void)pXfer;
+    if (s_pfnBurstDone != NULL)
+        s_pfnBurstDone();
+}
+
+int32_t AD5940_SPIBurstRead(uint8_t *pSeg0, uint32_t Len0,
+                            uint8_t *pSeg1, uint32_t Len1,
+                            uint8_t TxFill, AD5940_SPIBurstDoneFunc pfnDone)
+{
+    if (!pSeg0 || Len0 == 0 || (Len1 != 0 && !pSeg1))
+        return -1;
+    if ((Len0 > 0xFFFFu) || (Len1 > 0xFFFFu))
+        return -1;
+    if (AD5940_SPIBurstBusy())
+        return -1;
+
+    s_BurstFrames[0].pTx = NULL;
+    s_BurstFrames[0].pRx = pSeg0;
+    s_BurstFrames[0].Length = (uint16_t)Len0;
+    s_BurstFrames[0].TxFill = TxFill;
+    s_BurstFrames[0].CsCtrl = 0u;       /* 不控制CS */
+    s_BurstFrames[1] = s_BurstFrames[0];
+    s_BurstFrames[1].pRx = pSeg1;
+    s_BurstFrames[1].Length = (uint16_t)Len1;
+
+    s_pfnBurstDone = pfnDone;
+    s_BurstXfer.pFrames = s_BurstFrames;
+    s_BurstXfer.FrameCount = (Len1 != 0u) ? 2u : 1u;
+    s_BurstXfer.pfnDone = SPI_BurstDone;
+    s_BurstXfer.pUser = NULL;
+    if (AD5940_SPISubmit(&s_BurstXfer) != 0)
+        return -1;
+    if (pfnDone == NULL)
+        AD5940_SPIWait(&s_BurstXfer);
 
     return 0;
 }
 
+uint8_t AD5940_SPIBurstBusy(void)
+{
+    return ((s_BurstXfer.State == AD5940_XFER_QUEUED) || (s_BurstXfer.State == AD5940_XFER_ACTIVE)) ? 1u : 0u;
+}
+
+void AD5940_SPIBurstWait(void)
+{
+    AD5940_SPIWait(&s_BurstXfer);
+}
+
+void AD5940_SPISetIdleHook(void (*pfnIdle)(void))
+{
+    s_pfnIdle = pfnIdle;
+}
+
 /*******************************************************************************
 
 * GPIO控制函数
@@ -104,6 +761,9 @@ int32_t AD5940_ReadWriteNBytes(uint8_t *pSendBuffer, uint8_t *pRecvBuff, uint32_
 void AD5940_CsClr(void)
 {
     AD5940_CS_Write(0);
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceCs(AD5940_TRACE_CS_ASSERT);
+#endif
 }
 
 /**
@@ -114,6 +774,9 @@ void AD5940_CsClr(void)
 void AD5940_CsSet(void)
 {
     AD5940_CS_Write(1);
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceCs(AD5940_TRACE_CS_RELEASE);
+#endif
 }
 
 /**
@@ -163,38 +826,477 @@ void AD5940_Delay10us(uint32_t time)
     }
 }
 
+static volatile uint32_t s_McuIntFlag = 0; /* AD5940_EXTI中断置位，主循环清除 */
+
+/**
+ * @brief AD5940 INT0输出（AD5940_EXTI下降沿）中断
+ *
+ * 只置标志，不访问SPI：数据由主循环中的AppAMPISR()/AppIMPISR()读取，
+ * 中断可能打断正在进行的SPI帧。
+ */
+static CY_ISR(AD5940_IntIsr)
+{
+    (void)AD5940_EXTI_ClearInterrupt();
+    s_McuIntFlag = 1u;
+}
+
 /**
  * @brief 获取MCU中断标志
  * @return 中断状态（0=无中断, 非0=有中断）
  * 
- * 如果硬件中连接了AD5940的中断输出引脚，可在此读取其状态
- * 当前实现返回0，表示未检测到中断
+ * AD5940的INTC0（须在INTCSEL0中只选择需要MCU处理的中断源，
+ * 并将对应GPIO配置为GP0_INT）经AD5940_EXTI引脚触发AD5940_Interrupt后置位。
  */
 uint32_t AD5940_GetMCUIntFlag(void)
 {
-    /* 如果硬件中连接了AD5940的中断引脚，可在此读取
-     * 例如：return AD5940_Interrupt_Read();
-     */
-    
-    /* 如果未使用中断引脚，返回0表示无中断 */
-    return 0;
+    return s_McuIntFlag;
 }
 
 /**
  * @brief 清除MCU中断标志
  * @return 1=成功, 0=失败
  * 
- * 清除之前检测到的中断标志，为下一次中断做准备
+ * 在读取AFE中断状态之前清除：处理期间的新中断会再次置位，不会丢失
  */
 uint32_t AD5940_ClrMCUIntFlag(void)
 {
-    /* 如果使用了中断引脚，在此清除中断
-     * 例如：AD5940_Interrupt_ClearInterrupt();
-     */
-    
+    s_McuIntFlag = 0u;
     return 1;  /* 成功 */
 }
 
+/**
+ * @brief 安装AD5940 INT0的MCU中断服务并清除MCU中断标志
+ *
+ * AD5940_MCUResourceInit()会调用；不经过该函数初始化的流程（main()中的
+ * 状态机）在配置AD5940中断输出之前单独调用。
+ */
+void AD5940_MCUIntStart(void)
+{
+    /* AD5940 INT0 -> AD5940_EXTI（下降沿） -> AD5940_Interrupt */
+    (void)AD5940_EXTI_ClearInterrupt();
+    AD5940_Interrupt_ClearPending();
+    AD5940_Interrupt_StartEx(AD5940_IntIsr);
+    s_McuIntFlag = 0u;
+}
+
+/*******************************************************************************
+* 周期计数器
+*******************************************************************************/
+
+static volatile uint32_t s_CycleMs = 0;     /* SysTick 1ms中断计数 */
+static uint8_t s_CycleUsers = 0;            /* AD5940_CycleCounterStart()引用计数 */
+
+static void Cycle_SysTickIsr(void)
+{
+    s_CycleMs++;
+}
+
+/**
+ * @brief 启动周期计数器：SysTick每1ms中断一次，中断计数加当前值得到SYSCLK周期数
+ *
+ * SysTick由CySysTickStart()按1ms配置，与其他使用SysTick回调的模块兼容。
+ * DeepSleep期间SysTick停止，这段时间不计入。
+ */
+void AD5940_CycleCounterStart(void)
+{
+    uint32_t i;
+
+    if (s_CycleUsers++ != 0u)
+        return;
+
+    CySysTickStart();
+    for (i = 0; i < CY_SYS_SYST_NUM_OF_CALLBACKS; i++)
+    {
+        if (CySysTickGetCallback(i) == Cycle_SysTickIsr)
+            break;
+        if (CySysTickGetCallback(i) == NULL)
+        {
+            (void)CySysTickSetCallback(i, Cycle_SysTickIsr);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 停止周期计数器，最后一个使用者停止时关闭SysTick
+ */
+void AD5940_CycleCounterStop(void)
+{
+    if (s_CycleUsers == 0u)
+        return;
+    if (--s_CycleUsers == 0u)
+        CySysTickStop();
+}
+
+/**
+ * @brief 读取周期计数
+ *
+ * 关中断时SysTick回绕的中断还未处理，由PENDSTSET补上这1ms；
+ * 两次读取计数值之间发生回绕则重读。
+ */
+uint32_t AD5940_CycleCount(void)
+{
+    uint32_t ms;
+    uint32_t val;
+    uint32_t pend;
+    uint32_t period = CySysTickGetReload() + 1u;
+
+    do
+    {
+        ms = s_CycleMs;
+        val = CySysTickGetValue();
+        pend = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while ((ms != s_CycleMs) || (CySysTickGetValue() > val));
+
+    if (pend != 0u)
+        ms++;
+    return ms * period + (period - 1u - val);
+}
+
+uint32_t AD5940_CycleHz(void)
+{
+    return CYDEV_BCLK__SYSCLK__HZ;
+}
+
+
+/*******************************************************************************
+* SPI时钟校准
+*******************************************************************************/
+
+/* SPI_1使用组件内部时钟(SPI_1_SCBCLK)时，SCB的分频可在运行时修改 */
+#if (AD5940_SPI_SCB_PRESENT != 0u) && defined(CY_CLOCK_SPI_1_SCBCLK_H)
+    #define AD5940_SCB_CLKDIV_PRESENT   (1u)
+#else
+    #define AD5940_SCB_CLKDIV_PRESENT   (0u)
+#endif
+
+#if (AD5940_SCB_CLKDIV_PRESENT != 0u)
+static uint32_t s_ScbDivDefault = 0;    /* 组件配置的分频，SCB校准的起点；0=未读取 */
+
+static uint32_t ScbClk_GetDiv(void)
+{
+    return (uint32_t)SPI_1_SCBCLK_GetDividerRegister() + 1u;
+}
+#endif
+
+int32_t AD5940_SPISetClockDiv(uint32_t div)
+{
+    SPI_WaitQueueIdle();
+    switch (s_SpiBackend)
+    {
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+        case AD5940_SPI_BACKEND_SOFT:
+            s_SoftSpiDiv = div;
+            return 0;
+#endif
+#if (AD5940_SCB_CLKDIV_PRESENT != 0u)
+        case AD5940_SPI_BACKEND_SCB:
+            if ((div == 0u) || (div > 0xFFFFu))
+                return -1;
+            if (s_ScbDivDefault == 0u)
+                s_ScbDivDefault = ScbClk_GetDiv();
+            SPI_1_SCBCLK_SetDividerValue((uint16)div);
+            return 0;
+#endif
+        default:
+            return -1;
+    }
+}
+
+uint32_t AD5940_SPIGetClockDiv(void)
+{
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
+    if (s_SpiBackend == AD5940_SPI_BACKEND_SOFT)
+        return s_SoftSpiDiv;
+#endif
+#if (AD5940_SCB_CLKDIV_PRESENT != 0u)
+    if (s_SpiBackend == AD5940_SPI_BACKEND_SCB)
+        return ScbClk_GetDiv();
+#endif
+    return 0;
+}
+
+/**
+ * @brief 链路测试
+ *
+ * CALDATLOCK为32位可读写寄存器，写入非解锁密钥的值只会保持校准数据锁定，
+ * 适合做写入-回读。图案覆盖全0/全1、相邻位翻转和首尾位，每轮与轮数异或，
+ * 避免上一轮残留的回读值掩盖错误。
+ */
+int32_t AD5940_SPILinkTest(uint32_t repeat)
+{
+    static const uint32_t pattern[] =
+    {
+        0x00000000u, 0xFFFFFFFFu, 0xAAAAAAAAu, 0x55555555u,
+        0x0F0F0F0Fu, 0xF0F0F0F0u, 0x80000001u, 0x7FFFFFFEu,
+    };
+    uint32_t i;
+    uint32_t j;
+    uint32_t data;
+    int32_t result = 0;
+
+    for (i = 0; (i < repeat) && (result == 0); i++)
+    {
+        if (AD5940_ReadReg(REG_AFECON_ADIID) != AD5940_ADIID)
+            result = -1;
+        if ((AD5940_ReadReg(REG_AFECON_CHIPID) & BITM_AFECON_CHIPID_PARTID) != 0x5500u)
+            result = -1;
+        for (j = 0; (j < sizeof(pattern) / sizeof(pattern[0])) && (result == 0); j++)
+        {
+            data = pattern[j] ^ (i * 0x01010101u);
+            if (data == KEY_CALDATLOCK)
+                data = ~data;
+            AD5940_WriteReg(REG_AFE_CALDATLOCK, data);
+            if (AD5940_ReadReg(REG_AFE_CALDATLOCK) != data)
+                result = -1;
+        }
+    }
+    AD5940_WriteReg(REG_AFE_CALDATLOCK, REG_AFE_CALDATLOCK_RESET);
+
+    return result;
+}
+
+#if (AD5940_SPI_CAL_ENABLE != 0u)
+
+#define SPICAL_MAGIC            (0x4C414353u)   /* "SCAL" */
+#define SPICAL_DIV_NONE         (0xFFFFu)       /* 该后端未校准 */
+
+/* Em_EEPROM中保存的校准结果 */
+typedef struct
+{
+    uint32_t Magic;
+    uint16_t SoftDiv;
+    uint16_t ScbDiv;
+} SpiCal_Type;
+
+#if defined(CY_EM_EEPROM_H)
+#define SPICAL_EEPROM_SIZE      (sizeof(SpiCal_Type))
+
+/* Em_EEPROM占用的Flash，按行对齐，初值全0(Magic无效) */
+static const uint8_t s_SpiCalFlash[CY_EM_EEPROM_GET_PHYSICAL_SIZE(SPICAL_EEPROM_SIZE, 1u, 0u)]
+    CY_ALIGN(CY_FLASH_SIZEOF_ROW) = {0u};
+static cy_stc_eeprom_context_t s_SpiCalEeprom;
+static uint8_t s_SpiCalEepromReady = 0;
+
+static int32_t SpiCal_EepromInit(void)
+{
+    cy_stc_eeprom_config_t config;
+
+    if (s_SpiCalEepromReady == 0u)
+    {
+        config.eepromSize = SPICAL_EEPROM_SIZE;
+        config.wearLevelingFactor = 1u;
+        config.redundantCopy = 0u;
+        config.blockingWrite = 1u;
+        config.userFlashStartAddr = (uint32)s_SpiCalFlash;
+        if (Cy_Em_EEPROM_Init(&config, &s_SpiCalEeprom) != CY_EM_EEPROM_SUCCESS)
+            return -1;
+        s_SpiCalEepromReady = 1u;
+    }
+    return 0;
+}
+#endif /* CY_EM_EEPROM_H */
+
+/**
+ * @brief 读取保存的校准结果
+ * @return 0=有效, -1=未保存或Em_EEPROM不可用
+ */
+static int32_t SpiCal_Load(SpiCal_Type *pCal)
+{
+#if defined(CY_EM_EEPROM_H)
+    if ((SpiCal_EepromInit() == 0) &&
+        (Cy_Em_EEPROM_Read(0u, pCal, sizeof(*pCal), &s_SpiCalEeprom) == CY_EM_EEPROM_SUCCESS) &&
+        (pCal->Magic == SPICAL_MAGIC))
+        return 0;
+#endif
+    pCal->Magic = SPICAL_MAGIC;
+    pCal->SoftDiv = SPICAL_DIV_NONE;
+    pCal->ScbDiv = SPICAL_DIV_NONE;
+    return -1;
+}
+
+static void SpiCal_Save(SpiCal_Type *pCal)
+{
+#if defined(CY_EM_EEPROM_H)
+    if (SpiCal_EepromInit() == 0)
+        (void)Cy_Em_EEPROM_Write(0u, pCal, sizeof(*pCal), &s_SpiCalEeprom);
+#else
+    (void)pCal;
+#endif
+}
+
+/**
+ * @brief 在当前后端上从最慢分频开始逐档加快，找到第一次失败为止
+ * @param pDiv: 选定的分频（最后通过的一档加余量）
+ * @return 0=成功, -1=最慢一档也失败
+ *
+ * 过快的时钟可能把错误的地址或数据写进芯片，出现过失败时复位芯片。
+ */
+static int32_t SpiCal_Search(uint32_t *pDiv)
+{
+    uint32_t slowest;
+    uint32_t fastest;
+    uint32_t div;
+    uint32_t best = SPICAL_DIV_NONE;
+    uint8_t failed = 0u;
+
+    if (s_SpiBackend == AD5940_SPI_BACKEND_SOFT)
+    {
+        slowest = AD5940_SOFTSPI_CAL_MAX;
+        fastest = 0u;
+    }
+    else
+    {
+#if (AD5940_SCB_CLKDIV_PRESENT != 0u)
+        if (s_ScbDivDefault == 0u)
+            s_ScbDivDefault = ScbClk_GetDiv();
+        slowest = s_ScbDivDefault;
+#else
+        slowest = 1u;
+#endif
+        fastest = 1u;
+    }
+
+    for (div = slowest; ; div--)
+    {
+        (void)AD5940_SPISetClockDiv(div);
+        if (AD5940_SPILinkTest(AD5940_SPI_CAL_REPEAT) != 0)
+        {
+            failed = 1u;
+            break;
+        }
+        best = div;
+        if (div == fastest)
+            break;
+    }
+
+    if (best != SPICAL_DIV_NONE)
+    {
+        best = ((slowest - best) > AD5940_SPI_CAL_MARGIN) ? (best + AD5940_SPI_CAL_MARGIN) : slowest;
+        (void)AD5940_SPISetClockDiv(best);
+        *pDiv = best;
+    }
+    if (failed != 0u)
+    {
+        AD5940_HWReset();
+        (void)AD5940_ReadReg(REG_AFECON_ADIID);     /* CS下降沿唤醒SPI接口 */
+    }
+    return (best != SPICAL_DIV_NONE) ? 0 : -1;
+}
+
+int32_t AD5940_SPICalibrate(uint8_t Flags)
+{
+    static const uint8_t backends[] = {AD5940_SPI_BACKEND_SOFT, AD5940_SPI_BACKEND_SCB};
+    SpiCal_Type stored;
+    SpiCal_Type cal;
+    uint16_t *pDiv;
+    uint8_t oldBackend = s_SpiBackend;
+    uint32_t oldDiv;
+    uint32_t div;
+    uint32_t b;
+    int32_t result = AD5940_SPI_CAL_STORED;
+
+    if (((Flags & AD5940_SPI_CAL_FORCE) != 0u) || (SpiCal_Load(&stored) != 0))
+    {
+        stored.Magic = SPICAL_MAGIC;
+        stored.SoftDiv = SPICAL_DIV_NONE;
+        stored.ScbDiv = SPICAL_DIV_NONE;
+    }
+    cal = stored;
+
+    for (b = 0; b < sizeof(backends); b++)
+    {
+        if (AD5940_SPISetBackend(backends[b]) != 0)
+            continue;
+        oldDiv = AD5940_SPIGetClockDiv();
+        if (AD5940_SPISetClockDiv(oldDiv) != 0)
+            continue;                               /* 该后端的时钟不可调 */
+
+        pDiv = (backends[b] == AD5940_SPI_BACKEND_SOFT) ? &cal.SoftDiv : &cal.ScbDiv;
+        if ((*pDiv != SPICAL_DIV_NONE) && (AD5940_SPISetClockDiv(*pDiv) == 0) &&
+            (AD5940_SPILinkTest(AD5940_SPI_CAL_REPEAT) == 0))
+            continue;
+
+        if (SpiCal_Search(&div) == 0)
+        {
+            *pDiv = (uint16_t)div;
+            if (result == AD5940_SPI_CAL_STORED)
+                result = AD5940_SPI_CAL_DONE;
+        }
+        else
+        {
+            (void)AD5940_SPISetClockDiv(oldDiv);
+            *pDiv = SPICAL_DIV_NONE;
+            result = AD5940_SPI_CAL_FAIL;
+        }
+    }
+    (void)AD5940_SPISetBackend(oldBackend);
+
+    /* 只保存成功的结果，避免未接芯片时覆盖已有的校准 */
+    if ((result == AD5940_SPI_CAL_DONE) && ((Flags & AD5940_SPI_CAL_NOSAVE) == 0u) &&
+        ((cal.SoftDiv != stored.SoftDiv) || (cal.ScbDiv != stored.ScbDiv)))
+        SpiCal_Save(&cal);
+
+    return result;
+}
+
+#endif /* AD5940_SPI_CAL_ENABLE */
+
+/*******************************************************************************
+* 非易失存储
+*******************************************************************************/
+
+#if (AD5940_NVM_SIZE != 0u)
+
+#if ((AD5940_NVM_SIZE % CY_FLASH_SIZEOF_ROW) != 0u)
+    #error "AD5940_NVM_SIZE must be a multiple of CY_FLASH_SIZEOF_ROW"
+#endif
+
+/* 按行对齐的Flash存储区，初值全0 */
+static const uint8_t s_NvmFlash[AD5940_NVM_SIZE] CY_ALIGN(CY_FLASH_SIZEOF_ROW) = {0u};
+
+const uint8_t *AD5940_NvmBase(void)
+{
+    return s_NvmFlash;
+}
+
+int32_t AD5940_NvmWrite(uint32_t Offset, const void *pData, uint32_t Len)
+{
+    static uint8_t row[CY_FLASH_SIZEOF_ROW];
+    const uint8_t *pSrc = (const uint8_t *)pData;
+    const uint8_t *pRow;
+    uint32_t pos;
+    uint32_t n;
+
+    if ((Offset > AD5940_NVM_SIZE) || (Len > AD5940_NVM_SIZE - Offset))
+        return -1;
+
+    while (Len != 0u)
+    {
+        /* s_NvmFlash按行对齐 */
+        pos = Offset % CY_FLASH_SIZEOF_ROW;
+        pRow = &s_NvmFlash[Offset - pos];
+        n = CY_FLASH_SIZEOF_ROW - pos;
+        if (n > Len)
+            n = Len;
+
+        /* 内容相同的行不擦写 */
+        if (memcmp(&pRow[pos], pSrc, n) != 0)
+        {
+            memcpy(row, pRow, CY_FLASH_SIZEOF_ROW);
+            memcpy(&row[pos], pSrc, n);
+            if (CySysFlashWriteRow(((uint32_t)(uintptr_t)pRow - CY_FLASH_BASE) / CY_FLASH_SIZEOF_ROW, row) != CY_SYS_FLASH_SUCCESS)
+                return -1;
+        }
+        Offset += n;
+        pSrc += n;
+        Len -= n;
+    }
+    return 0;
+}
+
+#endif /* AD5940_NVM_SIZE */
+
 /*******************************************************************************
 * 初始化函数
 *******************************************************************************/
@@ -206,8 +1308,9 @@ uint32_t AD5940_ClrMCUIntFlag(void)
  * 
  * 该函数初始化：
  * 1. CS和RST引脚的初始状态
- * 2. SPI通信参数（通常已在TopDesign中配置）
- * 3. 芯片工作环境
+ * 2. SPI通信参数（通常已在TopDesign中配置），并启动当前SPI后端
+ * 3. AD5940中断引脚(AD5940_EXTI)的中断服务，清除MCU中断标志
+ * 4. 芯片工作环境
  * 
  * 调用时机：
  * - 在main()函数早期调用
@@ -235,8 +1338,22 @@ int32_t AD5940_MCUResourceInit(void *pCfg)
     /* 设置引脚初始状态 */
     AD5940_CS_Write(1);      /* CS 高电平 */
     AD5940_RST_Write(1);     /* RST 高电平 */
+#if (AD5940_SPI_SOFT_PRESENT != 0u)
     AD5940_SCLK_Write(0);    /* SCLK 低电平（CPOL=0）*/
     AD5940_MOSI_Write(0);    /* MOSI 低电平 */
+#endif
+
+    /* 启动当前选择的SPI后端 */
+    AD5940_SPISetBackend(s_SpiBackend);
+
+    /* AD5940 INT0 -> AD5940_EXTI（下降沿） -> AD5940_Interrupt */
+    AD5940_MCUIntStart();
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    /* 跟踪时间戳使用周期计数器 */
+    AD5940_CycleCounterStart();
+    AD5940_SPITraceSetClock(AD5940_CycleCount, AD5940_CycleHz());
+#endif
     
     /* 等待系统稳定 */
     CyDelay(10);
@@ -24,6 +24,105 @@
 #define SPI_MOSI_CLR()     AD5940_MOSI_Write(0)      // MOSI 设低
 #define SPI_MISO_GET()     AD5940_MISO_Read()        // MISO 读取
 
+/*******************************************************************************
+* SPI传输后端
+*******************************************************************************/
+
+#define AD5940_SPI_BACKEND_SOFT     (0u)    /* GPIO软件SPI */
+#define AD5940_SPI_BACKEND_SCB      (1u)    /* SCB硬件SPI主机(SPI_1组件) */
+
+/* 编译时默认后端。SPI_1组件不存在时自动回落到软件SPI */
+#ifndef AD5940_SPI_BACKEND_DEFAULT
+#define AD5940_SPI_BACKEND_DEFAULT  AD5940_SPI_BACKEND_SCB
+#endif
+
+/* 软件SPI时钟分频：每个SCLK半周期额外插入的NOP循环次数，0=不插入(最快)。
+ * 每增加1约增加4个SYSCLK周期的半周期；AD5940 SCLK上限16 MHz，不会超出 */
+#ifndef AD5940_SOFTSPI_CLKDIV
+#define AD5940_SOFTSPI_CLKDIV       (0u)
+#endif
+
+/* AD5940_SPIMeasureThroughput()单次测量的最大字节数 */
+#define AD5940_SPI_MEASURE_MAX      (256u)
+
+/**
+ * @brief 运行时切换SPI后端
+ * @param backend: AD5940_SPI_BACKEND_SOFT 或 AD5940_SPI_BACKEND_SCB
+ * @return 0=成功, -1=该后端未编译进固件
+ */
+int32_t AD5940_SPISetBackend(uint8_t backend);
+uint8_t AD5940_SPIGetBackend(void);
+
+/**
+ * @brief 测量当前SPI后端吞吐量（CS保持高电平，AD5940忽略这些字节）
+ * @param length: 测试传输字节数(1~AD5940_SPI_MEASURE_MAX)
+ * @return 字节/秒, 0=参数错误
+ */
+uint32_t AD5940_SPIMeasureThroughput(uint32_t length);
+
+/*******************************************************************************
+* SPI时钟校准
+*******************************************************************************/
+
+/* 编译启动时的SPI时钟校准，结果保存在Em_EEPROM中 */
+#ifndef AD5940_SPI_CAL_ENABLE
+#define AD5940_SPI_CAL_ENABLE       (1u)
+#endif
+
+/* 软件SPI校准的起始(最慢)分频 */
+#ifndef AD5940_SOFTSPI_CAL_MAX
+#define AD5940_SOFTSPI_CAL_MAX      (32u)
+#endif
+
+/* 选定的分频比最快通过的分频慢几档，留出温度和电压变化的余量 */
+#ifndef AD5940_SPI_CAL_MARGIN
+#define AD5940_SPI_CAL_MARGIN       (1u)
+#endif
+
+/* 每一档链路测试的重复次数 */
+#ifndef AD5940_SPI_CAL_REPEAT
+#define AD5940_SPI_CAL_REPEAT       (16u)
+#endif
+
+/* AD5940_SPICalibrate()的选项 */
+#define AD5940_SPI_CAL_FORCE        (0x01u)     /* 忽略保存的结果，重新校准 */
+#define AD5940_SPI_CAL_NOSAVE       (0x02u)     /* 不写入Em_EEPROM */
+
+/* AD5940_SPICalibrate()的返回值 */
+#define AD5940_SPI_CAL_STORED       (0)         /* 使用已保存的结果，且链路测试通过 */
+#define AD5940_SPI_CAL_DONE         (1)         /* 重新校准完成 */
+#define AD5940_SPI_CAL_FAIL         (-1)        /* 最慢设置也无法通信，已恢复默认分频 */
+
+/**
+ * @brief 设置/读取当前后端的SPI时钟分频，数值越大越慢
+ *
+ * 软件SPI为半周期延时循环数(0=最快)；SCB为SPI_1_SCBCLK的分频值(1~65535)，
+ * SPI_1使用外部时钟时不可调。
+ * @return Set: 0=成功, -1=该后端不支持或参数越界
+ */
+int32_t AD5940_SPISetClockDiv(uint32_t div);
+uint32_t AD5940_SPIGetClockDiv(void);
+
+/**
+ * @brief 链路完整性测试：读ADIID/CHIPID，并对CALDATLOCK做写入-回读
+ * @param repeat: 重复次数
+ * @return 0=全部正确, -1=有错误
+ *
+ * 会改写CALDATLOCK（结束时写回锁定值），须在AD5940_Initialize()之前调用。
+ */
+int32_t AD5940_SPILinkTest(uint32_t repeat);
+
+/**
+ * @brief 对每个已编译的SPI后端校准时钟
+ * @param Flags: AD5940_SPI_CAL_FORCE / AD5940_SPI_CAL_NOSAVE
+ * @return AD5940_SPI_CAL_STORED / AD5940_SPI_CAL_DONE / AD5940_SPI_CAL_FAIL
+ *
+ * 先使用Em_EEPROM中的结果并做链路测试，未保存或测试失败时，
+ * 从最慢分频开始逐档加快并测试，取最后通过的一档再放慢AD5940_SPI_CAL_MARGIN档。
+ * 需在芯片已唤醒、AD5940_Initialize()之前调用；结束后恢复原后端。
+ */
+int32_t AD5940_SPICalibrate(uint8_t Flags);
+
 /*******************************************************************************
 * 核心SPI通信函数
 *******************************************************************************/
@@ -39,6 +138,273 @@ int32_t AD5940_ReadWriteNBytes(uint8_t *pSendBuffer,
                                 uint8_t *pRecvBuff, 
                                 uint32_t length);
 
+/*******************************************************************************
+* SPI异步传输引擎
+*******************************************************************************/
+
+/* 置0可关闭DMA，所有传输在提交时同步执行 */
+#ifndef AD5940_SPI_DMA_ENABLE
+#define AD5940_SPI_DMA_ENABLE       (1u)
+#endif
+
+/* 帧的CS控制 */
+#define AD5940_FRAME_CS_ASSERT      (0x01u)     /* 帧开始前拉低CS */
+#define AD5940_FRAME_CS_RELEASE     (0x02u)     /* 帧结束后拉高CS */
+#define AD5940_FRAME_CS_FULL        (AD5940_FRAME_CS_ASSERT | AD5940_FRAME_CS_RELEASE)
+
+/* 传输状态 */
+#define AD5940_XFER_IDLE            (0u)        /* 未提交过 */
+#define AD5940_XFER_QUEUED          (1u)        /* 排队中 */
+#define AD5940_XFER_ACTIVE          (2u)        /* 执行中 */
+#define AD5940_XFER_DONE            (3u)        /* 已完成 */
+
+/* 一帧：一段连续的SPI字节 */
+typedef struct
+{
+    const uint8_t *pTx;         /* 发送数据，NULL表示每字节发送TxFill */
+    uint8_t *pRx;               /* 接收数据，NULL表示丢弃 */
+    uint16_t Length;            /* 字节数，不能为0 */
+    uint8_t TxFill;             /* pTx为NULL时发送的字节 */
+    uint8_t CsCtrl;             /* AD5940_FRAME_CS_xxx组合，0表示不动CS */
+} AD5940_SPIFrame_Type;
+
+/* 一次传输：帧列表+完成回调。提交后到完成前结构体和帧、缓冲区都必须保持有效 */
+typedef struct AD5940_SPIXfer
+{
+    const AD5940_SPIFrame_Type *pFrames;
+    uint32_t FrameCount;
+    void (*pfnDone)(struct AD5940_SPIXfer *pXfer);  /* 完成回调，可为NULL；DMA路径下在中断中调用 */
+    void *pUser;                /* 用户数据 */
+    volatile uint8_t State;     /* AD5940_XFER_xxx，首次使用前置为AD5940_XFER_IDLE */
+    struct AD5940_SPIXfer *pNext;   /* 队列链接，内部使用 */
+} AD5940_SPIXfer_Type;
+
+/**
+ * @brief 提交一次传输到队列，立即返回
+ * @return 0=成功, -1=参数错误或该传输尚未完成
+ *
+ * DMA不可用时在返回前同步执行完毕并调用回调。
+ */
+int32_t AD5940_SPISubmit(AD5940_SPIXfer_Type *pXfer);
+
+/**
+ * @brief 等待传输完成，期间调用空闲钩子。不能在传输回调中调用
+ */
+void AD5940_SPIWait(AD5940_SPIXfer_Type *pXfer);
+
+/**
+ * @brief 队列是否为空
+ * @return 1=空闲, 0=有传输在排队或执行
+ */
+uint8_t AD5940_SPIIsIdle(void);
+
+/**
+ * @brief 阻塞执行一组帧
+ * @return 0=成功, -1=参数错误
+ */
+int32_t AD5940_SPITransfer(const AD5940_SPIFrame_Type *pFrames, uint32_t FrameCount);
+
+/*******************************************************************************
+* SPI突发读
+*******************************************************************************/
+
+/* 突发读完成回调，DMA路径下在DMA中断上下文中调用 */
+typedef void (*AD5940_SPIBurstDoneFunc)(void);
+
+/**
+ * @brief 启动一次突发读：连续发送(Len0+Len1)个TxFill字节，接收数据依次存入
+ *        pSeg0[0..Len0-1]和pSeg1[0..Len1-1]（两段用于环形缓冲区回绕）
+ * @param pSeg0/Len0: 第一段接收缓冲区及长度（字节）
+ * @param pSeg1/Len1: 第二段接收缓冲区及长度，不需要时传NULL/0
+ * @param TxFill: 每个字节发送的固定值
+ * @param pfnDone: 完成回调；NULL表示阻塞到传输完成再返回
+ * @return 0=成功启动, -1=参数错误或上一次突发读未完成
+ *
+ * 不控制CS。通过传输引擎排队执行，每段不超过65535字节；
+ * DMA不可用时同步完成并在返回前调用pfnDone。
+ */
+int32_t AD5940_SPIBurstRead(uint8_t *pSeg0, uint32_t Len0,
+                            uint8_t *pSeg1, uint32_t Len1,
+                            uint8_t TxFill, AD5940_SPIBurstDoneFunc pfnDone);
+
+/**
+ * @brief 查询突发读是否仍在进行
+ * @return 1=进行中, 0=空闲
+ */
+uint8_t AD5940_SPIBurstBusy(void);
+
+/**
+ * @brief 等待突发读完成
+ */
+void AD5940_SPIBurstWait(void);
+
+/**
+ * @brief 设置等待传输时的空闲钩子，NULL表示忙等
+ *
+ * 钩子在关中断状态下调用，适合执行CySysPmSleep()，DMA完成中断会唤醒CPU。
+ */
+void AD5940_SPISetIdleHook(void (*pfnIdle)(void));
+
+/*******************************************************************************
+* 周期计数和总线统计
+*******************************************************************************/
+
+/**
+ * @brief 启动/停止周期计数器（引用计数，最后一次Stop时释放SysTick）
+ *
+ * 计数器由SysTick 1ms中断和当前计数值组成，用于计时SPI操作。
+ */
+void AD5940_CycleCounterStart(void);
+void AD5940_CycleCounterStop(void);
+
+/**
+ * @brief 读取周期计数（32位回绕，按无符号差计算时间间隔）
+ */
+uint32_t AD5940_CycleCount(void);
+
+/**
+ * @brief 周期计数器频率(Hz)
+ */
+uint32_t AD5940_CycleHz(void);
+
+/**
+ * @brief 读取SPI累计传输字节数（含CS为高时的字节，32位回绕）
+ */
+uint32_t AD5940_SPIGetByteCount(void);
+
+/*******************************************************************************
+* SPI跟踪记录
+*******************************************************************************/
+
+/* 置1编译跟踪记录(ad5941_spitrace.c)，每帧SPI传输记录到环形缓冲区 */
+#ifndef AD5940_SPI_TRACE_ENABLE
+#define AD5940_SPI_TRACE_ENABLE     (0u)
+#endif
+
+/* 缓冲区记录数，写满后覆盖最旧的记录 */
+#ifndef AD5940_SPI_TRACE_DEPTH
+#define AD5940_SPI_TRACE_DEPTH      (128u)
+#endif
+
+/* 每条记录保存的收发字节数(1~32)，更长的帧只保存前面部分 */
+#ifndef AD5940_SPI_TRACE_BYTES
+#define AD5940_SPI_TRACE_BYTES      (8u)
+#endif
+
+/* 记录标志 */
+#define AD5940_TRACE_CS_ASSERT      (0x01u)     /* 帧开始前拉低CS，与AD5940_FRAME_CS_ASSERT相同 */
+#define AD5940_TRACE_CS_RELEASE     (0x02u)     /* 帧结束后拉高CS，与AD5940_FRAME_CS_RELEASE相同 */
+#define AD5940_TRACE_TRUNC          (0x04u)     /* 帧长度超过AD5940_SPI_TRACE_BYTES */
+#define AD5940_TRACE_DMA            (0x08u)     /* 由DMA搬运 */
+#define AD5940_TRACE_CSONLY         (0x10u)     /* 只有CS动作(AD5940_CsClr/CsSet)，没有数据 */
+#define AD5940_TRACE_NORX           (0x20u)     /* 接收数据被丢弃，Rx无效 */
+
+#define AD5940_TRACE_ADDR_NONE      (0xFFFFu)   /* 帧不属于寄存器访问 */
+
+/* 一条记录：一帧SPI传输或一次CS动作 */
+typedef struct
+{
+    uint32_t Timestamp;         /* 帧结束时刻，单位见AD5940_SPITraceSetClock() */
+    uint16_t RegAddr;           /* 由SETADDR/READFIFO解码出的寄存器地址 */
+    uint16_t Length;            /* 帧字节数 */
+    uint8_t Flags;              /* AD5940_TRACE_xxx组合 */
+    uint8_t Tag;                /* 记录时的标签，见AD5940_SPITraceSetTag() */
+    uint8_t Tx[AD5940_SPI_TRACE_BYTES];
+    uint8_t Rx[AD5940_SPI_TRACE_BYTES];
+} AD5940_SPITrace_Type;
+
+/* 导出输出函数：UART可直接写出，BLE按MaxChunk分包通知 */
+typedef void (*AD5940_SPITraceOutFunc)(const char *pData, uint32_t len);
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+
+/**
+ * @brief 开始/停止记录。开始时不清除已有记录
+ */
+void AD5940_SPITraceStart(void);
+void AD5940_SPITraceStop(void);
+
+/**
+ * @brief 清除所有记录和丢失计数
+ */
+void AD5940_SPITraceClear(void);
+
+/**
+ * @brief 设置时间戳来源
+ * @param pfnNow: 返回32位递增计数的函数，NULL表示时间戳为0
+ * @param Hz: 计数频率，导出时写入文件头供回放换算
+ *
+ * AD5940_MCUResourceInit()安装平台默认时钟，目标板为SysTick(SYSCLK)。
+ */
+void AD5940_SPITraceSetClock(uint32_t (*pfnNow)(void), uint32_t Hz);
+
+/**
+ * @brief 设置之后记录的标签，用于按调用者统计总线占用
+ * @return 原来的标签，便于嵌套调用时恢复
+ */
+uint8_t AD5940_SPITraceSetTag(uint8_t Tag);
+
+/**
+ * @brief 缓冲区中的记录数/被覆盖的记录数/读取一条记录
+ * @param index: 0为最旧的记录
+ * @return AD5940_SPITraceGet(): 0=成功, -1=没有该记录
+ */
+uint32_t AD5940_SPITraceCount(void);
+uint32_t AD5940_SPITraceLost(void);
+int32_t AD5940_SPITraceGet(uint32_t index, AD5940_SPITrace_Type *pRec);
+
+/**
+ * @brief 以文本格式导出所有记录，导出期间暂停记录
+ * @param pfnOut: 输出函数
+ * @param MaxChunk: 每次调用pfnOut的最大字节数，0表示整行输出
+ * @return 导出的记录数
+ *
+ * 第一行为"# AD5940 SPI trace v1 hz=<Hz> n=<记录数> lost=<丢失数>"，
+ * 之后每行一条记录(十六进制)：时间戳 标签 标志 地址 长度 TX RX，
+ * 没有数据的字段为"-"。
+ */
+uint32_t AD5940_SPITraceDump(AD5940_SPITraceOutFunc pfnOut, uint32_t MaxChunk);
+
+/**
+ * @brief 记录一帧/一次CS动作，由平台层的传输引擎和CS函数调用
+ * @param Flags: 附加标志(如AD5940_TRACE_DMA)，CS标志取自pFrame->CsCtrl
+ */
+void AD5940_SPITraceFrame(const AD5940_SPIFrame_Type *pFrame, uint8_t Flags);
+void AD5940_SPITraceCs(uint8_t Flags);
+
+#endif /* AD5940_SPI_TRACE_ENABLE */
+
+/*******************************************************************************
+* 非易失存储
+*******************************************************************************/
+
+/* MCU Flash中保留给AD5940驱动的存储区大小（字节），须为Flash行大小的整数倍，
+ * 0表示不保留。目前由序列缓存(ad5941_seqcache.c)使用 */
+#ifndef AD5940_NVM_SIZE
+#define AD5940_NVM_SIZE             (2048u)
+#endif
+
+#if (AD5940_NVM_SIZE != 0u)
+
+/**
+ * @brief 存储区起始地址，可直接读取（常量Flash，未写过时全0）
+ */
+const uint8_t *AD5940_NvmBase(void);
+
+/**
+ * @brief 写存储区，按Flash行读-改-写，只擦写涉及的行
+ * @param Offset: 存储区内偏移
+ * @param pData: 数据
+ * @param Len: 字节数
+ * @return 0=成功, -1=越界或Flash写失败
+ *
+ * 每行写入约20ms且期间CPU停顿，BLE连接中调用可能导致连接事件丢失，
+ * 应在初始化阶段调用。
+ */
+int32_t AD5940_NvmWrite(uint32_t Offset, const void *pData, uint32_t Len);
+
+#endif /* AD5940_NVM_SIZE */
+
 /*******************************************************************************
 * GPIO控制函数
 *******************************************************************************/
@@ -69,6 +435,7 @@ void AD5940_Delay10us(uint32_t time);
  */
 uint32_t AD5940_GetMCUIntFlag(void);
 uint32_t AD5940_ClrMCUIntFlag(void);
+void AD5940_MCUIntStart(void);
 
 /*******************************************************************************
 * 初始化函数
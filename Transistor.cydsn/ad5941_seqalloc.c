@@ -0,0 +1,160 @@
+/*******************************************************************************
+* File Name: ad5941_seqalloc.c
+*
+* Description:
+*   AD5940序列器SRAM分配
+*   每个使用者一个区域，首次适配：从地址0开始，跳过与其他使用者重叠的
+*   区域。使用者很少（AMP、IMP），不做碎片整理。
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*
+********************************************************************************/
+
+#include "ad5940.h"
+#include "ad5941_seqalloc.h"
+
+#define SEQALLOC_2KB_WORDS      (512u)
+#define SEQALLOC_4KB_WORDS      (1024u)
+#define SEQALLOC_ID_NUM         (4u)        /* SEQID_0~SEQID_3 */
+
+#if (AD5940_SEQALLOC_MAX_WORDS > 1536u)
+    #error "AD5940_SEQALLOC_MAX_WORDS exceeds 6kB SRAM"
+#endif
+
+typedef struct
+{
+    uint32_t Addr;
+    uint32_t Len;               /* 0表示未分配 */
+    uint32_t IdMask;            /* bit n: SEQID_n */
+} SeqAlloc_Type;
+
+static SeqAlloc_Type s_SeqAlloc[AD5940_SEQALLOC_OWNERS];
+
+/*******************************************************************************
+* 接口函数
+*******************************************************************************/
+
+int32_t AD5940_SEQAllocRegion(uint32_t Owner, uint32_t Words, uint32_t *pStartAddr)
+{
+    SeqAlloc_Type *p;
+    uint32_t addr = 0;
+    uint32_t moved;
+    uint32_t i;
+
+    if ((Owner >= AD5940_SEQALLOC_OWNERS) || (Words == 0u) || (Words > AD5940_SEQALLOC_MAX_WORDS))
+        return -1;
+    p = &s_SeqAlloc[Owner];
+    if (p->Len >= Words)
+    {
+        p->Len = Words;         /* 原地缩小，SRAM中的序列不动 */
+        *pStartAddr = p->Addr;
+        return 0;
+    }
+
+    p->Len = 0;
+    do
+    {
+        moved = 0;
+        for (i = 0; i < AD5940_SEQALLOC_OWNERS; i++)
+        {
+            if ((s_SeqAlloc[i].Len != 0u) && (addr < s_SeqAlloc[i].Addr + s_SeqAlloc[i].Len) &&
+                (s_SeqAlloc[i].Addr < addr + Words))
+            {
+                addr = s_SeqAlloc[i].Addr + s_SeqAlloc[i].Len;
+                moved = 1;
+            }
+        }
+    } while ((moved != 0u) && (addr + Words <= AD5940_SEQALLOC_MAX_WORDS));
+    if (addr + Words > AD5940_SEQALLOC_MAX_WORDS)
+        return -1;
+
+    p->Addr = addr;
+    p->Len = Words;
+    *pStartAddr = addr;
+    return 0;
+}
+
+int32_t AD5940_SEQAllocId(uint32_t Owner, uint32_t Num, uint32_t *pSeqId)
+{
+    uint32_t used = 0;
+    uint32_t mask = 0;
+    uint32_t n = 0;
+    uint32_t i;
+
+    if ((Owner >= AD5940_SEQALLOC_OWNERS) || (Num == 0u) || (Num > SEQALLOC_ID_NUM))
+        return -1;
+    for (i = 0; i < SEQALLOC_ID_NUM; i++)
+    {
+        if ((s_SeqAlloc[Owner].IdMask & (1u << i)) != 0u)
+            n++;
+    }
+    if (n == Num)
+        mask = s_SeqAlloc[Owner].IdMask;
+    else
+    {
+        for (i = 0; i < AD5940_SEQALLOC_OWNERS; i++)
+        {
+            if (i != Owner)
+                used |= s_SeqAlloc[i].IdMask;
+        }
+        for (i = 0, n = 0; (i < SEQALLOC_ID_NUM) && (n < Num); i++)
+        {
+            if ((used & (1u << i)) == 0u)
+            {
+                mask |= 1u << i;
+                n++;
+            }
+        }
+        if (n < Num)
+            return -1;
+        s_SeqAlloc[Owner].IdMask = mask;
+    }
+
+    for (i = 0; i < SEQALLOC_ID_NUM; i++)
+    {
+        if ((mask & (1u << i)) != 0u)
+            *pSeqId++ = SEQID_0 + i;
+    }
+    return 0;
+}
+
+void AD5940_SEQAllocFree(uint32_t Owner)
+{
+    if (Owner < AD5940_SEQALLOC_OWNERS)
+    {
+        s_SeqAlloc[Owner].Len = 0;
+        s_SeqAlloc[Owner].IdMask = 0;
+    }
+}
+
+uint32_t AD5940_SEQAllocMemSize(void)
+{
+    uint32_t end = 0;
+    uint32_t i;
+
+    for (i = 0; i < AD5940_SEQALLOC_OWNERS; i++)
+    {
+        if ((s_SeqAlloc[i].Len != 0u) && (s_SeqAlloc[i].Addr + s_SeqAlloc[i].Len > end))
+            end = s_SeqAlloc[i].Addr + s_SeqAlloc[i].Len;
+    }
+    if (end <= SEQALLOC_2KB_WORDS)
+        return SEQMEMSIZE_2KB;
+    if (end <= SEQALLOC_4KB_WORDS)
+        return SEQMEMSIZE_4KB;
+    return SEQMEMSIZE_6KB;
+}
+
+uint32_t AD5940_SEQAllocFifoSize(void)
+{
+    switch (AD5940_SEQAllocMemSize())
+    {
+        case SEQMEMSIZE_2KB:
+            return FIFOSIZE_4KB;
+        case SEQMEMSIZE_4KB:
+            return FIFOSIZE_2KB;
+        default:
+            return FIFOSIZE_32B;
+    }
+}
+
+/* [] END OF FILE */
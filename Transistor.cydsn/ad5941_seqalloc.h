@@ -0,0 +1,78 @@
+/*******************************************************************************
+* File Name: ad5941_seqalloc.h
+*
+* Description:
+*   AD5940序列器SRAM分配
+*   为每个应用(AMP、IMP)分配互不重叠的序列器SRAM区域和SEQID，
+*   各应用的序列同时驻留在SRAM中，切换应用时只需运行初始化序列，
+*   不再重新生成和上传。序列器分区(2/4kB)按已分配区域的最高地址确定，
+*   其余SRAM用作数据FIFO。
+*
+*   区域大小取应用配置的MaxSeqLen（字）。应用的区域或SEQID改变时，
+*   应用按参数改变处理，重新加载序列。
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*
+********************************************************************************/
+
+#ifndef AD5941_SEQALLOC_H
+#define AD5941_SEQALLOC_H
+
+#include <stdint.h>
+
+/*******************************************************************************
+* 配置
+*******************************************************************************/
+
+/* 序列器可用的最大字数：默认4kB，至少留2kB给数据FIFO */
+#ifndef AD5940_SEQALLOC_MAX_WORDS
+#define AD5940_SEQALLOC_MAX_WORDS   (1024u)
+#endif
+
+/* 使用者 */
+#define AD5940_SEQALLOC_AMP         (0u)
+#define AD5940_SEQALLOC_IMP         (1u)
+#define AD5940_SEQALLOC_OWNERS      (2u)
+
+/*******************************************************************************
+* 函数
+*******************************************************************************/
+
+/**
+ * @brief 分配序列器SRAM区域
+ * @param Owner: 使用者
+ * @param Words: 字数，不大于已有区域时保留原地址
+ * @param pStartAddr: 返回区域起始地址（字）
+ * @return 0=成功, -1=参数错误或空间不足
+ */
+int32_t AD5940_SEQAllocRegion(uint32_t Owner, uint32_t Words, uint32_t *pStartAddr);
+
+/**
+ * @brief 分配SEQID
+ * @param Owner: 使用者
+ * @param Num: 数量，与已分配数量相同时返回原SEQID
+ * @param pSeqId: 返回Num个SEQID，从小到大
+ * @return 0=成功, -1=参数错误或SEQID不足
+ */
+int32_t AD5940_SEQAllocId(uint32_t Owner, uint32_t Num, uint32_t *pSeqId);
+
+/**
+ * @brief 释放使用者的区域和SEQID
+ */
+void AD5940_SEQAllocFree(uint32_t Owner);
+
+/**
+ * @brief 容纳全部已分配区域的序列器分区，用于SEQCfg_Type.SeqMemSize
+ * @return SEQMEMSIZE_2KB/SEQMEMSIZE_4KB/SEQMEMSIZE_6KB
+ */
+uint32_t AD5940_SEQAllocMemSize(void);
+
+/**
+ * @brief 与AD5940_SEQAllocMemSize()对应的数据FIFO大小，用于FIFOCfg_Type.FIFOSize
+ * @return FIFOSIZE_4KB/FIFOSIZE_2KB/FIFOSIZE_32B
+ */
+uint32_t AD5940_SEQAllocFifoSize(void);
+
+#endif /* AD5941_SEQALLOC_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,238 @@
+/*******************************************************************************
+* File Name: ad5941_seqcache.c
+*
+* Description:
+*   AD5940序列缓存
+*   槽位布局（AD5940_SEQ_CACHE_SLOT_SIZE字节）：
+*     SeqCache_Hdr_Type 64字节，之后依次存放各序列的命令字。
+*   保存时每生成一个序列写入其命令(AD5940_SEQCacheAdd)，最后写头，
+*   Check覆盖头和全部命令，写入中途掉电或内容被改动时校验失败，按未命中处理。
+*
+*   AD5940_SEQ_ROM_ENABLE为1时还包含离线序列表(ad5941_seqrom.h)。
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*   AD5940_SEQ_CACHE_ENABLE和AD5940_SEQ_ROM_ENABLE都为0时本文件不产生代码。
+*
+********************************************************************************/
+
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5941_seqcache.h"
+
+#define SEQCACHE_FNV_PRIME      (0x01000193u)
+
+/*******************************************************************************
+* 缓存键
+*******************************************************************************/
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+
+uint32_t AD5940_SEQCacheHash(uint32_t Hash, const void *pData, uint32_t Len)
+{
+    const uint8_t *p = (const uint8_t *)pData;
+
+    while (Len != 0u)
+    {
+        Hash = (Hash ^ *p++) * SEQCACHE_FNV_PRIME;
+        Len--;
+    }
+    return Hash;
+}
+
+#endif
+
+/*******************************************************************************
+* 离线序列
+*******************************************************************************/
+
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+
+#include "ad5941_seqrom.h"
+
+int32_t AD5940_SEQRomLoad(uint32_t Slot, uint32_t Key, SEQInfo_Type * const pSeqInfo[], uint32_t SeqNum)
+{
+    const AD5940_SEQRom_Type *pRom;
+    const uint32_t *pCmd;
+    uint32_t i;
+
+    for (pRom = &AD5940_SeqRom[0]; pRom < &AD5940_SeqRom[AD5940_SEQROM_NUM]; pRom++)
+    {
+        if ((pRom->Slot == Slot) && (pRom->Key == Key) && (pRom->SeqNum == SeqNum))
+            break;
+    }
+    if (pRom == &AD5940_SeqRom[AD5940_SEQROM_NUM])
+        return -1;
+
+    pCmd = pRom->pCmd;
+    for (i = 0; i < SeqNum; i++)
+    {
+        pSeqInfo[i]->SeqId = pRom->Seq[i].SeqId;
+        pSeqInfo[i]->SeqRamAddr = pRom->Seq[i].SeqRamAddr;
+        pSeqInfo[i]->SeqLen = pRom->Seq[i].SeqLen;
+        pSeqInfo[i]->pSeqCmd = pCmd;
+        AD5940_SEQCmdWrite(pSeqInfo[i]->SeqRamAddr, pCmd, pSeqInfo[i]->SeqLen);
+        pCmd += pSeqInfo[i]->SeqLen;
+    }
+    return 0;
+}
+
+#endif /* AD5940_SEQ_ROM_ENABLE */
+
+/*******************************************************************************
+* Flash缓存
+*******************************************************************************/
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+
+#if (AD5940_SEQ_CACHE_SLOTS < 2u)
+    #error "AD5940_NVM_SIZE too small for AD5940 sequence cache"
+#endif
+
+#define SEQCACHE_MAGIC          (0x48435153u)   /* "SQCH" */
+#define SEQCACHE_FNV_BASIS      (0x811C9DC5u)
+
+/* 槽位头 */
+typedef struct
+{
+    uint32_t Magic;
+    uint32_t Key;
+    uint32_t Check;             /* Key之后的头字段和全部命令的FNV-1a */
+    uint32_t SeqNum;
+    struct
+    {
+        uint32_t SeqId;
+        uint32_t SeqRamAddr;
+        uint32_t SeqLen;
+    } Seq[AD5940_SEQ_CACHE_SEQ_MAX];
+} SeqCache_Hdr_Type;
+
+/* 槽位中可保存的命令字数 */
+#define SEQCACHE_CMD_MAX        ((AD5940_SEQ_CACHE_SLOT_SIZE - sizeof(SeqCache_Hdr_Type)) / 4u)
+
+/* 正在保存的槽位头，Slot为AD5940_SEQ_CACHE_SLOTS表示出错 */
+static SeqCache_Hdr_Type s_SaveHdr;
+static uint32_t s_SaveSlot = AD5940_SEQ_CACHE_SLOTS;
+static uint32_t s_SaveWords = 0;
+
+/*******************************************************************************
+* 内部函数
+*******************************************************************************/
+
+static const SeqCache_Hdr_Type *SeqCache_Hdr(uint32_t Slot)
+{
+    return (const SeqCache_Hdr_Type *)(AD5940_NvmBase() + Slot * AD5940_SEQ_CACHE_SLOT_SIZE);
+}
+
+static const uint32_t *SeqCache_Cmd(uint32_t Slot)
+{
+    return (const uint32_t *)(AD5940_NvmBase() + Slot * AD5940_SEQ_CACHE_SLOT_SIZE + sizeof(SeqCache_Hdr_Type));
+}
+
+/**
+ * @brief 计算头(Key之后的字段)和槽位中命令的校验值
+ */
+static uint32_t SeqCache_Check(const SeqCache_Hdr_Type *pHdr, const uint32_t *pCmd)
+{
+    uint32_t hash;
+    uint32_t words = 0;
+    uint32_t i;
+
+    hash = AD5940_SEQCacheHash(SEQCACHE_FNV_BASIS, &pHdr->Key, sizeof(pHdr->Key));
+    hash = AD5940_SEQCacheHash(hash, &pHdr->SeqNum, sizeof(pHdr->SeqNum) + sizeof(pHdr->Seq));
+    for (i = 0; i < pHdr->SeqNum; i++)
+        words += pHdr->Seq[i].SeqLen;
+    return AD5940_SEQCacheHash(hash, pCmd, words * 4u);
+}
+
+/*******************************************************************************
+* 接口函数
+*******************************************************************************/
+
+uint32_t AD5940_SEQCacheKeyInit(void)
+{
+    static const char build[] = __DATE__ " " __TIME__;
+
+    return AD5940_SEQCacheHash(SEQCACHE_FNV_BASIS, build, sizeof(build) - 1u);
+}
+
+int32_t AD5940_SEQCacheLoad(uint32_t Slot, uint32_t Key, SEQInfo_Type * const pSeqInfo[], uint32_t SeqNum)
+{
+    const SeqCache_Hdr_Type *pHdr;
+    const uint32_t *pCmd;
+    uint32_t words = 0;
+    uint32_t i;
+
+    if ((Slot >= AD5940_SEQ_CACHE_SLOTS) || (SeqNum == 0u) || (SeqNum > AD5940_SEQ_CACHE_SEQ_MAX))
+        return -1;
+    pHdr = SeqCache_Hdr(Slot);
+    pCmd = SeqCache_Cmd(Slot);
+    if ((pHdr->Magic != SEQCACHE_MAGIC) || (pHdr->Key != Key) || (pHdr->SeqNum != SeqNum))
+        return -1;
+    for (i = 0; i < SeqNum; i++)
+        words += pHdr->Seq[i].SeqLen;
+    if ((words > SEQCACHE_CMD_MAX) || (SeqCache_Check(pHdr, pCmd) != pHdr->Check))
+        return -1;
+
+    for (i = 0; i < SeqNum; i++)
+    {
+        pSeqInfo[i]->SeqId = pHdr->Seq[i].SeqId;
+        pSeqInfo[i]->SeqRamAddr = pHdr->Seq[i].SeqRamAddr;
+        pSeqInfo[i]->SeqLen = pHdr->Seq[i].SeqLen;
+        pSeqInfo[i]->pSeqCmd = pCmd;
+        AD5940_SEQCmdWrite(pSeqInfo[i]->SeqRamAddr, pCmd, pSeqInfo[i]->SeqLen);
+        pCmd += pSeqInfo[i]->SeqLen;
+    }
+    return 0;
+}
+
+void AD5940_SEQCacheBegin(uint32_t Slot)
+{
+    memset(&s_SaveHdr, 0, sizeof(s_SaveHdr));
+    s_SaveSlot = Slot;
+    s_SaveWords = 0;
+}
+
+int32_t AD5940_SEQCacheAdd(uint32_t Slot, const SEQInfo_Type *pSeqInfo)
+{
+    uint32_t n = s_SaveHdr.SeqNum;
+
+    if ((Slot != s_SaveSlot) || (Slot >= AD5940_SEQ_CACHE_SLOTS) || (n >= AD5940_SEQ_CACHE_SEQ_MAX) ||
+        (pSeqInfo->pSeqCmd == NULL) || (pSeqInfo->SeqLen > SEQCACHE_CMD_MAX - s_SaveWords) ||
+        (AD5940_NvmWrite(Slot * AD5940_SEQ_CACHE_SLOT_SIZE + sizeof(SeqCache_Hdr_Type) + s_SaveWords * 4u,
+                         pSeqInfo->pSeqCmd, pSeqInfo->SeqLen * 4u) != 0))
+    {
+        s_SaveSlot = AD5940_SEQ_CACHE_SLOTS;
+        return -1;
+    }
+    s_SaveHdr.Seq[n].SeqId = pSeqInfo->SeqId;
+    s_SaveHdr.Seq[n].SeqRamAddr = pSeqInfo->SeqRamAddr;
+    s_SaveHdr.Seq[n].SeqLen = pSeqInfo->SeqLen;
+    s_SaveHdr.SeqNum = n + 1u;
+    s_SaveWords += pSeqInfo->SeqLen;
+    return 0;
+}
+
+int32_t AD5940_SEQCacheCommit(uint32_t Slot, uint32_t Key)
+{
+    if ((Slot != s_SaveSlot) || (Slot >= AD5940_SEQ_CACHE_SLOTS) || (s_SaveHdr.SeqNum == 0u))
+        return -1;
+    s_SaveSlot = AD5940_SEQ_CACHE_SLOTS;
+
+    /* 校验值按Flash中的命令计算，写入有误时下次加载不会命中 */
+    s_SaveHdr.Magic = SEQCACHE_MAGIC;
+    s_SaveHdr.Key = Key;
+    s_SaveHdr.Check = SeqCache_Check(&s_SaveHdr, SeqCache_Cmd(Slot));
+    return AD5940_NvmWrite(Slot * AD5940_SEQ_CACHE_SLOT_SIZE, &s_SaveHdr, sizeof(s_SaveHdr));
+}
+
+void AD5940_SEQCacheInvalidate(uint32_t Slot)
+{
+    uint32_t magic = 0;
+
+    if ((Slot < AD5940_SEQ_CACHE_SLOTS) && (SeqCache_Hdr(Slot)->Magic != 0u))
+        (void)AD5940_NvmWrite(Slot * AD5940_SEQ_CACHE_SLOT_SIZE, &magic, sizeof(magic));
+}
+
+#endif /* AD5940_SEQ_CACHE_ENABLE */
+
+/* [] END OF FILE */
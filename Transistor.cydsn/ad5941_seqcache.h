@@ -0,0 +1,168 @@
+/*******************************************************************************
+* File Name: ad5941_seqcache.h
+*
+* Description:
+*   AD5940序列缓存
+*   把应用生成的序列命令和SEQInfo_Type保存到MCU Flash(AD5940_NvmWrite)，
+*   以应用配置中影响序列生成的字段的哈希为键。上电或bParaChanged后键不变时
+*   直接从Flash写入AD5940 SRAM，不再运行序列生成器，也不需要生成缓冲区。
+*
+*   离线序列(AD5940_SEQ_ROM_ENABLE)：标准配置的序列由host/seqrom_gen.c在主机
+*   仿真上生成，写入ad5941_seqrom.h随固件编译。配置的键与生成时相同则直接
+*   使用，先于Flash缓存查找；生产固件可不带序列生成缓冲区。
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*   AD5940_SEQ_CACHE_ENABLE为0时本文件不产生代码。
+*
+********************************************************************************/
+
+#ifndef AD5941_SEQCACHE_H
+#define AD5941_SEQCACHE_H
+
+#include <stdint.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+
+/*******************************************************************************
+* 配置
+*******************************************************************************/
+
+/* 编译序列缓存，需要AD5940_NVM_SIZE不为0 */
+#ifndef AD5940_SEQ_CACHE_ENABLE
+#define AD5940_SEQ_CACHE_ENABLE     (1u)
+#endif
+
+/* 每个槽位占用的存储区字节数，含64字节头 */
+#ifndef AD5940_SEQ_CACHE_SLOT_SIZE
+#define AD5940_SEQ_CACHE_SLOT_SIZE  (1024u)
+#endif
+
+/* 使用离线生成的序列(ad5941_seqrom.h)，默认关闭 */
+#ifndef AD5940_SEQ_ROM_ENABLE
+#define AD5940_SEQ_ROM_ENABLE       (0u)
+#endif
+
+/* 离线序列的键初值：不含编译时间，主机工具和固件的计算结果相同 */
+#define AD5940_SEQ_ROM_KEY_BASIS    (0x811C9DC5u)
+
+/* 每个槽位最多保存的序列数 */
+#define AD5940_SEQ_CACHE_SEQ_MAX    (4u)
+
+/* 槽位分配 */
+#define AD5940_SEQCACHE_SLOT_AMP    (0u)
+#define AD5940_SEQCACHE_SLOT_IMP    (1u)
+
+/*******************************************************************************
+* 类型定义
+*******************************************************************************/
+
+/* 离线序列表项，由host/seqrom_gen.c生成 */
+typedef struct
+{
+    uint32_t Slot;              /* 与缓存槽位编号相同 */
+    uint32_t Key;               /* 以AD5940_SEQ_ROM_KEY_BASIS为初值的缓存键 */
+    uint32_t SeqNum;
+    struct
+    {
+        uint32_t SeqId;
+        uint32_t SeqRamAddr;
+        uint32_t SeqLen;
+    } Seq[AD5940_SEQ_CACHE_SEQ_MAX];
+    const uint32_t *pCmd;       /* 各序列的命令依次存放 */
+} AD5940_SEQRom_Type;
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u) || (AD5940_SEQ_ROM_ENABLE != 0u)
+
+/*******************************************************************************
+* 函数
+*******************************************************************************/
+
+/**
+ * @brief 计算缓存键(FNV-1a)，可连续调用累加多个字段
+ * @param Hash: 上一次的结果，第一次调用传AD5940_SEQCacheKeyInit()
+ * @param pData: 数据
+ * @param Len: 字节数
+ */
+uint32_t AD5940_SEQCacheHash(uint32_t Hash, const void *pData, uint32_t Len);
+
+#endif
+
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+
+/**
+ * @brief 查找离线序列，命中时把序列写入AD5940 SRAM并填写pSeqInfo
+ * @param Slot: 槽位
+ * @param Key: 以AD5940_SEQ_ROM_KEY_BASIS为初值计算的缓存键
+ * @param pSeqInfo: SeqNum个SEQInfo_Type指针，pSeqCmd指向ad5941_seqrom.h中的命令
+ * @param SeqNum: 序列数
+ * @return 0=命中, -1=没有该配置的离线序列
+ *
+ * 修改序列生成函数或其使用的配置后须重新运行host/seqrom_gen.c。
+ */
+int32_t AD5940_SEQRomLoad(uint32_t Slot, uint32_t Key, SEQInfo_Type * const pSeqInfo[], uint32_t SeqNum);
+
+#endif /* AD5940_SEQ_ROM_ENABLE */
+
+#if (AD5940_SEQ_CACHE_ENABLE != 0u)
+
+#if (AD5940_NVM_SIZE == 0u)
+    #error "AD5940_SEQ_CACHE_ENABLE requires AD5940_NVM_SIZE"
+#endif
+
+/* 存储区中的槽位数 */
+#define AD5940_SEQ_CACHE_SLOTS      (AD5940_NVM_SIZE / AD5940_SEQ_CACHE_SLOT_SIZE)
+
+/**
+ * @brief 缓存键初值：包含固件编译时间，固件更新后缓存自动失效
+ */
+uint32_t AD5940_SEQCacheKeyInit(void);
+
+/**
+ * @brief 查找缓存，命中时把序列写入AD5940 SRAM并填写pSeqInfo
+ * @param Slot: 槽位
+ * @param Key: 缓存键
+ * @param pSeqInfo: SeqNum个SEQInfo_Type指针，命中时填写SeqId、SeqRamAddr、
+ *                  SeqLen，pSeqCmd指向Flash中的命令
+ * @param SeqNum: 序列数，须与保存时相同
+ * @return 0=命中, -1=未命中（键不同、未保存或校验失败）
+ */
+int32_t AD5940_SEQCacheLoad(uint32_t Slot, uint32_t Key, SEQInfo_Type * const pSeqInfo[], uint32_t SeqNum);
+
+/**
+ * @brief 开始保存：生成序列前调用，清除之前未提交的内容
+ * @param Slot: 槽位
+ *
+ * 序列生成器的各序列共用同一缓冲区，生成下一个序列后上一个序列的
+ * pSeqCmd不再有效，因此每生成一个序列即调用AD5940_SEQCacheAdd()。
+ */
+void AD5940_SEQCacheBegin(uint32_t Slot);
+
+/**
+ * @brief 保存刚生成的一个序列的命令，Flash中内容相同的行不擦写
+ * @param Slot: 槽位，须与AD5940_SEQCacheBegin()相同
+ * @param pSeqInfo: 序列，pSeqCmd须有效
+ * @return 0=成功, -1=序列数超过AD5940_SEQ_CACHE_SEQ_MAX、槽位空间不足或Flash写失败，
+ *         失败后本次保存的AD5940_SEQCacheCommit()也失败
+ */
+int32_t AD5940_SEQCacheAdd(uint32_t Slot, const SEQInfo_Type *pSeqInfo);
+
+/**
+ * @brief 写入槽位头，完成保存
+ * @param Slot: 槽位
+ * @param Key: 缓存键
+ * @return 0=成功, -1=保存过程中有错误或Flash写失败
+ *
+ * 写Flash期间CPU停顿，只应在初始化阶段调用。
+ */
+int32_t AD5940_SEQCacheCommit(uint32_t Slot, uint32_t Key);
+
+/**
+ * @brief 使槽位失效，下次初始化重新生成序列
+ */
+void AD5940_SEQCacheInvalidate(uint32_t Slot);
+
+#endif /* AD5940_SEQ_CACHE_ENABLE */
+
+#endif /* AD5941_SEQCACHE_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,74 @@
+/*******************************************************************************
+* File Name: ad5941_seqrom.h
+*
+* Description:
+*   离线生成的AD5940序列，由host/seqrom_gen.c生成，请勿手工修改。
+*   只由ad5941_seqcache.c包含(AD5940_SEQ_ROM_ENABLE)。
+*
+********************************************************************************/
+
+#ifndef AD5941_SEQROM_H
+#define AD5941_SEQROM_H
+
+/* AMP: SEQID_1 @0, 23 cmds; SEQID_0 @23, 9 cmds */
+static const uint32_t SeqRom_AMPCmd[] =
+{
+    0xE0000037u, 0x94000000u, 0xCA000001u, 0xC801A680u,
+    0xC900003Eu, 0xBB00F100u, 0xB9003034u, 0xEA011014u,
+    0x9100D301u, 0xAA000000u, 0xAB000000u, 0xAC000000u,
+    0xAD000000u, 0xB4000000u, 0xF1000000u, 0xD4000000u,
+    0xD6000000u, 0xD5000000u, 0xD7000000u, 0x83010000u,
+    0x80080000u, 0x95000000u, 0x81000000u,
+    0x95000004u, 0x80090080u, 0x00000FA0u, 0x80090180u,
+    0x00007062u, 0x80080000u, 0x95000000u, 0xC7000000u,
+    0xC7000001u,
+};
+
+/* AMPMUX: SEQID_1 @0, 23 cmds; SEQID_0 @23, 24 cmds */
+static const uint32_t SeqRom_AMPMUXCmd[] =
+{
+    0xE0000037u, 0x94000000u, 0xCA000001u, 0xC801A680u,
+    0xC900003Eu, 0xBB00F100u, 0xB9003034u, 0xEA011014u,
+    0x9100D301u, 0xAA000000u, 0xAB000000u, 0xAC000000u,
+    0xAD000000u, 0xB4000000u, 0xF1000000u, 0xD4000000u,
+    0xD6000000u, 0xD5000000u, 0xD7000000u, 0x83010000u,
+    0x80080000u, 0x95000000u, 0x81000000u,
+    0x9500000Cu, 0x000C3500u, 0x80090080u, 0x00000FA0u,
+    0x80090180u, 0x00007062u, 0x80080000u, 0x95000014u,
+    0x000C3500u, 0x80090080u, 0x00000FA0u, 0x80090180u,
+    0x00007062u, 0x80080000u, 0x95000024u, 0x000C3500u,
+    0x80090080u, 0x00000FA0u, 0x80090180u, 0x00007062u,
+    0x80080000u, 0x95000000u, 0xC7000000u, 0xC7000001u,
+};
+
+/* IMP: SEQID_1 @0, 26 cmds; SEQID_0 @26, 23 cmds */
+static const uint32_t SeqRom_IMPCmd[] =
+{
+    0xE0000037u, 0x94000003u, 0x8400000Eu, 0xBF000000u,
+    0xBC0003E2u, 0xBE0000FDu, 0xD4000010u, 0xD6000400u,
+    0xD5000002u, 0xD7000102u, 0x83010000u, 0x8C010625u,
+    0x8F0007FFu, 0x8E000000u, 0x8D000000u, 0x85000034u,
+    0xEA000101u, 0x9100E011u, 0xAA000000u, 0xAB000000u,
+    0xAC000000u, 0xAD000000u, 0xB41000C1u, 0xF1000000u,
+    0x80194E40u, 0x81000000u,
+    0x95000004u, 0x00000FA0u, 0xD4000001u, 0xD6000001u,
+    0xD5000200u, 0xD7000900u, 0x83010000u, 0x80194EC0u,
+    0x000000A0u, 0x8019CFC0u, 0x000A007Du, 0xD4000010u,
+    0xD6000400u, 0xD5000002u, 0xD7000102u, 0x80194EC0u,
+    0x000000A0u, 0x8019CFC0u, 0x000A007Du, 0x80080000u,
+    0x95000000u, 0xC7000000u, 0xC7000001u,
+};
+
+#define AD5940_SEQROM_NUM       (3u)
+
+/* {Slot, Key, SeqNum, {{SeqId, SeqRamAddr, SeqLen}, ...}, pCmd} */
+static const AD5940_SEQRom_Type AD5940_SeqRom[AD5940_SEQROM_NUM] =
+{
+    {0u, 0x7CF7E87Bu, 2u, {{1u, 0u, 23u}, {0u, 23u, 9u}}, SeqRom_AMPCmd},
+    {0u, 0x19048DAEu, 2u, {{1u, 0u, 23u}, {0u, 23u, 24u}}, SeqRom_AMPMUXCmd},
+    {1u, 0xDB8BE0DBu, 2u, {{1u, 0u, 26u}, {0u, 26u, 23u}}, SeqRom_IMPCmd},
+};
+
+#endif /* AD5941_SEQROM_H */
+
+/* [] END OF FILE */
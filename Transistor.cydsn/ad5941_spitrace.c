@@ -0,0 +1,280 @@
+/*******************************************************************************
+* File Name: ad5941_spitrace.c
+*
+* Description:
+*   SPI传输跟踪记录
+*   传输引擎每执行完一帧调用AD5940_SPITraceFrame()，记录时间戳、CS动作、
+*   收发字节和由命令字节解码出的寄存器地址。记录以文本格式经UART/BLE导出，
+*   主机端host/spi_replay.c可回放到仿真器并按标签统计总线占用。
+*
+*   不依赖PSoC组件，目标板和主机仿真共用。
+*   AD5940_SPI_TRACE_ENABLE为0时本文件不产生代码。
+*
+********************************************************************************/
+
+#include "ad5940.h"
+#include "ad5941_platform.h"
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+
+#if (AD5940_SPI_TRACE_BYTES == 0u) || (AD5940_SPI_TRACE_BYTES > 32u)
+    #error "AD5940_SPI_TRACE_BYTES must be 1~32"
+#endif
+
+/* 一行导出文本："tttttttt gg ff aaaa llll <TX> <RX>\n"，文件头不超过80字节 */
+#define TRACE_LINE_SIZE         (80u + 4u * AD5940_SPI_TRACE_BYTES)
+
+static AD5940_SPITrace_Type s_TraceBuf[AD5940_SPI_TRACE_DEPTH];
+static uint32_t s_TraceWr = 0;          /* 写入的记录总数，取模得到写位置 */
+static uint32_t s_TraceBase = 0;        /* 清除时的s_TraceWr */
+static uint8_t s_TraceOn = 0;
+static uint8_t s_TraceTag = 0;
+static uint16_t s_TraceAddr = AD5940_TRACE_ADDR_NONE;  /* 最近一次SETADDR的地址 */
+static uint32_t (*s_pfnTraceNow)(void) = NULL;
+static uint32_t s_TraceHz = 0;
+
+/*******************************************************************************
+* 记录
+*******************************************************************************/
+
+/**
+ * @brief 取一条新记录的位置并填写公共字段
+ */
+static AD5940_SPITrace_Type *Trace_Alloc(uint8_t Flags)
+{
+    AD5940_SPITrace_Type *pRec = &s_TraceBuf[s_TraceWr % AD5940_SPI_TRACE_DEPTH];
+
+    s_TraceWr++;
+    pRec->Timestamp = (s_pfnTraceNow != NULL) ? s_pfnTraceNow() : 0u;
+    pRec->Flags = Flags;
+    pRec->Tag = s_TraceTag;
+    return pRec;
+}
+
+void AD5940_SPITraceFrame(const AD5940_SPIFrame_Type *pFrame, uint8_t Flags)
+{
+    AD5940_SPITrace_Type *pRec;
+    uint32_t n;
+    uint32_t i;
+
+    if (s_TraceOn == 0u)
+        return;
+
+    Flags |= pFrame->CsCtrl & (AD5940_TRACE_CS_ASSERT | AD5940_TRACE_CS_RELEASE);
+    n = pFrame->Length;
+    if (n > AD5940_SPI_TRACE_BYTES)
+    {
+        n = AD5940_SPI_TRACE_BYTES;
+        Flags |= AD5940_TRACE_TRUNC;
+    }
+    if (pFrame->pRx == NULL)
+        Flags |= AD5940_TRACE_NORX;
+
+    pRec = Trace_Alloc(Flags);
+    pRec->Length = pFrame->Length;
+    for (i = 0; i < n; i++)
+    {
+        pRec->Tx[i] = (pFrame->pTx != NULL) ? pFrame->pTx[i] : pFrame->TxFill;
+        pRec->Rx[i] = (pFrame->pRx != NULL) ? pFrame->pRx[i] : 0u;
+    }
+
+    /* 拉低CS的帧以命令字节开头：SETADDR给出地址，READREG/WRITEREG沿用，
+     * READFIFO对应DATAFIFORD。不动CS的帧(突发读)属于上一条命令 */
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_ASSERT) != 0u)
+    {
+        if ((pRec->Tx[0] == SPICMD_SETADDR) && (pFrame->Length >= 3u) && (n >= 3u))
+            s_TraceAddr = (uint16_t)(((uint16_t)pRec->Tx[1] << 8) | pRec->Tx[2]);
+        else if (pRec->Tx[0] == SPICMD_READFIFO)
+            s_TraceAddr = REG_AFE_DATAFIFORD;
+        else if ((pRec->Tx[0] != SPICMD_READREG) && (pRec->Tx[0] != SPICMD_WRITEREG))
+            s_TraceAddr = AD5940_TRACE_ADDR_NONE;
+    }
+    pRec->RegAddr = s_TraceAddr;
+}
+
+void AD5940_SPITraceCs(uint8_t Flags)
+{
+    AD5940_SPITrace_Type *pRec;
+
+    if (s_TraceOn == 0u)
+        return;
+    pRec = Trace_Alloc((uint8_t)(Flags | AD5940_TRACE_CSONLY | AD5940_TRACE_NORX));
+    pRec->Length = 0;
+    pRec->RegAddr = AD5940_TRACE_ADDR_NONE;
+}
+
+/*******************************************************************************
+* 控制和读取
+*******************************************************************************/
+
+void AD5940_SPITraceStart(void)
+{
+    s_TraceOn = 1u;
+}
+
+void AD5940_SPITraceStop(void)
+{
+    s_TraceOn = 0u;
+}
+
+void AD5940_SPITraceClear(void)
+{
+    s_TraceBase = s_TraceWr;
+    s_TraceAddr = AD5940_TRACE_ADDR_NONE;
+}
+
+void AD5940_SPITraceSetClock(uint32_t (*pfnNow)(void), uint32_t Hz)
+{
+    s_pfnTraceNow = pfnNow;
+    s_TraceHz = Hz;
+}
+
+uint8_t AD5940_SPITraceSetTag(uint8_t Tag)
+{
+    uint8_t old = s_TraceTag;
+
+    s_TraceTag = Tag;
+    return old;
+}
+
+uint32_t AD5940_SPITraceCount(void)
+{
+    uint32_t n = s_TraceWr - s_TraceBase;
+
+    return (n > AD5940_SPI_TRACE_DEPTH) ? AD5940_SPI_TRACE_DEPTH : n;
+}
+
+uint32_t AD5940_SPITraceLost(void)
+{
+    return (s_TraceWr - s_TraceBase) - AD5940_SPITraceCount();
+}
+
+int32_t AD5940_SPITraceGet(uint32_t index, AD5940_SPITrace_Type *pRec)
+{
+    uint32_t n = AD5940_SPITraceCount();
+
+    if ((pRec == NULL) || (index >= n))
+        return -1;
+    *pRec = s_TraceBuf[(s_TraceWr - n + index) % AD5940_SPI_TRACE_DEPTH];
+    return 0;
+}
+
+/*******************************************************************************
+* 文本导出
+*******************************************************************************/
+
+static char *Trace_PutHex(char *p, uint32_t value, uint32_t digits)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    while (digits != 0u)
+    {
+        digits--;
+        *p++ = hex[(value >> (4u * digits)) & 0x0Fu];
+    }
+    return p;
+}
+
+static char *Trace_PutDec(char *p, uint32_t value)
+{
+    char tmp[10];
+    uint32_t n = 0;
+
+    do
+    {
+        tmp[n++] = (char)('0' + value % 10u);
+        value /= 10u;
+    } while (value != 0u);
+    while (n != 0u)
+        *p++ = tmp[--n];
+    return p;
+}
+
+static char *Trace_PutStr(char *p, const char *s)
+{
+    while (*s != '\0')
+        *p++ = *s++;
+    return p;
+}
+
+/**
+ * @brief 输出一行，按MaxChunk分段
+ */
+static void Trace_Out(AD5940_SPITraceOutFunc pfnOut, const char *pLine, uint32_t len, uint32_t MaxChunk)
+{
+    uint32_t chunk;
+
+    while (len != 0u)
+    {
+        chunk = ((MaxChunk != 0u) && (len > MaxChunk)) ? MaxChunk : len;
+        pfnOut(pLine, chunk);
+        pLine += chunk;
+        len -= chunk;
+    }
+}
+
+uint32_t AD5940_SPITraceDump(AD5940_SPITraceOutFunc pfnOut, uint32_t MaxChunk)
+{
+    char line[TRACE_LINE_SIZE];
+    AD5940_SPITrace_Type rec;
+    uint8_t wasOn = s_TraceOn;
+    uint32_t n;
+    uint32_t i;
+    uint32_t j;
+    uint32_t bytes;
+    char *p;
+
+    if (pfnOut == NULL)
+        return 0;
+
+    s_TraceOn = 0u;
+    n = AD5940_SPITraceCount();
+
+    p = Trace_PutStr(line, "# AD5940 SPI trace v1 hz=");
+    p = Trace_PutDec(p, s_TraceHz);
+    p = Trace_PutStr(p, " n=");
+    p = Trace_PutDec(p, n);
+    p = Trace_PutStr(p, " lost=");
+    p = Trace_PutDec(p, AD5940_SPITraceLost());
+    *p++ = '\n';
+    Trace_Out(pfnOut, line, (uint32_t)(p - line), MaxChunk);
+
+    for (i = 0; i < n; i++)
+    {
+        if (AD5940_SPITraceGet(i, &rec) != 0)
+            break;
+        bytes = (rec.Length > AD5940_SPI_TRACE_BYTES) ? AD5940_SPI_TRACE_BYTES : rec.Length;
+
+        p = Trace_PutHex(line, rec.Timestamp, 8u);
+        *p++ = ' ';
+        p = Trace_PutHex(p, rec.Tag, 2u);
+        *p++ = ' ';
+        p = Trace_PutHex(p, rec.Flags, 2u);
+        *p++ = ' ';
+        p = Trace_PutHex(p, rec.RegAddr, 4u);
+        *p++ = ' ';
+        p = Trace_PutHex(p, rec.Length, 4u);
+        *p++ = ' ';
+        if (bytes == 0u)
+            *p++ = '-';
+        for (j = 0; j < bytes; j++)
+            p = Trace_PutHex(p, rec.Tx[j], 2u);
+        *p++ = ' ';
+        if ((bytes == 0u) || ((rec.Flags & AD5940_TRACE_NORX) != 0u))
+            *p++ = '-';
+        else
+        {
+            for (j = 0; j < bytes; j++)
+                p = Trace_PutHex(p, rec.Rx[j], 2u);
+        }
+        *p++ = '\n';
+        Trace_Out(pfnOut, line, (uint32_t)(p - line), MaxChunk);
+    }
+
+    s_TraceOn = wasOn;
+    return n;
+}
+
+#endif /* AD5940_SPI_TRACE_ENABLE */
+
+/* [] END OF FILE */
@@ -0,0 +1,1496 @@
+/*******************************************************************************
+* File Name: ad5940_sim.c
+*
+* Description:
+*   AD5940主机端仿真器
+*   在PC上替代ad5941_platform.c：实现ad5941_platform.h中的平台函数，
+*   并按AD5940 SPI协议(SETADDR/READREG/WRITEREG/READFIFO)解码字节流，
+*   驱动一个带复位默认值的寄存器模型。
+*
+* 模型包括：
+*   - 寄存器文件，复位值来自ad5940.h中的REG_xxx_RESET
+*   - 数据FIFO（FIFO/STREAM模式、阈值、满/空/溢出标志）
+*   - 序列器SRAM、SEQ0~3INFO、TRIGSEQ触发、SEQCNT/SEQCRC、命令FIFO模式
+*   - 中断控制器INTCSEL0/1、INTCFLAG0/1、INTCCLR，INT0上升沿置MCU中断标志
+*   - 唤醒定时器(SEQORDER/ENDSEQ/睡眠+唤醒时间)和休眠/唤醒
+*   - ADC/SINC3/SINC2/DFT数据通路的时序
+*
+* 使用方法见ad5940_sim.h。
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5940_sim.h"
+
+/*******************************************************************************
+* 仿真参数
+*******************************************************************************/
+
+#define SIM_REG_NUM             (0x1000u)   /* 寄存器地址空间0x0000~0x3FFF，每4字节一个 */
+#define SIM_SRAM_WORDS          (1536u)     /* 6KB SRAM，由序列器和数据FIFO分享 */
+#define SIM_CS_TICKS            (16u)       /* 每次CS翻转的MCU开销：1us */
+#define SIM_POLL_TICKS          (1600u)     /* 中断标志空闲轮询一次推进100us */
+#define SIM_WUPT_TICKS          (500u)      /* 唤醒定时器32kHz计数一次的系统时钟数 */
+#define SIM_STEP_MAX            (0x01000000u)   /* 单步推进上限，约1s */
+
+#define SIM_ADC_DEFAULT         (0x8200u)   /* 默认ADC码 */
+#define SIM_DFT_REAL_DEFAULT    (8000)      /* 默认DFT结果 */
+#define SIM_DFT_IMAG_DEFAULT    (-2000)
+
+/* SPI解码状态 */
+#define SIM_SPI_IDLE            (0u)        /* CS为高 */
+#define SIM_SPI_CMD             (1u)        /* 等待命令字节 */
+#define SIM_SPI_ADDR            (2u)        /* SETADDR地址 */
+#define SIM_SPI_RDDUMMY         (3u)        /* READREG空字节 */
+#define SIM_SPI_RDDATA          (4u)        /* READREG数据 */
+#define SIM_SPI_WRDATA          (5u)        /* WRITEREG数据 */
+#define SIM_SPI_FIFODUMMY       (6u)        /* READFIFO的6个空字节 */
+#define SIM_SPI_FIFODATA        (7u)        /* READFIFO数据流 */
+#define SIM_SPI_IGNORE          (8u)        /* 本帧剩余字节忽略 */
+
+#define SIM_REG(addr)           (s_Reg[((uint32_t)(addr) >> 2) & (SIM_REG_NUM - 1u)])
+
+/*******************************************************************************
+* 仿真状态
+*******************************************************************************/
+
+/* 非零复位值，其余寄存器复位为0 */
+static const RegPair_Type s_RegResetTable[] =
+{
+    {REG_AFECON_CLKCON0,          REG_AFECON_CLKCON0_RESET},
+    {REG_AFECON_CLKEN1,           REG_AFECON_CLKEN1_RESET},
+    {REG_AFECON_SWRSTCON,         REG_AFECON_SWRSTCON_RESET},
+    {REG_WUPTMR_SEQ0WUPL,         REG_WUPTMR_SEQ0WUPL_RESET},
+    {REG_WUPTMR_SEQ0WUPH,         REG_WUPTMR_SEQ0WUPH_RESET},
+    {REG_WUPTMR_SEQ0SLEEPL,       REG_WUPTMR_SEQ0SLEEPL_RESET},
+    {REG_WUPTMR_SEQ0SLEEPH,       REG_WUPTMR_SEQ0SLEEPH_RESET},
+    {REG_WUPTMR_SEQ1WUPL,         REG_WUPTMR_SEQ1WUPL_RESET},
+    {REG_WUPTMR_SEQ1WUPH,         REG_WUPTMR_SEQ1WUPH_RESET},
+    {REG_WUPTMR_SEQ1SLEEPL,       REG_WUPTMR_SEQ1SLEEPL_RESET},
+    {REG_WUPTMR_SEQ1SLEEPH,       REG_WUPTMR_SEQ1SLEEPH_RESET},
+    {REG_WUPTMR_SEQ2WUPL,         REG_WUPTMR_SEQ2WUPL_RESET},
+    {REG_WUPTMR_SEQ2WUPH,         REG_WUPTMR_SEQ2WUPH_RESET},
+    {REG_WUPTMR_SEQ2SLEEPL,       REG_WUPTMR_SEQ2SLEEPL_RESET},
+    {REG_WUPTMR_SEQ2SLEEPH,       REG_WUPTMR_SEQ2SLEEPH_RESET},
+    {REG_WUPTMR_SEQ3WUPL,         REG_WUPTMR_SEQ3WUPL_RESET},
+    {REG_WUPTMR_SEQ3WUPH,         REG_WUPTMR_SEQ3WUPH_RESET},
+    {REG_WUPTMR_SEQ3SLEEPL,       REG_WUPTMR_SEQ3SLEEPL_RESET},
+    {REG_WUPTMR_SEQ3SLEEPH,       REG_WUPTMR_SEQ3SLEEPH_RESET},
+    {REG_ALLON_PWRMOD,            REG_ALLON_PWRMOD_RESET},
+    {REG_ALLON_OSCCON,            REG_ALLON_OSCCON_RESET},
+    {REG_ALLON_EICLR,             REG_ALLON_EICLR_RESET},
+    {REG_ALLON_LOSCTST,           REG_ALLON_LOSCTST_RESET},
+    {REG_ALLON_CLKEN0,            REG_ALLON_CLKEN0_RESET},
+    {REG_AFE_AFECON,              REG_AFE_AFECON_RESET},
+    {REG_AFE_SEQCON,              REG_AFE_SEQCON_RESET},
+    {REG_AFE_FIFOCON,             REG_AFE_FIFOCON_RESET},
+    {REG_AFE_SWCON,               REG_AFE_SWCON_RESET},
+    {REG_AFE_HSDACCON,            REG_AFE_HSDACCON_RESET},
+    {REG_AFE_WGCON,               REG_AFE_WGCON_RESET},
+    {REG_AFE_ADCFILTERCON,        REG_AFE_ADCFILTERCON_RESET},
+    {REG_AFE_HSDACDAT,            REG_AFE_HSDACDAT_RESET},
+    {REG_AFE_SEQCRC,              REG_AFE_SEQCRC_RESET},
+    {REG_AFE_HPOSCCON,            REG_AFE_HPOSCCON_RESET},
+    {REG_AFE_DFTCON,              REG_AFE_DFTCON_RESET},
+    {REG_AFE_LPTIACON0,           REG_AFE_LPTIACON0_RESET},
+    {REG_AFE_HSRTIACON,           REG_AFE_HSRTIACON_RESET},
+    {REG_AFE_DE0RESCON,           REG_AFE_DE0RESCON_RESET},
+    {REG_AFE_LPMODECON,           REG_AFE_LPMODECON_RESET},
+    {REG_AFE_LPDACCON0,           REG_AFE_LPDACCON0_RESET},
+    {REG_AFE_BUFSENCON,           REG_AFE_BUFSENCON_RESET},
+    {REG_AFE_PSWSTA,              REG_AFE_PSWSTA_RESET},
+    {REG_AFE_NSWSTA,              REG_AFE_NSWSTA_RESET},
+    {REG_AFE_CMDDATACON,          REG_AFE_CMDDATACON_RESET},
+    {REG_AFE_REPEATADCCNV,        REG_AFE_REPEATADCCNV_RESET},
+    {REG_AFE_ADCGAINTEMPSENS0,    REG_AFE_ADCGAINTEMPSENS0_RESET},
+    {REG_AFE_ADCGAINGN1,          REG_AFE_ADCGAINGN1_RESET},
+    {REG_AFE_DACGAIN,             REG_AFE_DACGAIN_RESET},
+    {REG_AFE_ADCGAINGN1P5,        REG_AFE_ADCGAINGN1P5_RESET},
+    {REG_AFE_ADCGAINGN2,          REG_AFE_ADCGAINGN2_RESET},
+    {REG_AFE_ADCGAINGN4,          REG_AFE_ADCGAINGN4_RESET},
+    {REG_AFE_ADCGNHSTIA,          REG_AFE_ADCGNHSTIA_RESET},
+    {REG_AFE_ADCGNLPTIA0,         REG_AFE_ADCGNLPTIA0_RESET},
+    {REG_AFE_ADCPGAGN4OFCAL,      REG_AFE_ADCPGAGN4OFCAL_RESET},
+    {REG_AFE_ADCGAINGN9,          REG_AFE_ADCGAINGN9_RESET},
+    {REG_AFE_ADCGAINDIOTEMPSENS,  REG_AFE_ADCGAINDIOTEMPSENS_RESET},
+    {REG_AFE_ADCGNLPTIA1,         REG_AFE_ADCGNLPTIA1_RESET},
+    {REG_AFE_PMBW,                REG_AFE_PMBW_RESET},
+    {REG_AFE_AFE_TEMPSEN_DIO,     REG_AFE_AFE_TEMPSEN_DIO_RESET},
+    {REG_AFE_ADCBUFCON,           REG_AFE_ADCBUFCON_RESET},
+    {REG_INTC_INTCSEL0,           REG_INTC_INTCSEL0_RESET},
+};
+
+static const uint16_t s_Sinc3OsrTable[4] = {5, 4, 2, 5};
+static const uint16_t s_Sinc2OsrTable[16] = {22, 44, 89, 178, 267, 533, 640, 667,
+                                              800, 889, 1067, 1333, 1333, 1333, 1333, 1333};
+static const uint16_t s_MemWordsTable[4] = {8, 512, 1024, 1536};   /* 32B/2KB/4KB/6KB */
+static const uint16_t s_SeqInfoAddr[4] = {REG_AFE_SEQ0INFO, REG_AFE_SEQ1INFO,
+                                          REG_AFE_SEQ2INFO, REG_AFE_SEQ3INFO};
+
+/* 芯片状态 */
+static uint8_t  s_PowerOn = 0u;
+static uint8_t  s_InReset = 0u;         /* RESET引脚为低 */
+static uint8_t  s_Hibernate = 0u;
+static uint8_t  s_SleepReq = 0u;        /* 序列结束后进入休眠 */
+static uint64_t s_Ticks = 0u;
+static uint32_t s_Reg[SIM_REG_NUM];
+static uint32_t s_SeqRam[SIM_SRAM_WORDS];
+
+/* 数据FIFO */
+static uint32_t s_Fifo[SIM_SRAM_WORDS];
+static uint32_t s_FifoRd = 0u;
+static uint32_t s_FifoCnt = 0u;
+
+/* 中断 */
+static uint32_t s_IntFlag0 = 0u;
+static uint32_t s_IntFlag1 = 0u;
+static uint8_t  s_IntLine = 0u;         /* INT0当前是否有效 */
+static volatile uint32_t s_McuIntFlag = 0u;
+
+/* ADC数据通路 */
+static uint32_t s_AdcTickAcc = 0u;
+static uint32_t s_AdcRaw = 0u;          /* 启动转换后的原始采样数 */
+static uint32_t s_AdcSinc3 = 0u;        /* SINC3输出数 */
+static uint32_t s_DftCnt = 0u;          /* DFT已累计的点数 */
+static AD5940Sim_AdcFunc s_pfnAdc = NULL;
+static AD5940Sim_DftFunc s_pfnDft = NULL;
+
+/* 序列器 */
+static uint8_t  s_SeqRun = 0u;
+static uint8_t  s_SeqId = 0u;
+static uint8_t  s_SeqPending = 0u;      /* 等待执行的触发 */
+static uint32_t s_SeqPc = 0u;
+static uint32_t s_SeqEnd = 0u;
+static uint32_t s_SeqWait = 0u;         /* 当前命令剩余的时钟数 */
+static uint32_t s_SeqTout = 0u;
+static uint32_t s_CmdFifoRd = 0u;       /* 命令FIFO模式，占用序列器存储区 */
+static uint32_t s_CmdFifoCnt = 0u;
+static uint8_t  s_SeqStall = 0u;        /* 命令FIFO空，等待MCU写入 */
+
+/* 唤醒定时器 */
+static uint8_t  s_WuptPos = 0u;         /* 当前槽位A~H */
+static uint64_t s_WuptAcc = 0u;
+
+/* SPI */
+static uint8_t  s_SpiBackend = AD5940_SPI_BACKEND_DEFAULT;
+static uint32_t s_SpiByteTotal = 0;     /* AD5940_SPIGetByteCount()，不随统计清除 */
+static uint32_t s_ByteTicks = (8u * AD5940_SIM_SYSCLK_HZ) / AD5940_SIM_SCLK_DEFAULT;
+static uint8_t  s_SpiState = SIM_SPI_IDLE;
+static uint8_t  s_SpiCnt = 0u;
+static uint8_t  s_SpiWidth = 0u;
+static uint8_t  s_FrameDead = 0u;       /* 本帧用于唤醒，数据无效 */
+static uint16_t s_SpiAddr = 0u;
+static uint32_t s_SpiShift = 0u;
+
+static AD5940Sim_Stat_Type s_Stat;
+
+static void Sim_WriteReg(uint16_t RegAddr, uint32_t RegData, uint8_t bySeq);
+static void Sim_CsLow(void);
+static void Sim_CsHigh(void);
+
+/*******************************************************************************
+* 寄存器宽度
+*******************************************************************************/
+
+static uint8_t Sim_RegIs32(uint16_t RegAddr)
+{
+    return ((RegAddr >= 0x1000u) && (RegAddr <= 0x3014u)) ? 1u : 0u;
+}
+
+/*******************************************************************************
+* 中断控制器
+*******************************************************************************/
+
+/**
+ * @brief INT0由无效变为有效时置MCU中断标志（相当于MCU端的边沿中断）
+ */
+static void Sim_IntUpdate(void)
+{
+    uint8_t line = ((s_IntFlag0 & SIM_REG(REG_INTC_INTCSEL0)) != 0u) ? 1u : 0u;
+
+    if ((line != 0u) && (s_IntLine == 0u))
+        s_McuIntFlag = 1u;
+    s_IntLine = line;
+}
+
+/**
+ * @brief 产生中断源
+ *
+ * INTCFLAGx总是锁存，INTCSEL0只决定是否驱动INT0引脚。
+ * AppAMPInit()等在未配置INTCSEL1时轮询INTCFLAG1，按此行为建模。
+ */
+static void Sim_IntSet(uint32_t IntSrc)
+{
+    s_IntFlag0 |= IntSrc;
+    s_IntFlag1 |= IntSrc;
+    Sim_IntUpdate();
+}
+
+/*******************************************************************************
+* 数据FIFO
+*******************************************************************************/
+
+static uint32_t Sim_FifoCapacity(void)
+{
+    uint32_t sel = (SIM_REG(REG_AFE_CMDDATACON) & BITM_AFE_CMDDATACON_DATA_MEM_SEL) >> BITP_AFE_CMDDATACON_DATA_MEM_SEL;
+
+    return (sel < 4u) ? s_MemWordsTable[sel] : SIM_SRAM_WORDS;
+}
+
+static uint32_t Sim_FifoSrc(void)
+{
+    if ((SIM_REG(REG_AFE_FIFOCON) & BITM_AFE_FIFOCON_DATAFIFOEN) == 0u)
+        return 0xFFu;   /* FIFO关闭 */
+    return (SIM_REG(REG_AFE_FIFOCON) & BITM_AFE_FIFOCON_DATAFIFOSRCSEL) >> BITP_AFE_FIFOCON_DATAFIFOSRCSEL;
+}
+
+static void Sim_FifoFlush(void)
+{
+    s_FifoRd = 0u;
+    s_FifoCnt = 0u;
+}
+
+static void Sim_FifoPush(uint32_t data)
+{
+    uint32_t cap = Sim_FifoCapacity();
+    uint32_t mode = (SIM_REG(REG_AFE_CMDDATACON) & BITM_AFE_CMDDATACON_DATAMEMMDE) >> BITP_AFE_CMDDATACON_DATAMEMMDE;
+    uint32_t thresh;
+
+    if (s_FifoCnt >= cap)
+    {
+        if (mode == FIFOMODE_STREAM)
+        {
+            /* 流模式丢弃最旧的数据 */
+            s_FifoRd = (s_FifoRd + 1u) % SIM_SRAM_WORDS;
+            s_FifoCnt--;
+        }
+        else
+        {
+            s_Stat.FifoOverflows++;
+            Sim_IntSet(AFEINTSRC_DATAFIFOOF);
+            return;
+        }
+    }
+    s_Fifo[(s_FifoRd + s_FifoCnt) % SIM_SRAM_WORDS] = data;
+    s_FifoCnt++;
+
+    if (s_FifoCnt >= cap)
+        Sim_IntSet(AFEINTSRC_DATAFIFOFULL);
+    thresh = (SIM_REG(REG_AFE_DATAFIFOTHRES) & BITM_AFE_DATAFIFOTHRES_HIGHTHRES) >> BITP_AFE_DATAFIFOTHRES_HIGHTHRES;
+    if ((thresh != 0u) && (s_FifoCnt >= thresh))
+        Sim_IntSet(AFEINTSRC_DATAFIFOTHRESH);
+}
+
+static uint32_t Sim_FifoPop(void)
+{
+    uint32_t data;
+
+    if (s_FifoCnt == 0u)
+    {
+        Sim_IntSet(AFEINTSRC_DATAFIFOUF);
+        return 0u;
+    }
+    data = s_Fifo[s_FifoRd];
+    s_FifoRd = (s_FifoRd + 1u) % SIM_SRAM_WORDS;
+    s_FifoCnt--;
+    if (s_FifoCnt == 0u)
+        Sim_IntSet(AFEINTSRC_DATAFIFOEMPTY);
+    return data;
+}
+
+/*******************************************************************************
+* ADC数据通路
+*******************************************************************************/
+
+/* FIFO数据字：[31:25]ECC(不模拟) [24:23]SEQID [22:16]通道ID [15:0]数据 */
+static uint32_t Sim_FifoWord(uint32_t chanId, uint32_t data)
+{
+    uint32_t seqId = (s_SeqRun != 0u) ? s_SeqId : 0u;
+
+    return (seqId << 23) | ((chanId & 0x7Fu) << 16) | (data & 0xFFFFu);
+}
+
+static uint16_t Sim_AdcCode(void)
+{
+    if (s_pfnAdc != NULL)
+        return s_pfnAdc(SIM_REG(REG_AFE_ADCCON), s_Ticks);
+    return SIM_ADC_DEFAULT;
+}
+
+/**
+ * @brief 向DFT引擎送入一个点，满DftNum点后输出一次结果
+ */
+static void Sim_DftFeed(void)
+{
+    uint32_t dftNum = (SIM_REG(REG_AFE_DFTCON) & BITM_AFE_DFTCON_DFTNUM) >> BITP_AFE_DFTCON_DFTNUM;
+    uint32_t seqId = (s_SeqRun != 0u) ? s_SeqId : 0u;
+    int32_t real = SIM_DFT_REAL_DEFAULT;
+    int32_t imag = SIM_DFT_IMAG_DEFAULT;
+
+    if ((SIM_REG(REG_AFE_AFECON) & AFECTRL_DFT) == 0u)
+        return;
+    if (dftNum > DFTNUM_16384)
+        dftNum = DFTNUM_16384;
+    dftNum = 4u << dftNum;
+    if (++s_DftCnt < dftNum)
+        return;
+    s_DftCnt = 0u;
+
+    if (s_pfnDft != NULL)
+        s_pfnDft(SIM_REG(REG_AFE_ADCCON), dftNum, &real, &imag);
+    SIM_REG(REG_AFE_DFTREAL) = (uint32_t)real & 0x3FFFFu;
+    SIM_REG(REG_AFE_DFTIMAG) = (uint32_t)imag & 0x3FFFFu;
+    if (Sim_FifoSrc() == FIFOSRC_DFT)
+    {
+        /* DFT通道ID为11111_xx，低两位与18位数据的高两位重叠 */
+        Sim_FifoPush((seqId << 23) | (0x1Fu << 18) | SIM_REG(REG_AFE_DFTREAL));
+        Sim_FifoPush((seqId << 23) | (0x1Fu << 18) | SIM_REG(REG_AFE_DFTIMAG));
+    }
+    Sim_IntSet(AFEINTSRC_DFTRDY);
+}
+
+/**
+ * @brief 一个SINC3输出，并按SINC2过采样率产生SINC2输出
+ *
+ * 第N个SINC3输出在第(N+2)*OSR3+1个原始采样，第N个SINC2输出在
+ * 第(N+1)*OSR2+1个SINC3输出，与AD5940_ClksCalculate()的估算一致。
+ */
+static void Sim_Sinc3Out(uint32_t osr2)
+{
+    uint32_t afecon = SIM_REG(REG_AFE_AFECON);
+    uint32_t muxp = SIM_REG(REG_AFE_ADCCON) & 0x3Fu;
+    uint32_t dftSrc = (SIM_REG(REG_AFE_DFTCON) & BITM_AFE_DFTCON_DFTINSEL) >> BITP_AFE_DFTCON_DFTINSEL;
+    uint16_t code = Sim_AdcCode();
+
+    s_AdcSinc3++;
+    SIM_REG(REG_AFE_ADCDAT) = code;
+    if (Sim_FifoSrc() == FIFOSRC_SINC3)
+        Sim_FifoPush(Sim_FifoWord(muxp, code));
+    Sim_IntSet(AFEINTSRC_ADCRDY);
+    if ((dftSrc == DFTSRC_SINC3) || (dftSrc == DFTSRC_AVG))
+        Sim_DftFeed();
+
+    if ((afecon & AFECTRL_SINC2NOTCH) == 0u)
+        return;
+    if ((((s_AdcSinc3 - 1u) % osr2) != 0u) || (((s_AdcSinc3 - 1u) / osr2) < 2u))
+        return;
+    code = Sim_AdcCode();
+    SIM_REG(REG_AFE_SINC2DAT) = code;
+    if (Sim_FifoSrc() == FIFOSRC_SINC2NOTCH)
+        Sim_FifoPush(Sim_FifoWord(0x40u | muxp, code));
+    Sim_IntSet(AFEINTSRC_SINC2RDY);
+    if (dftSrc == DFTSRC_SINC2NOTCH)
+        Sim_DftFeed();
+}
+
+static void Sim_AdcRestart(void)
+{
+    s_AdcTickAcc = 0u;
+    s_AdcRaw = 0u;
+    s_AdcSinc3 = 0u;
+    s_DftCnt = 0u;
+}
+
+static uint8_t Sim_AdcActive(void)
+{
+    return ((s_Hibernate == 0u) && ((SIM_REG(REG_AFE_AFECON) & AFECTRL_ADCCNV) != 0u)) ? 1u : 0u;
+}
+
+static void Sim_AdcRun(uint32_t ticks)
+{
+    uint32_t filt = SIM_REG(REG_AFE_ADCFILTERCON);
+    uint32_t period;
+    uint32_t osr3;
+    uint32_t osr2;
+    uint32_t n;
+
+    if (Sim_AdcActive() == 0u)
+        return;
+
+    /* ADCRATE_800KHZ: 16MHz/20；ADCRATE_1P6MHZ按原始采样率加倍处理 */
+    period = ((filt & BITM_AFE_ADCFILTERCON_ADCCLK) != 0u) ? 20u : 10u;
+    osr3 = ((filt & BITM_AFE_ADCFILTERCON_SINC3BYP) != 0u) ? 1u :
+           s_Sinc3OsrTable[(filt & BITM_AFE_ADCFILTERCON_SINC3OSR) >> BITP_AFE_ADCFILTERCON_SINC3OSR];
+    osr2 = s_Sinc2OsrTable[(filt & BITM_AFE_ADCFILTERCON_SINC2OSR) >> BITP_AFE_ADCFILTERCON_SINC2OSR];
+
+    s_AdcTickAcc += ticks;
+    n = s_AdcTickAcc / period;
+    s_AdcTickAcc %= period;
+    while (n-- != 0u)
+    {
+        s_AdcRaw++;
+        if (((SIM_REG(REG_AFE_DFTCON) & BITM_AFE_DFTCON_DFTINSEL) >> BITP_AFE_DFTCON_DFTINSEL) == DFTSRC_ADCRAW)
+            Sim_DftFeed();
+        if ((((s_AdcRaw - 1u) % osr3) == 0u) && (((s_AdcRaw - 1u) / osr3) >= 3u))
+            Sim_Sinc3Out(osr2);
+    }
+}
+
+/*******************************************************************************
+* 休眠
+*******************************************************************************/
+
+static void Sim_EnterHibernate(void)
+{
+    s_Hibernate = 1u;
+}
+
+/*******************************************************************************
+* 序列器
+*******************************************************************************/
+
+static uint32_t Sim_SeqRamWords(void)
+{
+    uint32_t sel = (SIM_REG(REG_AFE_CMDDATACON) & BITM_AFE_CMDDATACON_CMD_MEM_SEL) >> BITP_AFE_CMDDATACON_CMD_MEM_SEL;
+
+    return (sel < 4u) ? s_MemWordsTable[sel] : SIM_SRAM_WORDS;
+}
+
+static uint8_t Sim_CmdFifoMode(void)
+{
+    return ((SIM_REG(REG_AFE_CMDDATACON) & BITM_AFE_CMDDATACON_CMDMEMMDE) == ENUM_AFE_CMDDATACON_CFIFO) ? 1u : 0u;
+}
+
+static void Sim_CmdFifoFlush(void)
+{
+    s_CmdFifoRd = 0u;
+    s_CmdFifoCnt = 0u;
+    s_SeqStall = 0u;
+}
+
+/**
+ * @brief MCU写CMDFIFOWRITE：FIFO满时丢弃并产生CMDFIFOOF，序列器在等待时继续执行
+ */
+static void Sim_CmdFifoPush(uint32_t cmd)
+{
+    uint32_t size = Sim_SeqRamWords();
+
+    if (s_CmdFifoCnt >= size)
+    {
+        Sim_IntSet(AFEINTSRC_CMDFIFOOF);
+        return;
+    }
+    s_SeqRam[(s_CmdFifoRd + s_CmdFifoCnt) % size] = cmd;
+    s_CmdFifoCnt++;
+    if (s_CmdFifoCnt == size)
+        Sim_IntSet(AFEINTSRC_CMDFIFOFULL);
+    s_SeqStall = 0u;
+}
+
+/* SEQCRC: CRC-8(x^8+x^2+x+1)，每条命令高字节在前 */
+static void Sim_SeqCrc(uint32_t cmd)
+{
+    uint32_t crc = SIM_REG(REG_AFE_SEQCRC) & 0xFFu;
+    int32_t i;
+    int32_t b;
+
+    for (i = 24; i >= 0; i -= 8)
+    {
+        crc ^= (cmd >> i) & 0xFFu;
+        for (b = 0; b < 8; b++)
+            crc = ((crc & 0x80u) != 0u) ? (((crc << 1) ^ 0x07u) & 0xFFu) : ((crc << 1) & 0xFFu);
+    }
+    SIM_REG(REG_AFE_SEQCRC) = crc;
+}
+
+static void Sim_SeqStartNext(void)
+{
+    uint32_t info;
+    uint8_t id;
+
+    for (id = 0u; id < 4u; id++)
+    {
+        if ((s_SeqPending & (1u << id)) != 0u)
+            break;
+    }
+    if (id >= 4u)
+        return;
+    s_SeqPending &= (uint8_t)~(1u << id);
+
+    info = SIM_REG(s_SeqInfoAddr[id]);
+    s_SeqId = id;
+    s_SeqPc = info & BITM_AFE_SEQ0INFO_ADDR;
+    s_SeqEnd = s_SeqPc + ((info & BITM_AFE_SEQ0INFO_LEN) >> BITP_AFE_SEQ0INFO_LEN);
+    s_SeqWait = 0u;
+    s_SeqStall = 0u;
+    s_SeqRun = 1u;
+    s_Hibernate = 0u;
+    s_Stat.SeqRuns++;
+}
+
+/**
+ * @brief 序列结束(执行完或SEQCON.SEQEN被清零)：产生ENDSEQ，处理休眠请求和排队的触发
+ */
+static void Sim_SeqStop(void)
+{
+    s_SeqRun = 0u;
+    s_SeqWait = 0u;
+    s_SeqStall = 0u;
+    Sim_IntSet(AFEINTSRC_ENDSEQ);
+    if (s_SleepReq != 0u)
+    {
+        s_SleepReq = 0u;
+        Sim_EnterHibernate();
+    }
+    else if ((s_SeqPending != 0u) && ((SIM_REG(REG_AFE_SEQCON) & BITM_AFE_SEQCON_SEQEN) != 0u))
+    {
+        Sim_SeqStartNext();
+    }
+}
+
+static void Sim_SeqTrigger(uint32_t mask)
+{
+    if ((SIM_REG(REG_AFE_SEQCON) & BITM_AFE_SEQCON_SEQEN) == 0u)
+        return;     /* 序列器未使能，忽略触发 */
+    s_SeqPending |= (uint8_t)(mask & 0x0Fu);
+    if (s_SeqRun == 0u)
+        Sim_SeqStartNext();
+}
+
+/**
+ * @brief 执行一条命令，设置该命令占用的时钟数
+ */
+static void Sim_SeqStep(void)
+{
+    uint32_t cmd;
+
+    if (Sim_CmdFifoMode() != 0u)
+    {
+        /* 命令FIFO模式：不使用SEQxINFO，FIFO空时等待 */
+        if (s_CmdFifoCnt == 0u)
+        {
+            s_SeqStall = 1u;
+            s_Stat.CmdFifoStalls++;
+            return;
+        }
+        cmd = s_SeqRam[s_CmdFifoRd];
+        s_CmdFifoRd = (s_CmdFifoRd + 1u) % Sim_SeqRamWords();
+        if (--s_CmdFifoCnt == 0u)
+            Sim_IntSet(AFEINTSRC_CMDFIFOEMPTY);
+    }
+    else if (s_SeqPc >= s_SeqEnd)
+    {
+        Sim_SeqStop();
+        return;
+    }
+    else
+    {
+        cmd = (s_SeqPc < Sim_SeqRamWords()) ? s_SeqRam[s_SeqPc] : 0u;
+        s_SeqPc++;
+    }
+    SIM_REG(REG_AFE_SEQCNT)++;
+    Sim_SeqCrc(cmd);
+    s_Stat.SeqCmds++;
+
+    if ((cmd & 0x80000000u) != 0u)
+    {
+        /* SEQ_WR: 只能访问0x2000~0x21FC */
+        s_SeqWait = 1u + ((SIM_REG(REG_AFE_SEQCON) & BITM_AFE_SEQCON_SEQWRTMR) >> BITP_AFE_SEQCON_SEQWRTMR);
+        Sim_WriteReg((uint16_t)(0x2000u | (((cmd >> 24) & 0x7Fu) << 2)), cmd & 0x00FFFFFFu, 1u);
+    }
+    else if ((cmd & 0x40000000u) != 0u)
+    {
+        /* SEQ_TOUT */
+        s_SeqTout = cmd & 0x3FFFFFFFu;
+        s_SeqWait = 1u;
+    }
+    else
+    {
+        /* SEQ_WAIT，SEQ_NOP等待一个时钟 */
+        s_SeqWait = cmd & 0x3FFFFFFFu;
+        if (s_SeqWait == 0u)
+            s_SeqWait = 1u;
+    }
+}
+
+/*******************************************************************************
+* 唤醒定时器
+*******************************************************************************/
+
+static uint8_t Sim_WuptEnabled(void)
+{
+    return ((SIM_REG(REG_WUPTMR_CON) & BITM_WUPTMR_CON_EN) != 0u) ? 1u : 0u;
+}
+
+static uint8_t Sim_WuptSeq(void)
+{
+    return (uint8_t)((SIM_REG(REG_WUPTMR_SEQORDER) >> (2u * s_WuptPos)) & 0x03u);
+}
+
+/**
+ * @brief 当前槽位的周期：睡眠时间+唤醒时间，结束时触发该槽位的序列
+ */
+static uint64_t Sim_WuptPeriod(void)
+{
+    uint16_t base = (uint16_t)(REG_WUPTMR_SEQ0WUPL + 0x10u * Sim_WuptSeq());
+    uint32_t wup = (SIM_REG(base) & 0xFFFFu) | ((SIM_REG(base + 0x4u) & 0xFu) << 16);
+    uint32_t slp = (SIM_REG(base + 0x8u) & 0xFFFFu) | ((SIM_REG(base + 0xCu) & 0xFu) << 16);
+
+    return ((uint64_t)wup + slp + 2u) * SIM_WUPT_TICKS;
+}
+
+static void Sim_WuptFire(void)
+{
+    uint8_t endPos = (uint8_t)((SIM_REG(REG_WUPTMR_CON) & BITM_WUPTMR_CON_ENDSEQ) >> BITP_WUPTMR_CON_ENDSEQ);
+    uint8_t seq = Sim_WuptSeq();
+
+    s_WuptAcc = 0u;
+    s_WuptPos = (s_WuptPos >= endPos) ? 0u : (uint8_t)(s_WuptPos + 1u);
+    s_Hibernate = 0u;
+    Sim_SeqTrigger(1u << seq);
+}
+
+/*******************************************************************************
+* 时间推进
+*******************************************************************************/
+
+static void Sim_Advance(uint64_t ticks)
+{
+    uint64_t step;
+    uint64_t period;
+
+    while (ticks != 0u)
+    {
+        /* 序列器在当前时刻连续执行命令，直到遇到占用时钟的命令 */
+        while ((s_SeqRun != 0u) && (s_SeqWait == 0u) && (s_SeqStall == 0u))
+            Sim_SeqStep();
+
+        step = (ticks > SIM_STEP_MAX) ? SIM_STEP_MAX : ticks;
+        if ((s_SeqRun != 0u) && (s_SeqStall == 0u) && (s_SeqWait < step))
+            step = s_SeqWait;
+        period = 0u;
+        if (Sim_WuptEnabled() != 0u)
+        {
+            period = Sim_WuptPeriod();
+            if (s_WuptAcc >= period)
+                s_WuptAcc = period - 1u;
+            if ((period - s_WuptAcc) < step)
+                step = period - s_WuptAcc;
+        }
+
+        Sim_AdcRun((uint32_t)step);
+        if (s_SeqTout != 0u)
+        {
+            if (s_SeqTout <= step)
+            {
+                s_SeqTout = 0u;
+                Sim_IntSet(AFEINTSRC_SEQTIMEOUT);
+            }
+            else
+            {
+                s_SeqTout -= (uint32_t)step;
+            }
+        }
+        if ((s_SeqRun != 0u) && (s_SeqStall == 0u))
+            s_SeqWait -= (uint32_t)step;
+        s_Ticks += step;
+        ticks -= step;
+
+        if (period != 0u)
+        {
+            s_WuptAcc += step;
+            if (s_WuptAcc >= period)
+                Sim_WuptFire();
+        }
+    }
+}
+
+/**
+ * @brief 距离下一次唤醒定时器触发的时钟数，未使能时返回0
+ */
+static uint64_t Sim_WuptRemain(void)
+{
+    uint64_t period;
+
+    if (Sim_WuptEnabled() == 0u)
+        return 0u;
+    period = Sim_WuptPeriod();
+    return (s_WuptAcc < period) ? (period - s_WuptAcc) : 1u;
+}
+
+/*******************************************************************************
+* 寄存器访问
+*******************************************************************************/
+
+static void Sim_ChipReset(void)
+{
+    uint32_t i;
+
+    memset(s_Reg, 0, sizeof(s_Reg));
+    for (i = 0; i < sizeof(s_RegResetTable) / sizeof(s_RegResetTable[0]); i++)
+        SIM_REG(s_RegResetTable[i].RegAddr) = s_RegResetTable[i].RegData;
+    memset(s_SeqRam, 0, sizeof(s_SeqRam));
+    Sim_FifoFlush();
+    Sim_CmdFifoFlush();
+    Sim_AdcRestart();
+    s_IntFlag0 = 0u;
+    s_IntFlag1 = 0u;
+    s_IntLine = 0u;
+    s_SeqRun = 0u;
+    s_SeqPending = 0u;
+    s_SeqWait = 0u;
+    s_SeqTout = 0u;
+    s_WuptPos = 0u;
+    s_WuptAcc = 0u;
+    s_Hibernate = 0u;
+    s_SleepReq = 0u;
+    s_SpiAddr = 0u;
+
+    /* 复位后自动加载完成，INTCSEL0默认使能该中断 */
+    Sim_IntSet(AFEINTSRC_BOOTLDDONE);
+}
+
+/**
+ * @brief 读寄存器，包含读操作的副作用
+ */
+static uint32_t Sim_ReadReg(uint16_t RegAddr)
+{
+    uint32_t data;
+
+    switch (RegAddr)
+    {
+        case REG_AFECON_ADIID:
+            return AD5940_ADIID;
+        case REG_AFECON_CHIPID:
+            return AD5940_SIM_CHIPID;
+        case REG_INTC_INTCFLAG0:
+            return s_IntFlag0;
+        case REG_INTC_INTCFLAG1:
+            return s_IntFlag1;
+        case REG_AFE_FIFOCNTSTA:
+            return s_FifoCnt << BITP_AFE_FIFOCNTSTA_DATAFIFOCNTSTA;
+        case REG_AFE_DATAFIFORD:
+            return Sim_FifoPop();
+        case REG_AFE_SEQTIMEOUT:
+            return s_SeqTout;
+        default:
+            break;
+    }
+    data = SIM_REG(RegAddr);
+    return (Sim_RegIs32(RegAddr) != 0u) ? data : (data & 0xFFFFu);
+}
+
+/**
+ * @brief 写寄存器，MCU经SPI写入和序列器SEQ_WR共用
+ * @param bySeq: 1=序列器写入
+ */
+static void Sim_WriteReg(uint16_t RegAddr, uint32_t RegData, uint8_t bySeq)
+{
+    uint32_t old = SIM_REG(RegAddr);
+    uint32_t addr;
+
+    if (Sim_RegIs32(RegAddr) == 0u)
+        RegData &= 0xFFFFu;
+
+    /* 命令型寄存器，不保存写入值 */
+    switch (RegAddr)
+    {
+        case REG_AFECON_SWRSTCON:
+            if (RegData == AD5940_SWRST)
+                Sim_ChipReset();
+            return;
+        case REG_AFECON_TRIGSEQ:
+            Sim_SeqTrigger(RegData);
+            return;
+        case REG_INTC_INTCCLR:
+            s_IntFlag0 &= ~RegData;
+            s_IntFlag1 &= ~RegData;
+            Sim_IntUpdate();
+            return;
+        case REG_AFE_CMDFIFOWRITE:
+            if (Sim_CmdFifoMode() != 0u)
+            {
+                Sim_CmdFifoPush(RegData);
+                return;
+            }
+            addr = SIM_REG(REG_AFE_CMDFIFOWADDR) & 0x7FFu;
+            if (addr < Sim_SeqRamWords())
+                s_SeqRam[addr] = RegData;
+            return;
+        case REG_AFE_SEQCNT:
+            /* 序列器关闭时写SEQCNT清除CNT和CRC */
+            if ((SIM_REG(REG_AFE_SEQCON) & BITM_AFE_SEQCON_SEQEN) == 0u)
+            {
+                SIM_REG(REG_AFE_SEQCNT) = 0u;
+                SIM_REG(REG_AFE_SEQCRC) = REG_AFE_SEQCRC_RESET;
+            }
+            return;
+        case REG_AFE_AFEGENINTSTA:
+            if (bySeq != 0u)
+                Sim_IntSet((RegData & 0x0Fu) * AFEINTSRC_CUSTOMINT0);
+            return;
+        case REG_AFE_SEQTRGSLP:
+            if (((RegData & 0x01u) != 0u) && (SIM_REG(REG_AFE_SEQSLPLOCK) == SLPKEY_UNLOCK))
+            {
+                if (s_SeqRun != 0u)
+                    s_SleepReq = 1u;
+                else
+                    Sim_EnterHibernate();
+            }
+            return;
+        case REG_AFECON_ADIID:
+        case REG_AFECON_CHIPID:
+        case REG_INTC_INTCFLAG0:
+        case REG_INTC_INTCFLAG1:
+        case REG_AFE_FIFOCNTSTA:
+        case REG_AFE_DATAFIFORD:
+            return;     /* 只读 */
+        default:
+            break;
+    }
+
+    SIM_REG(RegAddr) = RegData;
+
+    switch (RegAddr)
+    {
+        case REG_AFE_SEQCON:
+            if ((s_SeqRun != 0u) && ((RegData & BITM_AFE_SEQCON_SEQEN) == 0u))
+                Sim_SeqStop();
+            break;
+        case REG_AFE_FIFOCON:
+            if ((RegData & BITM_AFE_FIFOCON_DATAFIFOEN) == 0u)
+                Sim_FifoFlush();
+            break;
+        case REG_AFE_CMDDATACON:
+            if (((RegData ^ old) & (BITM_AFE_CMDDATACON_CMDMEMMDE | BITM_AFE_CMDDATACON_CMD_MEM_SEL)) != 0u)
+                Sim_CmdFifoFlush();
+            break;
+        case REG_AFE_AFECON:
+            if (((RegData & ~old) & AFECTRL_ADCCNV) != 0u)
+                Sim_AdcRestart();
+            if (((RegData & ~old) & AFECTRL_DFT) != 0u)
+                s_DftCnt = 0u;
+            break;
+        case REG_WUPTMR_CON:
+            if (((RegData & ~old) & BITM_WUPTMR_CON_EN) != 0u)
+            {
+                s_WuptPos = 0u;
+                s_WuptAcc = 0u;
+            }
+            break;
+        case REG_INTC_INTCSEL0:
+            Sim_IntUpdate();
+            break;
+        default:
+            break;
+    }
+}
+
+/*******************************************************************************
+* SPI协议解码
+*******************************************************************************/
+
+/**
+ * @brief 处理CS为低时的一个字节
+ * @param tx: MOSI字节
+ * @return MISO字节
+ */
+static uint8_t Sim_SpiByte(uint8_t tx)
+{
+    uint8_t rx = 0u;
+
+    if ((s_SpiState == SIM_SPI_IDLE) || (s_FrameDead != 0u) || (s_InReset != 0u))
+        return 0u;
+
+    switch (s_SpiState)
+    {
+        case SIM_SPI_CMD:
+            s_SpiCnt = 0u;
+            s_SpiShift = 0u;
+            s_SpiWidth = (Sim_RegIs32(s_SpiAddr) != 0u) ? 4u : 2u;
+            if (tx == SPICMD_SETADDR)
+                s_SpiState = SIM_SPI_ADDR;
+            else if (tx == SPICMD_READREG)
+                s_SpiState = SIM_SPI_RDDUMMY;
+            else if (tx == SPICMD_WRITEREG)
+                s_SpiState = SIM_SPI_WRDATA;
+            else if (tx == SPICMD_READFIFO)
+                s_SpiState = SIM_SPI_FIFODUMMY;
+            else
+                s_SpiState = SIM_SPI_IGNORE;
+            break;
+
+        case SIM_SPI_ADDR:
+            s_SpiShift = (s_SpiShift << 8) | tx;
+            if (++s_SpiCnt == 2u)
+            {
+                s_SpiAddr = (uint16_t)s_SpiShift;
+                s_SpiState = SIM_SPI_IGNORE;
+            }
+            break;
+
+        case SIM_SPI_RDDUMMY:
+            /* 空字节期间取出寄存器值 */
+            s_SpiShift = Sim_ReadReg(s_SpiAddr);
+            s_Stat.RegReads++;
+            s_SpiState = SIM_SPI_RDDATA;
+            break;
+
+        case SIM_SPI_RDDATA:
+            rx = (uint8_t)(s_SpiShift >> (8u * (s_SpiWidth - 1u - s_SpiCnt)));
+            if (++s_SpiCnt == s_SpiWidth)
+                s_SpiState = SIM_SPI_IGNORE;
+            break;
+
+        case SIM_SPI_WRDATA:
+            s_SpiShift = (s_SpiShift << 8) | tx;
+            if (++s_SpiCnt == s_SpiWidth)
+            {
+                Sim_WriteReg(s_SpiAddr, s_SpiShift, 0u);
+                s_Stat.RegWrites++;
+                s_SpiState = SIM_SPI_IGNORE;
+            }
+            break;
+
+        case SIM_SPI_FIFODUMMY:
+            if (++s_SpiCnt == 6u)
+            {
+                s_SpiCnt = 0u;
+                s_SpiState = SIM_SPI_FIFODATA;
+            }
+            break;
+
+        case SIM_SPI_FIFODATA:
+            /* 每个数据字的第一个字节出栈，高字节在前 */
+            if (s_SpiCnt == 0u)
+            {
+                s_SpiShift = Sim_FifoPop();
+                s_Stat.FifoWords++;
+            }
+            rx = (uint8_t)(s_SpiShift >> (8u * (3u - s_SpiCnt)));
+            s_SpiCnt = (uint8_t)((s_SpiCnt + 1u) & 0x03u);
+            break;
+
+        default:
+            break;
+    }
+    return rx;
+}
+
+/*******************************************************************************
+* 仿真控制函数
+*******************************************************************************/
+
+void AD5940Sim_Reset(void)
+{
+    s_Ticks = 0u;
+    s_InReset = 0u;
+    s_McuIntFlag = 0u;
+    s_SpiState = SIM_SPI_IDLE;
+    s_FrameDead = 0u;
+    memset(&s_Stat, 0, sizeof(s_Stat));
+    Sim_ChipReset();
+    s_PowerOn = 1u;
+}
+
+void AD5940Sim_SetSpiClock(uint32_t SclkHz)
+{
+    if (SclkHz == 0u)
+        SclkHz = AD5940_SIM_SCLK_DEFAULT;
+    s_ByteTicks = (uint32_t)(((uint64_t)8u * AD5940_SIM_SYSCLK_HZ + SclkHz / 2u) / SclkHz);
+    if (s_ByteTicks == 0u)
+        s_ByteTicks = 1u;
+}
+
+void AD5940Sim_SetAdcModel(AD5940Sim_AdcFunc pfnAdc)
+{
+    s_pfnAdc = pfnAdc;
+}
+
+void AD5940Sim_SetDftModel(AD5940Sim_DftFunc pfnDft)
+{
+    s_pfnDft = pfnDft;
+}
+
+void AD5940Sim_Run(uint32_t us)
+{
+    Sim_Advance((uint64_t)us * (AD5940_SIM_SYSCLK_HZ / 1000000u));
+}
+
+uint64_t AD5940Sim_GetTicks(void)
+{
+    return s_Ticks;
+}
+
+uint64_t AD5940Sim_GetTimeUs(void)
+{
+    return s_Ticks / (AD5940_SIM_SYSCLK_HZ / 1000000u);
+}
+
+uint32_t AD5940Sim_PeekReg(uint16_t RegAddr)
+{
+    switch (RegAddr)
+    {
+        case REG_AFE_DATAFIFORD:
+            return (s_FifoCnt != 0u) ? s_Fifo[s_FifoRd] : 0u;
+        case REG_AFECON_ADIID:
+        case REG_AFECON_CHIPID:
+        case REG_INTC_INTCFLAG0:
+        case REG_INTC_INTCFLAG1:
+        case REG_AFE_FIFOCNTSTA:
+        case REG_AFE_SEQTIMEOUT:
+            return Sim_ReadReg(RegAddr);
+        default:
+            return SIM_REG(RegAddr);
+    }
+}
+
+void AD5940Sim_PokeReg(uint16_t RegAddr, uint32_t RegData)
+{
+    SIM_REG(RegAddr) = RegData;
+}
+
+uint32_t AD5940Sim_FifoCount(void)
+{
+    return s_FifoCnt;
+}
+
+void AD5940Sim_GetStat(AD5940Sim_Stat_Type *pStat)
+{
+    if (pStat != NULL)
+        *pStat = s_Stat;
+}
+
+void AD5940Sim_ClrStat(void)
+{
+    memset(&s_Stat, 0, sizeof(s_Stat));
+}
+
+/*******************************************************************************
+* SPI后端
+* 仿真只有一种传输模型（按SCLK计时的同步传输），只接受默认后端，
+* 其他后端按未编译进固件处理，避免基准测试输出两份相同的结果
+*******************************************************************************/
+
+int32_t AD5940_SPISetBackend(uint8_t backend)
+{
+    if (backend != AD5940_SPI_BACKEND_DEFAULT)
+        return -1;
+    s_SpiBackend = backend;
+    return 0;
+}
+
+uint8_t AD5940_SPIGetBackend(void)
+{
+    return s_SpiBackend;
+}
+
+uint32_t AD5940_SPIMeasureThroughput(uint32_t length)
+{
+    uint8_t txBuff[AD5940_SPI_MEASURE_MAX];
+    uint8_t rxBuff[AD5940_SPI_MEASURE_MAX];
+    uint64_t start;
+    uint64_t ticks;
+
+    if ((length == 0u) || (length > AD5940_SPI_MEASURE_MAX))
+        return 0;
+
+    memset(txBuff, 0, length);
+    Sim_CsHigh();
+    start = s_Ticks;
+    (void)AD5940_ReadWriteNBytes(txBuff, rxBuff, length);
+    ticks = s_Ticks - start;
+
+    if (ticks == 0u)
+        ticks = 1u;
+    return (uint32_t)(((uint64_t)length * AD5940_SIM_SYSCLK_HZ) / ticks);
+}
+
+uint32_t AD5940_SPIGetByteCount(void)
+{
+    return s_SpiByteTotal;
+}
+
+/*******************************************************************************
+* 非易失存储：RAM数组，不随AD5940Sim_Reset()清除
+*******************************************************************************/
+
+#if (AD5940_NVM_SIZE != 0u)
+
+static uint8_t s_Nvm[AD5940_NVM_SIZE];
+
+const uint8_t *AD5940_NvmBase(void)
+{
+    return s_Nvm;
+}
+
+int32_t AD5940_NvmWrite(uint32_t Offset, const void *pData, uint32_t Len)
+{
+    if ((Offset > AD5940_NVM_SIZE) || (Len > AD5940_NVM_SIZE - Offset))
+        return -1;
+    memcpy(&s_Nvm[Offset], pData, Len);
+    s_Stat.NvmWrites++;
+    return 0;
+}
+
+void AD5940Sim_NvmErase(void)
+{
+    memset(s_Nvm, 0, sizeof(s_Nvm));
+}
+
+#endif /* AD5940_NVM_SIZE */
+
+/*******************************************************************************
+* 周期计数器：仿真时钟周期
+*******************************************************************************/
+
+void AD5940_CycleCounterStart(void)
+{
+}
+
+void AD5940_CycleCounterStop(void)
+{
+}
+
+uint32_t AD5940_CycleCount(void)
+{
+    return (uint32_t)s_Ticks;
+}
+
+uint32_t AD5940_CycleHz(void)
+{
+    return AD5940_SIM_SYSCLK_HZ;
+}
+
+/*******************************************************************************
+* 核心SPI通信函数
+*******************************************************************************/
+
+int32_t AD5940_ReadWriteNBytes(uint8_t *pSendBuffer, uint8_t *pRecvBuff, uint32_t length)
+{
+    uint32_t i;
+
+    if (!pSendBuffer || !pRecvBuff || length == 0)
+        return -1;
+
+    for (i = 0; i < length; i++)
+    {
+        pRecvBuff[i] = Sim_SpiByte(pSendBuffer[i]);
+        Sim_Advance(s_ByteTicks);
+    }
+    s_Stat.SpiBytes += length;
+    s_SpiByteTotal += length;
+    s_Stat.BusTicks += (uint64_t)length * s_ByteTicks;
+
+    return 0;
+}
+
+/*******************************************************************************
+* SPI异步传输引擎（仿真中所有传输在提交时同步执行）
+*******************************************************************************/
+
+static AD5940_SPIXfer_Type *s_pXferHead = NULL;
+static AD5940_SPIXfer_Type *s_pXferTail = NULL;
+static void (*s_pfnIdle)(void) = NULL;
+
+static void SPI_XferFinish(void);
+
+/**
+ * @brief 同步执行一帧
+ */
+static void SyncSPI_Frame(const AD5940_SPIFrame_Type *pFrame)
+{
+    uint8_t fillBuff[16];
+    uint8_t sinkBuff[16];
+    const uint8_t *pTx = pFrame->pTx;
+    uint8_t *pRx = pFrame->pRx;
+    uint32_t len = pFrame->Length;
+    uint32_t chunk;
+
+    memset(fillBuff, pFrame->TxFill, sizeof(fillBuff));
+
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_ASSERT) != 0u)
+        Sim_CsLow();
+
+    while (len != 0u)
+    {
+        chunk = (len > sizeof(fillBuff)) ? sizeof(fillBuff) : len;
+        AD5940_ReadWriteNBytes((pTx != NULL) ? (uint8_t *)pTx : fillBuff, (pRx != NULL) ? pRx : sinkBuff, chunk);
+        if (pTx != NULL)
+            pTx += chunk;
+        if (pRx != NULL)
+            pRx += chunk;
+        len -= chunk;
+    }
+
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceFrame(pFrame, 0u);
+#endif
+    if ((pFrame->CsCtrl & AD5940_FRAME_CS_RELEASE) != 0u)
+        Sim_CsHigh();
+}
+
+static void SPI_XferStart(void)
+{
+    AD5940_SPIXfer_Type *pXfer = s_pXferHead;
+    uint32_t i;
+
+    if (pXfer == NULL)
+        return;
+    pXfer->State = AD5940_XFER_ACTIVE;
+    for (i = 0; i < pXfer->FrameCount; i++)
+        SyncSPI_Frame(&pXfer->pFrames[i]);
+    SPI_XferFinish();
+}
+
+static void SPI_XferFinish(void)
+{
+    AD5940_SPIXfer_Type *pXfer = s_pXferHead;
+
+    s_pXferHead = pXfer->pNext;
+    if (s_pXferHead == NULL)
+        s_pXferTail = NULL;
+    pXfer->pNext = NULL;
+    pXfer->State = AD5940_XFER_DONE;
+
+    if (pXfer->pfnDone != NULL)
+        pXfer->pfnDone(pXfer);
+
+    if ((s_pXferHead != NULL) && (s_pXferHead->State == AD5940_XFER_QUEUED))
+        SPI_XferStart();
+}
+
+int32_t AD5940_SPISubmit(AD5940_SPIXfer_Type *pXfer)
+{
+    uint32_t i;
+
+    if ((pXfer == NULL) || (pXfer->pFrames == NULL) || (pXfer->FrameCount == 0u))
+        return -1;
+    if ((pXfer->State == AD5940_XFER_QUEUED) || (pXfer->State == AD5940_XFER_ACTIVE))
+        return -1;
+    for (i = 0; i < pXfer->FrameCount; i++)
+    {
+        if (pXfer->pFrames[i].Length == 0u)
+            return -1;
+    }
+
+    pXfer->pNext = NULL;
+    pXfer->State = AD5940_XFER_QUEUED;
+    if (s_pXferTail != NULL)
+    {
+        /* 在回调中提交：排在当前传输之后 */
+        s_pXferTail->pNext = pXfer;
+        s_pXferTail = pXfer;
+        return 0;
+    }
+    s_pXferHead = pXfer;
+    s_pXferTail = pXfer;
+    SPI_XferStart();
+
+    return 0;
+}
+
+void AD5940_SPIWait(AD5940_SPIXfer_Type *pXfer)
+{
+    if ((pXfer == NULL) || (pXfer->State == AD5940_XFER_IDLE))
+        return;
+    while (pXfer->State != AD5940_XFER_DONE)
+    {
+        if (s_pfnIdle != NULL)
+            s_pfnIdle();
+    }
+}
+
+uint8_t AD5940_SPIIsIdle(void)
+{
+    return (s_pXferHead == NULL) ? 1u : 0u;
+}
+
+int32_t AD5940_SPITransfer(const AD5940_SPIFrame_Type *pFrames, uint32_t FrameCount)
+{
+    AD5940_SPIXfer_Type xfer;
+
+    xfer.pFrames = pFrames;
+    xfer.FrameCount = FrameCount;
+    xfer.pfnDone = NULL;
+    xfer.pUser = NULL;
+    xfer.State = AD5940_XFER_IDLE;
+    xfer.pNext = NULL;
+
+    if (AD5940_SPISubmit(&xfer) != 0)
+        return -1;
+    AD5940_SPIWait(&xfer);
+
+    return 0;
+}
+
+/*******************************************************************************
+* SPI突发读
+*******************************************************************************/
+
+static AD5940_SPIFrame_Type s_BurstFrames[2];
+static AD5940_SPIXfer_Type s_BurstXfer;
+static AD5940_SPIBurstDoneFunc s_pfnBurstDone = NULL;
+
+static void SPI_BurstDone(AD5940_SPIXfer_Type *pXfer)
+{
+    (void)pXfer;
+    if (s_pfnBurstDone != NULL)
+        s_pfnBurstDone();
+}
+
+int32_t AD5940_SPIBurstRead(uint8_t *pSeg0, uint32_t Len0,
+                            uint8_t *pSeg1, uint32_t Len1,
+                            uint8_t TxFill, AD5940_SPIBurstDoneFunc pfnDone)
+{
+    if (!pSeg0 || Len0 == 0 || (Len1 != 0 && !pSeg1))
+        return -1;
+    if ((Len0 > 0xFFFFu) || (Len1 > 0xFFFFu))
+        return -1;
+    if (AD5940_SPIBurstBusy())
+        return -1;
+
+    s_BurstFrames[0].pTx = NULL;
+    s_BurstFrames[0].pRx = pSeg0;
+    s_BurstFrames[0].Length = (uint16_t)Len0;
+    s_BurstFrames[0].TxFill = TxFill;
+    s_BurstFrames[0].CsCtrl = 0u;
+    s_BurstFrames[1] = s_BurstFrames[0];
+    s_BurstFrames[1].pRx = pSeg1;
+    s_BurstFrames[1].Length = (uint16_t)Len1;
+
+    s_pfnBurstDone = pfnDone;
+    s_BurstXfer.pFrames = s_BurstFrames;
+    s_BurstXfer.FrameCount = (Len1 != 0u) ? 2u : 1u;
+    s_BurstXfer.pfnDone = SPI_BurstDone;
+    s_BurstXfer.pUser = NULL;
+    return AD5940_SPISubmit(&s_BurstXfer);
+}
+
+uint8_t AD5940_SPIBurstBusy(void)
+{
+    return ((s_BurstXfer.State == AD5940_XFER_QUEUED) || (s_BurstXfer.State == AD5940_XFER_ACTIVE)) ? 1u : 0u;
+}
+
+void AD5940_SPIBurstWait(void)
+{
+    AD5940_SPIWait(&s_BurstXfer);
+}
+
+void AD5940_SPISetIdleHook(void (*pfnIdle)(void))
+{
+    s_pfnIdle = pfnIdle;
+}
+
+/*******************************************************************************
+* GPIO控制函数
+*******************************************************************************/
+
+/**
+ * @brief CS下降沿：开始新的一帧；芯片休眠时只唤醒，本帧数据丢弃
+ */
+static void Sim_CsLow(void)
+{
+    if (s_PowerOn == 0u)
+        AD5940Sim_Reset();
+    Sim_Advance(SIM_CS_TICKS);
+    if (s_InReset != 0u)
+        return;
+    s_SpiState = SIM_SPI_CMD;
+    s_FrameDead = 0u;
+    s_Stat.CsFrames++;
+    if (s_Hibernate != 0u)
+    {
+        s_Hibernate = 0u;
+        s_FrameDead = 1u;
+        s_Stat.Wakeups++;
+    }
+}
+
+static void Sim_CsHigh(void)
+{
+    Sim_Advance(SIM_CS_TICKS);
+    s_SpiState = SIM_SPI_IDLE;
+    s_FrameDead = 0u;
+}
+
+void AD5940_CsClr(void)
+{
+    Sim_CsLow();
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceCs(AD5940_TRACE_CS_ASSERT);
+#endif
+}
+
+void AD5940_CsSet(void)
+{
+    Sim_CsHigh();
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceCs(AD5940_TRACE_CS_RELEASE);
+#endif
+}
+
+/**
+ * @brief 释放复位：芯片从复位状态开始运行
+ */
+void AD5940_RstSet(void)
+{
+    if (s_InReset != 0u)
+    {
+        s_InReset = 0u;
+        Sim_ChipReset();
+    }
+}
+
+void AD5940_RstClr(void)
+{
+    s_InReset = 1u;
+    s_SpiState = SIM_SPI_IDLE;
+}
+
+/*******************************************************************************
+* 延时和中断函数
+*******************************************************************************/
+
+void AD5940_Delay10us(uint32_t time)
+{
+    Sim_Advance((uint64_t)time * (AD5940_SIM_SYSCLK_HZ / 100000u));
+}
+
+/**
+ * @brief 获取MCU中断标志
+ *
+ * 标志为0时推进仿真时间，相当于MCU在主循环中等待：
+ * 序列器或ADC在运行时推进SIM_POLL_TICKS，否则直接跳到下一次唤醒定时器触发。
+ */
+uint32_t AD5940_GetMCUIntFlag(void)
+{
+    uint64_t ticks;
+
+    if (s_McuIntFlag == 0u)
+    {
+        ticks = Sim_WuptRemain();
+        if ((ticks == 0u) || (s_SeqRun != 0u) || (Sim_AdcActive() != 0u))
+            ticks = SIM_POLL_TICKS;
+        Sim_Advance(ticks);
+    }
+    return s_McuIntFlag;
+}
+
+uint32_t AD5940_ClrMCUIntFlag(void)
+{
+    s_McuIntFlag = 0u;
+    return 1;
+}
+
+/*******************************************************************************
+* 初始化函数
+*******************************************************************************/
+
+int32_t AD5940_MCUResourceInit(void *pCfg)
+{
+    (void)pCfg;
+    if (s_PowerOn == 0u)
+        AD5940Sim_Reset();
+    Sim_CsHigh();
+    AD5940_RstSet();
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceSetClock(AD5940_CycleCount, AD5940_CycleHz());
+#endif
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,151 @@
+/*******************************************************************************
+* File Name: ad5940_sim.h
+*
+* Description:
+*   AD5940主机端仿真器接口
+*   ad5940_sim.c在PC上实现ad5941_platform.h中的平台函数，并模拟AD5940的
+*   SPI协议、寄存器、数据FIFO、序列器SRAM、中断控制器和唤醒定时器，
+*   使ad5940.c、Amperometric.c、Impedance.c不经修改即可在PC上运行。
+*
+* 编译示例（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost host/ad5940_sim.c ad5940.c Amperometric.c \
+*       Impedance.c ad5941_seqcache.c ad5941_seqalloc.c your_main.c -lm
+*   ad5941_platform.c与main.c依赖PSoC组件，不参与主机编译。
+*   定义AD5940_SPI_TRACE_ENABLE=1u时同时编译ad5941_spitrace.c，
+*   跟踪时间戳为仿真时钟周期。
+*   AD5940_CycleCount()返回仿真时钟周期，基准测试见host/bench_main.c。
+*
+* 时间模型：
+*   仿真时间以AD5940系统时钟(16MHz)周期为单位。SPI字节、CS切换、
+*   AD5940_Delay10us()以及AD5940_GetMCUIntFlag()的空闲轮询推进仿真时间，
+*   序列器、ADC滤波器和唤醒定时器随时间推进运行。
+*
+* 模型范围：
+*   - ADC按800kHz/1.6MHz原始采样率、SINC3/SINC2过采样率产生数据，
+*     首个输出的延迟与AD5940_ClksCalculate()的计算一致；数值由回调提供
+*   - DFT按DFTCON的点数和输入源输出结果；统计模块、ECC不模拟
+*   - 序列器执行SEQ_WR/SEQ_WAIT/SEQ_TOUT，SEQCRC按CRC-8(x^8+x^2+x+1)
+*     对每条命令高字节在前累加
+*   - 命令FIFO模式(CMDDATACON.CMDMEMMDE=FIFO)：CMDFIFOWRITE写入FIFO，
+*     触发后序列器依次取出执行，FIFO空时等待新命令；没有命令FIFO阈值
+*     寄存器，只产生CMDFIFOEMPTY/CMDFIFOFULL/CMDFIFOOF
+*   - INTCFLAG0/1不受INTCSELx屏蔽，INTCSEL0只控制INT0引脚
+*   - 休眠后第一次CS下降沿只唤醒芯片，该帧数据被丢弃
+*   - 模拟电路(LPDAC、TIA、开关矩阵)不模拟，寄存器只做存储
+*   - 非易失存储(AD5940_NvmWrite)为RAM数组，仿真器复位后保留
+*   - SPI时钟校准(AD5940_SPICalibrate等)不提供，仿真SPI时钟由
+*     AD5940Sim_SetSpiClock()设置
+*
+********************************************************************************/
+
+#ifndef AD5940_SIM_H
+#define AD5940_SIM_H
+
+#include <stdint.h>
+
+/*******************************************************************************
+* 常量
+*******************************************************************************/
+
+#define AD5940_SIM_SYSCLK_HZ        (16000000u)     /* 仿真时钟频率 */
+#define AD5940_SIM_SCLK_DEFAULT     (4000000u)      /* 默认SPI时钟 */
+#define AD5940_SIM_CHIPID           (0x5502u)       /* 仿真芯片的CHIPID */
+
+/*******************************************************************************
+* 类型定义
+*******************************************************************************/
+
+/**
+ * @brief ADC数值模型：返回一次SINC3/SINC2输出的16位ADC码
+ * @param AdcCon: 当前REG_AFE_ADCCON（MUX和PGA选择）
+ * @param Ticks: 当前仿真时间
+ */
+typedef uint16_t (*AD5940Sim_AdcFunc)(uint32_t AdcCon, uint64_t Ticks);
+
+/**
+ * @brief DFT数值模型：给出一次DFT结果（18位补码范围内）
+ * @param AdcCon: 当前REG_AFE_ADCCON
+ * @param DftNum: DFT点数
+ */
+typedef void (*AD5940Sim_DftFunc)(uint32_t AdcCon, uint32_t DftNum,
+                                  int32_t *pReal, int32_t *pImag);
+
+/* 仿真统计 */
+typedef struct
+{
+    uint32_t CsFrames;          /* CS低电平帧数 */
+    uint32_t SpiBytes;          /* SPI字节数（含CS为高时的字节） */
+    uint32_t RegReads;          /* 经SPI读寄存器次数 */
+    uint32_t RegWrites;         /* 经SPI写寄存器次数 */
+    uint32_t FifoWords;         /* 经SPI读出的FIFO字数 */
+    uint32_t SeqRuns;           /* 序列执行次数 */
+    uint32_t SeqCmds;           /* 序列器执行的命令数 */
+    uint32_t CmdFifoStalls;     /* 命令FIFO模式下FIFO空、序列器等待的次数 */
+    uint32_t FifoOverflows;     /* FIFO模式下满时被丢弃的数据 */
+    uint32_t Wakeups;           /* 被CS唤醒的次数 */
+    uint32_t NvmWrites;         /* AD5940_NvmWrite()调用次数 */
+    uint64_t BusTicks;          /* SPI总线占用时间（时钟周期） */
+} AD5940Sim_Stat_Type;
+
+/*******************************************************************************
+* 仿真控制函数
+*******************************************************************************/
+
+/**
+ * @brief 上电复位：寄存器回到默认值，清空FIFO/SRAM/统计，仿真时间归零
+ *
+ * AD5940_MCUResourceInit()第一次调用时自动执行。
+ */
+void AD5940Sim_Reset(void);
+
+/**
+ * @brief 设置仿真SPI时钟
+ * @param SclkHz: SCLK频率(Hz)，0表示使用AD5940_SIM_SCLK_DEFAULT
+ */
+void AD5940Sim_SetSpiClock(uint32_t SclkHz);
+
+/**
+ * @brief 设置数值模型，NULL恢复默认模型（固定值）
+ */
+void AD5940Sim_SetAdcModel(AD5940Sim_AdcFunc pfnAdc);
+void AD5940Sim_SetDftModel(AD5940Sim_DftFunc pfnDft);
+
+/**
+ * @brief 推进仿真时间
+ * @param us: 微秒数
+ */
+void AD5940Sim_Run(uint32_t us);
+
+/**
+ * @brief 读取仿真时间
+ */
+uint64_t AD5940Sim_GetTicks(void);
+uint64_t AD5940Sim_GetTimeUs(void);
+
+/**
+ * @brief 不经SPI直接读写寄存器，无副作用（不出栈FIFO、不触发序列）
+ */
+uint32_t AD5940Sim_PeekReg(uint16_t RegAddr);
+void AD5940Sim_PokeReg(uint16_t RegAddr, uint32_t RegData);
+
+/**
+ * @brief 读取数据FIFO中的字数
+ */
+uint32_t AD5940Sim_FifoCount(void);
+
+/**
+ * @brief 读取/清除统计
+ */
+void AD5940Sim_GetStat(AD5940Sim_Stat_Type *pStat);
+void AD5940Sim_ClrStat(void);
+
+/**
+ * @brief 清空非易失存储(AD5940_NvmBase)，模拟首次烧录后的MCU Flash
+ *
+ * 存储区不随AD5940Sim_Reset()清除，复位后再次初始化可验证序列缓存命中。
+ */
+void AD5940Sim_NvmErase(void);
+
+#endif /* AD5940_SIM_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+* File Name: ampconv_bench.c
+*
+* Description:
+*   电流换算基准测试（主机端）
+*   比较ADC码到电流的三种换算，输出每个样本的时间：
+*     ref    - 改动前的AppAMPCalcCurrent：每个样本按PGA增益switch、浮点乘除、
+*              除以RTIA校准值（本文件中保留的副本）
+*     float  - 现在的AppAMPCalcCurrent：缓存的比例系数，每个样本一次浮点乘法
+*     batch  - AppAMPCalcCurrentBatch：整块整数乘法移位，输出pA
+*   同时给出batch相对float的最大误差。主机有硬件浮点，比例小于Cortex-M0
+*   软件浮点上的差别，只用于比较改动前后；给出CPU频率时按频率换算周期数。
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost host/ampconv_bench.c host/ad5940_sim.c ad5940.c \
+*       Amperometric.c ad5941_seqcache.c ad5941_seqalloc.c -lm -o ampconv_bench
+*
+* 用法：
+*   ampconv_bench [重复次数] [CPU_MHz]
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "ad5940.h"
+#include "Amperometric.h"
+
+#define BENCH_REPS_DEFAULT      (2000u)
+#define BENCH_BLOCK             (1024u)     /* 一次处理的样本数，约为FIFO半满 */
+
+static uint32_t s_Code[BENCH_BLOCK];
+static float s_Float[BENCH_BLOCK];
+static int32_t s_Fixed[BENCH_BLOCK];
+volatile double g_BenchSink;        /* 使结果被使用，避免循环被优化掉 */
+
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* 改动前的换算，逐样本调用 */
+static __attribute__((noinline)) float Ref_CalcCurrent(const AppAMPCfg_Type *pCfg, uint32_t ADCcode)
+{
+    float kFactor = 1.835 / 1.82;
+    float fVolt = 0.0;
+    int32_t tmp = ADCcode - 32768;
+
+    switch (pCfg->ADCPgaGain)
+    {
+        case ADCPGA_1:
+            fVolt = ((float)(tmp) / 32768) * (pCfg->ADCRefVolt / 1) * kFactor;
+            break;
+        case ADCPGA_1P5:
+            fVolt = ((float)(tmp) / 32768) * (pCfg->ADCRefVolt / 1.5f) * kFactor;
+            break;
+        case ADCPGA_2:
+            fVolt = ((float)(tmp) / 32768) * (pCfg->ADCRefVolt / 2) * kFactor;
+            break;
+        case ADCPGA_4:
+            fVolt = ((float)(tmp) / 32768) * (pCfg->ADCRefVolt / 4) * kFactor;
+            break;
+        case ADCPGA_9:
+            fVolt = ((float)(tmp) / 32768) * (pCfg->ADCRefVolt / 9) * kFactor;
+            break;
+    }
+    return -(fVolt / pCfg->RtiaCalValue.Magnitude) * 1000000;
+}
+
+static void Bench_Print(const char *pName, uint64_t ns, uint32_t reps, float mhz)
+{
+    double perSample = (double)ns / ((double)reps * BENCH_BLOCK);
+    double sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_BLOCK; i++)
+        sum += s_Float[i] + s_Fixed[i];
+    g_BenchSink = sum;
+    if (mhz > 0)
+        printf("%-6s %10.2f %12.1f\n", pName, perSample, perSample * mhz / 1000.0);
+    else
+        printf("%-6s %10.2f\n", pName, perSample);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t reps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_REPS_DEFAULT;
+    float mhz = (argc > 2) ? strtof(argv[2], NULL) : 0;
+    AppAMPCfg_Type *pCfg;
+    uint64_t ns;
+    double err;
+    double maxErr = 0;
+    uint32_t r;
+    uint32_t i;
+
+    if (reps == 0u)
+        reps = 1u;
+
+    /* 与main.c相同的配置：PGA 1.5，1.82V参考，10k RTIA；数据高16位为FIFO标记 */
+    AppAMPGetCfg(&pCfg);
+    pCfg->ADCPgaGain = ADCPGA_1P5;
+    pCfg->ADCRefVolt = 1.82f;
+    pCfg->RtiaCalValue.Magnitude = 10000.0f;
+    srand(1);
+    for (i = 0; i < BENCH_BLOCK; i++)
+        s_Code[i] = 0x00280000u | (uint32_t)(32768 - 2000 + rand() % 4000);
+
+    printf("conv     ns/sample%s\n", (mhz > 0) ? "  cycles/sample" : "");
+
+    ns = NowNs();
+    for (r = 0; r < reps; r++)
+    {
+        for (i = 0; i < BENCH_BLOCK; i++)
+            s_Float[i] = Ref_CalcCurrent(pCfg, s_Code[i] & 0xffff);
+        __asm__ volatile("" ::: "memory");
+    }
+    Bench_Print("ref", NowNs() - ns, reps, mhz);
+
+    ns = NowNs();
+    for (r = 0; r < reps; r++)
+    {
+        for (i = 0; i < BENCH_BLOCK; i++)
+            s_Float[i] = AppAMPCalcCurrent(s_Code[i] & 0xffff);
+        __asm__ volatile("" ::: "memory");
+    }
+    Bench_Print("float", NowNs() - ns, reps, mhz);
+
+    ns = NowNs();
+    for (r = 0; r < reps; r++)
+    {
+        AppAMPCalcCurrentBatch(s_Code, s_Fixed, BENCH_BLOCK);
+        __asm__ volatile("" ::: "memory");
+    }
+    Bench_Print("batch", NowNs() - ns, reps, mhz);
+
+    for (i = 0; i < BENCH_BLOCK; i++)
+    {
+        err = fabs(s_Fixed[i] - (double)Ref_CalcCurrent(pCfg, s_Code[i] & 0xffff) * 1e6);
+        if (err > maxErr)
+            maxErr = err;
+    }
+    printf("batch max error %.2f pA\n", maxErr);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,46 @@
+/*******************************************************************************
+* File Name: bench_main.c
+*
+* Description:
+*   SPI访问基准测试（主机端）
+*   在ad5940_sim仿真总线上运行ad5941_bench.c，时间为仿真时钟周期，
+*   可比较驱动层改动在不同SPI时钟下的总线开销。
+*   仿真只模拟一种SPI传输，只运行默认后端；结果中的后端名不代表
+*   目标板上该后端的实际性能。
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost -DAD5940_BENCH_ENABLE=1u host/bench_main.c \
+*       host/ad5940_sim.c ad5941_bench.c ad5940.c -lm -o spi_bench
+*
+* 用法：
+*   spi_bench [SCLK_Hz]
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5941_bench.h"
+#include "ad5940_sim.h"
+
+int main(int argc, char *argv[])
+{
+    uint32_t sclk = AD5940_SIM_SCLK_DEFAULT;
+    
+    AD5940Sim_Reset();
+    if (argc > 1)
+        sclk = (uint32_t)strtoul(argv[1], NULL, 0);
+    if (sclk == 0u)
+        sclk = AD5940_SIM_SCLK_DEFAULT;
+    AD5940Sim_SetSpiClock(sclk);
+    AD5940_MCUResourceInit(NULL);
+    AD5940_Initialize();
+
+    printf("[BENCH] simulated SPI transport (ad5940_sim), SCLK %lu Hz\n", (unsigned long)sclk);
+    /* 仿真中传输同步完成，不会调用空闲钩子 */
+    AD5940_BenchRun(NULL, printf);
+    return 0;
+}
+
+/* [] END OF FILE */
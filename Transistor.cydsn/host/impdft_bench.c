@@ -0,0 +1,255 @@
+/*******************************************************************************
+* File Name: impdft_bench.c
+*
+* Description:
+*   阻抗结果换算基准测试（主机端）
+*   对同一组DFT数据（每个频点4个FIFO字：RCAL实部、虚部，Rz实部、虚部）
+*   运行两种换算，输出每个频点的时间和相对双精度精确值的误差：
+*     ref    - 改动前的AppIMPDataProcess：每对结果两次sqrt、两次atan2和
+*              一次浮点除法（本文件中保留的副本）
+*     cordic - 现在的AppIMPDataProcess：整数CORDIC求模和相位，定点求比值
+*   误差给出|Z|的最大相对误差和相位的最大误差（度）。主机有硬件浮点，
+*   时间只用于比较改动前后，Cortex-M0上软件浮点的差别更大。
+*
+*   数据来源：
+*     给出文件时读取记录的FIFO数据，十六进制，空白分隔，每4个字一个频点
+*     （AD5940_FIFORd读出的原始字，高位的标记位由换算函数去掉）；
+*     不给文件时生成RCAL 10k下1Ω~10MΩ、-90°~+90°的随机负载。
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost host/impdft_bench.c host/ad5940_sim.c ad5940.c \
+*       Impedance.c ad5941_seqcache.c ad5941_seqalloc.c -lm -o impdft_bench
+*
+* 用法：
+*   impdft_bench [-n 重复次数] [FIFO数据文件]
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ad5940.h"
+#include "Impedance.h"
+
+#define BENCH_REPS_DEFAULT      (200u)
+#define BENCH_POINTS_MAX        (4096u)     /* 最多频点数 */
+#define BENCH_POINTS_GEN        (2048u)     /* 生成的频点数 */
+#define BENCH_RCAL              (10000.0)
+
+/* Impedance.c中的换算函数，未在头文件中声明 */
+int32_t AppIMPDataProcess(int32_t * const pData, uint32_t *pDataCount);
+
+static uint32_t s_Fifo[BENCH_POINTS_MAX * 4u];
+static int32_t s_Work[BENCH_POINTS_MAX * 4u];
+static fImpPol_Type s_Ref[BENCH_POINTS_MAX];
+static fImpPol_Type s_New[BENCH_POINTS_MAX];
+volatile float g_BenchSink;                 /* 使结果被使用，避免循环被优化掉 */
+
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int32_t SignExtend18(uint32_t Word)
+{
+    Word &= 0x3ffffu;
+    return (Word & (1u << 17)) ? (int32_t)(Word | 0xfffc0000u) : (int32_t)Word;
+}
+
+/* 改动前的换算 */
+static void Ref_DataProcess(int32_t * const pData, uint32_t DataCount, float RcalVal)
+{
+    uint32_t ImpResCount = DataCount / 4;
+    fImpPol_Type * const pOut = (fImpPol_Type *)pData;
+    iImpCar_Type *pSrcData = (iImpCar_Type *)pData;
+    uint32_t i;
+
+    for (i = 0; i < ImpResCount * 4; i++)
+        pData[i] = SignExtend18((uint32_t)pData[i]);
+    for (i = 0; i < ImpResCount; i++)
+    {
+        iImpCar_Type *pDftRcal = pSrcData++;
+        iImpCar_Type *pDftRz = pSrcData++;
+        float RzMag, RzPhase;
+        float RcalMag, RcalPhase;
+
+        RcalMag = sqrt((float)pDftRcal->Real * pDftRcal->Real + (float)pDftRcal->Image * pDftRcal->Image);
+        RcalPhase = atan2(-pDftRcal->Image, pDftRcal->Real);
+        RzMag = sqrt((float)pDftRz->Real * pDftRz->Real + (float)pDftRz->Image * pDftRz->Image);
+        RzPhase = atan2(-pDftRz->Image, pDftRz->Real);
+        pOut[i].Magnitude = RcalMag / RzMag * RcalVal;
+        pOut[i].Phase = RcalPhase - RzPhase;
+    }
+}
+
+/* 双精度精确值 */
+static void Exact_Point(const uint32_t *pWord, double *pMag, double *pPhase)
+{
+    double rr = SignExtend18(pWord[0]), ri = SignExtend18(pWord[1]);
+    double zr = SignExtend18(pWord[2]), zi = SignExtend18(pWord[3]);
+
+    *pMag = hypot(rr, ri) / hypot(zr, zi) * BENCH_RCAL;
+    *pPhase = atan2(-ri, rr) - atan2(-zi, zr);
+}
+
+static uint32_t Bench_Load(const char *pPath)
+{
+    FILE *fp = fopen(pPath, "r");
+    unsigned long word;
+    uint32_t n = 0;
+
+    if (fp == NULL)
+    {
+        perror(pPath);
+        return 0;
+    }
+    while ((n < BENCH_POINTS_MAX * 4u) && (fscanf(fp, "%lx", &word) == 1))
+        s_Fifo[n++] = (uint32_t)word;
+    fclose(fp);
+    return n / 4u;
+}
+
+static uint32_t Bench_Encode(double Value)
+{
+    return ((uint32_t)(int32_t)lround(Value) & 0x3ffffu) | ((uint32_t)(rand() & 0x3f) << 25);
+}
+
+/* RCAL和Rz的DFT结果之比为|Z|/RCAL；较大的一个取满量程的1/8~1 */
+static uint32_t Bench_Generate(void)
+{
+    double mag, phase, theta, big, aRcal, aRz;
+    uint32_t i;
+
+    srand(1);
+    for (i = 0; i < BENCH_POINTS_GEN; i++)
+    {
+        mag = pow(10.0, 7.0 * rand() / RAND_MAX);
+        phase = (rand() / (double)RAND_MAX - 0.5) * M_PI;
+        theta = (rand() / (double)RAND_MAX - 0.5) * 2.0 * M_PI;
+        big = 131071.0 * (0.125 + 0.875 * rand() / RAND_MAX);
+        aRcal = (mag > BENCH_RCAL) ? big : big * mag / BENCH_RCAL;
+        aRz = (mag > BENCH_RCAL) ? big * BENCH_RCAL / mag : big;
+        /* 相位为atan2(-Image, Real) */
+        s_Fifo[i * 4u + 0u] = Bench_Encode(aRcal * cos(theta));
+        s_Fifo[i * 4u + 1u] = Bench_Encode(-aRcal * sin(theta));
+        s_Fifo[i * 4u + 2u] = Bench_Encode(aRz * cos(theta - phase));
+        s_Fifo[i * 4u + 3u] = Bench_Encode(-aRz * sin(theta - phase));
+    }
+    return BENCH_POINTS_GEN;
+}
+
+static double Bench_PhaseErr(double Phase, double Exact)
+{
+    double err = fmod(fabs(Phase - Exact), 2.0 * M_PI);
+
+    return (err > M_PI) ? 2.0 * M_PI - err : err;
+}
+
+static void Bench_Error(const char *pName, const fImpPol_Type *pRes, uint32_t points)
+{
+    double mag, phase, err;
+    double maxMag = 0, maxPhase = 0;
+    uint32_t skip = 0;
+    uint32_t i;
+
+    for (i = 0; i < points; i++)
+    {
+        Exact_Point(&s_Fifo[i * 4u], &mag, &phase);
+        if (!isfinite(mag) || (mag == 0))
+        {
+            skip++;
+            continue;
+        }
+        err = fabs(pRes[i].Magnitude - mag) / mag;
+        if (err > maxMag)
+            maxMag = err;
+        err = Bench_PhaseErr(pRes[i].Phase, phase);
+        if (err > maxPhase)
+            maxPhase = err;
+    }
+    printf("%-7s max |Z| error %.3g, max phase error %.3g deg", pName, maxMag, maxPhase * 180.0 / M_PI);
+    if (skip != 0u)
+        printf(" (%u points with zero DFT skipped)", (unsigned)skip);
+    printf("\n");
+}
+
+static void Bench_Time(const char *pName, int UseNew, uint32_t points, uint32_t reps, fImpPol_Type *pRes)
+{
+    uint32_t count;
+    uint64_t ns;
+    uint64_t copyNs;
+    uint32_t r;
+
+    /* 换算是原地的，每次先复制输入，复制时间单独测出后扣除 */
+    copyNs = NowNs();
+    for (r = 0; r < reps; r++)
+    {
+        memcpy(s_Work, s_Fifo, points * 16u);
+        __asm__ volatile("" ::: "memory");
+    }
+    copyNs = NowNs() - copyNs;
+
+    ns = NowNs();
+    for (r = 0; r < reps; r++)
+    {
+        memcpy(s_Work, s_Fifo, points * 16u);
+        count = points * 4u;
+        if (UseNew != 0)
+            AppIMPDataProcess(s_Work, &count);
+        else
+            Ref_DataProcess(s_Work, count, (float)BENCH_RCAL);
+        __asm__ volatile("" ::: "memory");
+    }
+    ns = NowNs() - ns;
+    ns = (ns > copyNs) ? ns - copyNs : 0;
+
+    memcpy(pRes, s_Work, points * sizeof(fImpPol_Type));
+    g_BenchSink = pRes[points - 1u].Magnitude;
+    printf("%-7s %10.1f ns/point\n", pName, (double)ns / ((double)reps * points));
+}
+
+int main(int argc, char *argv[])
+{
+    AppIMPCfg_Type *pCfg;
+    uint32_t reps = BENCH_REPS_DEFAULT;
+    uint32_t points;
+    const char *pPath = NULL;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            reps = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else
+            pPath = argv[i];
+    }
+    if (reps == 0u)
+        reps = 1u;
+
+    points = (pPath != NULL) ? Bench_Load(pPath) : Bench_Generate();
+    if (points == 0u)
+    {
+        fprintf(stderr, "no data\n");
+        return 2;
+    }
+
+    /* 不扫频，换算不改变频率状态 */
+    AppIMPGetCfg(&pCfg);
+    pCfg->SweepCfg.SweepEn = bFALSE;
+    pCfg->RcalVal = (float)BENCH_RCAL;
+
+    printf("%u points%s%s\n", (unsigned)points, (pPath != NULL) ? " from " : " generated",
+           (pPath != NULL) ? pPath : "");
+    Bench_Time("ref", 0, points, reps, s_Ref);
+    Bench_Time("cordic", 1, points, reps, s_New);
+    Bench_Error("ref", s_Ref, points);
+    Bench_Error("cordic", s_New, points);
+    return 0;
+}
+
+/* [] END OF FILE */
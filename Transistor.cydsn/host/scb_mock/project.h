@@ -0,0 +1,170 @@
+/*******************************************************************************
+* File Name: project.h
+*
+* Description:
+*   PSoC生成头文件的主机端替身，只供host/scbspi_test.c编译ad5941_platform.c
+*   声明ad5941_platform.c在SCB+DMA配置下用到的组件接口：
+*     - SPI_1 SCB组件：收发FIFO、FIFO触发级寄存器
+*     - CyDMA(PSoC4 DMA)：通道分配、描述符配置、完成中断回调
+*     - AD5940_CS/RST引脚、AD5940_Interrupt、SysTick、Flash、延时
+*   常量取自PSoC Creator生成的CyDMA.h/cytypes.h，实现在scbspi_test.c中
+*
+********************************************************************************/
+
+#ifndef SCB_MOCK_PROJECT_H
+#define SCB_MOCK_PROJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* cytypes.h
+*******************************************************************************/
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t  int32;
+typedef uint8_t  cystatus;
+typedef volatile uint32_t reg32;
+
+#define CY_INLINE                   inline
+#define CY_ALIGN(align)             __attribute__ ((aligned(align)))
+#define CY_ISR(FuncName)            void FuncName (void)
+#define CY_ISR_PROTO(FuncName)      void FuncName (void)
+typedef void (*cyisraddress)(void);
+
+#define CYDEV_BCLK__SYSCLK__HZ      (48000000u)
+
+/*******************************************************************************
+* CyLib.h
+*******************************************************************************/
+
+uint8 CyEnterCriticalSection(void);
+void  CyExitCriticalSection(uint8 savedIntrStatus);
+void  CyIntEnable(uint8 number);
+void  CyDelay(uint32 milliseconds);
+void  CyDelayUs(uint16 microseconds);
+
+#define CY_SYS_SYST_NUM_OF_CALLBACKS    (5u)
+typedef void (*cySysTickCallback)(void);
+void  CySysTickStart(void);
+void  CySysTickStop(void);
+uint32 CySysTickGetReload(void);
+uint32 CySysTickGetValue(void);
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function);
+cySysTickCallback CySysTickGetCallback(uint32 number);
+
+/* core_cm0.h中的SCB(系统控制块)，只用到ICSR */
+typedef struct
+{
+    volatile uint32 ICSR;
+} MockScbCore_Type;
+extern MockScbCore_Type MockScbCore;
+#define SCB                         (&MockScbCore)
+#define SCB_ICSR_PENDSTSET_Msk      (1uL << 26)
+
+/*******************************************************************************
+* CyFlash.h
+*******************************************************************************/
+
+#define CY_FLASH_BASE               (0u)
+#define CY_FLASH_SIZEOF_ROW         (128u)
+#define CY_SYS_FLASH_SUCCESS        (0x00u)
+uint32 CySysFlashWriteRow(uint32 rowNum, const uint8 rowData[]);
+
+/*******************************************************************************
+* SPI_1 (SCB SPI主机)
+*******************************************************************************/
+
+#define CY_SCB_SPI_1_H
+
+#define SPI_1_FIFO_SIZE             (8u)
+
+void   SPI_1_Start(void);
+void   SPI_1_Stop(void);
+void   SPI_1_SpiUartWriteTxData(uint32 txData);
+uint32 SPI_1_SpiUartReadRxData(void);
+uint32 SPI_1_SpiUartGetRxBufferSize(void);
+void   SPI_1_SpiUartClearRxBuffer(void);
+
+/* 收发FIFO数据寄存器和控制寄存器，DMA以数据寄存器的地址区分方向 */
+extern reg32 MockScb_TxFifoWr;
+extern reg32 MockScb_RxFifoRd;
+extern reg32 MockScb_TxFifoCtrl;
+extern reg32 MockScb_RxFifoCtrl;
+#define SPI_1_TX_FIFO_WR_PTR        (&MockScb_TxFifoWr)
+#define SPI_1_RX_FIFO_RD_PTR        (&MockScb_RxFifoRd)
+#define SPI_1_TX_FIFO_CTRL_REG      (MockScb_TxFifoCtrl)
+#define SPI_1_RX_FIFO_CTRL_REG      (MockScb_RxFifoCtrl)
+#define SPI_1_TX_FIFO_CTRL_TRIGGER_LEVEL_MASK   ((uint32) 0x07u)
+#define SPI_1_RX_FIFO_CTRL_TRIGGER_LEVEL_MASK   ((uint32) 0x07u)
+
+/*******************************************************************************
+* CyDMA.h (PSoC4)
+*******************************************************************************/
+
+#define CY_DMA_GLOBAL_P4_H
+
+typedef struct
+{
+    uint32 dataElementSize;
+    int32  numDataElements;
+    uint32 srcDstTransferWidth;
+    uint32 addressIncrement;
+    uint32 triggerType;
+    uint32 transferMode;
+    uint32 preemptable;
+    uint32 actions;
+} cydma_init_struct;
+
+typedef void (*cydma_callback_t)(void);
+
+void   CyDmaEnable(void);
+int32  CyDmaChAlloc(void);
+cystatus CyDmaChFree(int32 channel);
+void   CyDmaChEnable(int32 channel);
+void   CyDmaChDisable(int32 channel);
+void   CyDmaSetPriority(int32 channel, int32 priority);
+void   CyDmaSetNextDescriptor(int32 channel, int32 descriptor);
+void   CyDmaSetConfiguration(int32 channel, int32 descriptor, const cydma_init_struct * config);
+void   CyDmaValidateDescriptor(int32 channel, int32 descriptor);
+void   CyDmaSetSrcAddress(int32 channel, int32 descriptor, void * srcAddress);
+void   CyDmaSetDstAddress(int32 channel, int32 descriptor, void * dstAddress);
+void   CyDmaSetInterruptSourceMask(uint32 interruptMask);
+uint32 CyDmaGetInterruptSourceMask(void);
+cydma_callback_t CyDmaSetInterruptCallback(int32 channel, cydma_callback_t callback);
+
+#define CYDMA_INTR_NUMBER               (2u)
+#define CYDMA_INVALID_CHANNEL           (-1)
+#define CYDMA_BYTE                      (0x00000000U)
+#define CYDMA_HALFWORD                  (0x00010000U)
+#define CYDMA_WORD                      (0x00020000U)
+#define CYDMA_ELEMENT_ELEMENT           (0x00000000U)
+#define CYDMA_ELEMENT_WORD              (0x00100000U)
+#define CYDMA_WORD_ELEMENT              (0x00400000U)
+#define CYDMA_WORD_WORD                 (0x00500000U)
+#define CYDMA_INC_SRC_ADDR              (0x00800000U)
+#define CYDMA_INC_DST_ADDR              (0x00200000U)
+#define CYDMA_INC_NONE                  (0x00000000U)
+#define CYDMA_PULSE                     (0x00000000U)
+#define CYDMA_PULSE_UNKNOWN             (0x03000000U)
+#define CYDMA_SINGLE_DATA_ELEMENT       (0x00000000U)
+#define CYDMA_PREEMPTABLE               (0x10000000U)
+#define CYDMA_NONE                      (0x00000000U)
+#define CYDMA_INVALIDATE                (0x04000000U)
+#define CYDMA_GENERATE_IRQ              (0x08000000U)
+
+/*******************************************************************************
+* 引脚和中断组件
+*******************************************************************************/
+
+void   AD5940_CS_Write(uint8 value);
+void   AD5940_RST_Write(uint8 value);
+uint8  AD5940_EXTI_ClearInterrupt(void);
+void   AD5940_Interrupt_StartEx(cyisraddress address);
+void   AD5940_Interrupt_ClearPending(void);
+
+#endif /* SCB_MOCK_PROJECT_H */
+
+/* [] END OF FILE */
@@ -0,0 +1,733 @@
+/*******************************************************************************
+* File Name: scbspi_test.c
+*
+* Description:
+*   SCB硬件SPI和DMA后端回环测试（主机端）
+*   用host/scb_mock/project.h替代PSoC生成头文件编译ad5941_platform.c，
+*   本文件实现SPI_1 SCB组件和PSoC4 DMA的模型：
+*     - SCB：8字节TX/RX硬件FIFO，总线比CPU快（每次查询RX FIFO时把TX FIFO
+*       中的字节全部移出），MISO回送MOSI按位取反；RX FIFO满时再移入即为溢出
+*     - DMA：按描述符逐个搬运数据元素，TX通道在TX FIFO低于触发级时搬运，
+*       RX通道在RX FIFO高于触发级时搬运；RX描述符完成后调用注册的中断回调。
+*       DMA在空闲钩子中运行，相当于CPU等待期间发生的中断
+*   检查项：
+*     1. ScbSPI_ReadWriteNBytes：收发字节顺序，在途字节数不超过FIFO深度
+*     2. 同步路径(DMA未初始化)：pTx为NULL时发送TxFill，pRx为NULL时丢弃
+*     3. DMA路径：pTx为NULL的填充发送，各帧在ScbDma_RxDone中依次推进，
+*        帧之间按CsCtrl翻转CS，整个传输只调用一次完成回调
+*     4. DMA路径：连续提交的两次传输依次执行
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -Ihost/scb_mock -I. host/scbspi_test.c ad5941_platform.c \
+*       ad5940.c -lm -o scbspi_test
+*
+* 用法：
+*   scbspi_test         全部通过时返回0
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "project.h"
+#include "ad5940.h"
+#include "ad5941_platform.h"
+
+#define MOCK_BUS_MAX            (4096u)     /* 记录的总线字节数上限 */
+#define MOCK_DMA_CH_NUM         (2)
+#define MOCK_DMA_DESCR_NUM      (2)
+#define MOCK_STALL_LIMIT        (100000u)   /* 连续无进展的轮询次数，超过即判为死锁 */
+#define MOCK_IRQ_LIMIT          (1000u)     /* 测试中DMA中断总数上限，超过即判为帧不推进 */
+
+static uint32_t s_Fail = 0;
+static uint32_t s_Stall = 0;
+
+#define CHECK(cond, ...)                                        \
+    do {                                                        \
+        if (!(cond))                                            \
+        {                                                       \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__);       \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            s_Fail++;                                           \
+        }                                                       \
+    } while (0)
+
+/* 等待的数据不会再到来(字节丢失或DMA没有触发)，驱动会一直等待，直接结束测试 */
+static void Mock_Stalled(uint8_t Progress, const char *pWhere)
+{
+    if (Progress != 0u)
+    {
+        s_Stall = 0;
+        return;
+    }
+    if (++s_Stall > MOCK_STALL_LIMIT)
+    {
+        printf("  FAIL %s: no progress, driver waits forever\n", pWhere);
+        printf("FAIL\n");
+        exit(1);
+    }
+}
+
+/*******************************************************************************
+* SCB模型
+*******************************************************************************/
+
+reg32 MockScb_TxFifoWr;
+reg32 MockScb_RxFifoRd;
+reg32 MockScb_TxFifoCtrl;
+reg32 MockScb_RxFifoCtrl;
+MockScbCore_Type MockScbCore;
+
+static struct
+{
+    uint8_t Tx[SPI_1_FIFO_SIZE];
+    uint32_t TxCount;
+    uint8_t Rx[SPI_1_FIFO_SIZE];
+    uint32_t RxCount;
+    uint32_t TxOverflow;        /* TX FIFO满时写入 */
+    uint32_t RxOverflow;        /* RX FIFO满时总线又移入一个字节 */
+    uint32_t RxUnderflow;       /* RX FIFO空时读取 */
+    uint32_t Written;           /* 写入TX FIFO的字节数(CPU或DMA) */
+    uint32_t Read;              /* 从RX FIFO读出的字节数(CPU或DMA) */
+    uint32_t MaxInFlight;       /* Written-Read的最大值 */
+    uint8_t Cs;                 /* AD5940_CS引脚电平 */
+    uint8_t Mosi[MOCK_BUS_MAX]; /* 总线上依次移出的字节 */
+    uint8_t MosiCs[MOCK_BUS_MAX];   /* 移出该字节时的CS电平 */
+    uint32_t BusCount;
+    char CsLog[256];            /* CS跳变和字节数，如"L3H" */
+    uint32_t CsLogLen;
+    uint32_t BytesSinceCs;      /* 上次CS跳变以来的总线字节数 */
+} Scb;
+
+static void MockScb_Reset(void)
+{
+    uint8_t cs = Scb.Cs;
+
+    memset(&Scb, 0, sizeof(Scb));
+    Scb.Cs = cs;
+}
+
+static void MockScb_Log(const char *pText)
+{
+    int n = snprintf(&Scb.CsLog[Scb.CsLogLen], sizeof(Scb.CsLog) - Scb.CsLogLen, "%s", pText);
+
+    if (n > 0)
+        Scb.CsLogLen += (uint32_t)n;
+    if (Scb.CsLogLen >= sizeof(Scb.CsLog))
+        Scb.CsLogLen = sizeof(Scb.CsLog) - 1u;
+}
+
+/* 在CS日志中插入上次跳变以来的字节数 */
+static void MockScb_LogBytes(void)
+{
+    char num[16];
+
+    if (Scb.BytesSinceCs != 0u)
+    {
+        snprintf(num, sizeof(num), "%u", (unsigned)Scb.BytesSinceCs);
+        MockScb_Log(num);
+        Scb.BytesSinceCs = 0;
+    }
+}
+
+static void MockScb_TxPush(uint8_t Data)
+{
+    if (Scb.TxCount >= SPI_1_FIFO_SIZE)
+    {
+        Scb.TxOverflow++;
+        return;
+    }
+    Scb.Tx[Scb.TxCount++] = Data;
+    Scb.Written++;
+    if (Scb.Written - Scb.Read > Scb.MaxInFlight)
+        Scb.MaxInFlight = Scb.Written - Scb.Read;
+}
+
+static uint8_t MockScb_RxPop(void)
+{
+    uint8_t data;
+
+    if (Scb.RxCount == 0u)
+    {
+        Scb.RxUnderflow++;
+        return 0;
+    }
+    data = Scb.Rx[0];
+    memmove(&Scb.Rx[0], &Scb.Rx[1], --Scb.RxCount);
+    Scb.Read++;
+    return data;
+}
+
+/* 总线移出一个字节，MISO返回MOSI取反 */
+static uint8_t MockScb_ShiftOne(void)
+{
+    uint8_t mosi;
+
+    if (Scb.TxCount == 0u)
+        return 0u;
+    mosi = Scb.Tx[0];
+    memmove(&Scb.Tx[0], &Scb.Tx[1], --Scb.TxCount);
+    if (Scb.BusCount < MOCK_BUS_MAX)
+    {
+        Scb.Mosi[Scb.BusCount] = mosi;
+        Scb.MosiCs[Scb.BusCount] = Scb.Cs;
+    }
+    Scb.BusCount++;
+    Scb.BytesSinceCs++;
+    if (Scb.RxCount >= SPI_1_FIFO_SIZE)
+        Scb.RxOverflow++;
+    else
+        Scb.Rx[Scb.RxCount++] = (uint8_t)~mosi;
+    return 1u;
+}
+
+void SPI_1_Start(void)
+{
+}
+
+void SPI_1_Stop(void)
+{
+}
+
+void SPI_1_SpiUartWriteTxData(uint32 txData)
+{
+    MockScb_TxPush((uint8_t)txData);
+}
+
+uint32 SPI_1_SpiUartGetRxBufferSize(void)
+{
+    /* 总线比CPU快：查询时TX FIFO中的字节已全部移出 */
+    while (MockScb_ShiftOne() != 0u)
+    {
+    }
+    Mock_Stalled((Scb.RxCount != 0u) ? 1u : 0u, "SPI_1 RX FIFO");
+    return Scb.RxCount;
+}
+
+uint32 SPI_1_SpiUartReadRxData(void)
+{
+    return MockScb_RxPop();
+}
+
+void SPI_1_SpiUartClearRxBuffer(void)
+{
+    Scb.Read += Scb.RxCount;
+    Scb.RxCount = 0;
+}
+
+void AD5940_CS_Write(uint8 value)
+{
+    value = (value != 0u) ? 1u : 0u;
+    if (value == Scb.Cs)
+        return;
+    MockScb_LogBytes();
+    MockScb_Log((value != 0u) ? "H" : "L");
+    Scb.Cs = value;
+}
+
+/*******************************************************************************
+* DMA模型
+*******************************************************************************/
+
+static struct
+{
+    cydma_init_struct Cfg[MOCK_DMA_DESCR_NUM];
+    void *pSrc[MOCK_DMA_DESCR_NUM];
+    void *pDst[MOCK_DMA_DESCR_NUM];
+    uint8_t Valid[MOCK_DMA_DESCR_NUM];
+    int32 Done[MOCK_DMA_DESCR_NUM];     /* 已搬运的元素数 */
+    int32 Next;                         /* 下一个执行的描述符 */
+    uint8_t Allocated;
+    uint8_t Enabled;
+    cydma_callback_t pfnIrq;
+} Dma[MOCK_DMA_CH_NUM];
+
+static uint32 s_DmaIntrMask = 0;
+static uint32_t s_DmaIrqCount = 0;
+static uint32_t s_DmaBadAddr = 0;
+
+static uint8_t MockDma_ChValid(int32 channel)
+{
+    return ((channel >= 0) && (channel < MOCK_DMA_CH_NUM)) ? 1u : 0u;
+}
+
+void CyDmaEnable(void)
+{
+}
+
+int32 CyDmaChAlloc(void)
+{
+    int32 ch;
+
+    for (ch = 0; ch < MOCK_DMA_CH_NUM; ch++)
+    {
+        if (Dma[ch].Allocated == 0u)
+        {
+            Dma[ch].Allocated = 1u;
+            return ch;
+        }
+    }
+    return CYDMA_INVALID_CHANNEL;
+}
+
+cystatus CyDmaChFree(int32 channel)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].Allocated = 0u;
+    return 0u;
+}
+
+void CyDmaChEnable(int32 channel)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].Enabled = 1u;
+}
+
+void CyDmaChDisable(int32 channel)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].Enabled = 0u;
+}
+
+void CyDmaSetPriority(int32 channel, int32 priority)
+{
+    (void)channel;
+    (void)priority;
+}
+
+void CyDmaSetNextDescriptor(int32 channel, int32 descriptor)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].Next = descriptor;
+}
+
+void CyDmaSetConfiguration(int32 channel, int32 descriptor, const cydma_init_struct * config)
+{
+    if (MockDma_ChValid(channel))
+    {
+        Dma[channel].Cfg[descriptor] = *config;
+        Dma[channel].Done[descriptor] = 0;
+    }
+}
+
+void CyDmaValidateDescriptor(int32 channel, int32 descriptor)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].Valid[descriptor] = 1u;
+}
+
+void CyDmaSetSrcAddress(int32 channel, int32 descriptor, void * srcAddress)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].pSrc[descriptor] = srcAddress;
+}
+
+void CyDmaSetDstAddress(int32 channel, int32 descriptor, void * dstAddress)
+{
+    if (MockDma_ChValid(channel))
+        Dma[channel].pDst[descriptor] = dstAddress;
+}
+
+void CyDmaSetInterruptSourceMask(uint32 interruptMask)
+{
+    s_DmaIntrMask = interruptMask;
+}
+
+uint32 CyDmaGetInterruptSourceMask(void)
+{
+    return s_DmaIntrMask;
+}
+
+cydma_callback_t CyDmaSetInterruptCallback(int32 channel, cydma_callback_t callback)
+{
+    cydma_callback_t old = NULL;
+
+    if (MockDma_ChValid(channel))
+    {
+        old = Dma[channel].pfnIrq;
+        Dma[channel].pfnIrq = callback;
+    }
+    return old;
+}
+
+/*
+ * 通道搬运一个元素。触发条件由SCB FIFO状态决定：
+ * TX目的为TX FIFO，FIFO数量低于触发级时搬运；RX源为RX FIFO，数量高于触发级时搬运。
+ * 地址按addressIncrement递增，字宽一侧每个元素4字节，递增后不再是FIFO寄存器即为配置错误。
+ * 返回1表示搬运了，描述符完成时置*pDone
+ */
+static uint8_t MockDma_Step(int32 ch, uint8_t *pDone)
+{
+    int32 d = Dma[ch].Next;
+    cydma_init_struct *pCfg = &Dma[ch].Cfg[d];
+    uint8_t *pSrc = (uint8_t *)Dma[ch].pSrc[d];
+    uint8_t *pDst = (uint8_t *)Dma[ch].pDst[d];
+    int32 i = Dma[ch].Done[d];
+    uint32_t srcStep = ((pCfg->srcDstTransferWidth & CYDMA_WORD_ELEMENT) != 0u) ? 4u : 1u;
+    uint32_t dstStep = ((pCfg->srcDstTransferWidth & CYDMA_ELEMENT_WORD) != 0u) ? 4u : 1u;
+    uint8_t isTx = (pDst == (uint8_t *)SPI_1_TX_FIFO_WR_PTR) ? 1u : 0u;
+    uint8_t isRx = (pSrc == (uint8_t *)SPI_1_RX_FIFO_RD_PTR) ? 1u : 0u;
+
+    *pDone = 0u;
+    if ((Dma[ch].Enabled == 0u) || (Dma[ch].Valid[d] == 0u) || (i >= pCfg->numDataElements))
+        return 0u;
+    /* FIFO寄存器一侧必须按字访问 */
+    if (((isTx == 0u) && (isRx == 0u)) ||
+        ((isTx != 0u) && (dstStep != 4u)) || ((isRx != 0u) && (srcStep != 4u)))
+    {
+        s_DmaBadAddr++;
+        Dma[ch].Enabled = 0u;
+        return 0u;
+    }
+    if ((isTx != 0u) && (Scb.TxCount >= (SPI_1_TX_FIFO_CTRL_REG & SPI_1_TX_FIFO_CTRL_TRIGGER_LEVEL_MASK)))
+        return 0u;
+    if ((isRx != 0u) && (Scb.RxCount <= (SPI_1_RX_FIFO_CTRL_REG & SPI_1_RX_FIFO_CTRL_TRIGGER_LEVEL_MASK)))
+        return 0u;
+
+    if ((pCfg->addressIncrement & CYDMA_INC_SRC_ADDR) != 0u)
+        pSrc += (uint32_t)i * srcStep;
+    if ((pCfg->addressIncrement & CYDMA_INC_DST_ADDR) != 0u)
+        pDst += (uint32_t)i * dstStep;
+    if (((isTx != 0u) && (pDst != (uint8_t *)SPI_1_TX_FIFO_WR_PTR)) ||
+        ((isRx != 0u) && (pSrc != (uint8_t *)SPI_1_RX_FIFO_RD_PTR)))
+    {
+        s_DmaBadAddr++;
+        Dma[ch].Enabled = 0u;
+        return 0u;
+    }
+    if (isTx != 0u)
+        MockScb_TxPush(*pSrc);      /* 字节元素，小端下即源地址处的字节 */
+    else
+        *pDst = MockScb_RxPop();
+
+    Dma[ch].Done[d] = ++i;
+    if (i >= pCfg->numDataElements)
+    {
+        if ((pCfg->actions & CYDMA_INVALIDATE) != 0u)
+            Dma[ch].Valid[d] = 0u;
+        *pDone = ((pCfg->actions & CYDMA_GENERATE_IRQ) != 0u) ? 1u : 0u;
+    }
+    return 1u;
+}
+
+/*
+ * 运行DMA直到一个描述符产生中断或没有进展，然后调用中断回调。
+ * 作为SPI空闲钩子，每次调用最多处理一个中断
+ */
+static void MockDma_Run(void)
+{
+    int32 irqCh = -1;
+    uint8_t progress;
+    uint8_t done;
+    int32 ch;
+
+    do
+    {
+        progress = 0u;
+        for (ch = 0; ch < MOCK_DMA_CH_NUM; ch++)
+        {
+            progress |= MockDma_Step(ch, &done);
+            if (done != 0u)
+                irqCh = ch;
+        }
+        progress |= MockScb_ShiftOne();
+    } while ((progress != 0u) && (irqCh < 0));
+
+    if ((irqCh >= 0) && ((s_DmaIntrMask & (1uL << (uint32)irqCh)) != 0u) && (Dma[irqCh].pfnIrq != NULL))
+    {
+        if (++s_DmaIrqCount > MOCK_IRQ_LIMIT)
+        {
+            printf("  FAIL DMA: %u interrupts, frames do not advance\n", (unsigned)s_DmaIrqCount);
+            printf("FAIL\n");
+            exit(1);
+        }
+        Dma[irqCh].pfnIrq();
+        Mock_Stalled(1u, "DMA");
+    }
+    else
+        Mock_Stalled(0u, "DMA");
+}
+
+/*******************************************************************************
+* 其他PSoC接口
+*******************************************************************************/
+
+uint8 CyEnterCriticalSection(void)
+{
+    return 0u;
+}
+
+void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    (void)savedIntrStatus;
+}
+
+void CyIntEnable(uint8 number)
+{
+    (void)number;
+}
+
+void CyDelay(uint32 milliseconds)
+{
+    (void)milliseconds;
+}
+
+void CyDelayUs(uint16 microseconds)
+{
+    (void)microseconds;
+}
+
+static cySysTickCallback s_SysTickCb[CY_SYS_SYST_NUM_OF_CALLBACKS];
+
+void CySysTickStart(void)
+{
+}
+
+void CySysTickStop(void)
+{
+}
+
+uint32 CySysTickGetReload(void)
+{
+    return 47999u;
+}
+
+uint32 CySysTickGetValue(void)
+{
+    return 0u;
+}
+
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function)
+{
+    cySysTickCallback old = s_SysTickCb[number];
+
+    s_SysTickCb[number] = function;
+    return old;
+}
+
+cySysTickCallback CySysTickGetCallback(uint32 number)
+{
+    return s_SysTickCb[number];
+}
+
+uint32 CySysFlashWriteRow(uint32 rowNum, const uint8 rowData[])
+{
+    (void)rowNum;
+    (void)rowData;
+    return CY_SYS_FLASH_SUCCESS;
+}
+
+void AD5940_RST_Write(uint8 value)
+{
+    (void)value;
+}
+
+uint8 AD5940_EXTI_ClearInterrupt(void)
+{
+    return 0u;
+}
+
+void AD5940_Interrupt_StartEx(cyisraddress address)
+{
+    (void)address;
+}
+
+void AD5940_Interrupt_ClearPending(void)
+{
+}
+
+/*******************************************************************************
+* 测试
+*******************************************************************************/
+
+static uint32_t s_XferDone = 0;
+
+static void Test_XferDone(AD5940_SPIXfer_Type *pXfer)
+{
+    (void)pXfer;
+    s_XferDone++;
+}
+
+static void Test_CheckFifo(void)
+{
+    CHECK(Scb.MaxInFlight <= SPI_1_FIFO_SIZE, "in-flight %u > FIFO depth %u",
+          (unsigned)Scb.MaxInFlight, (unsigned)SPI_1_FIFO_SIZE);
+    CHECK(Scb.TxOverflow == 0u, "TX FIFO overflow %u", (unsigned)Scb.TxOverflow);
+    CHECK(Scb.RxOverflow == 0u, "RX FIFO overflow %u", (unsigned)Scb.RxOverflow);
+    CHECK(Scb.RxUnderflow == 0u, "RX FIFO underflow %u", (unsigned)Scb.RxUnderflow);
+}
+
+/* 1. 逐字节收发：顺序和在途字节数 */
+static void Test_ScbReadWrite(void)
+{
+    uint8_t tx[300];
+    uint8_t rx[300];
+    uint32_t i;
+
+    printf("ScbSPI_ReadWriteNBytes\n");
+    for (i = 0; i < sizeof(tx); i++)
+        tx[i] = (uint8_t)(i * 7u + 3u);
+    memset(rx, 0, sizeof(rx));
+    MockScb_Reset();
+    CHECK(AD5940_ReadWriteNBytes(tx, rx, sizeof(tx)) == 0, "transfer failed");
+    CHECK(Scb.BusCount == sizeof(tx), "bus bytes %u", (unsigned)Scb.BusCount);
+    for (i = 0; i < sizeof(tx); i++)
+    {
+        CHECK(Scb.Mosi[i] == tx[i], "MOSI[%u] %02x, expected %02x", (unsigned)i, Scb.Mosi[i], tx[i]);
+        CHECK((rx[i] ^ tx[i]) == 0xFFu, "rx[%u] %02x, expected %02x", (unsigned)i, rx[i], (uint8_t)(tx[i] ^ 0xFFu));
+    }
+    Test_CheckFifo();
+}
+
+/* 2/3. 三帧传输：命令(丢弃接收) + 填充读 + 独立CS的写读 */
+static void Test_Frames(const char *pName, uint8_t UseDma)
+{
+    static const uint8_t cmd[3] = {0x6Du, 0x12u, 0x34u};
+    uint8_t data[20];
+    uint8_t rxFill[100];
+    uint8_t rxData[sizeof(data)];
+    AD5940_SPIFrame_Type frames[3];
+    AD5940_SPIXfer_Type xfer;
+    uint32_t irqBefore = s_DmaIrqCount;
+    uint32_t i, n;
+
+    printf("%s\n", pName);
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(0xC0u + i);
+    memset(rxFill, 0, sizeof(rxFill));
+    memset(rxData, 0, sizeof(rxData));
+
+    frames[0].pTx = cmd;
+    frames[0].pRx = NULL;
+    frames[0].Length = sizeof(cmd);
+    frames[0].TxFill = 0;
+    frames[0].CsCtrl = AD5940_FRAME_CS_ASSERT;
+    frames[1].pTx = NULL;
+    frames[1].pRx = rxFill;
+    frames[1].Length = sizeof(rxFill);
+    frames[1].TxFill = 0xA5u;
+    frames[1].CsCtrl = AD5940_FRAME_CS_RELEASE;
+    frames[2].pTx = data;
+    frames[2].pRx = rxData;
+    frames[2].Length = sizeof(data);
+    frames[2].TxFill = 0;
+    frames[2].CsCtrl = AD5940_FRAME_CS_FULL;
+
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.pFrames = frames;
+    xfer.FrameCount = 3;
+    xfer.pfnDone = Test_XferDone;
+    xfer.State = AD5940_XFER_IDLE;
+    s_XferDone = 0;
+    MockScb_Reset();
+
+    CHECK(AD5940_SPISubmit(&xfer) == 0, "submit failed");
+    if (UseDma != 0u)
+        CHECK(xfer.State == AD5940_XFER_ACTIVE, "DMA transfer finished before wait, state %u", xfer.State);
+    AD5940_SPIWait(&xfer);
+    MockScb_LogBytes();
+
+    CHECK(xfer.State == AD5940_XFER_DONE, "state %u", xfer.State);
+    CHECK(s_XferDone == 1u, "done callback %u times", (unsigned)s_XferDone);
+    CHECK(AD5940_SPIIsIdle() == 1u, "queue not idle");
+    if (UseDma != 0u)
+        CHECK(s_DmaIrqCount - irqBefore == 3u, "RX DMA interrupts %u, expected one per frame",
+              (unsigned)(s_DmaIrqCount - irqBefore));
+    else
+        CHECK(s_DmaIrqCount == irqBefore, "DMA used on sync path");
+
+    /* 帧之间的CS：第1、2帧之间不动，第2、3帧之间拉高再拉低 */
+    CHECK(strcmp(Scb.CsLog, "L103HL20H") == 0, "CS log %s, expected L103HL20H", Scb.CsLog);
+    CHECK(Scb.BusCount == sizeof(cmd) + sizeof(rxFill) + sizeof(data), "bus bytes %u", (unsigned)Scb.BusCount);
+    for (i = 0; i < Scb.BusCount; i++)
+        CHECK(Scb.MosiCs[i] == 0u, "byte %u sent with CS high", (unsigned)i);
+
+    n = 0;
+    for (i = 0; i < sizeof(cmd); i++, n++)
+        CHECK(Scb.Mosi[n] == cmd[i], "cmd MOSI[%u] %02x", (unsigned)i, Scb.Mosi[n]);
+    for (i = 0; i < sizeof(rxFill); i++, n++)
+    {
+        CHECK(Scb.Mosi[n] == 0xA5u, "fill MOSI[%u] %02x, expected a5", (unsigned)i, Scb.Mosi[n]);
+        CHECK(rxFill[i] == 0x5Au, "fill rx[%u] %02x, expected 5a", (unsigned)i, rxFill[i]);
+    }
+    for (i = 0; i < sizeof(data); i++, n++)
+    {
+        CHECK(Scb.Mosi[n] == data[i], "data MOSI[%u] %02x", (unsigned)i, Scb.Mosi[n]);
+        CHECK((rxData[i] ^ data[i]) == 0xFFu, "data rx[%u] %02x", (unsigned)i, rxData[i]);
+    }
+    Test_CheckFifo();
+}
+
+/* 4. 连续提交两次传输，第二次在第一次的完成中断中启动 */
+static void Test_Queue(void)
+{
+    static const uint8_t txA[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    static const uint8_t txB[5] = {0xF1u, 0xF2u, 0xF3u, 0xF4u, 0xF5u};
+    uint8_t rxA[sizeof(txA)];
+    uint8_t rxB[sizeof(txB)];
+    AD5940_SPIFrame_Type frameA;
+    AD5940_SPIFrame_Type frameB;
+    AD5940_SPIXfer_Type xferA;
+    AD5940_SPIXfer_Type xferB;
+    uint32_t i;
+
+    printf("DMA queued transfers\n");
+    frameA.pTx = txA;
+    frameA.pRx = rxA;
+    frameA.Length = sizeof(txA);
+    frameA.TxFill = 0;
+    frameA.CsCtrl = AD5940_FRAME_CS_FULL;
+    frameB = frameA;
+    frameB.pTx = txB;
+    frameB.pRx = rxB;
+    frameB.Length = sizeof(txB);
+    memset(&xferA, 0, sizeof(xferA));
+    xferA.pFrames = &frameA;
+    xferA.FrameCount = 1;
+    xferA.pfnDone = Test_XferDone;
+    xferB = xferA;
+    xferB.pFrames = &frameB;
+    s_XferDone = 0;
+    MockScb_Reset();
+
+    CHECK(AD5940_SPISubmit(&xferA) == 0, "submit A failed");
+    CHECK(AD5940_SPISubmit(&xferB) == 0, "submit B failed");
+    CHECK(xferB.State == AD5940_XFER_QUEUED, "B state %u, expected queued", xferB.State);
+    CHECK(AD5940_SPISubmit(&xferB) != 0, "B submitted twice");
+    AD5940_SPIWait(&xferB);
+    MockScb_LogBytes();
+
+    CHECK((xferA.State == AD5940_XFER_DONE) && (xferB.State == AD5940_XFER_DONE), "states %u %u",
+          xferA.State, xferB.State);
+    CHECK(s_XferDone == 2u, "done callback %u times", (unsigned)s_XferDone);
+    CHECK(strcmp(Scb.CsLog, "L12HL5H") == 0, "CS log %s, expected L12HL5H", Scb.CsLog);
+    for (i = 0; i < sizeof(txA); i++)
+        CHECK((rxA[i] ^ txA[i]) == 0xFFu, "A rx[%u] %02x", (unsigned)i, rxA[i]);
+    for (i = 0; i < sizeof(txB); i++)
+        CHECK((rxB[i] ^ txB[i]) == 0xFFu, "B rx[%u] %02x", (unsigned)i, rxB[i]);
+    Test_CheckFifo();
+}
+
+int main(void)
+{
+    Scb.Cs = 1u;
+    AD5940_SPISetIdleHook(MockDma_Run);
+
+    /* SPI_1启动前DMA未分配，传输走同步路径 */
+    Test_ScbReadWrite();
+    Test_Frames("sync frames", 0u);
+
+    CHECK(AD5940_SPISetBackend(AD5940_SPI_BACKEND_SCB) == 0, "SCB backend not built");
+    CHECK((SPI_1_RX_FIFO_CTRL_REG & SPI_1_RX_FIFO_CTRL_TRIGGER_LEVEL_MASK) == 0u, "RX trigger level %u",
+          (unsigned)(SPI_1_RX_FIFO_CTRL_REG & SPI_1_RX_FIFO_CTRL_TRIGGER_LEVEL_MASK));
+    Test_Frames("DMA frames", 1u);
+    Test_Queue();
+    Test_ScbReadWrite();        /* DMA初始化后阻塞接口仍走CPU收发 */
+    CHECK(s_DmaBadAddr == 0u, "DMA descriptor address or width does not match SPI_1 FIFO");
+
+    printf("%s\n", (s_Fail == 0u) ? "PASS" : "FAIL");
+    return (s_Fail == 0u) ? 0 : 1;
+}
+
+/* [] END OF FILE */
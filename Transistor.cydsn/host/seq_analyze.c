@@ -0,0 +1,154 @@
+/*******************************************************************************
+* File Name: seq_analyze.c
+*
+* Description:
+*   序列时间与能耗静态分析工具（主机端）
+*   用AD5940_SEQAnalyze()分析ad5941_seqrom.h中的离线序列（与main.c和
+*   AppIMPCfg初值对应），输出每个序列的时长、最高可用ODR、各模块(AFECON位)
+*   开启时间，给出电流表时输出每次运行的电荷估计。不运行序列。
+*   部署新配置前先用seqrom_gen重新生成ad5941_seqrom.h再分析。
+*
+*   模块电流不内置，按电路板实测值或数据手册在命令行给出，单位uA。
+*   ACTIVE为序列器运行期间不随AFECON变化的电流。
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost host/seq_analyze.c host/ad5940_sim.c ad5940.c -lm -o seq_analyze
+*
+* 用法：
+*   seq_analyze [ACTIVE=uA] [ADCPWR=uA] [HSDACPWR=uA] ... [ODR=Hz]
+*   给出ODR时检查每个测量序列能否在该ODR下完成。
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ad5940.h"
+#include "ad5941_seqcache.h"
+#include "ad5941_seqrom.h"
+
+#define ANA_SYSCLK_FREQ         (16000000.0f)   /* 与main.c、AppIMPCfg相同 */
+
+/* AFECON位名称 */
+typedef struct
+{
+    const char *pName;
+    uint32_t Bit;
+} AnaBlock_Type;
+
+static const AnaBlock_Type s_Block[] =
+{
+    {"HPREFPWR", 5},   {"HSDACPWR", 6},   {"ADCPWR", 7},     {"ADCCNV", 8},
+    {"EXTBUFPWR", 9},  {"INAMPPWR", 10},  {"HSTIAPWR", 11},  {"TEMPSPWR", 12},
+    {"TEMPCNV", 13},   {"WG", 14},        {"DFT", 15},       {"SINC2NOTCH", 16},
+    {"ALDOLIMIT", 19}, {"DACREFPWR", 20}, {"DCBUFPWR", 21},
+};
+
+#define ANA_BLOCK_NUM           (sizeof(s_Block) / sizeof(s_Block[0]))
+
+static float s_Current[32];
+
+/* NAME=uA，返回0=成功 */
+static int Ana_ParseCurrent(const char *pArg, float *pActive, float *pOdr, int *pHasCurrent)
+{
+    const char *pEq = strchr(pArg, '=');
+    size_t len;
+    uint32_t i;
+
+    if (pEq == NULL)
+        return -1;
+    len = (size_t)(pEq - pArg);
+    if ((len == 6u) && (strncmp(pArg, "ACTIVE", len) == 0))
+    {
+        *pActive = strtof(pEq + 1, NULL);
+        *pHasCurrent = 1;
+        return 0;
+    }
+    if ((len == 3u) && (strncmp(pArg, "ODR", len) == 0))
+    {
+        *pOdr = strtof(pEq + 1, NULL);
+        return 0;
+    }
+    for (i = 0; i < ANA_BLOCK_NUM; i++)
+    {
+        if ((strlen(s_Block[i].pName) == len) && (strncmp(pArg, s_Block[i].pName, len) == 0))
+        {
+            s_Current[s_Block[i].Bit] = strtof(pEq + 1, NULL);
+            *pHasCurrent = 1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void Ana_Print(const char *pName, uint32_t SeqId, uint32_t SeqLen, const SEQAnalyzeResult_Type *pRes,
+                      int HasCurrent)
+{
+    uint32_t i;
+
+    printf("%s SEQID_%u: %u cmds, %u clks, %.3f ms, max ODR %.2f Hz%s\n", pName, (unsigned)SeqId,
+           (unsigned)SeqLen, (unsigned)pRes->Cycles, pRes->Duration * 1000.0f, pRes->MaxODR,
+           (pRes->bSleep == bTRUE) ? ", sleep" : "");
+    for (i = 0; i < ANA_BLOCK_NUM; i++)
+    {
+        if (pRes->BlockCycles[s_Block[i].Bit] != 0u)
+            printf("    %-10s %10.3f ms\n", s_Block[i].pName,
+                   pRes->BlockCycles[s_Block[i].Bit] * 1000.0f / ANA_SYSCLK_FREQ);
+    }
+    if (HasCurrent != 0)
+        printf("    charge     %10.3f uC\n", pRes->Charge);
+}
+
+int main(int argc, char *argv[])
+{
+    SEQAnalyzeCfg_Type cfg;
+    SEQAnalyzeResult_Type res;
+    const AD5940_SEQRom_Type *pRom;
+    char name[16];
+    float active = 0;
+    float odr = 0;
+    int hasCurrent = 0;
+    int fail = 0;
+    uint32_t offset;
+    uint32_t i;
+    uint32_t s;
+
+    for (i = 1; i < (uint32_t)argc; i++)
+    {
+        if (Ana_ParseCurrent(argv[i], &active, &odr, &hasCurrent) != 0)
+        {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    for (i = 0; i < AD5940_SEQROM_NUM; i++)
+    {
+        pRom = &AD5940_SeqRom[i];
+        /* 同一应用可有多个配置(如AMP单通道和三通道复用)，附加表中序号区分 */
+        snprintf(name, sizeof(name), "%s[%u]", (pRom->Slot == AD5940_SEQCACHE_SLOT_AMP) ? "AMP" : "IMP",
+                 (unsigned)i);
+        offset = 0;
+        for (s = 0; s < pRom->SeqNum; s++)
+        {
+            /* 与应用相同：每个序列从复位值开始 */
+            AD5940_StructInit(&cfg, sizeof(cfg));
+            cfg.SysClkFreq = ANA_SYSCLK_FREQ;
+            cfg.AfeconInit = REG_AFE_AFECON_RESET;
+            cfg.pBlockCurrent = (hasCurrent != 0) ? s_Current : NULL;
+            cfg.ActiveCurrent = active;
+            AD5940_SEQAnalyze(&pRom->pCmd[offset], pRom->Seq[s].SeqLen, &cfg, &res);
+            Ana_Print(name, pRom->Seq[s].SeqId, pRom->Seq[s].SeqLen, &res, hasCurrent);
+            /* seqrom_gen先输出初始化序列，后输出测量序列 */
+            if ((odr > 0) && (s == 1u) && (res.Duration * odr >= 1.0f))
+            {
+                printf("    ODR %.2f Hz too high\n", odr);
+                fail = 1;
+            }
+            offset += pRom->Seq[s].SeqLen;
+        }
+    }
+    return fail;
+}
+
+/* [] END OF FILE */
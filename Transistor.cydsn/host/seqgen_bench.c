@@ -0,0 +1,156 @@
+/*******************************************************************************
+* File Name: seqgen_bench.c
+*
+* Description:
+*   序列生成器基准测试（主机端）
+*   在ad5940_sim上反复执行AppAMPInit()/AppIMPInit()，只统计
+*   AD5940_SEQGenCtrl(bTRUE)到AD5940_SEQGenCtrl(bFALSE)之间的时间，
+*   即AppAMPSeqCfgGen/AppAMPSeqMeasureGen等序列生成函数本身的开销，
+*   以及生成期间为读取寄存器默认值产生的SPI读次数（定义AD5940_SEQGEN_LIVEREAD时）。
+*   用不同版本的ad5940.c编译即可比较序列生成器的改动。
+*
+* 编译（在Transistor.cydsn目录下，需要GNU ld的--wrap）：
+*   gcc -std=gnu99 -O2 -I. -Ihost -Wl,--wrap=AD5940_SEQGenCtrl -DAD5940_SEQ_CACHE_ENABLE=0u \
+*       host/seqgen_bench.c host/ad5940_sim.c ad5940.c Amperometric.c Impedance.c \
+*       ad5941_seqalloc.c -lm -o seqgen_bench
+*   关闭序列缓存，否则第二次初始化起直接从缓存加载，不运行生成器。
+*
+* 用法：
+*   seqgen_bench [重复次数]
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5940_sim.h"
+#include "Amperometric.h"
+#include "Impedance.h"
+
+#define BENCH_REPS_DEFAULT      (200u)
+#define BENCH_SEQ_BUFF          (512u)
+
+typedef struct
+{
+    uint64_t Ns;                /* 生成器运行时间 */
+    uint32_t Runs;              /* 生成的序列数 */
+    uint32_t SpiReads;          /* 生成期间的SPI读寄存器次数 */
+} GenStat_Type;
+
+static uint32_t s_SeqBuff[BENCH_SEQ_BUFF];
+static GenStat_Type s_Gen;
+static uint64_t s_GenStartNs;
+static uint32_t s_GenStartReads;
+
+void __real_AD5940_SEQGenCtrl(BoolFlag bFlag);
+
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t SimRegReads(void)
+{
+    AD5940Sim_Stat_Type st;
+
+    AD5940Sim_GetStat(&st);
+    return st.RegReads;
+}
+
+/* 链接时以--wrap替换应用代码中的AD5940_SEQGenCtrl()调用 */
+void __wrap_AD5940_SEQGenCtrl(BoolFlag bFlag)
+{
+    if (bFlag == bTRUE)
+    {
+        s_GenStartReads = SimRegReads();
+        s_GenStartNs = NowNs();
+        __real_AD5940_SEQGenCtrl(bFlag);
+    }
+    else
+    {
+        __real_AD5940_SEQGenCtrl(bFlag);
+        s_Gen.Ns += NowNs() - s_GenStartNs;
+        s_Gen.SpiReads += SimRegReads() - s_GenStartReads;
+        s_Gen.Runs++;
+    }
+}
+
+static void Bench_Print(const char *pName, uint32_t reps, uint32_t seqLen)
+{
+    printf("%-4s %6u %8u %12.2f %12.2f %8u\n", pName, (unsigned)reps, (unsigned)s_Gen.Runs,
+           (double)s_Gen.Ns / 1000.0 / reps, (double)s_Gen.SpiReads / reps, (unsigned)seqLen);
+}
+
+static void Bench_Amp(uint32_t reps)
+{
+    AppAMPCfg_Type *pCfg;
+    uint32_t i;
+
+    AppAMPGetCfg(&pCfg);
+    pCfg->SeqStartAddr = 0;
+    pCfg->MaxSeqLen = BENCH_SEQ_BUFF;
+    pCfg->SysClkFreq = 16000000.0;
+    pCfg->WuptClkFreq = 32000.0;
+    pCfg->AdcClkFreq = 16000000.0;
+    pCfg->AMPInited = bFALSE;
+
+    for (i = 0; i <= reps; i++)
+    {
+        if (i == 1u)
+            s_Gen = (GenStat_Type){0};      /* 第一次包含RTIA校准，不计入 */
+        pCfg->bParaChanged = bTRUE;
+        if (AppAMPInit(s_SeqBuff, BENCH_SEQ_BUFF) != AD5940ERR_OK)
+        {
+            printf("AppAMPInit failed\n");
+            return;
+        }
+    }
+    Bench_Print("AMP", reps, pCfg->InitSeqInfo.SeqLen + pCfg->MeasureSeqInfo.SeqLen);
+}
+
+static void Bench_Imp(uint32_t reps)
+{
+    AppIMPCfg_Type *pCfg;
+    uint32_t i;
+
+    AppIMPGetCfg(&pCfg);
+    pCfg->IMPInited = bFALSE;
+
+    for (i = 0; i <= reps; i++)
+    {
+        if (i == 1u)
+            s_Gen = (GenStat_Type){0};
+        pCfg->bParaChanged = bTRUE;
+        if (AppIMPInit(s_SeqBuff, BENCH_SEQ_BUFF) != AD5940ERR_OK)
+        {
+            printf("AppIMPInit failed\n");
+            return;
+        }
+    }
+    Bench_Print("IMP", reps, pCfg->InitSeqInfo.SeqLen + pCfg->MeasureSeqInfo.SeqLen);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t reps = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_REPS_DEFAULT;
+
+    if (reps == 0u)
+        reps = 1u;
+
+    AD5940_MCUResourceInit(NULL);
+    AD5940_HWReset();
+    AD5940_Initialize();
+    AD5940_INTCCfg(AFEINTC_1, AFEINTSRC_ALLINT, bTRUE);
+
+    printf("seq    reps     gens   gen_us/init  spi_rd/init     cmds\n");
+    Bench_Amp(reps);
+    Bench_Imp(reps);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,256 @@
+/*******************************************************************************
+* File Name: seqrom_gen.c
+*
+* Description:
+*   离线序列生成工具（主机端）
+*   在ad5940_sim上以标准配置运行AppAMPInit()/AppIMPInit()，记录应用写入
+*   序列器SRAM的命令和SEQInfo_Type，以及应用计算的缓存键，输出
+*   ad5941_seqrom.h。寄存器初值取自ad5940.c的复位值表，与芯片状态无关。
+*   固件定义AD5940_SEQ_ROM_ENABLE=1u后，配置与这里相同时不再运行序列生成器。
+*
+*   标准配置：AMP与main.c步骤5相同，AMPMUX为在此基础上的三通道复用测量
+*   (main.c StartMultiplexedMeasurement)，IMP为Impedance.c中AppIMPCfg的初值；
+*   都按单独使用分配SRAM（ad5941_seqalloc），从地址0开始。
+*   修改main.c的配置、序列生成函数或ad5940.c的生成器后须重新生成。
+*
+* 编译（在Transistor.cydsn目录下，需要GNU ld的--wrap）：
+*   gcc -std=gnu99 -O2 -I. -Ihost -DAD5940_SEQ_CACHE_ENABLE=0u -DAD5940_SEQ_ROM_ENABLE=1u \
+*       -Wl,--wrap=AD5940_SEQRomLoad -Wl,--wrap=AD5940_SEQCmdWrite \
+*       host/seqrom_gen.c host/ad5940_sim.c ad5940.c Amperometric.c Impedance.c \
+*       ad5941_seqcache.c ad5941_seqalloc.c -lm -o seqrom_gen
+*
+* 用法：
+*   seqrom_gen > ad5941_seqrom.h
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5941_seqcache.h"
+#include "ad5941_seqalloc.h"
+#include "ad5940_sim.h"
+#include "Amperometric.h"
+#include "Impedance.h"
+
+#define ROMGEN_SEQ_BUFF         (512u)
+#define ROMGEN_SRAM_WORDS       (2048u)     /* 序列器最多6kB，按8kB SRAM记录 */
+#define ROMGEN_ENTRY_NUM        (3u)
+
+/* 一个应用的生成结果 */
+typedef struct
+{
+    const char *pName;
+    uint32_t Slot;
+    uint32_t Key;
+    SEQInfo_Type Seq[2];        /* 复制：AMP和AMPMUX共用AppAMPCfg */
+} RomEntry_Type;
+
+static uint32_t s_SeqBuff[ROMGEN_SEQ_BUFF];
+static uint32_t s_Sram[ROMGEN_SRAM_WORDS];
+static uint32_t s_LoadKey;
+static uint32_t s_LoadSlot;
+
+void __real_AD5940_SEQCmdWrite(uint32_t StartAddr, const uint32_t *pCommand, uint32_t CmdCnt);
+
+/* 记录应用计算的离线序列键，返回未命中使应用运行序列生成器 */
+int32_t __wrap_AD5940_SEQRomLoad(uint32_t Slot, uint32_t Key, SEQInfo_Type * const pSeqInfo[], uint32_t SeqNum)
+{
+    (void)pSeqInfo;
+    (void)SeqNum;
+    s_LoadSlot = Slot;
+    s_LoadKey = Key;
+    return -1;
+}
+
+/* 生成器的各序列共用缓冲区，在写入SRAM时记录命令 */
+void __wrap_AD5940_SEQCmdWrite(uint32_t StartAddr, const uint32_t *pCommand, uint32_t CmdCnt)
+{
+    if (StartAddr + CmdCnt <= ROMGEN_SRAM_WORDS)
+        memcpy(&s_Sram[StartAddr], pCommand, CmdCnt * 4u);
+    __real_AD5940_SEQCmdWrite(StartAddr, pCommand, CmdCnt);
+}
+
+static void Gen_Boot(void)
+{
+    AD5940Sim_Reset();
+    AD5940_MCUResourceInit(NULL);
+    AD5940_HWReset();
+    AD5940_Initialize();
+    AD5940_INTCCfg(AFEINTC_1, AFEINTSRC_ALLINT, bTRUE);
+    AD5940_INTCCfg(AFEINTC_0, AFEINTSRC_DATAFIFOTHRESH, bTRUE);
+    memset(s_Sram, 0, sizeof(s_Sram));
+    s_LoadSlot = AD5940_SEQCACHE_SLOT_AMP;
+    s_LoadKey = 0;
+}
+
+/* 与main.c步骤5相同 */
+static int Gen_Amp(RomEntry_Type *pEntry)
+{
+    AppAMPCfg_Type *pCfg;
+
+    Gen_Boot();
+    AD5940_LPModeClkS(LPMODECLK_LFOSC);
+    AppAMPGetCfg(&pCfg);
+    pCfg->bParaChanged = bTRUE;
+    pCfg->MaxSeqLen = 128;
+    pCfg->SeqStartAddrCal = 0;
+    pCfg->MaxSeqLenCal = 512;
+    pCfg->SysClkFreq = 16000000.0;
+    pCfg->WuptClkFreq = 32000.0;
+    pCfg->AdcClkFreq = 16000000.0;
+    pCfg->PwrMod = AFEPWR_LP;
+    pCfg->AmpODR = 10.0;
+    pCfg->NumOfData = -1;
+    pCfg->FifoThresh = 4;
+    pCfg->RcalVal = 10000.0;
+    pCfg->ADCRefVolt = 1.82;
+    pCfg->ExtRtia = bFALSE;
+    pCfg->LptiaRtiaSel = LPTIARTIA_10K;
+    pCfg->LpTiaRf = LPTIARF_1M;
+    pCfg->LpTiaRl = LPTIARLOAD_100R;
+    pCfg->Vzero = 1100.0;
+    pCfg->SensorBias = 0.0;
+    pCfg->ADCPgaGain = ADCPGA_1P5;
+    pCfg->ADCSinc3Osr = ADCSINC3OSR_4;
+    pCfg->ADCSinc2Osr = ADCSINC2OSR_178;
+    pCfg->DataFifoSrc = FIFOSRC_SINC3;
+    pCfg->AMPInited = bFALSE;
+    pCfg->StopRequired = bFALSE;
+    pCfg->FifoDataCount = 0;
+    pCfg->ChanNum = 1;
+
+    if (AppAMPInit(s_SeqBuff, ROMGEN_SEQ_BUFF) != AD5940ERR_OK)
+        return -1;
+    pEntry->pName = "AMP";
+    pEntry->Slot = s_LoadSlot;
+    pEntry->Key = s_LoadKey;
+    pEntry->Seq[0] = pCfg->InitSeqInfo;
+    pEntry->Seq[1] = pCfg->MeasureSeqInfo;
+    return 0;
+}
+
+/* main.c步骤5之后StartMultiplexedMeasurement()的配置 */
+static int Gen_AmpMux(RomEntry_Type *pEntry)
+{
+    AppAMPCfg_Type *pCfg;
+
+    if (Gen_Amp(pEntry) != 0)
+        return -1;
+    AppAMPGetCfg(&pCfg);
+    pCfg->ChanNum = 3;
+    pCfg->ChanGpio[0] = AGPIO_Pin3;
+    pCfg->ChanGpio[1] = AGPIO_Pin4;
+    pCfg->ChanGpio[2] = AGPIO_Pin5;
+    pCfg->ChanSettleTime = 50.0f;
+    pCfg->DataFifoSrc = FIFOSRC_SINC2NOTCH;
+    pCfg->FifoThresh = 3;
+    pCfg->bParaChanged = bTRUE;
+    if (AppAMPInit(s_SeqBuff, ROMGEN_SEQ_BUFF) != AD5940ERR_OK)
+        return -1;
+    pEntry->pName = "AMPMUX";
+    pEntry->Key = s_LoadKey;
+    pEntry->Seq[0] = pCfg->InitSeqInfo;
+    pEntry->Seq[1] = pCfg->MeasureSeqInfo;
+    return 0;
+}
+
+/* AppIMPCfg初值 */
+static int Gen_Imp(RomEntry_Type *pEntry)
+{
+    AppIMPCfg_Type *pCfg;
+
+    Gen_Boot();
+    AD5940_SEQAllocFree(AD5940_SEQALLOC_AMP);  /* IMP单独使用时的地址和SEQID */
+    AppIMPGetCfg(&pCfg);
+    pCfg->IMPInited = bFALSE;
+    if (AppIMPInit(s_SeqBuff, ROMGEN_SEQ_BUFF) != AD5940ERR_OK)
+        return -1;
+    pEntry->pName = "IMP";
+    pEntry->Slot = s_LoadSlot;
+    pEntry->Key = s_LoadKey;
+    pEntry->Seq[0] = pCfg->InitSeqInfo;
+    pEntry->Seq[1] = pCfg->MeasureSeqInfo;
+    return 0;
+}
+
+static void Gen_PrintCmd(const RomEntry_Type *pEntry)
+{
+    uint32_t s;
+    uint32_t i;
+
+    printf("/* %s: ", pEntry->pName);
+    for (s = 0; s < 2u; s++)
+        printf("%sSEQID_%u @%u, %u cmds", (s != 0u) ? "; " : "", (unsigned)pEntry->Seq[s].SeqId,
+               (unsigned)pEntry->Seq[s].SeqRamAddr, (unsigned)pEntry->Seq[s].SeqLen);
+    printf(" */\n");
+    printf("static const uint32_t SeqRom_%sCmd[] =\n{\n", pEntry->pName);
+    for (s = 0; s < 2u; s++)
+    {
+        for (i = 0; i < pEntry->Seq[s].SeqLen; i++)
+        {
+            printf("%s0x%08Xu,", ((i % 4u) == 0u) ? "    " : " ",
+                   (unsigned)s_Sram[pEntry->Seq[s].SeqRamAddr + i]);
+            if (((i % 4u) == 3u) || (i + 1u == pEntry->Seq[s].SeqLen))
+                printf("\n");
+        }
+    }
+    printf("};\n\n");
+}
+
+static void Gen_PrintEntry(const RomEntry_Type *pEntry)
+{
+    printf("    {%uu, 0x%08Xu, 2u, {{%uu, %uu, %uu}, {%uu, %uu, %uu}}, SeqRom_%sCmd},\n",
+           (unsigned)pEntry->Slot, (unsigned)pEntry->Key,
+           (unsigned)pEntry->Seq[0].SeqId, (unsigned)pEntry->Seq[0].SeqRamAddr,
+           (unsigned)pEntry->Seq[0].SeqLen,
+           (unsigned)pEntry->Seq[1].SeqId, (unsigned)pEntry->Seq[1].SeqRamAddr,
+           (unsigned)pEntry->Seq[1].SeqLen, pEntry->pName);
+}
+
+int main(void)
+{
+    RomEntry_Type entry[ROMGEN_ENTRY_NUM];
+    uint32_t i;
+
+    /* 每次生成后立即输出命令：s_Sram在下一次Gen_Boot()时清除 */
+    printf("/*******************************************************************************\n"
+           "* File Name: ad5941_seqrom.h\n"
+           "*\n"
+           "* Description:\n"
+           "*   离线生成的AD5940序列，由host/seqrom_gen.c生成，请勿手工修改。\n"
+           "*   只由ad5941_seqcache.c包含(AD5940_SEQ_ROM_ENABLE)。\n"
+           "*\n"
+           "********************************************************************************/\n\n"
+           "#ifndef AD5941_SEQROM_H\n"
+           "#define AD5941_SEQROM_H\n\n");
+    if (Gen_Amp(&entry[0]) != 0)
+    {
+        fprintf(stderr, "AppAMPInit failed\n");
+        return 1;
+    }
+    Gen_PrintCmd(&entry[0]);
+    if (Gen_AmpMux(&entry[1]) != 0)
+    {
+        fprintf(stderr, "AppAMPInit(ChanNum=3) failed\n");
+        return 1;
+    }
+    Gen_PrintCmd(&entry[1]);
+    if (Gen_Imp(&entry[2]) != 0)
+    {
+        fprintf(stderr, "AppIMPInit failed\n");
+        return 1;
+    }
+    Gen_PrintCmd(&entry[2]);
+
+    printf("#define AD5940_SEQROM_NUM       (%uu)\n\n", (unsigned)ROMGEN_ENTRY_NUM);
+    printf("/* {Slot, Key, SeqNum, {{SeqId, SeqRamAddr, SeqLen}, ...}, pCmd} */\n");
+    printf("static const AD5940_SEQRom_Type AD5940_SeqRom[AD5940_SEQROM_NUM] =\n{\n");
+    for (i = 0; i < ROMGEN_ENTRY_NUM; i++)
+        Gen_PrintEntry(&entry[i]);
+    printf("};\n\n#endif /* AD5941_SEQROM_H */\n\n/* [] END OF FILE */\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,260 @@
+/*******************************************************************************
+* File Name: spi_replay.c
+*
+* Description:
+*   SPI跟踪回放工具（主机端）
+*   读取AD5940_SPITraceDump()导出的文本，按记录的时间间隔把每一帧送入
+*   ad5940_sim仿真总线，统计每个标签的帧数、字节数、总线时间和总线占用率，
+*   并与记录的接收数据比较。给出两个文件时并列输出，便于比较固件版本。
+*
+* 编译（在Transistor.cydsn目录下）：
+*   gcc -std=gnu99 -O2 -I. -Ihost host/spi_replay.c host/ad5940_sim.c -o spi_replay
+*
+* 用法：
+*   spi_replay [-s SCLK_Hz] trace.txt [trace_new.txt]
+*
+* 说明：
+*   - 回放从仿真器上电复位开始，跟踪不是从芯片复位开始记录时，
+*     依赖芯片状态的接收数据会不一致，只作为参考
+*   - 被截断的帧(AD5940_TRACE_TRUNC)剩余字节按最后一个记录的发送字节补齐
+*   - 总线时间由仿真SPI时钟(-s，默认AD5940_SIM_SCLK_DEFAULT)计算
+*
+********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ad5940.h"
+#include "ad5941_platform.h"
+#include "ad5940_sim.h"
+
+#define REPLAY_TAG_NUM          (256u)
+#define REPLAY_LINE_SIZE        (512u)
+#define REPLAY_FRAME_MAX        (0x10000u)
+
+typedef struct
+{
+    uint32_t Frames;
+    uint32_t Bytes;
+    uint64_t BusTicks;          /* 仿真总线时间 */
+    uint32_t RxMismatch;        /* 接收数据与记录不一致的帧 */
+} TagStat_Type;
+
+typedef struct
+{
+    const char *pName;
+    uint32_t Hz;
+    uint32_t Records;
+    uint32_t Lost;
+    uint64_t SpanUs;            /* 第一条到最后一条记录的时间 */
+    uint64_t BusTicks;
+    TagStat_Type Tag[REPLAY_TAG_NUM];
+} Replay_Type;
+
+static Replay_Type s_Replay[2];
+static uint32_t s_Sclk = 0;
+
+/*******************************************************************************
+* 解析
+*******************************************************************************/
+
+static uint32_t HexToBytes(const char *pHex, uint8_t *pOut, uint32_t max)
+{
+    uint32_t n = 0;
+    unsigned int v;
+
+    if (pHex[0] == '-')
+        return 0;
+    while ((n < max) && (pHex[0] != '\0') && (pHex[1] != '\0') && (sscanf(pHex, "%2x", &v) == 1))
+    {
+        pOut[n++] = (uint8_t)v;
+        pHex += 2;
+    }
+    return n;
+}
+
+/**
+ * @brief 回放一个跟踪文件
+ * @return 0=成功, -1=文件无法读取
+ */
+static int32_t Replay_File(const char *pName, Replay_Type *pRep)
+{
+    static uint8_t tx[REPLAY_FRAME_MAX];
+    static uint8_t rx[REPLAY_FRAME_MAX];
+    uint8_t recTx[64];
+    uint8_t recRx[64];
+    char line[REPLAY_LINE_SIZE];
+    char txHex[REPLAY_LINE_SIZE];
+    char rxHex[REPLAY_LINE_SIZE];
+    unsigned long ts;
+    unsigned int tag, flags, addr, len;
+    unsigned long hz = 0, n = 0, lost = 0;
+    uint32_t lastTs = 0;
+    uint64_t traceUs = 0;       /* 相对第一条记录的时间 */
+    uint64_t ticks = 0;         /* 相对第一条记录的跟踪时钟数 */
+    uint64_t startUs = 0;
+    AD5940Sim_Stat_Type st0, st1;
+    uint32_t txLen, rxLen, i;
+    FILE *fp = fopen(pName, "r");
+
+    if (fp == NULL)
+        return -1;
+
+    memset(pRep, 0, sizeof(*pRep));
+    pRep->pName = pName;
+
+    AD5940Sim_Reset();
+    AD5940Sim_SetSpiClock(s_Sclk);
+    AD5940_MCUResourceInit(NULL);
+    startUs = AD5940Sim_GetTimeUs();
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (line[0] == '#')
+        {
+            if (sscanf(line, "# AD5940 SPI trace v1 hz=%lu n=%lu lost=%lu", &hz, &n, &lost) == 3)
+            {
+                pRep->Hz = (uint32_t)hz;
+                pRep->Lost = (uint32_t)lost;
+            }
+            continue;
+        }
+        if (sscanf(line, "%lx %x %x %x %x %s %s", &ts, &tag, &flags, &addr, &len, txHex, rxHex) != 7)
+            continue;
+
+        /* 时间戳32位回绕，按无符号差累加；不递减 */
+        if (pRep->Records != 0u)
+        {
+            uint32_t delta = (uint32_t)ts - lastTs;
+            if (delta < 0x80000000u)
+                ticks += delta;
+        }
+        lastTs = (uint32_t)ts;
+        pRep->Records++;
+        if (pRep->Hz != 0u)
+        {
+            traceUs = (ticks * 1000000u) / pRep->Hz;
+            if (AD5940Sim_GetTimeUs() - startUs < traceUs)
+                AD5940Sim_Run((uint32_t)(traceUs - (AD5940Sim_GetTimeUs() - startUs)));
+        }
+
+        if ((flags & AD5940_TRACE_CSONLY) != 0u)
+        {
+            if ((flags & AD5940_TRACE_CS_ASSERT) != 0u)
+                AD5940_CsClr();
+            if ((flags & AD5940_TRACE_CS_RELEASE) != 0u)
+                AD5940_CsSet();
+            continue;
+        }
+        if ((len == 0u) || (len > REPLAY_FRAME_MAX))
+            continue;
+
+        txLen = HexToBytes(txHex, recTx, sizeof(recTx));
+        rxLen = HexToBytes(rxHex, recRx, sizeof(recRx));
+        for (i = 0; i < len; i++)
+            tx[i] = (i < txLen) ? recTx[i] : ((txLen != 0u) ? recTx[txLen - 1u] : 0u);
+
+        AD5940Sim_GetStat(&st0);
+        if ((flags & AD5940_TRACE_CS_ASSERT) != 0u)
+            AD5940_CsClr();
+        AD5940_ReadWriteNBytes(tx, rx, len);
+        if ((flags & AD5940_TRACE_CS_RELEASE) != 0u)
+            AD5940_CsSet();
+        AD5940Sim_GetStat(&st1);
+
+        pRep->Tag[tag & 0xFFu].Frames++;
+        pRep->Tag[tag & 0xFFu].Bytes += len;
+        pRep->Tag[tag & 0xFFu].BusTicks += st1.BusTicks - st0.BusTicks;
+        pRep->BusTicks += st1.BusTicks - st0.BusTicks;
+        if (((flags & AD5940_TRACE_NORX) == 0u) && (rxLen != 0u) && (memcmp(rx, recRx, rxLen) != 0))
+            pRep->Tag[tag & 0xFFu].RxMismatch++;
+    }
+    fclose(fp);
+
+    pRep->SpanUs = traceUs;
+    return 0;
+}
+
+/*******************************************************************************
+* 输出
+*******************************************************************************/
+
+static double TicksToUs(uint64_t ticks)
+{
+    return (double)ticks * 1e6 / AD5940_SIM_SYSCLK_HZ;
+}
+
+static void Replay_Print(const Replay_Type *pRep)
+{
+    uint32_t t;
+    double busUs;
+
+    printf("%s: %u records, %u lost, span %.0f us, clock %u Hz\n", pRep->pName,
+           (unsigned)pRep->Records, (unsigned)pRep->Lost, (double)pRep->SpanUs, (unsigned)pRep->Hz);
+    printf("  tag  frames     bytes     bus_us   util%%  rx_mismatch\n");
+    for (t = 0; t < REPLAY_TAG_NUM; t++)
+    {
+        const TagStat_Type *pTag = &pRep->Tag[t];
+        if (pTag->Frames == 0u)
+            continue;
+        busUs = TicksToUs(pTag->BusTicks);
+        printf("  %3u %7u %9u %10.1f %7.2f %12u\n", (unsigned)t, (unsigned)pTag->Frames,
+               (unsigned)pTag->Bytes, busUs,
+               (pRep->SpanUs != 0u) ? (100.0 * busUs / (double)pRep->SpanUs) : 0.0,
+               (unsigned)pTag->RxMismatch);
+    }
+    busUs = TicksToUs(pRep->BusTicks);
+    printf("  all %37.1f %7.2f\n", busUs,
+           (pRep->SpanUs != 0u) ? (100.0 * busUs / (double)pRep->SpanUs) : 0.0);
+}
+
+static void Replay_Compare(const Replay_Type *pOld, const Replay_Type *pNew)
+{
+    uint32_t t;
+
+    printf("diff (%s -> %s)\n", pOld->pName, pNew->pName);
+    printf("  tag  d_frames   d_bytes   d_bus_us\n");
+    for (t = 0; t < REPLAY_TAG_NUM; t++)
+    {
+        const TagStat_Type *pA = &pOld->Tag[t];
+        const TagStat_Type *pB = &pNew->Tag[t];
+        if ((pA->Frames == 0u) && (pB->Frames == 0u))
+            continue;
+        printf("  %3u %+9ld %+9ld %+10.1f\n", (unsigned)t,
+               (long)pB->Frames - (long)pA->Frames, (long)pB->Bytes - (long)pA->Bytes,
+               TicksToUs(pB->BusTicks) - TicksToUs(pA->BusTicks));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int argi = 1;
+    int files = 0;
+
+    if ((argc > 2) && (strcmp(argv[1], "-s") == 0))
+    {
+        s_Sclk = (uint32_t)strtoul(argv[2], NULL, 0);
+        argi = 3;
+    }
+    if ((argc - argi < 1) || (argc - argi > 2))
+    {
+        fprintf(stderr, "usage: %s [-s SCLK_Hz] trace.txt [trace_new.txt]\n", argv[0]);
+        return 1;
+    }
+
+    for (; argi < argc; argi++, files++)
+    {
+        if (Replay_File(argv[argi], &s_Replay[files]) != 0)
+        {
+            fprintf(stderr, "cannot read %s\n", argv[argi]);
+            return 1;
+        }
+        Replay_Print(&s_Replay[files]);
+    }
+    if (files == 2)
+        Replay_Compare(&s_Replay[0], &s_Replay[1]);
+
+    return 0;
+}
+
+/* [] END OF FILE */
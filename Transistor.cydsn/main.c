@@ -16,6 +16,8 @@
 #include "ad5940.h"
 #include "ad5941_platform.h"
 #include "Amperometric.h"
+#include "ad5941_bench.h"
+#include "ad5941_seqcache.h"
 uint8_t g_SPI_Debug_Buf[8] = {0}; // 全局变量，记录最后一次读取的原始字节
 
 // 在 main() 函数开头添加变量
@@ -53,13 +55,38 @@ typedef enum {
     SENSOR_COUNT = 3
 } AmperometricSensor_t;
 
+// 三通道复用测量开关：1 = 一个AD5940序列轮流测量三个传感器（连续采集，MCU不阻塞），
+// 传感器选择开关由AD5941的GPIO驱动，需将AMP1_EN/AMP2_EN/AMP3_EN改接到以下引脚后才能使用；
+// 0 = 现有电路板，由MCU的AMP1_EN/AMP2_EN/AMP3_EN逐个选通，ReadCurrentFromAD5940()测量
+#ifndef AMP_MUX_ENABLE
+#define AMP_MUX_ENABLE          (0u)
+#endif
+
+// 复用测量的传感器选择引脚，与host/seqrom_gen.c中的Gen_AmpMux()相同
+#define AMP_GPIO_GLUCOSE        AGPIO_Pin3
+#define AMP_GPIO_LACTATE        AGPIO_Pin4
+#define AMP_GPIO_URIC_ACID      AGPIO_Pin5
+#define AMP_CHAN_SETTLE_MS      (50.0f)     // 切换传感器后的稳定时间，与ReadCurrentFromAD5940()相同
+#define AMP_STREAM_PERIOD_S     (0.2f)      // 连续测量每轮周期，须长于测量序列（三通道约156ms）
+#define AMP_STREAM_SIZE         (128u)      // MCU端样本环形缓冲区，最多保存127个样本
+
+// AD5941中断输出：GP0(INT0)接MCU的AD5940_EXTI引脚，下降沿触发AD5940_Interrupt
+#define AFE_INT_GPIO            AGPIO_Pin0
+
 
 
 
 
 // AD5941相关变量
 AppAMPCfg_Type *pAmpCfg;
+#if (AMP_MUX_ENABLE != 0u)
+static AppAMPSample_Type ampSampleBuffer[AMP_STREAM_SIZE];
+static AppAMPStream_Type ampStream;     // 连续测量：AppAMPStreamService()写入，ReadMultiplexedCurrents()读出
+#endif
+#if (AD5940_SEQ_ROM_ENABLE == 0u)
 uint32 ampBuffer[512];  // 用于AppAMPInit的缓冲区
+#endif
+uint32_t seqShadow[132];  // 序列器SRAM影子，跟踪前128条命令，参数改变时只写变化的命令
 fAmpRes_Type ampResult;
 
 /*******************************************************************************
@@ -79,6 +106,9 @@ static uint32_t g_fifosta_measure = 0;   // 测量中的FIFOSTA
 static uint32_t g_afecon_measure = 0;    // 测量中的AFECON
 static uint32_t g_fifo_count_measure = 0; // 测量中的FIFO计数
 static uint32_t g_fifo_first_data = 0;   // 第一个FIFO数据
+#if (AMP_MUX_ENABLE == 0u)
+static uint32_t g_fifo_buffer[64];       // 中断后读空FIFO用（ReadFifoOnInterrupt）
+#endif
 
 // ⭐ 新增：关键寄存器诊断变量
 static uint32_t g_lptiacon_measure = 0;  // LPTIA配置 (0x2200)
@@ -104,10 +134,7 @@ static InitState_t g_init_state = INIT_IDLE;
 static uint8_t g_reg_index = 0;
 
 // 寄存器表
-const struct {
-    uint16_t reg_addr;
-    uint32_t reg_data;
-} g_RegTable[] = {
+const RegPair_Type g_RegTable[] = {
     {0x0908, 0x02c9},
     {0x0c08, 0x206C},
     {0x21F0, 0x0010},
@@ -127,6 +154,71 @@ const struct {
 #define REG_TABLE_SIZE (sizeof(g_RegTable)/sizeof(g_RegTable[0]))
 #define REG_AFE_FIFO_STA      0x2084
 
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+/*******************************************************************************
+* SPI跟踪导出（编译时定义AD5940_SPI_TRACE_ENABLE=1u）
+*******************************************************************************/
+
+// 跟踪标签：按初始化阶段统计总线占用，host/spi_replay按标签汇总
+#define TRACE_TAG_PROBE     1u   // ID检查
+#define TRACE_TAG_LIBINIT   2u   // AD5940_Initialize
+#define TRACE_TAG_APPINIT   3u   // AppAMPInit（含RTIA校准）
+
+// 经UART(printf)输出
+static void SPITrace_UartOut(const char *pData, uint32_t len)
+{
+    printf("%.*s", (int)len, pData);
+}
+
+// 经BLE通知输出（乳酸特征值，当前用作诊断日志）
+static void SPITrace_BleOut(const char *pData, uint32_t len)
+{
+    CYBLE_GATTS_HANDLE_VALUE_NTF_T notificationHandle;
+
+    while(CyBle_GattGetBusyStatus() == CYBLE_STACK_STATE_BUSY)
+    {
+        CyBle_ProcessEvents();
+    }
+    notificationHandle.attrHandle = CYBLE_CUSTOM_SERVICE_LACTATE_CHAR_HANDLE;
+    notificationHandle.value.val = (uint8*)pData;
+    notificationHandle.value.len = len;
+    CyBle_GattsNotification(cyBle_connHandle, &notificationHandle);
+}
+
+// 导出跟踪：BLE已连接时按20字节分包通知，否则经UART输出
+static void DumpSPITrace(void)
+{
+    if(CyBle_GetState() == CYBLE_STATE_CONNECTED)
+        AD5940_SPITraceDump(SPITrace_BleOut, 20u);
+    else
+        AD5940_SPITraceDump(SPITrace_UartOut, 0u);
+}
+#endif
+
+/*******************************************************************************
+* Function Name: AD5941_IntCfg
+********************************************************************************
+* Summary:
+*   配置AD5941中断：INTC0只选择数据FIFO阈值中断，由GP0输出到MCU，
+*   MCU在中断之间休眠，不再轮询FIFO计数；INTC1选择全部中断源，供库函数查询
+*   (序列结束等)。其他GPIO的功能保持不变。
+*******************************************************************************/
+static void AD5941_IntCfg(void)
+{
+    uint32_t func;
+    
+    AD5940_INTCCfg(AFEINTC_1, AFEINTSRC_ALLINT, bTRUE);
+    AD5940_INTCCfg(AFEINTC_0, AFEINTSRC_ALLINT, bFALSE);
+    AD5940_INTCCfg(AFEINTC_0, AFEINTSRC_DATAFIFOTHRESH, bTRUE);
+    AD5940_INTCClrFlag(AFEINTSRC_ALLINT);
+    
+    func = AD5940_ReadReg(REG_AGPIO_GP0CON);
+    func = (func & ~(uint32_t)BITM_AGPIO_GP0CON_PIN0CFG) | GP0_INT;
+    AD5940_AGPIOFuncCfg(func);
+    AD5940_AGPIOOen(AD5940_ReadReg(REG_AGPIO_GP0OEN) | AFE_INT_GPIO);
+    AD5940_ClrMCUIntFlag();
+}
+
 /*******************************************************************************
 * Function Name: AD5941_Initialize
 ********************************************************************************
@@ -170,6 +262,18 @@ void AD5941_Initialize(void)
 
     // 初始化 MCU SPI 资源变量
     AD5940_MCUResourceInit(NULL);
+#if (AD5940_SPI_CAL_ENABLE != 0u)
+    // SPI时钟校准：优先使用Em_EEPROM中保存的结果，链路测试失败时重新校准
+    printf("[INIT] SPI clock calibration: %ld, div %lu\r\n",
+           (long)AD5940_SPICalibrate(0u), (unsigned long)AD5940_SPIGetClockDiv());
+#endif
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceClear();
+    AD5940_SPITraceStart();
+#endif
+    // FIFO突发读由DMA搬运时，等待期间CPU进入Sleep，DMA完成中断唤醒
+    AD5940_SPISetIdleHook(CySysPmSleep);
+    printf("[INIT] SPI backend %u\r\n", (unsigned)AD5940_SPIGetBackend());
 
     // ====================================================================
     // 步骤 3: 寄存器通信测试 (ID 检查)
@@ -180,6 +284,9 @@ void AD5941_Initialize(void)
     uint32_t chipid = 0;
     uint8_t id_valid = 0;
 
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceSetTag(TRACE_TAG_PROBE);
+#endif
     // 尝试读取3次，排除偶发的上电不稳定
     for(int attempt = 1; attempt <= 3; attempt++)
     {
@@ -220,8 +327,21 @@ void AD5941_Initialize(void)
     // ====================================================================
     // 这个函数会向芯片写入大量的校准数据和默认配置
     printf("\r\n[INIT] Step 4: Running ADI Library Init (Table 14)...\r\n");
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceSetTag(TRACE_TAG_LIBINIT);
+#endif
     AD5940_Initialize(); 
+    AD5941_IntCfg();
     printf("[INIT] Library Init complete.\r\n");
+#if (AD5940_BENCH_ENABLE != 0u)
+    // SPI访问基准测试（编译时定义AD5940_BENCH_ENABLE=1u），须在AppAMPInit之前
+    // 吞吐量测量用512字节栈缓冲，只在基准测试时运行
+    printf("[BENCH] SPI throughput: %lu B/s\r\n",
+           (unsigned long)AD5940_SPIMeasureThroughput(AD5940_SPI_MEASURE_MAX));
+    AD5940_BenchRun(CySysPmSleep, printf);
+#endif
+    // 启用序列器SRAM影子（基准测试之后，测试直接写SRAM）
+    AD5940_SEQShadowInit(seqShadow, sizeof(seqShadow) / sizeof(seqShadow[0]));
     
     // 再次等待 AFE 稳定
     CyDelay(100); 
@@ -242,8 +362,7 @@ void AD5941_Initialize(void)
 
     // --- 基础配置 ---
     pAmpCfg->bParaChanged = bTRUE;
-    pAmpCfg->SeqStartAddr = 0;
-    pAmpCfg->MaxSeqLen = 512;
+    pAmpCfg->MaxSeqLen = 128;       // 序列器SRAM中为AMP保留的字数，起始地址由ad5941_seqalloc分配
     pAmpCfg->SeqStartAddrCal = 0;
     pAmpCfg->MaxSeqLenCal = 512;
     
@@ -287,12 +406,32 @@ void AD5941_Initialize(void)
     // 步骤 6: 启动应用
     // ====================================================================
     printf("[INIT] Step 6: Calling AppAMPInit...\r\n");
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceSetTag(TRACE_TAG_APPINIT);
+#endif
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+    // 使用离线生成的序列(ad5941_seqrom.h)，不需要生成缓冲区；
+    // 步骤5的配置须与host/seqrom_gen.c相同，否则返回AD5940ERR_PARA
+    error = AppAMPInit(NULL, 0);
+#else
     error = AppAMPInit(ampBuffer, 512);
+#endif
+#if (AD5940_SPI_TRACE_ENABLE != 0u)
+    AD5940_SPITraceStop();
+    AD5940_SPITraceSetTag(0);
+    DumpSPITrace();
+#endif
     
     if(error == AD5940ERR_OK)
     {
         printf("[OK] AD5941 System Initialized Successfully.\r\n");
         printf("     AMPInited Flag: %d\r\n", pAmpCfg->AMPInited);
+
+        RegCacheStat_Type cacheStat;
+        AD5940_RegCacheGetStat(&cacheStat);
+        printf("     RegCache hit/miss/uncached: %lu/%lu/%lu\r\n",
+               (unsigned long)cacheStat.Hit, (unsigned long)cacheStat.Miss,
+               (unsigned long)cacheStat.Uncached);
     }
     else
     {
@@ -641,6 +780,115 @@ float ReadCurrentFromAD5940(AmperometricSensor_t sensorType)
     return current_nA;
 }
 
+#if (AMP_MUX_ENABLE != 0u)
+/*******************************************************************************
+* Function Name: StartMultiplexedMeasurement
+********************************************************************************
+* Summary:
+*   启动三通道复用安培测量：一个AD5940测量序列依次选通葡萄糖/乳酸/尿酸传感器，
+*   每个通道等待稳定后转换一次，结果按通道顺序进入数据FIFO。
+*   序列由唤醒定时器每AMP_STREAM_PERIOD_S触发一次，连续运行不停止，
+*   FIFO阈值中断后所有样本进入ampStream环形缓冲区，MCU不阻塞。
+*   在AD5941_Initialize()之后调用，沿用步骤5的配置。
+*
+* Return:
+*   AD5940Err: AppAMPInit()或AppAMPCtrl()的错误码
+*******************************************************************************/
+AD5940Err StartMultiplexedMeasurement(void)
+{
+    AD5940Err error;
+    
+    AppAMPGetCfg(&pAmpCfg);
+    AMP1_EN_Write(0);   // 由AD5941 GPIO选择传感器
+    AMP2_EN_Write(0);
+    AMP3_EN_Write(0);
+    
+    pAmpCfg->ChanNum = SENSOR_COUNT;
+    pAmpCfg->ChanGpio[SENSOR_GLUCOSE] = AMP_GPIO_GLUCOSE;
+    pAmpCfg->ChanGpio[SENSOR_LACTATE] = AMP_GPIO_LACTATE;
+    pAmpCfg->ChanGpio[SENSOR_URIC_ACID] = AMP_GPIO_URIC_ACID;
+    pAmpCfg->ChanSettleTime = AMP_CHAN_SETTLE_MS;
+    pAmpCfg->DataFifoSrc = FIFOSRC_SINC2NOTCH; // 每个通道一个数据，按位置区分传感器
+    pAmpCfg->FifoThresh = SENSOR_COUNT;     // 每完成一轮测量中断一次
+    pAmpCfg->AmpODR = AMP_STREAM_PERIOD_S;
+    pAmpCfg->NumOfData = -1;
+    pAmpCfg->bParaChanged = bTRUE;
+    
+#if (AD5940_SEQ_ROM_ENABLE != 0u)
+    error = AppAMPInit(NULL, 0);
+#else
+    error = AppAMPInit((uint32_t *)ampBuffer, 512);
+#endif
+    if(error != AD5940ERR_OK)
+    {
+        return error;
+    }
+    AppAMPStreamInit(&ampStream, ampSampleBuffer, AMP_STREAM_SIZE);
+    return AppAMPCtrl(AMPCTRL_STREAM, &ampStream);
+}
+
+/*******************************************************************************
+* Function Name: ReadMultiplexedCurrents
+********************************************************************************
+* Summary:
+*   读取连续复用测量自上次调用以来的全部样本，按传感器求平均，不等待。
+*   AD5941数据FIFO阈值中断之后先把FIFO中的样本移入ampStream，
+*   没有中断时不访问SPI。丢失样本时输出计数。
+*
+* Parameters:
+*   current_nA: 返回各传感器电流平均值（nA），按AmperometricSensor_t索引
+*
+* Return:
+*   AD5940ERR_OK: 每个传感器都有新样本；AD5940ERR_ERROR: 没有完整的一轮数据
+*******************************************************************************/
+AD5940Err ReadMultiplexedCurrents(float current_nA[SENSOR_COUNT])
+{
+    static uint32_t lastDropped = 0;
+    static uint32_t lastOverflow = 0;
+    AppAMPSample_Type sample[16];
+    int64_t sum[SENSOR_COUNT] = {0};      // pA，整数累加，每个样本不做浮点运算
+    uint32_t num[SENSOR_COUNT] = {0};
+    uint32_t count;
+    uint32_t i;
+    
+    if(AD5940_GetMCUIntFlag() != 0)
+    {
+        AD5940_ClrMCUIntFlag();
+        AppAMPStreamService();
+    }
+    
+    // 样本的Chan由AppAMPStreamService按位置给出，Tick为唤醒定时器时钟数
+    while((count = AppAMPStreamRead(&ampStream, sample, 16)) > 0)
+    {
+        for(i = 0; i < count; i++)
+        {
+            sum[sample[i].Chan] += sample[i].Current;
+            num[sample[i].Chan]++;
+        }
+    }
+    if((ampStream.Dropped != lastDropped) || (ampStream.FifoOverflow != lastOverflow))
+    {
+        lastDropped = ampStream.Dropped;
+        lastOverflow = ampStream.FifoOverflow;
+        printf("[AMP] samples dropped %lu, AFE FIFO overflow %lu\r\n",
+               (unsigned long)lastDropped, (unsigned long)lastOverflow);
+    }
+    
+    for(i = 0; i < SENSOR_COUNT; i++)
+    {
+        if(num[i] == 0)
+        {
+            return AD5940ERR_ERROR;
+        }
+    }
+    for(i = 0; i < SENSOR_COUNT; i++)
+    {
+        current_nA[i] = (float)sum[i] / num[i] * 1e-3f;  // pA -> nA
+    }
+    return AD5940ERR_OK;
+}
+#endif /* AMP_MUX_ENABLE */
+
 /*******************************************************************************
 * Function Name: ReadCurrentFromSourceMeter_Simulated
 ********************************************************************************
@@ -692,36 +940,50 @@ float ReadCurrentFromSourceMeter_Simulated(AmperometricSensor_t sensorType)
 *******************************************************************************/
 void MeasureAllSensorsWithCurrent(void)
 {
+#if (AMP_MUX_ENABLE != 0u)
+    static uint8 muxStarted = 0;
+    float current_nA[SENSOR_COUNT];
+#endif
  
     // 1. 温度测量
     sensorData.temperature = MeasureTemperature();
     
+#if (AMP_MUX_ENABLE != 0u)
+    // 2~4. 三个传感器由AD5940序列连续轮流测量，这里取上次以来所有样本的平均，没有新数据时保留上次的电流
+    if(muxStarted == 0)
+    {
+        muxStarted = (StartMultiplexedMeasurement() == AD5940ERR_OK) ? 1 : 0;
+    }
+    if(ReadMultiplexedCurrents(current_nA) == AD5940ERR_OK)
+    {
+        sensorData.current_glucose_nA = current_nA[SENSOR_GLUCOSE];
+        sensorData.current_lactate_nA = current_nA[SENSOR_LACTATE];
+        sensorData.current_uric_nA = current_nA[SENSOR_URIC_ACID];
+    }
+#else
     // 2. 葡萄糖测量
-
     
-    // 方法 A: 使用 AD5940 读取（推荐）
-   sensorData.current_glucose_nA = ReadCurrentFromAD5940(SENSOR_GLUCOSE);
+    // 方法 A: 使用 AD5940 读取（单通道，阻塞约0.55s）
+    sensorData.current_glucose_nA = ReadCurrentFromAD5940(SENSOR_GLUCOSE);
     
     // 方法 B: 使用模拟值测试（测试用）
     //sensorData.current_glucose_nA = ReadCurrentFromSourceMeter_Simulated(SENSOR_GLUCOSE);
     
-    // 转换为浓度
-    sensorData.glucose = ConvertCurrentToConcentration(sensorData.current_glucose_nA, SENSOR_GLUCOSE);
-    
-    
     // 3. 乳酸测量
-
-     sensorData.current_lactate_nA = ReadCurrentFromAD5940(SENSOR_LACTATE); 
+    sensorData.current_lactate_nA = ReadCurrentFromAD5940(SENSOR_LACTATE); 
     //sensorData.current_lactate_nA = ReadCurrentFromSourceMeter_Simulated(SENSOR_LACTATE);
-    sensorData.lactate = ConvertCurrentToConcentration(sensorData.current_lactate_nA, SENSOR_LACTATE);
     
     // 4. 尿酸测量
-
     sensorData.current_uric_nA = ReadCurrentFromAD5940(SENSOR_URIC_ACID);
     //sensorData.uric_acid = ConvertCurrentToConcentration(sensorData.current_uric_nA,SENSOR_URIC_ACID);
     // [修改] 切换为模拟数据
     // sensorData.current_uric_acid_nA = ReadCurrentFromAD5940(SENSOR_URIC_ACID);
     //sensorData.current_uric_nA = ReadCurrentFromSourceMeter_Simulated(SENSOR_URIC_ACID); 
+#endif
+    
+    // 转换为浓度
+    sensorData.glucose = ConvertCurrentToConcentration(sensorData.current_glucose_nA, SENSOR_GLUCOSE);
+    sensorData.lactate = ConvertCurrentToConcentration(sensorData.current_lactate_nA, SENSOR_LACTATE);
     // [增加] 电流换算到浓度
     sensorData.uric_acid = ConvertCurrentToConcentration(sensorData.current_uric_nA, SENSOR_URIC_ACID);    
 
@@ -1068,7 +1330,12 @@ static void LowPowerImplementation(void)
         bleMode = CyBle_EnterLPM(CYBLE_BLESS_DEEPSLEEP);
         interruptStatus = CyEnterCriticalSection();
         
-        if(bleMode == CYBLE_BLESS_DEEPSLEEP)
+        // 检查标志之后才到的AD5941中断在关中断期间挂起，WFI立即返回
+        if(AD5940_GetMCUIntFlag() != 0)
+        {
+            // 已有AD5941中断待处理，不休眠
+        }
+        else if(bleMode == CYBLE_BLESS_DEEPSLEEP)
         {
             if((CyBle_GetBleSsState() == CYBLE_BLESS_STATE_ECO_ON) || 
                (CyBle_GetBleSsState() == CYBLE_BLESS_STATE_DEEPSLEEP))
@@ -1088,6 +1355,55 @@ static void LowPowerImplementation(void)
     }
 }
 
+#if (AMP_MUX_ENABLE == 0u)
+/*******************************************************************************
+* Function Name: ReadFifoOnInterrupt
+********************************************************************************
+* Summary:
+*   AD5941数据FIFO阈值中断之后读空FIFO，更新诊断显示的计数和第一个数据。
+*   没有中断时不访问SPI，取代每秒轮询FIFOCNTSTA。
+*   复用测量时中断标志和FIFO归ReadMultiplexedCurrents()，不编译该函数。
+*******************************************************************************/
+static void ReadFifoOnInterrupt(void)
+{
+    uint32_t count;
+    uint32_t n;
+    
+    if(AD5940_GetMCUIntFlag() == 0)
+    {
+        return;
+    }
+    AD5940_ClrMCUIntFlag();
+    if(AD5940_WakeUp(10) > 10)  // 读寄存器唤醒AFE，最多10次
+    {
+        return;
+    }
+    AD5940_SleepKeyCtrlS(SLPKEY_LOCK);  // 读FIFO期间禁止AFE进入休眠
+    if(AD5940_INTCTestFlag(AFEINTC_0, AFEINTSRC_DATAFIFOTHRESH) == bFALSE)
+    {
+        AD5940_SleepKeyCtrlS(SLPKEY_UNLOCK);
+        return;
+    }
+    
+    // 先清标志再读计数：读空期间再次越过阈值会重新置位并产生新的边沿，
+    // 否则该次越过被下面的清除吞掉，EXTI是边沿触发，之后不再被唤醒
+    AD5940_INTCClrFlag(AFEINTSRC_DATAFIFOTHRESH);
+    count = AD5940_FIFOGetCnt();
+    g_test_fifo_count = (uint16_t)count;
+    while(count > 0)
+    {
+        n = (count > 64u) ? 64u : count;
+        AD5940_FIFORd(g_fifo_buffer, n);
+        if(count == g_test_fifo_count)
+        {
+            g_fifo_first_data = g_fifo_buffer[0];
+        }
+        count -= n;
+    }
+    AD5940_SleepKeyCtrlS(SLPKEY_UNLOCK);
+}
+#endif /* AMP_MUX_ENABLE == 0u */
+
 void AD5941_HardReset(void)
 {
     AD5940_RST_Write(0);
@@ -1179,21 +1495,11 @@ int main()
                     break;
                     
                 case INIT_WRITE_REGS:
-                    // ✅ 每次循环只写1个寄存器
-                    if(g_reg_index < REG_TABLE_SIZE)
-                    {
-                        AD5940_WriteReg(g_RegTable[g_reg_index].reg_addr, 
-                                       g_RegTable[g_reg_index].reg_data);
-                        
-                        printf("[INIT] Wrote reg %d/%d\n", g_reg_index+1, REG_TABLE_SIZE);
-                        
-                        g_reg_index++;
-                    }
-                    else
-                    {
-                        printf("[INIT] All registers written\n");
-                        g_init_state = INIT_VERIFY_REG;  // ← 改为验证寄存器
-                    }
+                    // 整张寄存器表编码到一个缓冲区批量写入
+                    AD5940_WriteRegBatch(g_RegTable, REG_TABLE_SIZE);
+                    g_reg_index = REG_TABLE_SIZE;
+                    printf("[INIT] All %d registers written\n", REG_TABLE_SIZE);
+                    g_init_state = INIT_VERIFY_REG;  // ← 改为验证寄存器
                     break;
                 
                 // ✅ 新增：验证寄存器写入
@@ -1344,6 +1650,8 @@ int main()
                     // FIFO Setup
                     AD5940_WriteReg(0x2008, 0x0000020D); 
                     AD5940_WriteReg(0x21E0, (2 << 16)); 
+                    AD5940_MCUIntStart();   // 状态机不经过AD5941_Initialize()，在这里安装中断服务
+                    AD5941_IntCfg();    // FIFO达到阈值时经GP0中断MCU
 
                     // ========================================================
                     // 步骤 2: 启动 AFE (死循环检查)
@@ -1416,25 +1724,20 @@ int main()
             }
         }
         
+#if (AMP_MUX_ENABLE == 0u)
+        // ✅ AD5941数据FIFO达到阈值后才读取（AD5940_EXTI中断置标志）
+        // 复用测量时由ReadMultiplexedCurrents()处理中断和FIFO
+        if(g_init_state == INIT_COMPLETE)
+        {
+            ReadFifoOnInterrupt();
+        }
+#endif
+        
         // ✅ 发送状态到手机（详细版本）
         if(measurementFlag)
         {
             measurementFlag = 0;
             
-            // ⚠️ 新增：实时读取FIFO计数
-            if(g_init_state == INIT_COMPLETE)
-            {
-                uint32_t fifosta_now = AD5940_ReadReg(REG_AFE_FIFOCNTSTA);
-                g_test_fifo_count = (fifosta_now >> 16) & 0x7FF; // 计数在 [26:16]
-                
-                // 如果有数据，读取并转换
-                if(g_test_fifo_count > 0)
-                {
-                    g_fifo_first_data = AD5940_ReadReg(0x206C); // REG_AFE_DATAFIFORD
-                }
-            }
-            
-            
             if(CyBle_GetState() == CYBLE_STATE_CONNECTED)
             {
                 CYBLE_GATTS_HANDLE_VALUE_NTF_T notificationHandle;
@@ -1566,6 +1869,9 @@ int main()
         {
             apiResult = CyBle_StoreBondingData(0u);
         }
+        
+        // ✅ 没有BLE事件和AD5941中断要处理时休眠
+        LowPowerImplementation();
     }
 }
 